@@ -565,6 +565,114 @@ int kpa_get_powerstat(AMP *amp, powerstat_t *status)
     return RIG_OK;
 }
 
+/*
+ * The KPA has no single status command, so all the queries go out in
+ * one write and the replies are matched by prefix as they come back.
+ * That is one round trip per status instead of one per level.
+ */
+int kpa_get_status(AMP *amp, struct amp_status *status)
+{
+    static const char *cmd = "^ON;^OP;^FR;^PWI;^PWF;^PWR;^PWK;^SW;^SF;";
+    struct amp_state *rs = &amp->state;
+    char responsebuf[KPABUFSZ];
+    int retval;
+    int n;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
+
+    retval = kpa_transaction(amp, cmd, responsebuf, sizeof(responsebuf));
+
+    if (retval != RIG_OK) { return retval; }
+
+    for (n = 0; ; ++n)
+    {
+        int int_value;
+        unsigned long tfreq;
+
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: response='%s'\n", __func__, responsebuf);
+
+        if (sscanf(responsebuf, "^ON%d", &int_value) == 1)
+        {
+            status->has_powerstat = 1;
+            status->powerstat = int_value ? RIG_POWER_ON : RIG_POWER_OFF;
+
+            /* nothing else answers while the amp is off */
+            if (!int_value) { return RIG_OK; }
+        }
+        else if (sscanf(responsebuf, "^OP%d", &int_value) == 1)
+        {
+            status->powerstat = int_value ? RIG_POWER_OPERATE : RIG_POWER_STANDBY;
+        }
+        else if (sscanf(responsebuf, "^FR%lu", &tfreq) == 1)
+        {
+            status->has_freq = 1;
+            status->freq = tfreq * 1000;
+        }
+        else if (sscanf(responsebuf, "^PWI%d", &int_value) == 1)
+        {
+            status->levels |= AMP_LEVEL_PWR_INPUT;
+            status->level[rig_setting2idx(AMP_LEVEL_PWR_INPUT)].i = int_value;
+        }
+        else if (sscanf(responsebuf, "^PWF%d", &int_value) == 1)
+        {
+            status->levels |= AMP_LEVEL_PWR_FWD;
+            status->level[rig_setting2idx(AMP_LEVEL_PWR_FWD)].i = int_value;
+        }
+        else if (sscanf(responsebuf, "^PWR%d", &int_value) == 1)
+        {
+            status->levels |= AMP_LEVEL_PWR_REFLECTED;
+            status->level[rig_setting2idx(AMP_LEVEL_PWR_REFLECTED)].i = int_value;
+        }
+        else if (sscanf(responsebuf, "^PWK%d", &int_value) == 1)
+        {
+            status->levels |= AMP_LEVEL_PWR_PEAK;
+            status->level[rig_setting2idx(AMP_LEVEL_PWR_PEAK)].i = int_value;
+        }
+        else if (sscanf(responsebuf, "^SW%d", &int_value) == 1)
+        {
+            status->levels |= AMP_LEVEL_SWR;
+            status->level[rig_setting2idx(AMP_LEVEL_SWR)].f = int_value / 10.0f;
+        }
+        else if (sscanf(responsebuf, "^SF%x", &int_value) == 1)
+        {
+            int i;
+
+            SNPRINTF(status->fault, sizeof(status->fault), "Unknown fault code=0x%02x",
+                     int_value);
+
+            for (i = 0; kpa_fault_list[i].errmsg != NULL; ++i)
+            {
+                if (kpa_fault_list[i].code == int_value)
+                {
+                    SNPRINTF(status->fault, sizeof(status->fault), "%s",
+                             kpa_fault_list[i].errmsg);
+                    break;
+                }
+            }
+
+            status->levels |= AMP_LEVEL_FAULT;
+            status->level[rig_setting2idx(AMP_LEVEL_FAULT)].s = status->fault;
+
+            /* ^SF is the last reply */
+            return RIG_OK;
+        }
+        else
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: unexpected response='%s'\n", __func__,
+                      responsebuf);
+        }
+
+        if (n >= 9) { break; }
+
+        retval = read_string(&rs->ampport, (unsigned char *) responsebuf,
+                             sizeof(responsebuf), ";", 1, 0, 1);
+
+        if (retval < 0) { return retval; }
+    }
+
+    return status->has_powerstat ? RIG_OK : -RIG_EPROTO;
+}
+
 int kpa_set_powerstat(AMP *amp, powerstat_t status)
 {
     int retval;
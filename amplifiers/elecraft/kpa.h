@@ -56,6 +56,7 @@ int kpa_set_freq(AMP *amp, freq_t freq);
 
 int kpa_get_level(AMP *amp, setting_t level, value_t *val);
 int kpa_get_powerstat(AMP *amp, powerstat_t *status);
+int kpa_get_status(AMP *amp, struct amp_status *status);
 int kpa_set_powerstat(AMP *amp, powerstat_t status);
 
 #endif  /* _AMP_ELECRAFT_H */
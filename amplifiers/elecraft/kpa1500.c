@@ -60,7 +60,7 @@ const struct amp_caps kpa1500_amp_caps =
     AMP_MODEL(AMP_MODEL_ELECRAFT_KPA1500),
     .model_name =   "KPA1500",
     .mfg_name =     "Elecraft",
-    .version =      "20220710.0",
+    .version =      "20261018.0",
     .copyright =    "LGPL",
     .status =     RIG_STATUS_ALPHA,
     .amp_type =     AMP_TYPE_OTHER,
@@ -88,6 +88,7 @@ const struct amp_caps kpa1500_amp_caps =
     .set_freq = kpa_set_freq,
     .get_freq = kpa_get_freq,
     .get_level = kpa_get_level,
+    .get_status = kpa_get_status,
 };
 
 
@@ -175,7 +175,14 @@ int expert_transaction(AMP *amp, const unsigned char *cmd, int cmd_len,
         if (len == 4) { bytes = response[3]; }
 
         rig_debug(RIG_DEBUG_ERR, "%s: bytes=%d\n", __func__, bytes);
-        len = read_block_direct(&rs->ampport, (unsigned  char *) response, bytes - 3);
+
+        if (bytes >= response_len) { bytes = response_len - 1; }
+
+        len = read_block_direct(&rs->ampport, (unsigned  char *) response, bytes);
+
+        if (len < 0) { return len; }
+
+        response[len] = 0;
         dump_hex(response, len);
     }
     else   // if no response expected try to get one
@@ -591,6 +598,83 @@ int expert_get_powerstat(AMP *amp, powerstat_t *status)
     return RIG_OK;
 }
 
+/*
+ * Band codes of the status frame, lowest edge of each band
+ */
+static const freq_t expert_band_freq[] =
+{
+    MHz(1.8), MHz(3.5), MHz(5.3), MHz(7), MHz(10.1), MHz(14),
+    MHz(18.068), MHz(21), MHz(24.89), MHz(28), MHz(50), MHz(70)
+};
+
+/*
+ * Command 0x90 returns one comma separated frame with everything the
+ * amplifier reports:
+ * ID,O/S,R/T,bank,input,band,TX ant,RX ant,L/M/H,watts,SWR ATU,SWR ANT,
+ * V PA,I PA,temp upper,temp lower,temp combiner,warning,alarm
+ */
+int expert_get_status(AMP *amp, struct amp_status *status)
+{
+    unsigned char cmd = 0x90;
+    unsigned char responsebuf[KPABUFSZ];
+    char id[8], operate, txrx, powerlevel, warning, alarm;
+    int band, watts, nargs, retval;
+    float swr_atu, swr_ant;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
+
+    retval = expert_transaction(amp, &cmd, 1, responsebuf, sizeof(responsebuf));
+
+    if (retval != RIG_OK) { return retval; }
+
+    nargs = sscanf((char *) responsebuf,
+                   ",%7[^,],%c,%c,%*c,%*d,%d,%*[^,],%*[^,],%c,%d,%f,%f,"
+                   "%*f,%*f,%*d,%*d,%*d,%c,%c",
+                   id, &operate, &txrx, &band, &powerlevel, &watts, &swr_atu, &swr_ant,
+                   &warning, &alarm);
+
+    if (nargs != 10)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: invalid status frame '%s'\n", __func__,
+                  responsebuf);
+        return -RIG_EPROTO;
+    }
+
+    status->has_powerstat = 1;
+    status->powerstat = operate == 'O' ? RIG_POWER_OPERATE : RIG_POWER_STANDBY;
+
+    if (band >= 0 && band < sizeof(expert_band_freq) / sizeof(expert_band_freq[0]))
+    {
+        status->has_freq = 1;
+        status->freq = expert_band_freq[band];
+    }
+
+    status->levels = AMP_LEVEL_PWR | AMP_LEVEL_PWR_FWD | AMP_LEVEL_SWR
+                     | AMP_LEVEL_FAULT;
+    status->level[rig_setting2idx(AMP_LEVEL_PWR)].f =
+        powerlevel == 'L' ? .33f : powerlevel == 'M' ? .67f : 1.0f;
+    status->level[rig_setting2idx(AMP_LEVEL_PWR_FWD)].i = watts;
+    status->level[rig_setting2idx(AMP_LEVEL_SWR)].f = swr_ant;
+
+    if (alarm != 'N')
+    {
+        SNPRINTF(status->fault, sizeof(status->fault), "Alarm %c", alarm);
+    }
+    else if (warning != 'N')
+    {
+        SNPRINTF(status->fault, sizeof(status->fault), "Warning %c", warning);
+    }
+    else
+    {
+        SNPRINTF(status->fault, sizeof(status->fault), "%s",
+                 expert_fault_list[0].errmsg);
+    }
+
+    status->level[rig_setting2idx(AMP_LEVEL_FAULT)].s = status->fault;
+
+    return RIG_OK;
+}
+
 int expert_set_powerstat(AMP *amp, powerstat_t status)
 {
     int retval;
@@ -674,7 +758,7 @@ const struct amp_caps expert_amp_caps =
     AMP_MODEL(AMP_MODEL_EXPERT_FA),
     .model_name =   "1.3K-FA/1.5K-FA/2K-FA",
     .mfg_name =     "Expert",
-    .version =      "20230328.0",
+    .version =      "20261018.0",
     .copyright =    "LGPL",
     .status =     RIG_STATUS_ALPHA,
     .amp_type =     AMP_TYPE_OTHER,
@@ -689,7 +773,7 @@ const struct amp_caps expert_amp_caps =
     .post_write_delay = 0,
     .timeout =      2000,
     .retry =      2,
-    .has_get_level = AMP_LEVEL_SWR | AMP_LEVEL_NH | AMP_LEVEL_PF | AMP_LEVEL_PWR_INPUT | AMP_LEVEL_PWR_FWD | AMP_LEVEL_PWR_REFLECTED | AMP_LEVEL_FAULT,
+    .has_get_level = AMP_LEVEL_SWR | AMP_LEVEL_NH | AMP_LEVEL_PF | AMP_LEVEL_PWR_INPUT | AMP_LEVEL_PWR_FWD | AMP_LEVEL_PWR_REFLECTED | AMP_LEVEL_FAULT | AMP_LEVEL_PWR,
     .has_set_level = 0,
 
     .amp_open = expert_open,
@@ -702,6 +786,7 @@ const struct amp_caps expert_amp_caps =
     .set_freq = expert_set_freq,
     .get_freq = expert_get_freq,
     .get_level = expert_get_level,
+    .get_status = expert_get_status,
 };
 
 
@@ -56,6 +56,7 @@ int expert_set_freq(AMP *amp, freq_t freq);
 
 int expert_get_level(AMP *amp, setting_t level, value_t *val);
 int expert_get_powerstat(AMP *amp, powerstat_t *status);
+int expert_get_status(AMP *amp, struct amp_status *status);
 int expert_set_powerstat(AMP *amp, powerstat_t status);
 
 #endif  /* _AMP_EXPERT_H */
@@ -60,7 +60,7 @@ const struct amp_caps gemini_amp_caps =
     AMP_MODEL(AMP_MODEL_GEMINI_DX1200),
     .model_name =   "DX1200/HF-1K",
     .mfg_name =     "Gemini",
-    .version =      "20230318.0",
+    .version =      "20261018.0",
     .copyright =    "LGPL",
     .status =     RIG_STATUS_BETA,
     .amp_type =     AMP_TYPE_OTHER,
@@ -82,6 +82,7 @@ const struct amp_caps gemini_amp_caps =
     .get_freq = gemini_get_freq,
     .set_freq = gemini_set_freq,
     .get_level = gemini_get_level,
+    .get_status = gemini_get_status,
     .set_level = gemini_set_level,
 };
 
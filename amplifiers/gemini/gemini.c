@@ -150,35 +150,47 @@ int gemini_status_parse(AMP *amp)
     if (retval != RIG_OK)
     {
         rig_debug(RIG_DEBUG_ERR, "%s: error sending command 'S'\n", __func__);
+        return retval;
     }
 
-    p = strtok(responsebuf, ",\n");
     rig_debug(RIG_DEBUG_VERBOSE, "%s: responsebuf=%s\n", __func__, responsebuf);
 
-    while (p)
+    for (p = strtok(responsebuf, ",\n"); p; p = strtok(NULL, ",\n"))
     {
-        char tmp[8];
+        char tmp[8] = "";
         double freq;
-        n += sscanf(p, "BAND=%lf%7s", &freq, tmp);
+        int items = 0;
 
-        if (tmp[0] == 'K') { priv->band = freq * 1000; }
+        if (sscanf(p, "BAND=%lf%7s", &freq, tmp) == 2)
+        {
+            if (tmp[0] == 'K') { priv->band = freq * 1000; }
+
+            if (tmp[0] == 'M') { priv->band = freq * 1000000; }
 
-        if (tmp[0] == 'M') { priv->band = freq * 1000000; }
+            items++;
+        }
 
-        n += sscanf(p, "ANTENNA=%c", &priv->antenna);
-        n += sscanf(p, "POWER=%dW%d", &priv->power_current, &priv->power_peak);
-        n += sscanf(p, "VSWR=%lf", &priv->vswr);
-        n += sscanf(p, "CURRENT=%d", &priv->current);
-        n += sscanf(p, "TEMPERATURE=%d", &priv->temperature);
-        n += sscanf(p, "STATE=%7s", priv->state);
-        n += sscanf(p, "PTT=%7s", tmp);
-        priv->ptt = tmp[0] == 'T';
-        n += sscanf(p, "TRIP=%7s", priv->trip);
+        items += sscanf(p, "ANTENNA=%c", &priv->antenna);
+        items += sscanf(p, "POWER=%dW%d", &priv->power_current, &priv->power_peak);
+        items += sscanf(p, "VSWR=%lf", &priv->vswr);
+        items += sscanf(p, "CURRENT=%d", &priv->current);
+        items += sscanf(p, "TEMPERATURE=%d", &priv->temperature);
+        items += sscanf(p, "STATE=%4s", priv->state);
 
-        if (n == 0)
+        if (sscanf(p, "PTT=%7s", tmp) == 1)
+        {
+            priv->ptt = tmp[0] == 'T';
+            items++;
+        }
+
+        items += sscanf(p, "TRIP=%255s", priv->trip);
+
+        if (items == 0)
         {
             rig_debug(RIG_DEBUG_ERR, "%s: unknown status item=%s\n", __func__, p);
         }
+
+        n += items;
     }
 
     if (n == 0) { return -RIG_EPROTO; }
@@ -186,6 +198,31 @@ int gemini_status_parse(AMP *amp)
     return RIG_OK;
 }
 
+/*
+ * The 'S' response has everything get_level and get_freq can report
+ */
+int gemini_get_status(AMP *amp, struct amp_status *status)
+{
+    int retval;
+    struct gemini_priv_data *priv = amp->state.priv;
+
+    retval = gemini_status_parse(amp);
+
+    if (retval != RIG_OK) { return retval; }
+
+    status->has_freq = 1;
+    status->freq = priv->band;
+    status->levels = AMP_LEVEL_SWR | AMP_LEVEL_PWR_FWD | AMP_LEVEL_PWR_PEAK
+                     | AMP_LEVEL_FAULT;
+    status->level[rig_setting2idx(AMP_LEVEL_SWR)].f = priv->vswr;
+    status->level[rig_setting2idx(AMP_LEVEL_PWR_FWD)].i = priv->power_peak;
+    status->level[rig_setting2idx(AMP_LEVEL_PWR_PEAK)].i = priv->power_peak;
+    SNPRINTF(status->fault, sizeof(status->fault), "%.63s", priv->trip);
+    status->level[rig_setting2idx(AMP_LEVEL_FAULT)].s = status->fault;
+
+    return RIG_OK;
+}
+
 int gemini_get_freq(AMP *amp, freq_t *freq)
 {
     int retval;
@@ -66,6 +66,7 @@ int gemini_set_freq(AMP *amp, freq_t freq);
 int gemini_get_level(AMP *amp, setting_t level, value_t *val);
 int gemini_set_level(AMP *amp, setting_t level, value_t val);
 int gemini_get_powerstat(AMP *amp, powerstat_t *status);
+int gemini_get_status(AMP *amp, struct amp_status *status);
 int gemini_set_powerstat(AMP *amp, powerstat_t status);
 
 #endif  /* _AMP_GEMINI_H */
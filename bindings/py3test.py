@@ -1,6 +1,8 @@
 #!/usr/bin/env python3
 # -*- coding: utf-8 -*-
 import sys
+import threading
+import time
 # Change this path to match your "make install" path
 sys.path.append('/usr/local/lib/python3.10/site-packages')
 
@@ -77,6 +79,31 @@ def StartUp():
     print("status:\t\t\t%s" % my_rig.error_status)
     print("status(str):\t\t%s" % Hamlib.rigerror(my_rig.error_status))
 
+    (freq, mode, af) = my_rig.get_many(("freq", "mode", "AF"))
+
+    print("get_many:\t\tfreq = %s, mode = %s, AF = %0.2f" \
+          % (freq, Hamlib.rig_strrmode(mode), af))
+
+    # The GIL is released while the rig is busy, another thread keeps going
+    stalls = []
+    done = threading.Event()
+
+    def ticker():
+        while not done.is_set():
+            t0 = time.perf_counter()
+            time.sleep(0.001)
+            stalls.append(time.perf_counter() - t0)
+
+    t = threading.Thread(target=ticker)
+    t.start()
+    for i in range(10):
+        my_rig.set_freq(Hamlib.RIG_VFO_A, 145550000 + i)
+    done.set()
+    t.join()
+
+    print("threads:\t\t%d ticks, longest %0.1f ms" \
+          % (len(stalls), max(stalls) * 1000))
+
     chan = Hamlib.channel(Hamlib.RIG_VFO_B)
     my_rig.get_channel(chan,1)
 
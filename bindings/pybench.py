@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""Throughput and latency of the Python bindings under concurrent threads.
+
+    pybench.py [-m model] [-r rig_pathname] [-t threads] [-d seconds]
+
+Each worker thread has its own Rig and polls get_freq() while a ticker
+thread sleeps 1 ms at a time and records how late it wakes up.  With the
+GIL held across the rig I/O the ticker stalls for whole transactions; with
+the GIL released it keeps ticking.  Run it against the old and the new
+module to compare.  The last line compares get_many() to separate calls.
+"""
+
+import argparse
+import threading
+import time
+
+import Hamlib
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def worker(args, stop, results):
+    rig = Hamlib.Rig(args.model)
+    if args.rig_file:
+        rig.set_conf("rig_pathname", args.rig_file)
+    rig.open()
+    lat = []
+    while not stop.is_set():
+        t0 = time.perf_counter()
+        rig.get_freq()
+        lat.append(time.perf_counter() - t0)
+    rig.close()
+    results.append(lat)
+
+
+def ticker(stop, stalls):
+    while not stop.is_set():
+        t0 = time.perf_counter()
+        time.sleep(0.001)
+        stalls.append(time.perf_counter() - t0 - 0.001)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("-m", "--model", type=int, default=Hamlib.RIG_MODEL_DUMMY)
+    parser.add_argument("-r", "--rig-file", default=None)
+    parser.add_argument("-t", "--threads", type=int, default=4)
+    parser.add_argument("-d", "--duration", type=float, default=5.0)
+    args = parser.parse_args()
+
+    Hamlib.rig_set_debug(Hamlib.RIG_DEBUG_NONE)
+
+    stop = threading.Event()
+    results, stalls = [], []
+    threads = [threading.Thread(target=worker, args=(args, stop, results))
+               for _ in range(args.threads)]
+    threads.append(threading.Thread(target=ticker, args=(stop, stalls)))
+
+    for t in threads:
+        t.start()
+    time.sleep(args.duration)
+    stop.set()
+    for t in threads:
+        t.join()
+
+    lat = [x for r in results for x in r]
+    print("%d thread(s): %.0f calls/s, latency p50 %.3f ms p99 %.3f ms"
+          % (args.threads, len(lat) / args.duration,
+             percentile(lat, 50) * 1e3, percentile(lat, 99) * 1e3))
+    print("ticker: %d ticks, stall p50 %.3f ms p99 %.3f ms max %.3f ms"
+          % (len(stalls), percentile(stalls, 50) * 1e3,
+             percentile(stalls, 99) * 1e3, max(stalls or [0]) * 1e3))
+
+    rig = Hamlib.Rig(args.model)
+    if args.rig_file:
+        rig.set_conf("rig_pathname", args.rig_file)
+    rig.open()
+    if hasattr(rig, "get_many"):
+        n = 200
+        t0 = time.perf_counter()
+        for _ in range(n):
+            rig.get_freq()
+            rig.get_mode()
+            rig.get_ptt()
+        separate = time.perf_counter() - t0
+        t0 = time.perf_counter()
+        for _ in range(n):
+            rig.get_many(("freq", "mode", "width", "ptt"))
+        batched = time.perf_counter() - t0
+        print("freq+mode+ptt: separate %.3f ms, get_many %.3f ms"
+              % (separate / n * 1e3, batched / n * 1e3))
+    rig.close()
+
+
+if __name__ == '__main__':
+    main()
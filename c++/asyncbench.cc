@@ -0,0 +1,177 @@
+/*
+ * Hamlib C++ asynchronous API benchmark
+ *
+ * Compares the throughput of AsyncRig to the synchronous Rig wrapper.
+ *
+ *   asyncbench [model [rig_pathname [count]]]
+ *
+ * Defaults to the dummy rig, which has no I/O latency and so shows the
+ * overhead of the queue.  Against a real or simulated rig the interesting
+ * numbers are the pipelined and batched ones.
+ */
+
+#include <hamlib/rig.h>
+#include <hamlib/rigasync.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#if __cplusplus >= 201703L
+
+#include <atomic>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double rate(int ops, bench_clock::time_point t0)
+{
+	std::chrono::duration<double> dt = bench_clock::now() - t0;
+	return dt.count() > 0 ? ops / dt.count() : 0;
+}
+
+static void report(const char *name, int ops, double r, double sync_r)
+{
+	printf("%-22s %8d ops %12.0f ops/s %7.2fx\n", name, ops, r,
+	       sync_r > 0 ? r / sync_r : 0);
+}
+
+#ifdef HAMLIB_CPP_COROUTINES
+struct bench_task {
+	struct promise_type {
+		bench_task get_return_object() { return {}; }
+		std::suspend_never initial_suspend() { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+static bench_task co_loop(AsyncRig &arig, int n, freq_t want, int &bad,
+			  std::promise<void> &finished)
+{
+	for (int i = 0; i < n; i++) {
+		freq_t f = co_await arig.await(RigOp::GetFreq {});
+		if (f != want)
+			bad++;
+	}
+	finished.set_value();
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+	rig_model_t model = argc > 1 ? atoi(argv[1]) : RIG_MODEL_DUMMY;
+	int n = argc > 3 ? atoi(argv[3]) : 2000;
+	freq_t want = MHz(14.074);
+	int bad = 0;
+
+	rig_set_debug(RIG_DEBUG_NONE);
+
+	try {
+		Rig rig(model);
+
+		if (argc > 2)
+			rig.setConf("rig_pathname", argv[2]);
+		rig.open();
+		rig.setFreq(want);
+
+		bench_clock::time_point t0 = bench_clock::now();
+		for (int i = 0; i < n; i++)
+			if (rig.getFreq() != want)
+				bad++;
+		double sync_r = rate(n, t0);
+		report("sync getFreq", n, sync_r, sync_r);
+
+		t0 = bench_clock::now();
+		for (int i = 0; i < n / 3; i++) {
+			pbwidth_t width;
+			rig.getFreq();
+			rig.getMode(width);
+			rig.getVFO();
+		}
+		double sync3_r = rate(n / 3 * 3, t0);
+		report("sync freq+mode+vfo", n / 3 * 3, sync3_r, sync3_r);
+
+		AsyncRig arig(rig);
+
+		t0 = bench_clock::now();
+		for (int i = 0; i < n; i++)
+			if (arig.getFreq().get() != want)
+				bad++;
+		report("future round trip", n, rate(n, t0), sync_r);
+
+		{
+			std::vector<std::future<freq_t>> fs;
+			fs.reserve(n);
+			t0 = bench_clock::now();
+			for (int i = 0; i < n; i++)
+				fs.push_back(arig.getFreq());
+			for (auto &f : fs)
+				if (f.get() != want)
+					bad++;
+			report("future pipelined", n, rate(n, t0), sync_r);
+		}
+
+		{
+			std::atomic<int> left(n);
+			std::promise<void> finished;
+			t0 = bench_clock::now();
+			for (int i = 0; i < n; i++)
+				arig.post(RigOp::GetFreq {}, [&](RigResult<freq_t> &&r) {
+					if (!r.ok() || r.take() != want)
+						bad++;
+					if (--left == 0)
+						finished.set_value();
+				});
+			finished.get_future().wait();
+			report("post pipelined", n, rate(n, t0), sync_r);
+		}
+
+		{
+			std::vector<std::future<std::tuple<freq_t, RigOp::Mode, vfo_t>>> fs;
+			fs.reserve(n / 3);
+			t0 = bench_clock::now();
+			for (int i = 0; i < n / 3; i++)
+				fs.push_back(arig.batch(RigOp::GetFreq {}, RigOp::GetMode {},
+							RigOp::GetVFO {}));
+			for (auto &f : fs)
+				if (std::get<0>(f.get()) != want)
+					bad++;
+			report("batch freq+mode+vfo", n / 3 * 3, rate(n / 3 * 3, t0), sync3_r);
+		}
+
+#ifdef HAMLIB_CPP_COROUTINES
+		{
+			std::promise<void> finished;
+			t0 = bench_clock::now();
+			co_loop(arig, n, want, bad, finished);
+			finished.get_future().wait();
+			report("co_await", n, rate(n, t0), sync_r);
+		}
+#endif
+
+		rig.close();
+	}
+	catch (const RigException &Ex) {
+		Ex.print();
+		return 1;
+	}
+
+	if (bad) {
+		fprintf(stderr, "%d wrong result(s)\n", bad);
+		return 1;
+	}
+
+	return 0;
+}
+
+#else
+
+int main()
+{
+	std::cout << "asyncbench needs C++17" << std::endl;
+	return 0;
+}
+
+#endif
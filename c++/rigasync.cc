@@ -0,0 +1,127 @@
+/**
+ * \file src/rigasync.cc
+ * \brief Ham Radio Control Libraries C++ asynchronous interface
+ *
+ * AsyncRig runs Rig operations on a worker thread.
+ */
+
+/*
+ *  Hamlib C++ bindings - asynchronous API
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <hamlib/config.h>
+
+#include <hamlib/rig.h>
+#include <hamlib/rigasync.h>
+
+#if __cplusplus >= 201703L
+
+AsyncRig::AsyncRig(Rig &rig, unsigned nslots)
+	: theRig(rig), head(nullptr), tail(nullptr), stopping(false), done(0),
+	  slots(nslots)
+{
+	free_slots.reserve(nslots);
+	for (unsigned i = 0; i < nslots; i++)
+		free_slots.push_back(slots[i].mem);
+
+	worker = std::thread(&AsyncRig::run, this);
+}
+
+AsyncRig::~AsyncRig()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	cond.notify_one();
+	worker.join();
+}
+
+unsigned long AsyncRig::completed() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return done;
+}
+
+void AsyncRig::enqueue(Task *t)
+{
+	bool was_empty;
+
+	t->next = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		was_empty = head == nullptr;
+		if (tail)
+			tail->next = t;
+		else
+			head = t;
+		tail = t;
+	}
+	if (was_empty)
+		cond.notify_one();
+}
+
+void *AsyncRig::slot_get()
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (free_slots.empty())
+		return nullptr;
+
+	void *mem = free_slots.back();
+	free_slots.pop_back();
+	return mem;
+}
+
+void AsyncRig::slot_put(void *mem)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	free_slots.push_back(mem);
+}
+
+void AsyncRig::run()
+{
+	std::unique_lock<std::mutex> guard(lock);
+
+	for (;;) {
+		while (!head && !stopping)
+			cond.wait(guard);
+
+		if (!head)
+			break;
+
+		/* take the whole queue, one wakeup for a burst of requests */
+		Task *t = head;
+		head = tail = nullptr;
+		guard.unlock();
+
+		unsigned long n = 0;
+		while (t) {
+			Task *next = t->next;
+			t->complete(theRig);	/* t is gone after this */
+			t = next;
+			n++;
+		}
+
+		guard.lock();
+		done += n;
+	}
+}
+
+#endif /* __cplusplus >= 201703L */
@@ -158,6 +158,28 @@ enum amp_level_e
 #define AMP_LEVEL_IS_STRING(l) ((l)&AMP_LEVEL_STRING_LIST)
 //! @endcond
 
+/**
+ * \brief Amplifier status read with one query.
+ *
+ * \struct amp_status
+ *
+ * Filled in by amp_caps#get_status() from the amplifier's status frame, so
+ * amp_get_level(), amp_get_powerstat() and amp_get_freq() can all be
+ * answered by one transaction, see the "cache_timeout" and "status_refresh"
+ * configuration parameters.  Only the fields the backend marks as present
+ * are used, the others are queried the usual way.
+ */
+struct amp_status
+{
+  setting_t levels;                 /*!< AMP_LEVEL_... values present in level[]. */
+  value_t level[RIG_SETTING_MAX];   /*!< Level values, indexed by rig_setting2idx(). */
+  int has_powerstat;                /*!< powerstat is present. */
+  powerstat_t powerstat;            /*!< Power or standby status. */
+  int has_freq;                     /*!< freq is present. */
+  freq_t freq;                      /*!< Frequency or band the amplifier is set to. */
+  char fault[64];                   /*!< Text of AMP_LEVEL_FAULT, level[] points here. */
+};
+
 /* Basic amp type, can store some useful info about different amplifiers. Each
  * lib must be able to populate this structure, so we can make useful
  * enquiries about capabilities.
@@ -261,6 +283,8 @@ struct amp_caps
   const struct confparams *extparms;          /*!< Extension parameters list.  \sa extamp.c */
 
   const char *macro_name;                     /*!< Amplifier model macro name. */
+
+  int (*get_status)(AMP *amp, struct amp_status *status); /*!< Pointer to backend function reading the whole status, see amp_get_status(). */
 };
 
 
@@ -296,6 +320,10 @@ struct amp_state
   gran_t level_gran[RIG_SETTING_MAX]; /*!< Level granularity. */
   gran_t parm_gran[RIG_SETTING_MAX];  /*!< Parameter granularity. */
   hamlib_port_t ampport;  /*!< Amplifier port (internal use). */
+
+  int cache_timeout;      /*!< ms a status read by amp_caps#get_status() answers queries, 0 reads it every time. */
+  int status_refresh;     /*!< ms between status reads by a background thread, 0 for none. */
+  rig_ptr_t status_cache_priv; /*!< Status cache (internal use). */
 };
 
 
@@ -373,6 +401,15 @@ amp_get_level HAMLIB_PARAMS((AMP *amp, setting_t level, value_t *val));
 extern HAMLIB_EXPORT(int)
 amp_set_level HAMLIB_PARAMS((AMP *amp, setting_t level, value_t val));
 
+extern HAMLIB_EXPORT(int)
+amp_get_status HAMLIB_PARAMS((AMP *amp, struct amp_status *status));
+
+extern HAMLIB_EXPORT(int)
+amp_get_status_cache_stats HAMLIB_PARAMS((AMP *amp,
+                                          unsigned long *hits,
+                                          unsigned long *reads,
+                                          unsigned long *refreshes));
+
 
 extern HAMLIB_EXPORT(int)
 amp_register HAMLIB_PARAMS((const struct amp_caps *caps));
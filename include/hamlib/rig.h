@@ -192,6 +192,7 @@ enum rig_errcode_e {
     RIG_EDEPRECATED,/*!< 18 Function deprecated */
     RIG_ESECURITY,  /*!< 19 Security error */
     RIG_EPOWER,     /*!< 20 Rig not powered on */
+    RIG_ECANCELED,  /*!< 21 Queued operation cancelled, see rig_async_cancel() */
     RIG_EEND        // MUST BE LAST ITEM IN LAST
 };
 /**
@@ -206,7 +207,7 @@ enum rig_errcode_e {
 #define RIG_IS_SOFT_ERRCODE(errcode) (errcode == RIG_EINVAL || errcode == RIG_ENIMPL || errcode == RIG_ERJCTED \
     || errcode == RIG_ETRUNC || errcode == RIG_ENAVAIL || errcode == RIG_ENTARGET \
     || errcode == RIG_EVFO || errcode == RIG_EDOM || errcode == RIG_EDEPRECATED \
-    || errcode == RIG_ESECURITY || errcode == RIG_EPOWER)
+    || errcode == RIG_ESECURITY || errcode == RIG_EPOWER || errcode == RIG_ECANCELED)
 
 /**
  * \brief Token in the netrigctl protocol for returning error code
@@ -2157,6 +2158,7 @@ struct rig_caps {
     int (*get_lock_mode)(RIG *rig, int *mode);
     short timeout_retry;    /*!< number of retries to make in case of read timeout errors, some serial interfaces may require this, 0 to use default value, -1 to disable */
     short morse_qsize;  /* max length of morse */
+    int (*get_meters)(RIG *rig, vfo_t vfo, setting_t *levels, value_t *vals); /*!< Read several meters in one transaction, *levels in: wanted, out: read, \a vals indexed by rig_setting2idx() */
 //    int (*bandwidth2rig)(RIG  *rig, enum bandwidth_t bandwidth);
 //    enum bandwidth_t (*rig2bandwidth)(RIG  *rig, int rigbandwidth);
 };
@@ -2589,6 +2591,150 @@ typedef unsigned int rig_comm_status_t;
 #define RIG_COMM_STATUS_WARNING       0x04
 #define RIG_COMM_STATUS_ERROR         0x05
 
+/**
+ * \brief One VFO's target for rig_set_vfo_settings()
+ */
+typedef struct rig_vfo_setting {
+    vfo_t vfo;          /*!< Target VFO, RIG_VFO_TX for the split TX VFO */
+    freq_t freq;        /*!< Frequency to set, 0 to leave it alone */
+    rmode_t mode;       /*!< Mode to set, RIG_MODE_NONE to leave it alone */
+    pbwidth_t width;    /*!< Passband for \a mode */
+} rig_vfo_setting_t;
+
+/**
+ * \brief Transaction counts of rig_set_vfo_settings()
+ */
+struct rig_vfo_plan_stats {
+    unsigned long plans;        /*!< Number of plans run */
+    unsigned long transactions; /*!< Backend set_freq/set_mode/set_vfo calls made */
+    unsigned long vfo_swaps;    /*!< Of which VFO swaps, including swaps back */
+};
+
+/**
+ * \brief What rig_sw_scan() samples to decide a channel is active
+ */
+enum rig_sw_scan_signal {
+    RIG_SW_SCAN_DCD,        /*!< rig_get_dcd() reports the squelch open */
+    RIG_SW_SCAN_STRENGTH,   /*!< RIG_LEVEL_STRENGTH at or above \c threshold dB rel. S9 */
+    RIG_SW_SCAN_SPECTRUM    /*!< Spectrum scope peak in the passband at or above \c threshold dB */
+};
+
+/**
+ * \brief Software scan description for rig_sw_scan()
+ *
+ * Channels are \c freqs[0..nfreqs-1] or, when \c freqs is NULL,
+ * \c start to \c stop in \c step Hz increments.
+ */
+struct rig_sw_scan {
+    const freq_t *freqs;    /*!< Channel list, NULL to use start/stop/step */
+    int nfreqs;             /*!< Number of entries in \c freqs */
+    freq_t start;           /*!< First channel of the range */
+    freq_t stop;            /*!< Last channel of the range */
+    shortfreq_t step;       /*!< Channel step of the range */
+    rmode_t mode;           /*!< Mode set once before scanning, RIG_MODE_NONE to leave it */
+    pbwidth_t width;        /*!< Passband for \c mode, also the spectrum window */
+    enum rig_sw_scan_signal signal; /*!< Activity criterion */
+    int threshold;          /*!< dB level for STRENGTH/SPECTRUM */
+    int dwell_ms;           /*!< Settling time after tuning before sampling */
+    int hold_ms;            /*!< Most time spent on an active channel, 0 while active */
+    int passes;             /*!< Passes over the channels, 0 until stopped */
+};
+
+/**
+ * \brief One meter reading from a meter stream, see rig_meter_stream_start()
+ */
+struct rig_meter_sample {
+    setting_t level;            /*!< RIG_LEVEL_* meter */
+    value_t val;                /*!< As rig_get_level() returns it */
+    struct timespec ts;         /*!< When the reading was taken, CLOCK_REALTIME */
+};
+
+/**
+ * \brief Counters of a meter stream, see rig_meter_stream_stats()
+ */
+struct rig_meter_stream_stats {
+    double rate;                /*!< Sweeps over all meters in the last second */
+    unsigned long sweeps;       /*!< Sweeps since the stream started */
+    unsigned long samples;      /*!< Samples delivered */
+    unsigned long transactions; /*!< Backend calls made, one per batch of meters */
+    unsigned long dropped;      /*!< Samples overwritten before rig_meter_stream_read() */
+    unsigned long errors;       /*!< Failed reads */
+};
+
+/**
+ * \brief Operations for rig_submit(), each runs the rig_* call of the same name
+ */
+enum rig_async_opcode {
+    RIG_ASYNC_CALL = 0,         /*!< fn(rig, fn_arg), for anything not listed */
+    RIG_ASYNC_SET_FREQ,         /*!< freq */
+    RIG_ASYNC_GET_FREQ,         /*!< freq */
+    RIG_ASYNC_SET_MODE,         /*!< mode, width */
+    RIG_ASYNC_GET_MODE,         /*!< mode, width */
+    RIG_ASYNC_SET_VFO,          /*!< vfo */
+    RIG_ASYNC_GET_VFO,          /*!< vfo */
+    RIG_ASYNC_SET_PTT,          /*!< status is the ptt_t */
+    RIG_ASYNC_GET_PTT,          /*!< status is the ptt_t */
+    RIG_ASYNC_GET_DCD,          /*!< status is the dcd_t */
+    RIG_ASYNC_SET_SPLIT_VFO,    /*!< status is the split_t, tx_vfo */
+    RIG_ASYNC_GET_SPLIT_VFO,    /*!< status is the split_t, tx_vfo */
+    RIG_ASYNC_SET_SPLIT_FREQ,   /*!< freq */
+    RIG_ASYNC_GET_SPLIT_FREQ,   /*!< freq */
+    RIG_ASYNC_SET_RIT,          /*!< offset */
+    RIG_ASYNC_GET_RIT,          /*!< offset */
+    RIG_ASYNC_SET_XIT,          /*!< offset */
+    RIG_ASYNC_GET_XIT,          /*!< offset */
+    RIG_ASYNC_SET_LEVEL,        /*!< setting, val */
+    RIG_ASYNC_GET_LEVEL,        /*!< setting, val */
+    RIG_ASYNC_SET_FUNC,         /*!< setting, status */
+    RIG_ASYNC_GET_FUNC,         /*!< setting, status */
+    RIG_ASYNC_SET_PARM,         /*!< setting, val */
+    RIG_ASYNC_GET_PARM,         /*!< setting, val */
+    RIG_ASYNC_SET_POWERSTAT,    /*!< status is the powerstat_t */
+    RIG_ASYNC_GET_POWERSTAT,    /*!< status is the powerstat_t */
+    RIG_ASYNC_VFO_OP,           /*!< status is the vfo_op_t */
+    RIG_ASYNC_SET_MEM,          /*!< status is the channel number */
+    RIG_ASYNC_GET_MEM,          /*!< status is the channel number */
+};
+
+/**
+ * \brief Cancel queued reads of the same value, see rig_submit()
+ */
+#define RIG_ASYNC_SUPERSEDE (1<<0)
+
+/**
+ * \brief An operation for rig_submit(), and its result
+ *
+ * The caller fills in op and the arguments it takes; the completion
+ * carries a copy with id, retcode and the values read.
+ */
+struct rig_async_op {
+    enum rig_async_opcode op;   /*!< What to do */
+    int flags;                  /*!< RIG_ASYNC_SUPERSEDE */
+    vfo_t vfo;                  /*!< Target VFO */
+    setting_t setting;          /*!< RIG_LEVEL_*, RIG_FUNC_* or RIG_PARM_* */
+    freq_t freq;                /*!< Frequency */
+    rmode_t mode;               /*!< Mode */
+    pbwidth_t width;            /*!< Passband */
+    shortfreq_t offset;         /*!< RIT/XIT offset */
+    value_t val;                /*!< Level or parm value */
+    int status;                 /*!< Func status, or the enum named by the opcode */
+    vfo_t tx_vfo;               /*!< Split TX VFO */
+    int (*fn)(RIG *, rig_ptr_t);    /*!< RIG_ASYNC_CALL function */
+    rig_ptr_t fn_arg;           /*!< Passed to fn */
+    long id;                    /*!< Set on completion, as rig_submit() returned it */
+    int retcode;                /*!< Set on completion, the rig_* call's return or -RIG_ECANCELED */
+};
+
+/**
+ * \brief Counters filled in by rig_sw_scan()
+ */
+struct rig_sw_scan_stats {
+    unsigned long channels;     /*!< Channels sampled */
+    unsigned long tunes;        /*!< Frequency changes sent to the rig */
+    unsigned long hits;         /*!< Channels found active */
+    double elapsed_ms;          /*!< Wall time of the scan */
+};
+
 /**
  * \brief Rig state containing live data and customized fields.
  *
@@ -2780,6 +2926,28 @@ struct rig_state {
     void *multicast_receiver_priv_data;
     rig_comm_status_t comm_status; /*!< Detailed rig control status */
     char device_id[HAMLIB_RIGNAMSIZ];
+    char *port_record_pathname; /*!< Record rig port traffic to this file */
+    char *port_replay_pathname; /*!< Replay rig port traffic from this file instead of opening the port */
+    double port_replay_scale;   /*!< Multiplier for recorded delays during replay, 0 for none */
+    int freq_coalesce;          /*!< Latest-wins set_freq, see rig_set_freq_coalesce() */
+    void *freq_coalesce_priv;
+    void *capindex_priv;        /*!< Lookup tables built by rig_open, see capindex.c */
+    void *tokindex_priv;        /*!< Conf/ext token lookup tables built by rig_init, see tokindex.c */
+    struct rig_vfo_plan_stats vfo_plan_stats;   /*!< See rig_get_vfo_plan_stats() */
+    void *meter_stream_priv;    /*!< Hamlib internal use, see rig_meter_stream_start() */
+    unsigned int state_gen;     /*!< Bumped by rig_open/rig_close/rig_set_conf, backends changing the caps-derived lists later should bump it too */
+    void *dump_state_priv;      /*!< rigctld's cached dump_state text, freed by rig_cleanup */
+    void *dump_caps_priv;       /*!< rigctld's cached dump_caps text, freed by rig_cleanup */
+    int chk_vfo_executed;       /*!< rigctld: a client of this rig sent chk_vfo, selects the dump_state variant */
+    int tcp_keepalive;          /*!< Network port keepalive idle time in seconds, 0 disables */
+    int tcp_user_timeout;       /*!< Network port TCP_USER_TIMEOUT in ms, 0 for the system default */
+    int net_reconnect;          /*!< True reconnects a lost network port, see network_lost() */
+    int io_uring;               /*!< True drives the rig port through io_uring, see uring.c */
+    void *async_priv;           /*!< Hamlib internal use, see rig_submit() */
+    volatile int net_resync;    /*!< Reconnected, transceive mode and VFO are restored at the next API call */
+    pthread_mutex_t meter_lock; /*!< Serializes rig access with the meter stream, recursive, see meter.c */
+    pthread_mutex_t spectrum_cb_lock;   /*!< Held while the spectrum callback is changed or runs, recursive, see event.c */
+    pthread_mutex_t morse_start_lock;   /*!< The first of concurrent rig_send_morse() calls starts the morse handler */
 };
 
 /**
@@ -2933,6 +3101,10 @@ typedef int (*pltune_cb_t)(RIG *,
 typedef int (*spectrum_cb_t)(RIG *,
                              struct rig_spectrum_line *,
                              rig_ptr_t);
+typedef int (*sw_scan_cb_t)(RIG *, vfo_t, freq_t, int, rig_ptr_t);
+typedef int (*meter_cb_t)(RIG *, const struct rig_meter_sample *, int,
+                          rig_ptr_t);
+typedef int (*rig_async_cb_t)(RIG *, const struct rig_async_op *, rig_ptr_t);
 
 //! @endcond
 
@@ -3026,6 +3198,19 @@ rig_set_freq HAMLIB_PARAMS((RIG *rig,
                             vfo_t vfo,
                             freq_t freq));
 #endif
+
+extern HAMLIB_EXPORT(int)
+rig_set_freq_coalesce HAMLIB_PARAMS((RIG *rig,
+                                     int enable));
+extern HAMLIB_EXPORT(int)
+rig_freq_coalesce_defer HAMLIB_PARAMS((RIG *rig,
+                                       vfo_t vfo,
+                                       freq_t freq));
+extern HAMLIB_EXPORT(int)
+rig_get_freq_coalesce_stats HAMLIB_PARAMS((RIG *rig,
+                                           unsigned long *requests,
+                                           unsigned long *sent,
+                                           unsigned long *coalesced));
 #if BUILTINFUNC
 #define rig_get_freq(r,v,f) rig_get_freq(r,v,f,__builtin_FUNCTION())
 extern HAMLIB_EXPORT(int)
@@ -3174,6 +3359,14 @@ rig_set_split_freq_mode HAMLIB_PARAMS((RIG *rig,
                                        rmode_t tx_mode,
                                        pbwidth_t tx_width));
 extern HAMLIB_EXPORT(int)
+rig_set_vfo_settings HAMLIB_PARAMS((RIG *rig,
+                                    const rig_vfo_setting_t *settings,
+                                    int count));
+extern HAMLIB_EXPORT(int)
+rig_get_vfo_plan_stats HAMLIB_PARAMS((RIG *rig,
+                                      struct rig_vfo_plan_stats *stats));
+
+extern HAMLIB_EXPORT(int)
 rig_get_split_freq_mode HAMLIB_PARAMS((RIG *rig,
                                        vfo_t vfo,
                                        freq_t *tx_freq,
@@ -3248,6 +3441,38 @@ rig_get_level HAMLIB_PARAMS((RIG *rig,
 
 #define rig_get_strength(r,v,s) rig_get_level((r),(v),RIG_LEVEL_STRENGTH, (value_t*)(s))
 
+extern HAMLIB_EXPORT(int)
+rig_meter_stream_start HAMLIB_PARAMS((RIG *rig,
+                                      vfo_t vfo,
+                                      setting_t levels,
+                                      int rate_hz,
+                                      meter_cb_t cb,
+                                      rig_ptr_t arg));
+extern HAMLIB_EXPORT(int)
+rig_meter_stream_stop HAMLIB_PARAMS((RIG *rig));
+extern HAMLIB_EXPORT(int)
+rig_meter_stream_read HAMLIB_PARAMS((RIG *rig,
+                                     struct rig_meter_sample *samples,
+                                     int max));
+extern HAMLIB_EXPORT(int)
+rig_meter_stream_stats HAMLIB_PARAMS((RIG *rig,
+                                      struct rig_meter_stream_stats *stats));
+
+extern HAMLIB_EXPORT(long)
+rig_submit HAMLIB_PARAMS((RIG *rig,
+                          const struct rig_async_op *op,
+                          rig_async_cb_t cb,
+                          rig_ptr_t arg));
+extern HAMLIB_EXPORT(int)
+rig_async_cancel HAMLIB_PARAMS((RIG *rig,
+                                long id));
+extern HAMLIB_EXPORT(int)
+rig_async_fd HAMLIB_PARAMS((RIG *rig));
+extern HAMLIB_EXPORT(int)
+rig_async_reap HAMLIB_PARAMS((RIG *rig,
+                              struct rig_async_op *done,
+                              int max));
+
 extern HAMLIB_EXPORT(int)
 rig_set_parm HAMLIB_PARAMS((RIG *rig,
                             setting_t parm,
@@ -3475,6 +3700,14 @@ extern HAMLIB_EXPORT(scan_t)
 rig_has_scan HAMLIB_PARAMS((RIG *rig,
                             scan_t scan));
 
+extern HAMLIB_EXPORT(int)
+rig_sw_scan HAMLIB_PARAMS((RIG *rig,
+                           vfo_t vfo,
+                           const struct rig_sw_scan *scan,
+                           sw_scan_cb_t cb,
+                           rig_ptr_t arg,
+                           struct rig_sw_scan_stats *stats));
+
 extern HAMLIB_EXPORT(int)
 rig_set_channel HAMLIB_PARAMS((RIG *rig,
                                vfo_t vfo,
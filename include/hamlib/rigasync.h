@@ -0,0 +1,545 @@
+/*
+ *  Hamlib C++ bindings - asynchronous API header
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _RIGASYNC_H
+#define _RIGASYNC_H 1
+
+/*
+ * AsyncRig runs the operations of a Rig on a worker thread of its own, so
+ * a GUI never blocks on a 100 ms transaction.  An operation is anything
+ * callable with a Rig&: the RigOp structs below, a RigOp::Batch of them,
+ * or a lambda.  Three ways to get the result:
+ *
+ *   std::future<freq_t> f = arig.submit(RigOp::GetFreq{});   // C++17
+ *
+ *   arig.post(RigOp::GetFreq{}, [](RigResult<freq_t> &&r) { ... });
+ *
+ *   freq_t freq = co_await arig.await(RigOp::GetFreq{});     // C++20
+ *
+ * post() and co_await do not allocate per call as long as the operation
+ * and callback fit in a slot, submit() pays for the std::future shared
+ * state.  Callbacks and coroutines are resumed on the worker thread.
+ * Errors are the RigException the synchronous Rig method would throw.
+ *
+ * Operations run one at a time and in order.  The Rig itself should not be
+ * used directly by other threads while an AsyncRig is attached to it.
+ */
+
+#if __cplusplus >= 201703L
+
+#include <hamlib/rigclass.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#  if __has_include(<coroutine>)
+#    include <coroutine>
+#    define HAMLIB_CPP_COROUTINES 1
+#  endif
+#endif
+
+
+//! @cond Doxygen_Suppress
+
+// Result of an operation, either a value or the error it failed with
+template <class T>
+class RigResult
+{
+private:
+    std::optional<T> val;
+    int err;
+    const char *msg;
+
+public:
+    RigResult() : err(-RIG_EINTERNAL), msg("no result") {}
+    explicit RigResult(T &&v) : val(std::move(v)), err(RIG_OK), msg(nullptr) {}
+    RigResult(int e, const char *m) : err(e), msg(m) {}
+
+    RigResult(RigResult &&) = default;
+    RigResult &operator=(RigResult &&) = default;
+    RigResult(const RigResult &) = delete;
+    RigResult &operator=(const RigResult &) = delete;
+
+    bool ok() const { return err == RIG_OK; }
+    int error() const { return err; }
+    const char *message() const { return msg; }
+
+    // the value, or throws the RigException
+    T take()
+    {
+        if (err != RIG_OK) { throw RigException(msg, err); }
+
+        return std::move(*val);
+    }
+};
+
+template <>
+class RigResult<void>
+{
+private:
+    int err;
+    const char *msg;
+
+public:
+    RigResult() : err(RIG_OK), msg(nullptr) {}
+    RigResult(int e, const char *m) : err(e), msg(m) {}
+
+    RigResult(RigResult &&) = default;
+    RigResult &operator=(RigResult &&) = default;
+    RigResult(const RigResult &) = delete;
+    RigResult &operator=(const RigResult &) = delete;
+
+    bool ok() const { return err == RIG_OK; }
+    int error() const { return err; }
+    const char *message() const { return msg; }
+
+    void take()
+    {
+        if (err != RIG_OK) { throw RigException(msg, err); }
+    }
+};
+
+
+// what an operation returns
+template <class Op>
+using rig_op_result_t = decltype(std::declval<Op &>()(std::declval<Rig &>()));
+
+
+namespace RigOp
+{
+
+struct Mode
+{
+    rmode_t mode;
+    pbwidth_t width;
+};
+
+struct SetFreq
+{
+    freq_t freq;
+    vfo_t vfo = RIG_VFO_CURR;
+    void operator()(Rig &rig) const { rig.setFreq(freq, vfo); }
+};
+
+struct GetFreq
+{
+    vfo_t vfo = RIG_VFO_CURR;
+    freq_t operator()(Rig &rig) const { return rig.getFreq(vfo); }
+};
+
+struct SetMode
+{
+    rmode_t mode;
+    pbwidth_t width = RIG_PASSBAND_NORMAL;
+    vfo_t vfo = RIG_VFO_CURR;
+    void operator()(Rig &rig) const { rig.setMode(mode, width, vfo); }
+};
+
+struct GetMode
+{
+    vfo_t vfo = RIG_VFO_CURR;
+    Mode operator()(Rig &rig) const
+    {
+        Mode m;
+        m.mode = rig.getMode(m.width, vfo);
+        return m;
+    }
+};
+
+struct SetVFO
+{
+    vfo_t vfo;
+    void operator()(Rig &rig) const { rig.setVFO(vfo); }
+};
+
+struct GetVFO
+{
+    vfo_t operator()(Rig &rig) const { return rig.getVFO(); }
+};
+
+struct SetPTT
+{
+    ptt_t ptt;
+    vfo_t vfo = RIG_VFO_CURR;
+    void operator()(Rig &rig) const { rig.setPTT(ptt, vfo); }
+};
+
+struct GetPTT
+{
+    vfo_t vfo = RIG_VFO_CURR;
+    ptt_t operator()(Rig &rig) const { return rig.getPTT(vfo); }
+};
+
+struct GetDCD
+{
+    vfo_t vfo = RIG_VFO_CURR;
+    dcd_t operator()(Rig &rig) const { return rig.getDCD(vfo); }
+};
+
+struct SetLevelI
+{
+    setting_t level;
+    int val;
+    vfo_t vfo = RIG_VFO_CURR;
+    void operator()(Rig &rig) const { rig.setLevel(level, val, vfo); }
+};
+
+struct SetLevelF
+{
+    setting_t level;
+    float val;
+    vfo_t vfo = RIG_VFO_CURR;
+    void operator()(Rig &rig) const { rig.setLevel(level, val, vfo); }
+};
+
+struct GetLevelI
+{
+    setting_t level;
+    vfo_t vfo = RIG_VFO_CURR;
+    int operator()(Rig &rig) const { return rig.getLevelI(level, vfo); }
+};
+
+struct GetLevelF
+{
+    setting_t level;
+    vfo_t vfo = RIG_VFO_CURR;
+    float operator()(Rig &rig) const { return rig.getLevelF(level, vfo); }
+};
+
+struct SetSplitFreq
+{
+    freq_t freq;
+    vfo_t vfo = RIG_VFO_CURR;
+    void operator()(Rig &rig) const { rig.setSplitFreq(freq, vfo); }
+};
+
+struct GetSplitFreq
+{
+    vfo_t vfo = RIG_VFO_CURR;
+    freq_t operator()(Rig &rig) const { return rig.getSplitFreq(vfo); }
+};
+
+// void results show up as std::monostate in a Batch tuple
+template <class T>
+using batch_elem_t = std::conditional_t<std::is_void<T>::value, std::monostate, T>;
+
+/*
+ * Several operations run back to back in a single worker turn, the result
+ * is the tuple of their results.  The first one to fail aborts the rest.
+ */
+template <class... Ops>
+struct Batch
+{
+    std::tuple<Ops...> ops;
+
+    explicit Batch(Ops... o) : ops(std::move(o)...) {}
+
+    std::tuple<batch_elem_t<rig_op_result_t<Ops>>...> operator()(Rig &rig)
+    {
+        return run(rig, std::index_sequence_for<Ops...> {});
+    }
+
+private:
+    template <class Op>
+    static batch_elem_t<rig_op_result_t<Op>> one(Op &op, Rig &rig)
+    {
+        if constexpr (std::is_void<rig_op_result_t<Op>>::value)
+        {
+            op(rig);
+            return std::monostate {};
+        }
+        else
+        {
+            return op(rig);
+        }
+    }
+
+    template <std::size_t... I>
+    std::tuple<batch_elem_t<rig_op_result_t<Ops>>...> run(Rig &rig,
+            std::index_sequence<I...>)
+    {
+        // braced init runs them left to right
+        return std::tuple<batch_elem_t<rig_op_result_t<Ops>>...> { one(std::get<I>(ops), rig)... };
+    }
+};
+
+template <class... Ops>
+Batch<Ops...> batch(Ops... ops)
+{
+    return Batch<Ops...>(std::move(ops)...);
+}
+
+} // namespace RigOp
+
+
+// runs op, catching what it throws into the result
+template <class Op>
+RigResult<rig_op_result_t<Op>> rig_op_invoke(Op &op, Rig &rig) noexcept
+{
+    typedef rig_op_result_t<Op> T;
+
+    try
+    {
+        if constexpr (std::is_void<T>::value)
+        {
+            op(rig);
+            return RigResult<void>();
+        }
+        else
+        {
+            return RigResult<T>(op(rig));
+        }
+    }
+    catch (const RigException &e)
+    {
+        return RigResult<T>(e.errorno, e.message);
+    }
+    catch (...)
+    {
+        return RigResult<T>(-RIG_EINTERNAL, rigerror(-RIG_EINTERNAL));
+    }
+}
+
+
+class HAMLIB_CPP_IMPEXP AsyncRig
+{
+public:
+    // a queued operation, completes (and disposes of) itself on the worker
+    struct Task
+    {
+        Task *next = nullptr;
+        virtual void complete(Rig &rig) noexcept = 0;
+        virtual ~Task() {}
+    };
+
+    // bytes available for the operation and callback of a post()
+    static const std::size_t SLOT_SIZE = 128;
+
+    explicit AsyncRig(Rig &rig, unsigned slots = 32);
+    // runs what is still queued, then stops the worker
+    ~AsyncRig();
+
+    AsyncRig(const AsyncRig &) = delete;
+    AsyncRig &operator=(const AsyncRig &) = delete;
+
+    Rig &rig() { return theRig; }
+
+    // operations completed so far
+    unsigned long completed() const;
+
+    template <class Op>
+    std::future<rig_op_result_t<Op>> submit(Op op)
+    {
+        auto *t = new FutureTask<Op>(std::move(op));
+        std::future<rig_op_result_t<Op>> f = t->promise.get_future();
+        enqueue(t);
+        return f;
+    }
+
+    // cb(RigResult<T> &&) is called on the worker
+    template <class Op, class Cb>
+    void post(Op op, Cb cb)
+    {
+        typedef PostTask<Op, Cb> P;
+        void *mem = nullptr;
+
+        if (sizeof(P) <= SLOT_SIZE && alignof(P) <= alignof(std::max_align_t))
+        {
+            mem = slot_get();
+        }
+
+        bool pooled = mem != nullptr;
+
+        if (!pooled) { mem = ::operator new (sizeof(P)); }
+
+        enqueue(new (mem) P(this, pooled, std::move(op), std::move(cb)));
+    }
+
+    template <class... Ops>
+    std::future<std::tuple<RigOp::batch_elem_t<rig_op_result_t<Ops>>...>>
+            batch(Ops... ops)
+    {
+        return submit(RigOp::batch(std::move(ops)...));
+    }
+
+    std::future<void> setFreq(freq_t freq, vfo_t vfo = RIG_VFO_CURR)
+    {
+        return submit(RigOp::SetFreq {freq, vfo});
+    }
+    std::future<freq_t> getFreq(vfo_t vfo = RIG_VFO_CURR)
+    {
+        return submit(RigOp::GetFreq {vfo});
+    }
+    std::future<void> setMode(rmode_t mode, pbwidth_t width = RIG_PASSBAND_NORMAL,
+                              vfo_t vfo = RIG_VFO_CURR)
+    {
+        return submit(RigOp::SetMode {mode, width, vfo});
+    }
+    std::future<RigOp::Mode> getMode(vfo_t vfo = RIG_VFO_CURR)
+    {
+        return submit(RigOp::GetMode {vfo});
+    }
+    std::future<void> setVFO(vfo_t vfo)
+    {
+        return submit(RigOp::SetVFO {vfo});
+    }
+    std::future<vfo_t> getVFO()
+    {
+        return submit(RigOp::GetVFO {});
+    }
+    std::future<void> setPTT(ptt_t ptt, vfo_t vfo = RIG_VFO_CURR)
+    {
+        return submit(RigOp::SetPTT {ptt, vfo});
+    }
+    std::future<ptt_t> getPTT(vfo_t vfo = RIG_VFO_CURR)
+    {
+        return submit(RigOp::GetPTT {vfo});
+    }
+
+#ifdef HAMLIB_CPP_COROUTINES
+    template <class Op>
+    class Awaiter : private Task
+    {
+    private:
+        AsyncRig &owner;
+        Op op;
+        RigResult<rig_op_result_t<Op>> res;
+        std::coroutine_handle<> handle;
+
+        void complete(Rig &rig) noexcept override
+        {
+            res = rig_op_invoke(op, rig);
+            handle.resume();    // may destroy us
+        }
+
+    public:
+        Awaiter(AsyncRig &a, Op o) : owner(a), op(std::move(o)) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            handle = h;
+            owner.enqueue(this);
+        }
+        rig_op_result_t<Op> await_resume() { return res.take(); }
+    };
+
+    // co_await arig.await(op), the awaiter lives in the coroutine frame
+    template <class Op>
+    Awaiter<Op> await(Op op)
+    {
+        return Awaiter<Op>(*this, std::move(op));
+    }
+#endif
+
+private:
+    template <class Op>
+    struct FutureTask : Task
+    {
+        Op op;
+        std::promise<rig_op_result_t<Op>> promise;
+
+        explicit FutureTask(Op o) : op(std::move(o)) {}
+
+        void complete(Rig &rig) noexcept override
+        {
+            try
+            {
+                if constexpr (std::is_void<rig_op_result_t<Op>>::value)
+                {
+                    op(rig);
+                    promise.set_value();
+                }
+                else
+                {
+                    promise.set_value(op(rig));
+                }
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+            }
+
+            delete this;
+        }
+    };
+
+    template <class Op, class Cb>
+    struct PostTask : Task
+    {
+        AsyncRig *owner;
+        bool pooled;
+        Op op;
+        Cb cb;
+
+        PostTask(AsyncRig *a, bool p, Op o, Cb c)
+            : owner(a), pooled(p), op(std::move(o)), cb(std::move(c)) {}
+
+        void complete(Rig &rig) noexcept override
+        {
+            AsyncRig *a = owner;
+            bool p = pooled;
+
+            cb(rig_op_invoke(op, rig));
+            this->~PostTask();
+
+            if (p) { a->slot_put(this); }
+            else { ::operator delete (this); }
+        }
+    };
+
+    struct alignas(std::max_align_t) Slot
+    {
+        unsigned char mem[SLOT_SIZE];
+    };
+
+    Rig &theRig;
+    mutable std::mutex lock;
+    std::condition_variable cond;
+    Task *head;
+    Task *tail;
+    bool stopping;
+    unsigned long done;
+    std::vector<Slot> slots;
+    std::vector<void *> free_slots;
+    std::thread worker;
+
+    void enqueue(Task *t);
+    void *slot_get();
+    void slot_put(void *mem);
+    void run();
+};
+
+//! @endcond
+
+#endif /* __cplusplus >= 201703L */
+
+#endif  // _RIGASYNC_H
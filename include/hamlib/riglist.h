@@ -529,6 +529,7 @@
 #define RIG_MODEL_SDR1000RFE RIG_MAKE_MODEL(RIG_FLEXRADIO, 2)
 #define RIG_MODEL_DTTSP RIG_MAKE_MODEL(RIG_FLEXRADIO, 3)
 #define RIG_MODEL_DTTSP_UDP RIG_MAKE_MODEL(RIG_FLEXRADIO, 4)
+#define RIG_MODEL_SMARTSDR RIG_MAKE_MODEL(RIG_FLEXRADIO, 5)
 
 /*
  * VEB Funkwerk Köpenick RFT
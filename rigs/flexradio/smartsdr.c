@@ -0,0 +1,1509 @@
+/*
+ *  Hamlib FlexRadio backend - SmartSDR native TCP API
+ *  Copyright (c) 2026 by the Hamlib Group
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * The Flex 6000 series also answer Kenwood CAT (see kenwood/flex6xxx.c),
+ * but that is poll only.  This speaks the radio's own API on TCP port
+ * 4992, one line per message:
+ *
+ *   radio:  V<version>               on connect
+ *           H<handle>                our client handle, in hex
+ *           R<seq>|<status>|<text>   reply to our command <seq>
+ *           S<handle>|<object> ...   status, after a "sub" for <object>
+ *           M<code>|<text>           message
+ *   us:     C<seq>|<command>
+ *
+ * After "sub slice all" and "sub tx all" the radio pushes every change of
+ * frequency, mode, filter, TX slice and interlock state, so the get_*
+ * functions answer from that state without a round trip, and changes
+ * made on the radio fire the rig events and refresh the rig cache.
+ *
+ * Meters: "sub meter all" describes the meters in status lines and the
+ * radio then streams their values as VITA-49 packets to the UDP port we
+ * gave with "client udpport".  Levels from those feed get_level and
+ * get_meters, so a meter stream costs no transactions at all.
+ *
+ * A thread per rig reads the TCP socket and the UDP meter socket.  It
+ * owns the TCP socket: the port descriptor is parked on an idle socket
+ * pair, so the flushes rig.c does on the port cannot eat status lines.
+ *
+ * VFO A is the slice given by the "slice" conf (0 by default), VFO B the
+ * next one.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>
+#  include <poll.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#  include <netinet/in.h>
+#endif
+
+#include "hamlib/rig.h"
+#include "iofunc.h"
+#include "misc.h"
+#include "token.h"
+#include "event.h"
+#include "flexradio.h"
+
+#ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+#endif
+
+#define DEFAULT_SMARTSDR_ADDR "127.0.0.1:4992"
+
+#define SMARTSDR_SLICES 8
+#define SMARTSDR_METERS 256
+#define SMARTSDR_LINE 1024
+#define SMARTSDR_HELLO_MS 3000
+#define SMARTSDR_MAX_WATTS 100.0
+
+#define TOK_SLICE  TOKEN_BACKEND(1)
+#define TOK_METERS TOKEN_BACKEND(2)
+
+struct smartsdr_slice
+{
+    int in_use;
+    freq_t freq;
+    rmode_t mode;
+    int filter_lo;
+    int filter_hi;
+    int tx;
+    int audio_level;
+};
+
+struct smartsdr_meter
+{
+    setting_t level;                /* 0 when not one we use */
+    int slice;                      /* SLC meters, -1 otherwise */
+    float scale;                    /* raw value per unit */
+    int dbm_to_watts;
+    float value;
+    int valid;
+};
+
+struct smartsdr_priv_data
+{
+    int slice;                      /* VFO A, VFO B is slice + 1 */
+    int want_meters;
+
+    int fd;                         /* TCP socket, read by the thread only */
+    int udp_fd;                     /* VITA-49 meter packets */
+    int park[2];                    /* rigport.fd sits on park[0] */
+
+    pthread_t thread;
+    volatile int run;
+    int thread_started;
+    int connected;
+
+    pthread_mutex_t lock;           /* everything below */
+    pthread_cond_t cond;
+    pthread_mutex_t cmd_lock;       /* one command in flight */
+
+    char version[32];
+    unsigned handle;
+    unsigned seq;
+    unsigned wait_seq;
+    int reply_done;
+    unsigned reply_status;
+    char reply[256];
+
+    struct smartsdr_slice slices[SMARTSDR_SLICES];
+    ptt_t ptt;
+    int rfpower;
+    struct smartsdr_meter meters[SMARTSDR_METERS];
+
+    unsigned long commands, replies, stale, status, meter_packets;
+
+    char line[SMARTSDR_LINE];
+    int linelen;
+    char info[80];
+};
+
+static const struct
+{
+    rmode_t mode;
+    const char *name;
+} smartsdr_modes[] =
+{
+    { RIG_MODE_USB, "USB" },
+    { RIG_MODE_LSB, "LSB" },
+    { RIG_MODE_CW, "CW" },
+    { RIG_MODE_AM, "AM" },
+    { RIG_MODE_SAM, "SAM" },
+    { RIG_MODE_FM, "FM" },
+    { RIG_MODE_FMN, "NFM" },
+    { RIG_MODE_PKTFM, "DFM" },
+    { RIG_MODE_PKTUSB, "DIGU" },
+    { RIG_MODE_PKTLSB, "DIGL" },
+    { RIG_MODE_RTTY, "RTTY" },
+};
+
+#define SMARTSDR_MODES_COUNT (sizeof(smartsdr_modes)/sizeof(smartsdr_modes[0]))
+
+static const struct confparams smartsdr_cfg_params[] =
+{
+    {
+        TOK_SLICE, "slice", "Slice", "Slice used as VFO A, VFO B is the next one",
+        "0", RIG_CONF_NUMERIC, { .n = { 0, SMARTSDR_SLICES - 2, 1 } }
+    },
+    {
+        TOK_METERS, "meters", "Meters", "Subscribe to the meter stream over UDP",
+        "1", RIG_CONF_CHECKBUTTON, { }
+    },
+    { RIG_CONF_END, NULL, }
+};
+
+
+static long now_ms(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec * 1000L + tv.tv_usec / 1000;
+}
+
+
+static rmode_t smartsdr_str2mode(const char *s)
+{
+    int i;
+
+    for (i = 0; i < SMARTSDR_MODES_COUNT; i++)
+    {
+        if (strcmp(smartsdr_modes[i].name, s) == 0) { return smartsdr_modes[i].mode; }
+    }
+
+    return RIG_MODE_NONE;
+}
+
+
+static const char *smartsdr_mode2str(rmode_t mode)
+{
+    int i;
+
+    for (i = 0; i < SMARTSDR_MODES_COUNT; i++)
+    {
+        if (smartsdr_modes[i].mode == mode) { return smartsdr_modes[i].name; }
+    }
+
+    return NULL;
+}
+
+
+/* slice behind a VFO, -1 if none */
+static int smartsdr_vfo2slice(RIG *rig, vfo_t vfo)
+{
+    const struct smartsdr_priv_data *priv = rig->state.priv;
+    int i;
+
+    switch (vfo)
+    {
+    case RIG_VFO_CURR:
+    case RIG_VFO_A:
+    case RIG_VFO_MAIN:
+        return priv->slice;
+
+    case RIG_VFO_B:
+    case RIG_VFO_SUB:
+        return priv->slice + 1;
+
+    case RIG_VFO_TX:
+        for (i = 0; i < SMARTSDR_SLICES; i++)
+        {
+            if (priv->slices[i].in_use && priv->slices[i].tx) { return i; }
+        }
+
+        return priv->slice;
+
+    default:
+        return -1;
+    }
+}
+
+
+static vfo_t smartsdr_slice2vfo(const struct smartsdr_priv_data *priv,
+                                int slice)
+{
+    if (slice == priv->slice) { return RIG_VFO_A; }
+
+    if (slice == priv->slice + 1) { return RIG_VFO_B; }
+
+    return RIG_VFO_NONE;
+}
+
+
+#ifdef HAVE_SYS_SOCKET_H
+
+/*
+ * Sends one command and waits for its reply.  Returns RIG_OK when the
+ * radio answered status 0, the reply text goes to reply if not NULL.
+ */
+static int smartsdr_command(RIG *rig, const char *cmd, char *reply,
+                            int reply_len)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    char buf[SMARTSDR_LINE];
+    struct timespec deadline;
+    struct timeval tv;
+    unsigned seq;
+    int len, sent, retval;
+
+    pthread_mutex_lock(&priv->cmd_lock);
+    pthread_mutex_lock(&priv->lock);
+
+    if (!priv->connected)
+    {
+        pthread_mutex_unlock(&priv->lock);
+        pthread_mutex_unlock(&priv->cmd_lock);
+        return -RIG_EIO;
+    }
+
+    seq = ++priv->seq;
+    priv->wait_seq = seq;
+    priv->reply_done = 0;
+    priv->commands++;
+    pthread_mutex_unlock(&priv->lock);
+
+    len = snprintf(buf, sizeof(buf), "C%u|%s\n", seq, cmd);
+
+    if (len >= sizeof(buf))
+    {
+        pthread_mutex_unlock(&priv->cmd_lock);
+        return -RIG_EINVAL;
+    }
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: %s", __func__, buf);
+
+    for (sent = 0; sent < len;)
+    {
+        int n = send(priv->fd, buf + sent, len - sent, MSG_NOSIGNAL);
+
+        if (n < 0 && errno == EINTR) { continue; }
+
+        if (n <= 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: send: %s\n", __func__, strerror(errno));
+            pthread_mutex_unlock(&priv->cmd_lock);
+            return -RIG_EIO;
+        }
+
+        sent += n;
+    }
+
+    gettimeofday(&tv, NULL);
+    deadline.tv_sec = tv.tv_sec + rig->state.rigport.timeout / 1000;
+    deadline.tv_nsec = tv.tv_usec * 1000L
+                       + (rig->state.rigport.timeout % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&priv->lock);
+
+    while (!priv->reply_done && priv->connected)
+    {
+        if (pthread_cond_timedwait(&priv->cond, &priv->lock, &deadline) != 0)
+        {
+            break;
+        }
+    }
+
+    if (!priv->reply_done)
+    {
+        retval = priv->connected ? -RIG_ETIMEOUT : -RIG_EIO;
+        priv->wait_seq = 0;
+        rig_debug(RIG_DEBUG_ERR, "%s: no reply to C%u|%s\n", __func__, seq, cmd);
+    }
+    else if (priv->reply_status != 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: C%u|%s failed: %08X %s\n", __func__, seq,
+                  cmd, priv->reply_status, priv->reply);
+        retval = -RIG_ERJCTED;
+    }
+    else
+    {
+        retval = RIG_OK;
+
+        if (reply) { SNPRINTF(reply, reply_len, "%s", priv->reply); }
+    }
+
+    pthread_mutex_unlock(&priv->lock);
+    pthread_mutex_unlock(&priv->cmd_lock);
+
+    return retval;
+}
+
+
+/* "7.src=SLC#7.num=0#7.nam=LEVEL#7.unit=dBm#..." or "7 removed" */
+static void smartsdr_meter_status(struct smartsdr_priv_data *priv, char *s)
+{
+    char src[8] = "", name[32] = "", unit[16] = "";
+    int id = -1, num = -1;
+    char *tok, *save;
+    struct smartsdr_meter *m;
+
+    if (strstr(s, "removed"))
+    {
+        id = atoi(s);
+
+        if (id >= 0 && id < SMARTSDR_METERS)
+        {
+            memset(&priv->meters[id], 0, sizeof(priv->meters[id]));
+        }
+
+        return;
+    }
+
+    for (tok = strtok_r(s, "#", &save); tok; tok = strtok_r(NULL, "#", &save))
+    {
+        char *dot = strchr(tok, '.');
+        char *eq = strchr(tok, '=');
+        int this_id;
+
+        if (!dot || !eq || eq < dot) { continue; }
+
+        this_id = atoi(tok);
+
+        if (this_id != id)
+        {
+            /* several meters per line, store the one before */
+            if (id >= 0) { break; }
+
+            id = this_id;
+        }
+
+        *eq++ = '\0';
+
+        if (strcmp(dot + 1, "src") == 0) { SNPRINTF(src, sizeof(src), "%s", eq); }
+        else if (strcmp(dot + 1, "num") == 0) { num = atoi(eq); }
+        else if (strcmp(dot + 1, "nam") == 0) { SNPRINTF(name, sizeof(name), "%s", eq); }
+        else if (strcmp(dot + 1, "unit") == 0) { SNPRINTF(unit, sizeof(unit), "%s", eq); }
+    }
+
+    if (id < 0 || id >= SMARTSDR_METERS) { return; }
+
+    m = &priv->meters[id];
+    memset(m, 0, sizeof(*m));
+    m->slice = -1;
+
+    if (strcmp(src, "SLC") == 0 && strcmp(name, "LEVEL") == 0)
+    {
+        m->level = RIG_LEVEL_STRENGTH;
+        m->slice = num;
+    }
+    else if (strcmp(name, "FWDPWR") == 0)
+    {
+        m->level = RIG_LEVEL_RFPOWER_METER_WATTS;
+        m->dbm_to_watts = strcmp(unit, "dBm") == 0;
+    }
+    else if (strcmp(name, "SWR") == 0) { m->level = RIG_LEVEL_SWR; }
+    else if (strcmp(name, "ALC") == 0) { m->level = RIG_LEVEL_ALC; }
+    else if (strcmp(name, "COMPPEAK") == 0) { m->level = RIG_LEVEL_COMP_METER; }
+    else if (strcmp(name, "PATEMP") == 0) { m->level = RIG_LEVEL_TEMP_METER; }
+    else if (strcmp(name, "+13.8A") == 0) { m->level = RIG_LEVEL_VD_METER; }
+
+    /* fixed point as the radio sends it */
+    if (strcmp(unit, "dBm") == 0 || strcmp(unit, "dBFS") == 0
+            || strcmp(unit, "dB") == 0 || strcmp(unit, "SWR") == 0)
+    {
+        m->scale = 128.0f;
+    }
+    else if (strcmp(unit, "Volts") == 0 || strcmp(unit, "Amps") == 0)
+    {
+        m->scale = 256.0f;
+    }
+    else if (strcmp(unit, "degC") == 0 || strcmp(unit, "degF") == 0)
+    {
+        m->scale = 64.0f;
+    }
+    else
+    {
+        m->scale = 1.0f;
+    }
+}
+
+
+enum { CHANGED_FREQ = 1, CHANGED_MODE = 2, CHANGED_TX = 4 };
+
+/*
+ * One status line, after the "S<handle>|".  Updates the state under
+ * priv->lock and fires the events after letting go of it.
+ */
+static void smartsdr_status(RIG *rig, char *s)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    char *tok, *save;
+    int changed = 0, slice = -1, ptt_changed = 0;
+    struct smartsdr_slice sl;
+    ptt_t ptt = RIG_PTT_OFF;
+
+    pthread_mutex_lock(&priv->lock);
+    priv->status++;
+
+    if (strncmp(s, "meter ", 6) == 0)
+    {
+        smartsdr_meter_status(priv, s + 6);
+        pthread_mutex_unlock(&priv->lock);
+        return;
+    }
+
+    tok = strtok_r(s, " ", &save);
+
+    if (tok == NULL)
+    {
+        pthread_mutex_unlock(&priv->lock);
+        return;
+    }
+
+    if (strcmp(tok, "slice") == 0)
+    {
+        struct smartsdr_slice *p;
+
+        tok = strtok_r(NULL, " ", &save);
+        slice = tok ? atoi(tok) : -1;
+
+        if (slice < 0 || slice >= SMARTSDR_SLICES)
+        {
+            pthread_mutex_unlock(&priv->lock);
+            return;
+        }
+
+        p = &priv->slices[slice];
+
+        /* a status line for a slice means it exists until in_use=0 */
+        p->in_use = 1;
+
+        while ((tok = strtok_r(NULL, " ", &save)))
+        {
+            char *val = strchr(tok, '=');
+
+            if (!val) { continue; }
+
+            *val++ = '\0';
+
+            if (strcmp(tok, "RF_frequency") == 0)
+            {
+                freq_t f = floor(atof(val) * 1e6 + 0.5);
+
+                if (f != p->freq) { p->freq = f; changed |= CHANGED_FREQ; }
+            }
+            else if (strcmp(tok, "mode") == 0)
+            {
+                rmode_t m = smartsdr_str2mode(val);
+
+                if (m != p->mode) { p->mode = m; changed |= CHANGED_MODE; }
+            }
+            else if (strcmp(tok, "filter_lo") == 0)
+            {
+                int v = atoi(val);
+
+                if (v != p->filter_lo) { p->filter_lo = v; changed |= CHANGED_MODE; }
+            }
+            else if (strcmp(tok, "filter_hi") == 0)
+            {
+                int v = atoi(val);
+
+                if (v != p->filter_hi) { p->filter_hi = v; changed |= CHANGED_MODE; }
+            }
+            else if (strcmp(tok, "tx") == 0)
+            {
+                int v = atoi(val);
+
+                if (v != p->tx) { p->tx = v; changed |= CHANGED_TX; }
+            }
+            else if (strcmp(tok, "audio_level") == 0)
+            {
+                p->audio_level = atoi(val);
+            }
+            else if (strcmp(tok, "in_use") == 0)
+            {
+                p->in_use = atoi(val);
+            }
+        }
+
+        sl = *p;
+    }
+    else if (strcmp(tok, "interlock") == 0 || strcmp(tok, "transmit") == 0)
+    {
+        while ((tok = strtok_r(NULL, " ", &save)))
+        {
+            char *val = strchr(tok, '=');
+
+            if (!val) { continue; }
+
+            *val++ = '\0';
+
+            if (strcmp(tok, "state") == 0)
+            {
+                ptt_t p = priv->ptt;
+
+                if (strcmp(val, "TRANSMITTING") == 0) { p = RIG_PTT_ON; }
+                else if (strcmp(val, "READY") == 0 || strcmp(val, "RECEIVE") == 0)
+                {
+                    p = RIG_PTT_OFF;
+                }
+
+                if (p != priv->ptt) { priv->ptt = p; ptt = p; ptt_changed = 1; }
+            }
+            else if (strcmp(tok, "rfpower") == 0)
+            {
+                priv->rfpower = atoi(val);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&priv->lock);
+
+    if (ptt_changed) { rig_fire_ptt_event(rig, RIG_VFO_TX, ptt); }
+
+    if (slice >= 0 && changed && sl.in_use)
+    {
+        vfo_t vfo = smartsdr_slice2vfo(priv, slice);
+
+        if (vfo == RIG_VFO_NONE) { return; }
+
+        if (changed & CHANGED_FREQ) { rig_fire_freq_event(rig, vfo, sl.freq); }
+
+        if ((changed & CHANGED_MODE) && sl.mode != RIG_MODE_NONE)
+        {
+            rig_fire_mode_event(rig, vfo, sl.mode, sl.filter_hi - sl.filter_lo);
+        }
+    }
+}
+
+
+static void smartsdr_line(RIG *rig, char *line)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    char *bar;
+
+    switch (line[0])
+    {
+    case 'V':
+        pthread_mutex_lock(&priv->lock);
+        SNPRINTF(priv->version, sizeof(priv->version), "%s", line + 1);
+        pthread_mutex_unlock(&priv->lock);
+        break;
+
+    case 'H':
+        pthread_mutex_lock(&priv->lock);
+        priv->handle = strtoul(line + 1, NULL, 16);
+        pthread_cond_broadcast(&priv->cond);
+        pthread_mutex_unlock(&priv->lock);
+        break;
+
+    case 'R':
+    {
+        unsigned seq = strtoul(line + 1, &bar, 10);
+        unsigned status = 0;
+        char *text = "";
+
+        if (*bar == '|')
+        {
+            status = strtoul(bar + 1, &bar, 16);
+
+            if (*bar == '|') { text = bar + 1; }
+        }
+
+        pthread_mutex_lock(&priv->lock);
+        priv->replies++;
+
+        if (seq == priv->wait_seq && !priv->reply_done)
+        {
+            priv->reply_status = status;
+            SNPRINTF(priv->reply, sizeof(priv->reply), "%s", text);
+            priv->reply_done = 1;
+            pthread_cond_broadcast(&priv->cond);
+        }
+        else
+        {
+            /* answer to a command we gave up on */
+            priv->stale++;
+        }
+
+        pthread_mutex_unlock(&priv->lock);
+        break;
+    }
+
+    case 'S':
+        bar = strchr(line, '|');
+
+        if (bar) { smartsdr_status(rig, bar + 1); }
+
+        break;
+
+    case 'M':
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: radio message %s\n", __func__, line + 1);
+        break;
+    }
+}
+
+
+static unsigned get32be(const unsigned char *p)
+{
+    return ((unsigned) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+
+/* VITA-49 extension data packet with meter id/value pairs */
+static void smartsdr_vita(struct smartsdr_priv_data *priv,
+                          const unsigned char *buf, int len)
+{
+    unsigned word0;
+    int off = 4, size;
+
+    if (len < 4) { return; }
+
+    word0 = get32be(buf);
+    size = (word0 & 0xffff) * 4;
+
+    if (size < len) { len = size; }
+
+    if ((word0 >> 28) & 1) { off += 4; }        /* stream id */
+
+    if ((word0 >> 27) & 1)                      /* class id */
+    {
+        if (off + 8 > len || ((buf[off + 6] << 8) | buf[off + 7]) != 0x8002)
+        {
+            return;                             /* not a meter packet */
+        }
+
+        off += 8;
+    }
+
+    if ((word0 >> 22) & 3) { off += 4; }        /* integer timestamp */
+
+    if ((word0 >> 20) & 3) { off += 8; }        /* fractional timestamp */
+
+    pthread_mutex_lock(&priv->lock);
+    priv->meter_packets++;
+
+    for (; off + 4 <= len; off += 4)
+    {
+        unsigned id = (buf[off] << 8) | buf[off + 1];
+        short raw = (short)((buf[off + 2] << 8) | buf[off + 3]);
+        struct smartsdr_meter *m;
+
+        if (id >= SMARTSDR_METERS) { continue; }
+
+        m = &priv->meters[id];
+
+        if (m->level == 0) { continue; }
+
+        m->value = raw / m->scale;
+        m->valid = 1;
+    }
+
+    pthread_mutex_unlock(&priv->lock);
+}
+
+
+static void *smartsdr_thread(void *arg)
+{
+    RIG *rig = arg;
+    struct smartsdr_priv_data *priv = rig->state.priv;
+
+    while (priv->run)
+    {
+        struct pollfd pfd[2] =
+        {
+            { priv->fd, POLLIN, 0 },
+            { priv->udp_fd, POLLIN, 0 },
+        };
+        unsigned char buf[1500];
+        int n;
+
+        if (poll(pfd, priv->udp_fd >= 0 ? 2 : 1, 100) <= 0) { continue; }
+
+        if (priv->udp_fd >= 0 && (pfd[1].revents & POLLIN)
+                && (n = recv(priv->udp_fd, buf, sizeof(buf), 0)) > 0)
+        {
+            smartsdr_vita(priv, buf, n);
+        }
+
+        if (!(pfd[0].revents & (POLLIN | POLLHUP | POLLERR))) { continue; }
+
+        n = recv(priv->fd, buf, sizeof(buf), 0);
+
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) { continue; }
+
+        if (n <= 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: connection to the radio lost\n", __func__);
+            pthread_mutex_lock(&priv->lock);
+            priv->connected = 0;
+            pthread_cond_broadcast(&priv->cond);
+            pthread_mutex_unlock(&priv->lock);
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            if (buf[i] == '\n' || buf[i] == '\r')
+            {
+                if (priv->linelen > 0)
+                {
+                    priv->line[priv->linelen] = '\0';
+                    smartsdr_line(rig, priv->line);
+                    priv->linelen = 0;
+                }
+            }
+            else if (priv->linelen < SMARTSDR_LINE - 1)
+            {
+                priv->line[priv->linelen++] = buf[i];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+static int smartsdr_udp_open(RIG *rig)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    struct sockaddr_in sin;
+    socklen_t sinlen = sizeof(sin);
+    char cmd[64];
+
+    priv->udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (priv->udp_fd < 0) { return -RIG_EIO; }
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_ANY);
+    sin.sin_port = 0;
+
+    if (bind(priv->udp_fd, (struct sockaddr *) &sin, sizeof(sin)) < 0
+            || getsockname(priv->udp_fd, (struct sockaddr *) &sin, &sinlen) < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: meter socket: %s\n", __func__,
+                  strerror(errno));
+        close(priv->udp_fd);
+        priv->udp_fd = -1;
+        return -RIG_EIO;
+    }
+
+    SNPRINTF(cmd, sizeof(cmd), "client udpport %u", ntohs(sin.sin_port));
+
+    return smartsdr_command(rig, cmd, NULL, 0);
+}
+
+#else
+
+static int smartsdr_command(RIG *rig, const char *cmd, char *reply,
+                            int reply_len)
+{
+    return -RIG_ENIMPL;
+}
+
+#endif /* HAVE_SYS_SOCKET_H */
+
+
+static int smartsdr_init(RIG *rig)
+{
+    struct smartsdr_priv_data *priv;
+
+    rig->state.priv = calloc(1, sizeof(struct smartsdr_priv_data));
+
+    if (!rig->state.priv) { return -RIG_ENOMEM; }
+
+    priv = rig->state.priv;
+    priv->want_meters = 1;
+    priv->fd = -1;
+    priv->udp_fd = -1;
+    priv->park[0] = priv->park[1] = -1;
+    pthread_mutex_init(&priv->lock, NULL);
+    pthread_mutex_init(&priv->cmd_lock, NULL);
+    pthread_cond_init(&priv->cond, NULL);
+
+    strncpy(rig->state.rigport.pathname, DEFAULT_SMARTSDR_ADDR,
+            HAMLIB_FILPATHLEN - 1);
+
+    return RIG_OK;
+}
+
+
+static int smartsdr_cleanup(RIG *rig)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+
+    if (priv)
+    {
+        pthread_mutex_destroy(&priv->lock);
+        pthread_mutex_destroy(&priv->cmd_lock);
+        pthread_cond_destroy(&priv->cond);
+        free(priv);
+    }
+
+    rig->state.priv = NULL;
+
+    return RIG_OK;
+}
+
+
+static int smartsdr_set_conf(RIG *rig, token_t token, const char *val)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+
+    switch (token)
+    {
+    case TOK_SLICE:
+        priv->slice = atoi(val);
+
+        if (priv->slice < 0 || priv->slice > SMARTSDR_SLICES - 2)
+        {
+            priv->slice = 0;
+            return -RIG_EINVAL;
+        }
+
+        break;
+
+    case TOK_METERS:
+        priv->want_meters = atoi(val) != 0;
+        break;
+
+    default:
+        return -RIG_EINVAL;
+    }
+
+    return RIG_OK;
+}
+
+
+static int smartsdr_get_conf2(RIG *rig, token_t token, char *val, int val_len)
+{
+    const struct smartsdr_priv_data *priv = rig->state.priv;
+
+    switch (token)
+    {
+    case TOK_SLICE:
+        SNPRINTF(val, val_len, "%d", priv->slice);
+        break;
+
+    case TOK_METERS:
+        SNPRINTF(val, val_len, "%d", priv->want_meters);
+        break;
+
+    default:
+        return -RIG_EINVAL;
+    }
+
+    return RIG_OK;
+}
+
+
+static int smartsdr_close(RIG *rig);
+
+static int smartsdr_open(RIG *rig)
+{
+#ifdef HAVE_SYS_SOCKET_H
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    static const char *const subs[] = { "sub slice all", "sub tx all" };
+    long start;
+    int retval, i;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, priv->park) < 0)
+    {
+        return -RIG_EIO;
+    }
+
+    priv->fd = rig->state.rigport.fd;
+    rig->state.rigport.fd = priv->park[0];
+    priv->connected = 1;
+    priv->handle = 0;
+    priv->linelen = 0;
+    memset(priv->slices, 0, sizeof(priv->slices));
+    memset(priv->meters, 0, sizeof(priv->meters));
+
+    priv->run = 1;
+
+    if (pthread_create(&priv->thread, NULL, smartsdr_thread, rig) != 0)
+    {
+        smartsdr_close(rig);
+        return -RIG_EINTERNAL;
+    }
+
+    priv->thread_started = 1;
+
+    /* the radio introduces itself first */
+    start = now_ms();
+    pthread_mutex_lock(&priv->lock);
+
+    while (priv->handle == 0 && priv->connected
+            && now_ms() - start < SMARTSDR_HELLO_MS)
+    {
+        pthread_mutex_unlock(&priv->lock);
+        hl_usleep(10 * 1000);
+        pthread_mutex_lock(&priv->lock);
+    }
+
+    retval = priv->handle ? RIG_OK : -RIG_EPROTO;
+    pthread_mutex_unlock(&priv->lock);
+
+    if (retval != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: no handle from the radio\n", __func__);
+        smartsdr_close(rig);
+        return retval;
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: SmartSDR %s, handle %08X\n", __func__,
+              priv->version, priv->handle);
+
+    for (i = 0; i < sizeof(subs) / sizeof(subs[0]); i++)
+    {
+        retval = smartsdr_command(rig, subs[i], NULL, 0);
+
+        if (retval != RIG_OK)
+        {
+            smartsdr_close(rig);
+            return retval;
+        }
+    }
+
+    if (priv->want_meters)
+    {
+        retval = smartsdr_udp_open(rig);
+
+        if (retval == RIG_OK) { retval = smartsdr_command(rig, "sub meter all", NULL, 0); }
+
+        if (retval != RIG_OK)
+        {
+            /* meters are a nicety, control works without them */
+            rig_debug(RIG_DEBUG_WARN, "%s: no meter stream\n", __func__);
+        }
+
+        /* so the first get_level finds values, meters run at 10 fps or more */
+        start = now_ms();
+
+        while (retval == RIG_OK && priv->meter_packets == 0
+                && now_ms() - start < 250)
+        {
+            hl_usleep(10 * 1000);
+        }
+    }
+
+    /* the subscription replays the current state of every slice */
+    start = now_ms();
+
+    while (!priv->slices[priv->slice].in_use
+            && now_ms() - start < rig->state.rigport.timeout)
+    {
+        hl_usleep(10 * 1000);
+    }
+
+    if (!priv->slices[priv->slice].in_use)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: slice %d is not open on the radio\n",
+                  __func__, priv->slice);
+    }
+
+    return RIG_OK;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+static int smartsdr_close(RIG *rig)
+{
+#ifdef HAVE_SYS_SOCKET_H
+    struct smartsdr_priv_data *priv = rig->state.priv;
+
+    if (priv->thread_started)
+    {
+        priv->run = 0;
+        pthread_join(priv->thread, NULL);
+        priv->thread_started = 0;
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE,
+              "%s: %lu commands, %lu replies (%lu stale), %lu status lines, "
+              "%lu meter packets\n", __func__, priv->commands, priv->replies,
+              priv->stale, priv->status, priv->meter_packets);
+
+    if (priv->udp_fd >= 0) { close(priv->udp_fd); }
+
+    priv->udp_fd = -1;
+
+    /* port_close() closes the TCP socket */
+    if (priv->fd >= 0) { rig->state.rigport.fd = priv->fd; }
+
+    priv->fd = -1;
+
+    if (priv->park[0] >= 0) { close(priv->park[0]); }
+
+    if (priv->park[1] >= 0) { close(priv->park[1]); }
+
+    priv->park[0] = priv->park[1] = -1;
+    priv->connected = 0;
+#endif
+
+    return RIG_OK;
+}
+
+
+static int smartsdr_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    int slice = smartsdr_vfo2slice(rig, vfo);
+    char cmd[64];
+    int retval;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: vfo=%s freq=%.0f\n", __func__,
+              rig_strvfo(vfo), freq);
+
+    if (slice < 0) { return -RIG_EINVAL; }
+
+    SNPRINTF(cmd, sizeof(cmd), "slice tune %d %.6f", slice, freq / 1e6);
+    retval = smartsdr_command(rig, cmd, NULL, 0);
+
+    if (retval == RIG_OK)
+    {
+        /* the status line may come after the reply */
+        pthread_mutex_lock(&priv->lock);
+        priv->slices[slice].freq = freq;
+        pthread_mutex_unlock(&priv->lock);
+    }
+
+    return retval;
+}
+
+
+static int smartsdr_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    int slice = smartsdr_vfo2slice(rig, vfo);
+    int retval = RIG_OK;
+
+    if (slice < 0) { return -RIG_EINVAL; }
+
+    pthread_mutex_lock(&priv->lock);
+
+    if (priv->slices[slice].in_use) { *freq = priv->slices[slice].freq; }
+    else { retval = -RIG_ENAVAIL; }
+
+    pthread_mutex_unlock(&priv->lock);
+
+    return retval;
+}
+
+
+static int smartsdr_set_mode(RIG *rig, vfo_t vfo, rmode_t mode,
+                             pbwidth_t width)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    int slice = smartsdr_vfo2slice(rig, vfo);
+    const char *name = smartsdr_mode2str(mode);
+    char cmd[64];
+    int lo, hi, retval;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: vfo=%s mode=%s width=%d\n", __func__,
+              rig_strvfo(vfo), rig_strrmode(mode), (int) width);
+
+    if (slice < 0 || name == NULL) { return -RIG_EINVAL; }
+
+    SNPRINTF(cmd, sizeof(cmd), "slice set %d mode=%s", slice, name);
+    retval = smartsdr_command(rig, cmd, NULL, 0);
+
+    if (retval != RIG_OK || width == RIG_PASSBAND_NOCHANGE) { return retval; }
+
+    if (width == RIG_PASSBAND_NORMAL) { width = rig_passband_normal(rig, mode); }
+
+    /* filter edges are relative to the slice frequency */
+    switch (mode)
+    {
+    case RIG_MODE_USB:
+    case RIG_MODE_PKTUSB:
+        lo = 100;
+        hi = 100 + width;
+        break;
+
+    case RIG_MODE_LSB:
+    case RIG_MODE_PKTLSB:
+        lo = -100 - width;
+        hi = -100;
+        break;
+
+    default:
+        lo = -width / 2;
+        hi = width / 2;
+        break;
+    }
+
+    SNPRINTF(cmd, sizeof(cmd), "filt %d %d %d", slice, lo, hi);
+    retval = smartsdr_command(rig, cmd, NULL, 0);
+
+    if (retval == RIG_OK)
+    {
+        pthread_mutex_lock(&priv->lock);
+        priv->slices[slice].mode = mode;
+        priv->slices[slice].filter_lo = lo;
+        priv->slices[slice].filter_hi = hi;
+        pthread_mutex_unlock(&priv->lock);
+    }
+
+    return retval;
+}
+
+
+static int smartsdr_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode,
+                             pbwidth_t *width)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    int slice = smartsdr_vfo2slice(rig, vfo);
+    int retval = RIG_OK;
+
+    if (slice < 0) { return -RIG_EINVAL; }
+
+    pthread_mutex_lock(&priv->lock);
+
+    if (priv->slices[slice].in_use)
+    {
+        *mode = priv->slices[slice].mode;
+        *width = priv->slices[slice].filter_hi - priv->slices[slice].filter_lo;
+    }
+    else
+    {
+        retval = -RIG_ENAVAIL;
+    }
+
+    pthread_mutex_unlock(&priv->lock);
+
+    return retval;
+}
+
+
+static int smartsdr_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
+{
+    char cmd[16];
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: ptt=%d\n", __func__, ptt);
+
+    SNPRINTF(cmd, sizeof(cmd), "xmit %d", ptt == RIG_PTT_OFF ? 0 : 1);
+
+    return smartsdr_command(rig, cmd, NULL, 0);
+}
+
+
+static int smartsdr_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+
+    pthread_mutex_lock(&priv->lock);
+    *ptt = priv->ptt;
+    pthread_mutex_unlock(&priv->lock);
+
+    return RIG_OK;
+}
+
+
+static int smartsdr_set_split_vfo(RIG *rig, vfo_t vfo, split_t split,
+                                  vfo_t tx_vfo)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    char cmd[32];
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: split=%d tx_vfo=%s\n", __func__, split,
+              rig_strvfo(tx_vfo));
+
+    SNPRINTF(cmd, sizeof(cmd), "slice set %d tx=1",
+             split == RIG_SPLIT_ON ? priv->slice + 1 : priv->slice);
+
+    return smartsdr_command(rig, cmd, NULL, 0);
+}
+
+
+static int smartsdr_get_split_vfo(RIG *rig, vfo_t vfo, split_t *split,
+                                  vfo_t *tx_vfo)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+
+    pthread_mutex_lock(&priv->lock);
+    *split = priv->slices[priv->slice + 1].in_use
+             && priv->slices[priv->slice + 1].tx ? RIG_SPLIT_ON : RIG_SPLIT_OFF;
+    pthread_mutex_unlock(&priv->lock);
+
+    *tx_vfo = *split == RIG_SPLIT_ON ? RIG_VFO_B : RIG_VFO_A;
+
+    return RIG_OK;
+}
+
+
+static int smartsdr_set_level(RIG *rig, vfo_t vfo, setting_t level,
+                              value_t val)
+{
+    int slice = smartsdr_vfo2slice(rig, vfo);
+    char cmd[64];
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: level=%s val=%g\n", __func__,
+              rig_strlevel(level), val.f);
+
+    switch (level)
+    {
+    case RIG_LEVEL_AF:
+        SNPRINTF(cmd, sizeof(cmd), "slice set %d audio_level=%d", slice,
+                 (int)(val.f * 100 + 0.5));
+        break;
+
+    case RIG_LEVEL_RFPOWER:
+        SNPRINTF(cmd, sizeof(cmd), "transmit set rfpower=%d",
+                 (int)(val.f * 100 + 0.5));
+        break;
+
+    default:
+        return -RIG_EINVAL;
+    }
+
+    return smartsdr_command(rig, cmd, NULL, 0);
+}
+
+
+/* latest value of a streamed meter, with priv->lock held */
+static int smartsdr_meter(const struct smartsdr_priv_data *priv,
+                          setting_t level, int slice, value_t *val)
+{
+    setting_t want = level == RIG_LEVEL_RFPOWER_METER
+                     ? RIG_LEVEL_RFPOWER_METER_WATTS : level;
+    int i;
+
+    for (i = 0; i < SMARTSDR_METERS; i++)
+    {
+        const struct smartsdr_meter *m = &priv->meters[i];
+        float v;
+
+        if (m->level != want || !m->valid
+                || (m->level == RIG_LEVEL_STRENGTH && m->slice != slice))
+        {
+            continue;
+        }
+
+        v = m->value;
+
+        if (m->dbm_to_watts) { v = pow(10.0, (v - 30.0) / 10.0); }
+
+        switch (level)
+        {
+        case RIG_LEVEL_STRENGTH:
+            val->i = (int) floor(v + 73.0 + 0.5);   /* S9 is -73 dBm */
+            break;
+
+        case RIG_LEVEL_RFPOWER_METER:
+            val->f = v / SMARTSDR_MAX_WATTS;
+            break;
+
+        default:
+            val->f = v;
+            break;
+        }
+
+        return RIG_OK;
+    }
+
+    return -RIG_ENAVAIL;
+}
+
+
+static int smartsdr_get_level(RIG *rig, vfo_t vfo, setting_t level,
+                              value_t *val)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    int slice = smartsdr_vfo2slice(rig, vfo);
+    int retval = RIG_OK;
+
+    if (slice < 0) { return -RIG_EINVAL; }
+
+    pthread_mutex_lock(&priv->lock);
+
+    switch (level)
+    {
+    case RIG_LEVEL_AF:
+        val->f = priv->slices[slice].audio_level / 100.0f;
+        break;
+
+    case RIG_LEVEL_RFPOWER:
+        val->f = priv->rfpower / 100.0f;
+        break;
+
+    default:
+        retval = smartsdr_meter(priv, level, slice, val);
+        break;
+    }
+
+    pthread_mutex_unlock(&priv->lock);
+
+    return retval;
+}
+
+
+/* all meters come from the stream, so one call serves any set of them */
+static int smartsdr_get_meters(RIG *rig, vfo_t vfo, setting_t *levels,
+                               value_t *vals)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+    int slice = smartsdr_vfo2slice(rig, vfo);
+    setting_t got = 0;
+    int i;
+
+    pthread_mutex_lock(&priv->lock);
+
+    for (i = 0; i < RIG_SETTING_MAX; i++)
+    {
+        setting_t level = rig_idx2setting(i);
+
+        if ((*levels & level)
+                && smartsdr_meter(priv, level, slice, &vals[i]) == RIG_OK)
+        {
+            got |= level;
+        }
+    }
+
+    pthread_mutex_unlock(&priv->lock);
+
+    *levels = got;
+
+    return RIG_OK;
+}
+
+
+static const char *smartsdr_get_info(RIG *rig)
+{
+    struct smartsdr_priv_data *priv = rig->state.priv;
+
+    pthread_mutex_lock(&priv->lock);
+    SNPRINTF(priv->info, sizeof(priv->info), "SmartSDR %s, handle %08X",
+             priv->version, priv->handle);
+    pthread_mutex_unlock(&priv->lock);
+
+    return priv->info;
+}
+
+
+#define SMARTSDR_MODES (RIG_MODE_SSB|RIG_MODE_CW|RIG_MODE_AM|RIG_MODE_SAM| \
+        RIG_MODE_FM|RIG_MODE_FMN|RIG_MODE_PKTFM|RIG_MODE_PKTUSB|RIG_MODE_PKTLSB| \
+        RIG_MODE_RTTY)
+
+#define SMARTSDR_METER_LEVELS (RIG_LEVEL_STRENGTH|RIG_LEVEL_SWR|RIG_LEVEL_ALC| \
+        RIG_LEVEL_RFPOWER_METER|RIG_LEVEL_RFPOWER_METER_WATTS| \
+        RIG_LEVEL_COMP_METER|RIG_LEVEL_TEMP_METER|RIG_LEVEL_VD_METER)
+
+#define SMARTSDR_LEVELS (RIG_LEVEL_AF|RIG_LEVEL_RFPOWER)
+
+#define SMARTSDR_VFO (RIG_VFO_A|RIG_VFO_B)
+
+const struct rig_caps smartsdr_rig_caps =
+{
+    RIG_MODEL(RIG_MODEL_SMARTSDR),
+    .model_name =     "SmartSDR",
+    .mfg_name =       "FlexRadio",
+    .version =        "20261018.0",
+    .copyright =      "LGPL",
+    .status =         RIG_STATUS_ALPHA,
+    .rig_type =       RIG_TYPE_TRANSCEIVER,
+    .targetable_vfo = RIG_TARGETABLE_FREQ | RIG_TARGETABLE_MODE,
+    .ptt_type =       RIG_PTT_RIG,
+    .dcd_type =       RIG_DCD_NONE,
+    .port_type =      RIG_PORT_NETWORK,
+    .timeout =        1000,
+    .retry =          0,
+    .has_get_func =   RIG_FUNC_NONE,
+    .has_set_func =   RIG_FUNC_NONE,
+    .has_get_level =  SMARTSDR_LEVELS | SMARTSDR_METER_LEVELS,
+    .has_set_level =  SMARTSDR_LEVELS,
+    .has_get_parm =   RIG_PARM_NONE,
+    .has_set_parm =   RIG_PARM_NONE,
+    .chan_list =      { RIG_CHAN_END, },
+    .scan_ops =       RIG_SCAN_NONE,
+    .vfo_ops =        RIG_OP_NONE,
+    .transceive =     RIG_TRN_RIG,
+    .async_data_supported = 1,
+    .attenuator =     { RIG_DBLST_END, },
+    .preamp =         { RIG_DBLST_END, },
+    .rx_range_list1 = { {
+            .startf = kHz(30), .endf = MHz(77), .modes = SMARTSDR_MODES,
+            .low_power = -1, .high_power = -1, SMARTSDR_VFO
+        },
+        RIG_FRNG_END,
+    },
+    .tx_range_list1 = { RIG_FRNG_END, },
+    .rx_range_list2 = { {
+            .startf = kHz(30), .endf = MHz(77), .modes = SMARTSDR_MODES,
+            .low_power = -1, .high_power = -1, SMARTSDR_VFO
+        },
+        RIG_FRNG_END,
+    },
+    .tx_range_list2 = { RIG_FRNG_END, },
+    .tuning_steps =   { {SMARTSDR_MODES, 1}, {SMARTSDR_MODES, RIG_TS_ANY}, RIG_TS_END, },
+    .filters =        {
+        {RIG_MODE_SSB | RIG_MODE_PKTUSB | RIG_MODE_PKTLSB, kHz(2.7)},
+        {RIG_MODE_CW | RIG_MODE_RTTY, 500},
+        {RIG_MODE_AM | RIG_MODE_SAM, kHz(6)},
+        {RIG_MODE_FM | RIG_MODE_PKTFM, kHz(12)},
+        {RIG_MODE_FMN, kHz(6)},
+        {SMARTSDR_MODES, RIG_FLT_ANY},
+        RIG_FLT_END,
+    },
+
+    .priv =  NULL,
+
+    .rig_init =       smartsdr_init,
+    .rig_cleanup =    smartsdr_cleanup,
+    .rig_open =       smartsdr_open,
+    .rig_close =      smartsdr_close,
+
+    .cfgparams =      smartsdr_cfg_params,
+    .set_conf =       smartsdr_set_conf,
+    .get_conf2 =      smartsdr_get_conf2,
+
+    .set_freq =       smartsdr_set_freq,
+    .get_freq =       smartsdr_get_freq,
+    .set_mode =       smartsdr_set_mode,
+    .get_mode =       smartsdr_get_mode,
+    .set_ptt =        smartsdr_set_ptt,
+    .get_ptt =        smartsdr_get_ptt,
+    .set_split_vfo =  smartsdr_set_split_vfo,
+    .get_split_vfo =  smartsdr_get_split_vfo,
+
+    .set_level =      smartsdr_set_level,
+    .get_level =      smartsdr_get_level,
+    .get_meters =     smartsdr_get_meters,
+
+    .get_info =       smartsdr_get_info,
+    .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
+};
@@ -33,6 +33,7 @@
 #include <cal.h>
 #include <token.h>
 #include <register.h>
+#include <icomlan.h>
 
 #include "icom.h"
 #include "icom_defs.h"
@@ -434,6 +435,8 @@ struct icom_addr
 #define TOK_CIVADDR TOKEN_BACKEND(1)
 #define TOK_MODE731 TOKEN_BACKEND(2)
 #define TOK_NOXCHG TOKEN_BACKEND(3)
+#define TOK_LAN_USER TOKEN_BACKEND(4)
+#define TOK_LAN_PASSWORD TOKEN_BACKEND(5)
 
 const struct confparams icom_cfg_params[] =
 {
@@ -451,6 +454,15 @@ const struct confparams icom_cfg_params[] =
         "Don't Use VFO XCHG to set other VFO mode and Frequency",
         "0", RIG_CONF_CHECKBUTTON
     },
+    {
+        TOK_LAN_USER, "lan_user", "LAN user", "Network user set in the radio, "
+        "talks the radio's own LAN protocol when the port is host:50001",
+        "", RIG_CONF_STRING, { }
+    },
+    {
+        TOK_LAN_PASSWORD, "lan_password", "LAN password",
+        "Network password set in the radio", "", RIG_CONF_STRING, { }
+    },
     {RIG_CONF_END, NULL,}
 };
 
@@ -657,14 +669,7 @@ int icom_init(RIG *rig)
             RETURNFUNC(-RIG_ECONF);
         }
 
-        priv->spectrum_scope_cache[i].spectrum_data = calloc(1,
-                priv_caps->spectrum_scope_caps.spectrum_line_length);
-
-        if (!priv->spectrum_scope_cache[i].spectrum_data)
-        {
-            RETURNFUNC(-RIG_ENOMEM);
-        }
-
+        /* the line buffer is allocated by the first spectrum frame */
         priv->spectrum_scope_count++;
     }
 
@@ -736,6 +741,8 @@ int icom_cleanup(RIG *rig)
 
     priv = rig->state.priv;
 
+    icomlan_forget(&rig->state.rigport);
+
     for (i = 0; rig->caps->spectrum_scopes[i].name != NULL; i++)
     {
         if (priv->spectrum_scope_cache[i].spectrum_data)
@@ -5062,6 +5069,16 @@ int icom_set_conf(RIG *rig, token_t token, const char *val)
         priv->no_xchg = atoi(val) ? 1 : 0;
         break;
 
+    case TOK_LAN_USER:
+        SNPRINTF(priv->lan_user, sizeof(priv->lan_user), "%s", val);
+        RETURNFUNC(icomlan_set_login(&rs->rigport, priv->lan_user,
+                                     priv->lan_password));
+
+    case TOK_LAN_PASSWORD:
+        SNPRINTF(priv->lan_password, sizeof(priv->lan_password), "%s", val);
+        RETURNFUNC(icomlan_set_login(&rs->rigport, priv->lan_user,
+                                     priv->lan_password));
+
     default:
         RETURNFUNC(-RIG_EINVAL);
     }
@@ -5095,6 +5112,13 @@ int icom_get_conf2(RIG *rig, token_t token, char *val, int val_len)
     case TOK_NOXCHG: SNPRINTF(val, val_len, "%d", priv->no_xchg);
         break;
 
+    case TOK_LAN_USER: SNPRINTF(val, val_len, "%s", priv->lan_user);
+        break;
+
+    case TOK_LAN_PASSWORD: SNPRINTF(val, val_len, "%s",
+                                        priv->lan_password[0] ? "********" : "");
+        break;
+
     default: RETURNFUNC(-RIG_EINVAL);
     }
 
@@ -9052,6 +9076,17 @@ static int icom_parse_spectrum_frame(RIG *rig, size_t length,
 
     cache = &priv->spectrum_scope_cache[spectrum_id];
 
+    if (cache->spectrum_data == NULL)
+    {
+        cache->spectrum_data = calloc(1,
+                                      priv_caps->spectrum_scope_caps.spectrum_line_length);
+
+        if (cache->spectrum_data == NULL)
+        {
+            RETURNFUNC(-RIG_ENOMEM);
+        }
+    }
+
     if (division == 1)
     {
         int spectrum_scope_mode = frame_data[3];
@@ -35,7 +35,7 @@
 #include <sys/time.h>
 #endif
 
-#define BACKEND_VER "20231116"
+#define BACKEND_VER "20261018"
 
 #define ICOM_IS_ID31 rig_is_model(rig, RIG_MODEL_ID31)
 #define ICOM_IS_ID51 rig_is_model(rig, RIG_MODEL_ID51)
@@ -280,6 +280,8 @@ struct icom_priv_data
     freq_t other_freq; /*!< Our other freq depending on which vfo is selected */
     int vfo_flag; // used to skip vfo check when frequencies are equal
     int dual_watch; // dual watch mode on status
+    char lan_user[17]; /*!< Radio's network user, enables the LAN protocol on UDP ports */
+    char lan_password[17]; /*!< Radio's network password */
 };
 
 extern const struct ts_sc_list r8500_ts_sc_list[];
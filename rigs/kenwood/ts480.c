@@ -477,6 +477,60 @@ static int ts480_read_meters(RIG *rig, int *swr, int *comp, int *alc)
     RETURNFUNC(RIG_OK);
 }
 
+/* RIG_LEVEL_SWR, COMP_METER and ALC from the RM; readings */
+static void ts480_meter_value(RIG *rig, setting_t level, int swr, int comp,
+                              int alc, value_t *val)
+{
+    switch (level)
+    {
+    case RIG_LEVEL_SWR:
+        if (rig->caps->swr_cal.size)
+        {
+            val->f = rig_raw2val_float(swr, &rig->caps->swr_cal);
+        }
+        else
+        {
+            val->f = (float) swr / 2.0f;
+        }
+
+        break;
+
+    case RIG_LEVEL_COMP_METER:
+        val->f = (float) comp; // Maximum value is 20dB
+        break;
+
+    case RIG_LEVEL_ALC:
+        // Maximum value is 20, so have the max at 5 just to be on the range where other rigs report ALC
+        val->f = (float) alc / 4.0f;
+        break;
+    }
+}
+
+/* one RM; answers all three meters */
+static int ts480_get_meters(RIG *rig, vfo_t vfo, setting_t *levels, value_t *vals)
+{
+    const setting_t rm = RIG_LEVEL_SWR | RIG_LEVEL_COMP_METER | RIG_LEVEL_ALC;
+    int swr, comp, alc, retval, i;
+
+    *levels &= rm;
+
+    if (*levels == 0) { return RIG_OK; }
+
+    retval = ts480_read_meters(rig, &swr, &comp, &alc);
+
+    if (retval != RIG_OK) { return retval; }
+
+    for (i = 0; i < RIG_SETTING_MAX; i++)
+    {
+        if (*levels & rig_idx2setting(i))
+        {
+            ts480_meter_value(rig, rig_idx2setting(i), swr, comp, alc, &vals[i]);
+        }
+    }
+
+    return RIG_OK;
+}
+
 
 /*
  * kenwood_ts480_get_level
@@ -674,33 +728,7 @@ kenwood_ts480_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
             RETURNFUNC(retval);
         }
 
-        switch (level)
-        {
-        case RIG_LEVEL_SWR:
-            if (rig->caps->swr_cal.size)
-            {
-                val->f = rig_raw2val_float(swr, &rig->caps->swr_cal);
-            }
-            else
-            {
-                val->f = (float) swr / 2.0f;
-            }
-
-            break;
-
-        case RIG_LEVEL_COMP_METER:
-            val->f = (float) comp; // Maximum value is 20dB
-            break;
-
-        case RIG_LEVEL_ALC:
-            // Maximum value is 20, so have the max at 5 just to be on the range where other rigs report ALC
-            val->f = (float) alc / 4.0f;
-            break;
-
-        default:
-            return -RIG_ENAVAIL;
-        }
-
+        ts480_meter_value(rig, level, swr, comp, alc, val);
         break;
     }
 
@@ -1423,6 +1451,7 @@ const struct rig_caps ts480_caps =
     .has_get_level = TS480_LEVEL_GET,
     .set_level = kenwood_ts480_set_level,
     .get_level = kenwood_ts480_get_level,
+    .get_meters = ts480_get_meters,
     .set_ext_level = ts480_set_ext_level,
     .get_ext_level = ts480_get_ext_level,
     .has_get_func = TS480_FUNC_ALL,
@@ -1617,6 +1646,7 @@ const struct rig_caps qrplabs_caps =
     .has_get_level = TS480_LEVEL_GET,
     .set_level = kenwood_ts480_set_level,
     .get_level = kenwood_ts480_get_level,
+    .get_meters = ts480_get_meters,
     .set_ext_level = ts480_set_ext_level,
     .get_ext_level = ts480_get_ext_level,
     .has_get_func = TS480_FUNC_ALL,
@@ -1795,6 +1825,7 @@ const struct rig_caps pt8000a_caps =
     .has_get_level = TS480_LEVEL_GET,
     .set_level = kenwood_ts480_set_level,
     .get_level = kenwood_ts480_get_level,
+    .get_meters = ts480_get_meters,
     .has_get_func = TS480_FUNC_ALL,
     .has_set_func = TS480_FUNC_ALL,
     .set_func = kenwood_set_func,
@@ -1983,6 +2014,7 @@ const struct rig_caps sdruno_caps =
     .has_get_level = TS480_LEVEL_GET,
     .set_level = kenwood_ts480_set_level,
     .get_level = kenwood_ts480_get_level,
+    .get_meters = ts480_get_meters,
     .set_ext_level = ts480_set_ext_level,
     .get_ext_level = ts480_get_ext_level,
     .has_get_func = TS480_FUNC_ALL,
@@ -634,6 +634,60 @@ static int ts590_read_meters(RIG *rig, int *swr, int *comp, int *alc)
     RETURNFUNC(RIG_OK);
 }
 
+/* RIG_LEVEL_SWR, COMP_METER and ALC from the RM; readings */
+static void ts590_meter_value(RIG *rig, setting_t level, int swr, int comp,
+                              int alc, value_t *val)
+{
+    switch (level)
+    {
+    case RIG_LEVEL_SWR:
+        if (rig->caps->swr_cal.size)
+        {
+            val->f = rig_raw2val_float(swr, &rig->caps->swr_cal);
+        }
+        else
+        {
+            val->f = (float) swr / 2.0f;
+        }
+
+        break;
+
+    case RIG_LEVEL_COMP_METER:
+        val->f = (float) comp; // Maximum value is 30
+        break;
+
+    case RIG_LEVEL_ALC:
+        // Maximum value is 30, so have the max at 5 just to be on the range where other rigs report ALC
+        val->f = (float) alc / 6.0f;
+        break;
+    }
+}
+
+/* one RM; answers all three meters */
+static int ts590_get_meters(RIG *rig, vfo_t vfo, setting_t *levels, value_t *vals)
+{
+    const setting_t rm = RIG_LEVEL_SWR | RIG_LEVEL_COMP_METER | RIG_LEVEL_ALC;
+    int swr, comp, alc, retval, i;
+
+    *levels &= rm;
+
+    if (*levels == 0) { return RIG_OK; }
+
+    retval = ts590_read_meters(rig, &swr, &comp, &alc);
+
+    if (retval != RIG_OK) { return retval; }
+
+    for (i = 0; i < RIG_SETTING_MAX; i++)
+    {
+        if (*levels & rig_idx2setting(i))
+        {
+            ts590_meter_value(rig, rig_idx2setting(i), swr, comp, alc, &vals[i]);
+        }
+    }
+
+    return RIG_OK;
+}
+
 static int ts590_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
 {
     struct kenwood_priv_data *priv = rig->state.priv;
@@ -863,33 +917,7 @@ static int ts590_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
             RETURNFUNC(retval);
         }
 
-        switch (level)
-        {
-        case RIG_LEVEL_SWR:
-            if (rig->caps->swr_cal.size)
-            {
-                val->f = rig_raw2val_float(swr, &rig->caps->swr_cal);
-            }
-            else
-            {
-                val->f = (float) swr / 2.0f;
-            }
-
-            break;
-
-        case RIG_LEVEL_COMP_METER:
-            val->f = (float) comp; // Maximum value is 30
-            break;
-
-        case RIG_LEVEL_ALC:
-            // Maximum value is 30, so have the max at 5 just to be on the range where other rigs report ALC
-            val->f = (float) alc / 6.0f;
-            break;
-
-        default:
-            return -RIG_ENAVAIL;
-        }
-
+        ts590_meter_value(rig, level, swr, comp, alc, val);
         break;
     }
 
@@ -1737,6 +1765,7 @@ const struct rig_caps ts590_caps =
     .has_get_level = TS590_LEVEL_GET,
     .set_level = ts590_set_level,
     .get_level = ts590_get_level,
+    .get_meters = ts590_get_meters,
     .set_ext_level = ts590_set_ext_level,
     .get_ext_level = ts590_get_ext_level,
     .has_get_func = TS590_FUNC_ALL,
@@ -1931,6 +1960,7 @@ const struct rig_caps fx4_caps =
     .has_get_level = TS590_LEVEL_GET,
     .set_level = ts590_set_level,
     .get_level = ts590_get_level,
+    .get_meters = ts590_get_meters,
     .set_ext_level = ts590_set_ext_level,
     .get_ext_level = ts590_get_ext_level,
     .has_get_func = TS590_FUNC_ALL,
@@ -2128,6 +2158,7 @@ const struct rig_caps ts590sg_caps =
     .has_get_level = TS590_LEVEL_GET,
     .set_level = ts590_set_level,
     .get_level = ts590_get_level,
+    .get_meters = ts590_get_meters,
     .set_ext_level = ts590_set_ext_level,
     .get_ext_level = ts590_get_ext_level,
     .has_get_func = TS590_FUNC_ALL,
@@ -157,8 +157,10 @@ const struct rig_caps esmc_caps =
     .get_freq =  rs_get_freq,
     .set_mode =  rs_set_mode,
     .get_mode =  rs_get_mode,
+    .rig_get_vfo_info =  rs_get_vfo_info,
     .set_level =  rs_set_level,
     .get_level =  rs_get_level,
+    .get_meters =  rs_get_meters,
     .set_func =  rs_set_func,
     .get_func =  rs_get_func,
     .get_info =  rs_get_info,
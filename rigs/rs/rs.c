@@ -37,6 +37,7 @@
 
 #define BUFSZ 64
 #define RESPSZ 64
+#define RS_QUERYSZ 128
 
 #define LF "\x0a"
 #define CR "\x0d"
@@ -88,6 +89,71 @@ int rs_transaction(RIG *rig, const char *cmd, int cmd_len, char *data,
     return RIG_OK;
 }
 
+/*
+ * rs_query
+ * Sends n SCPI queries in one message and splits the reply.  SCPI
+ * answers a "FREQ?;:DEM?;:BAND?" program message with the values in order,
+ * separated by ';', so several readings cost a single round trip.
+ * Queries are given without BOM/EOM; the leading ':' that keeps each one
+ * at the root of the command tree is added here.  reply[i] points into buf.
+ */
+int rs_query(RIG *rig, const char *const *query, int n, char *buf,
+             int buf_len, char **reply)
+{
+    struct rig_state *rs = &rig->state;
+    char cmd[RS_QUERYSZ];
+    int cmd_len, i, retval;
+    char *p;
+
+    cmd_len = snprintf(cmd, sizeof(cmd), BOM "%s", query[0]);
+
+    for (i = 1; i < n && cmd_len < sizeof(cmd); i++)
+    {
+        cmd_len += snprintf(cmd + cmd_len, sizeof(cmd) - cmd_len,
+                            query[i][0] == '*' ? ";%s" : ";:%s", query[i]);
+    }
+
+    if (cmd_len >= sizeof(cmd) - 1) { return -RIG_EINTERNAL; }
+
+    strcat(cmd, EOM);
+    cmd_len++;
+
+    rig_flush(&rs->rigport);
+
+    retval = write_block(&rs->rigport, (unsigned char *) cmd, cmd_len);
+
+    if (retval != RIG_OK)
+    {
+        return retval;
+    }
+
+    retval = read_string(&rs->rigport, (unsigned char *) buf, buf_len, CR, 1, 0, 1);
+
+    if (retval < 0)
+    {
+        return retval;
+    }
+
+    buf[strcspn(buf, CR LF)] = '\0';
+
+    for (i = 0, p = buf; i < n; i++)
+    {
+        if (!p)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: %d of %d replies in '%s'\n", __func__, i, n,
+                      buf);
+            return -RIG_EPROTO;
+        }
+
+        reply[i] = p;
+        p = strchr(p, ';');
+
+        if (p) { *p++ = '\0'; }
+    }
+
+    return RIG_OK;
+}
+
 /*
  * rs_set_freq
  * Assumes rig!=NULL
@@ -182,31 +248,122 @@ int rs_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
  */
 int rs_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width)
 {
-    char buf[RESPSZ];
-    int buf_len, retval;
+    static const char *const query[] = { "DEM?", "BAND?" };
+    char buf[RESPSZ], *reply[2];
+    int retval;
+
+    retval = rs_query(rig, query, 2, buf, sizeof(buf), reply);
+
+    if (retval < 0)
+    {
+        return retval;
+    }
 
-#define DEM_QUERY   BOM "DEM?" EOM
+    *mode = rig_parse_mode(reply[0]);
+    *width = atoi(reply[1]);
 
-    retval = rs_transaction(rig, DEM_QUERY, strlen(DEM_QUERY), buf, &buf_len);
+    return retval;
+}
+
+/*
+ * rs_get_vfo_info
+ * Frequency, mode and bandwidth in one exchange, for rig_get_vfo_info()
+ * and the get_vfo_info polling of rigctld clients.
+ */
+int rs_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                    pbwidth_t *width, split_t *split)
+{
+    static const char *const query[] = { "FREQ?", "DEM?", "BAND?" };
+    char buf[RESPSZ], *reply[3];
+    int retval;
+
+    retval = rs_query(rig, query, 3, buf, sizeof(buf), reply);
 
     if (retval < 0)
     {
         return retval;
     }
 
-    *mode = rig_parse_mode(buf);
+    if (sscanf(reply[0], "%"SCNfreq, freq) != 1)
+    {
+        return -RIG_EPROTO;
+    }
+
+    *mode = rig_parse_mode(reply[1]);
+    *width = atoi(reply[2]);
+    *split = RIG_SPLIT_OFF;
+
+    return RIG_OK;
+}
+
+/*
+ * rs_get_meters
+ * STRENGTH, ATT and AF in one exchange, for the meter stream.
+ */
+int rs_get_meters(RIG *rig, vfo_t vfo, setting_t *levels, value_t *vals)
+{
+    static const struct
+    {
+        setting_t level;
+        const char *query;
+    } meter[] =
+    {
+        { RIG_LEVEL_STRENGTH, "SENS:DATA? \"VOLT:AC\"" },
+        { RIG_LEVEL_ATT, "INP:ATT:STAT?" },
+        { RIG_LEVEL_AF, "SYST:AUD:VOL?" },
+    };
+    const char *query[3];
+    setting_t got[3];
+    char buf[RESPSZ], *reply[3];
+    int i, n = 0, retval;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (*levels & meter[i].level)
+        {
+            got[n] = meter[i].level;
+            query[n++] = meter[i].query;
+        }
+    }
+
+    *levels = 0;
+
+    if (n == 0) { return RIG_OK; }
 
-#define BAND_QUERY   BOM "BAND?" EOM
-    retval = rs_transaction(rig, BAND_QUERY, strlen(BAND_QUERY), buf, &buf_len);
+    retval = rs_query(rig, query, n, buf, sizeof(buf), reply);
 
     if (retval < 0)
     {
         return retval;
     }
 
-    *width = atoi(buf);
+    for (i = 0; i < n; i++)
+    {
+        value_t *val = &vals[rig_setting2idx(got[i])];
 
-    return retval;
+        switch (got[i])
+        {
+        case RIG_LEVEL_STRENGTH:
+            if (sscanf(reply[i], "%d", &val->i) != 1) { continue; }
+
+            val->i -= 34;
+            break;
+
+        case RIG_LEVEL_ATT:
+            val->i = (!memcmp(reply[i], "ON", 2)
+                      || !memcmp(reply[i], "1", 1)) ? rig->state.attenuator[0] : 0;
+            break;
+
+        case RIG_LEVEL_AF:
+            if (num_sscanf(reply[i], "%f", &val->f) != 1) { continue; }
+
+            break;
+        }
+
+        *levels |= got[i];
+    }
+
+    return RIG_OK;
 }
 
 
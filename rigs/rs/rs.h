@@ -24,12 +24,17 @@
 
 #include <hamlib/rig.h>
 
-#define BACKEND_VER "20090803"
+#define BACKEND_VER "20261018"
 
 int rs_set_freq(RIG *rig, vfo_t vfo, freq_t freq);
 int rs_get_freq(RIG *rig, vfo_t vfo, freq_t *freq);
 int rs_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width);
 int rs_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width);
+int rs_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                    pbwidth_t *width, split_t *split);
+int rs_get_meters(RIG *rig, vfo_t vfo, setting_t *levels, value_t *vals);
+int rs_query(RIG *rig, const char *const *query, int n, char *buf,
+             int buf_len, char **reply);
 int rs_set_func(RIG *rig, vfo_t vfo, setting_t func, int status);
 int rs_get_func(RIG *rig, vfo_t vfo, setting_t func, int *status);
 int rs_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val);
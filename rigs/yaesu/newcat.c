@@ -422,33 +422,57 @@ static ncboolean newcat_valid_command(RIG *rig, char const *const command);
 /*
  * The BS command needs to know what band we're on so we can restore band info
  * So this converts freq to band index
+ *
+ * restrict band memory recall to ITU 1,2,3 band ranges
+ * using < instead of <= for the moment
+ * does anybody work LSB or RTTYR at the upper band edge?
+ * what about band 13 -- what is it?
+ * band 14 is RX only, 144-148 is band 15 inside it
+ *
+ * Sorted by frequency for the binary search, anything else is 11 (general)
  */
+static const struct
+{
+    freq_t start, stop;     /* [start, stop) */
+    int band;
+} newcat_bands[] =
+{
+    { MHz(0.5),    MHz(1.705),  12 }, // MW Medium Wave
+    { MHz(1.8),    MHz(2),       0 },
+    { MHz(3.5),    MHz(4),       1 },
+    { MHz(5.3515), MHz(5.3665),  2 },
+    { MHz(7),      MHz(7.3),     3 },
+    { MHz(10),     MHz(10.15),   4 },
+    { MHz(14),     MHz(14.35),   5 },
+    { MHz(18),     MHz(18.168),  6 },
+    { MHz(21),     MHz(21.45),   7 },
+    { MHz(24.890), MHz(24.990),  8 },
+    { MHz(28),     MHz(29.7),    9 },
+    { MHz(50),     MHz(55),     10 },
+    { MHz(70),     MHz(70.5),   17 },
+    { MHz(118),    MHz(144),    14 },
+    { MHz(144),    MHz(148),    15 },
+    { MHz(148),    MHz(164),    14 },
+    { MHz(420),    MHz(470),    16 },
+};
+
 static int newcat_band_index(freq_t freq)
 {
+    int lo = 0, hi = sizeof(newcat_bands) / sizeof(newcat_bands[0]);
     int band = 11; // general
 
-    // restrict band memory recall to ITU 1,2,3 band ranges
-    // using < instead of <= for the moment
-    // does anybody work LSB or RTTYR at the upper band edge?
-    // what about band 13 -- what is it?
-    if (freq >= MHz(420) && freq < MHz(470)) { band = 16; }
-    else if (freq >= MHz(144) && freq < MHz(148)) { band = 15; }
-    // band 14 is RX only
-    // override band 15 with 14 if needed
-    else if (freq >= MHz(118) && freq < MHz(164)) { band = 14; }
-    else if (freq >= MHz(70) && freq < MHz(70.5)) { band = 17; }
-    else if (freq >= MHz(50) && freq < MHz(55)) { band = 10; }
-    else if (freq >= MHz(28) && freq < MHz(29.7)) { band = 9; }
-    else if (freq >= MHz(24.890) && freq < MHz(24.990)) { band = 8; }
-    else if (freq >= MHz(21) && freq < MHz(21.45)) { band = 7; }
-    else if (freq >= MHz(18) && freq < MHz(18.168)) { band = 6; }
-    else if (freq >= MHz(14) && freq < MHz(14.35)) { band = 5; }
-    else if (freq >= MHz(10) && freq < MHz(10.15)) { band = 4; }
-    else if (freq >= MHz(7) && freq < MHz(7.3)) { band = 3; }
-    else if (freq >= MHz(5.3515) && freq < MHz(5.3665)) { band = 2; }
-    else if (freq >= MHz(3.5) && freq < MHz(4)) { band = 1; }
-    else if (freq >= MHz(1.8) && freq < MHz(2)) { band = 0; }
-    else if (freq >= MHz(0.5) && freq < MHz(1.705)) { band = 12; } // MW Medium Wave
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+
+        if (freq < newcat_bands[mid].start) { hi = mid; }
+        else if (freq >= newcat_bands[mid].stop) { lo = mid + 1; }
+        else
+        {
+            band = newcat_bands[mid].band;
+            break;
+        }
+    }
 
     rig_debug(RIG_DEBUG_TRACE, "%s: freq=%g, band=%d\n", __func__, freq, band);
     return (band);
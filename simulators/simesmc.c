@@ -0,0 +1,168 @@
+// SCPI stand-in for the R&S ESMC/EB200 backends
+// simesmc [port [latency_ms]]
+// answers compound queries like "FREQ?;:DEM?;:BAND?" in one reply and
+// waits latency_ms (default 20) before each reply, like a rig on a slow link
+#define _XOPEN_SOURCE 700
+// since we are POSIX here we need this
+#if 0
+struct ip_mreq
+{
+    int dummy;
+};
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <hamlib/rig.h>
+#include "sim.h"
+
+#define BUFSIZE 256
+
+int mysleep = 20;
+
+long long freq = 14074000;
+char dem[8] = "USB";
+int band = 2400;
+int att = 0;
+float vol = 0.5;
+int afc = 0;
+int squ = 0;
+int messages, queries;
+
+int
+getmyline(int fd, char *buf)
+{
+    char c;
+    int i = 0;
+    memset(buf, 0, BUFSIZE);
+
+    while (i < BUFSIZE - 1 && read(fd, &c, 1) > 0)
+    {
+        if (c == '\r')
+        {
+            if (i == 0) { continue; } // BOM
+
+            return i;
+        }
+
+        buf[i++] = c;
+    }
+
+    return i;
+}
+
+#if defined(WIN32) || defined(_WIN32)
+int openPort(char *comport) // doesn't matter for using pts devices
+{
+    int fd;
+    fd = open(comport, O_RDWR);
+
+    if (fd < 0)
+    {
+        perror(comport);
+    }
+
+    return fd;
+}
+
+#else
+int openPort(char *comport) // doesn't matter for using pts devices
+{
+    int fd = posix_openpt(O_RDWR);
+    char *name = ptsname(fd);
+
+    if (name == NULL)
+    {
+        perror("pstname");
+        return -1;
+    }
+
+    printf("name=%s\n", name);
+
+    if (fd == -1 || grantpt(fd) == -1 || unlockpt(fd) == -1)
+    {
+        perror("posix_openpt");
+        return -1;
+    }
+
+    return fd;
+}
+#endif
+
+// one program message unit, reply appended to out for queries
+void scpi(char *cmd, char *out, int outlen)
+{
+    char reply[64] = "";
+
+    if (cmd[0] == ':') { cmd++; }
+
+    if (strcmp(cmd, "FREQ?") == 0) { snprintf(reply, sizeof(reply), "%lld", freq); }
+    else if (strcmp(cmd, "DEM?") == 0) { snprintf(reply, sizeof(reply), "%s", dem); }
+    else if (strcmp(cmd, "BAND?") == 0) { snprintf(reply, sizeof(reply), "%d", band); }
+    else if (strcmp(cmd, "INP:ATT:STAT?") == 0) { snprintf(reply, sizeof(reply), "%s", att ? "ON" : "OFF"); }
+    else if (strcmp(cmd, "SYST:AUD:VOL?") == 0) { snprintf(reply, sizeof(reply), "%.1f", vol); }
+    else if (strcmp(cmd, "FREQ:AFC?") == 0) { snprintf(reply, sizeof(reply), "%d", afc); }
+    else if (strcmp(cmd, "OUTP:SQU?") == 0) { snprintf(reply, sizeof(reply), "%d", squ); }
+    else if (strncmp(cmd, "SENS:DATA?", 10) == 0) { snprintf(reply, sizeof(reply), "%d", 40 + rand() % 10); }
+    else if (strcmp(cmd, "*IDN?") == 0) { snprintf(reply, sizeof(reply), "ROHDE&SCHWARZ,ESMC,0,simesmc"); }
+    else if (sscanf(cmd, "FREQ %lld", &freq) == 1) { return; }
+    else if (sscanf(cmd, "DEM %7s", dem) == 1) { return; }
+    else if (sscanf(cmd, "BAND %d", &band) == 1) { return; }
+    else if (strncmp(cmd, "INP:ATT:STAT ", 13) == 0) { att = strcmp(cmd + 13, "ON") == 0; return; }
+    else if (sscanf(cmd, "SYST:AUD:VOL %f", &vol) == 1) { return; }
+    else if (strncmp(cmd, "FREQ:AFC ", 9) == 0) { afc = strcmp(cmd + 9, "ON") == 0; return; }
+    else if (strncmp(cmd, "OUTP:SQU ", 9) == 0) { squ = strcmp(cmd + 9, "ON") == 0; return; }
+    else if (strcmp(cmd, "*RST") == 0) { freq = 14074000; strcpy(dem, "USB"); band = 2400; return; }
+    else
+    {
+        fprintf(stderr, "Unknown command: %s\n", cmd);
+        return;
+    }
+
+    queries++;
+
+    if (out[0]) { strncat(out, ";", outlen - strlen(out) - 1); }
+
+    strncat(out, reply, outlen - strlen(out) - 1);
+}
+
+int main(int argc, char *argv[])
+{
+    char buf[BUFSIZE];
+    char out[BUFSIZE];
+    int fd = openPort(argv[1]);
+
+    if (argc > 2) { mysleep = atoi(argv[2]); }
+
+    printf("latency=%dms\n", mysleep);
+
+    while (1)
+    {
+        char *cmd, *save;
+
+        if (getmyline(fd, buf) <= 0) { continue; }
+
+        printf("Cmd:%s\n", buf);
+        messages++;
+        out[0] = 0;
+
+        for (cmd = strtok_r(buf, ";", &save); cmd; cmd = strtok_r(NULL, ";", &save))
+        {
+            scpi(cmd, out, sizeof(out) - 1);
+        }
+
+        if (out[0])
+        {
+            hl_usleep(mysleep * 1000);
+            strcat(out, "\r");
+            WRITE(fd, out, strlen(out));
+        }
+
+        printf("messages=%d queries=%d\n", messages, queries);
+    }
+
+    return 0;
+}
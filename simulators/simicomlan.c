@@ -0,0 +1,486 @@
+// Icom LAN (UDP) stand-in for src/icomlan.c
+// simicomlan [port [loss_percent [user [password]]]]
+// serves the control stream on port (default 50001) and CI-V on port+1
+// for an IC-705 at CI-V address 0xa4 that knows freq, mode, vfo and ptt.
+// loss_percent drops that share of the CI-V replies, still keeping them
+// for retransmission, to exercise the client's gap handling.
+// rigctl -m 3085 -r 127.0.0.1:50001 -C lan_user=hamlib,lan_password=hamlib
+#define _XOPEN_SOURCE 700
+// since we are POSIX here we need this
+#if 0
+struct ip_mreq
+{
+    int dummy;
+};
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <hamlib/rig.h>
+#include "../src/misc.h"
+#include "../src/icomlan.h"
+
+#define MAXPKT 512
+#define HISTORY 64
+#define CIVADDR 0xa4
+
+struct stream
+{
+    int fd;
+    struct sockaddr_in peer;
+    socklen_t peerlen;
+    uint32_t myid, remoteid;
+    uint16_t seq, pingseq;
+    long last_tx;
+    struct { uint16_t seq; int len; unsigned char buf[MAXPKT]; } sent[HISTORY];
+};
+
+struct stream ctl, civ;
+int loss = 0;
+int civport;
+const char *user = "hamlib";
+const char *password = "hamlib";
+uint16_t innerseq, civseq;
+
+long long freqA = 14074000, freqB = 7074000;
+int modeA = 1, modeB = 3; // USB, CW
+int vfo = 0;
+int ptt = 0;
+unsigned long civ_in, civ_out, dropped, resent;
+
+long now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000L + tv.tv_usec / 1000;
+}
+
+void put16(unsigned char *p, unsigned v) { p[0] = v & 0xff; p[1] = v >> 8; }
+void put16be(unsigned char *p, unsigned v) { p[0] = v >> 8; p[1] = v & 0xff; }
+void put32(unsigned char *p, uint32_t v) { put16(p, v & 0xffff); put16(p + 2, v >> 16); }
+unsigned get16(const unsigned char *p) { return p[0] | (p[1] << 8); }
+uint32_t get32(const unsigned char *p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+
+void header(struct stream *s, unsigned char *buf, int len, int type, int seq)
+{
+    memset(buf, 0, len);
+    put32(buf, len);
+    put16(buf + 4, type);
+    put16(buf + 6, seq);
+    put32(buf + 8, s->myid);
+    put32(buf + 12, s->remoteid);
+}
+
+void send_raw(struct stream *s, const unsigned char *buf, int len)
+{
+    sendto(s->fd, buf, len, 0, (struct sockaddr *)&s->peer, s->peerlen);
+    s->last_tx = now_ms();
+}
+
+// drop is only applied to CI-V data, the handshake has its own retries
+void send_tracked(struct stream *s, unsigned char *buf, int len, int drop)
+{
+    int i = s->seq % HISTORY;
+
+    put16(buf + 6, s->seq);
+    s->sent[i].seq = s->seq++;
+    s->sent[i].len = len;
+    memcpy(s->sent[i].buf, buf, len);
+
+    if (drop && loss > 0 && rand() % 100 < loss)
+    {
+        dropped++;
+        s->last_tx = now_ms();
+        return;
+    }
+
+    send_raw(s, buf, len);
+}
+
+void resend(struct stream *s, uint16_t seq)
+{
+    int i = seq % HISTORY;
+
+    if (s->sent[i].len && s->sent[i].seq == seq)
+    {
+        resent++;
+        send_raw(s, s->sent[i].buf, s->sent[i].len);
+    }
+}
+
+void inner(unsigned char *buf, int len, int reply, int type, const unsigned char *req)
+{
+    header(&ctl, buf, len, 0, 0);
+    put16be(buf + 0x12, len - 0x10);
+    buf[0x14] = reply;
+    buf[0x15] = type;
+    put16be(buf + 0x16, innerseq++);
+
+    if (req) { memcpy(buf + 0x1a, req + 0x1a, 6); } // tokrequest, token
+}
+
+void civ_reply(const unsigned char *reply, int n)
+{
+    unsigned char buf[MAXPKT];
+
+    header(&civ, buf, ICOMLAN_DATA_HEADER + n, 0, 0);
+    buf[0x10] = 0xc1;
+    put16(buf + 0x11, n);
+    put16be(buf + 0x13, civseq++);
+    memcpy(buf + ICOMLAN_DATA_HEADER, reply, n);
+    civ_out++;
+    send_tracked(&civ, buf, ICOMLAN_DATA_HEADER + n, 1);
+}
+
+// one CI-V command, frame is fe fe a4 e0 cmd ... fd
+void civ_frame(const unsigned char *frame, int len)
+{
+    unsigned char r[64];
+    int n = 0;
+    long long *freq = vfo ? &freqB : &freqA;
+    int *mode = vfo ? &modeB : &modeA;
+
+    if (len < 6 || frame[2] != CIVADDR) { return; }
+
+    civ_in++;
+    r[n++] = 0xfe;
+    r[n++] = 0xfe;
+    r[n++] = frame[3];
+    r[n++] = CIVADDR;
+
+    switch (frame[4])
+    {
+    case 0x03:
+        r[n++] = 0x03;
+        to_bcd(&r[n], *freq, 10);
+        n += 5;
+        break;
+
+    case 0x04:
+        r[n++] = 0x04;
+        r[n++] = *mode;
+        r[n++] = 1;
+        break;
+
+    case 0x00:
+    case 0x05:
+        *freq = from_bcd(&frame[5], 10);
+        r[n++] = 0xfb;
+        break;
+
+    case 0x01:
+    case 0x06:
+        *mode = frame[5];
+        r[n++] = 0xfb;
+        break;
+
+    case 0x07:
+        if (frame[5] == 0x00) { vfo = 0; }
+        else if (frame[5] == 0x01) { vfo = 1; }
+        else if (frame[5] == 0xb0) { long long t = freqA; freqA = freqB; freqB = t; }
+
+        r[n++] = 0xfb;
+        break;
+
+    case 0x25:
+        if (len == 7)
+        {
+            r[n++] = 0x25;
+            r[n++] = frame[5];
+            to_bcd(&r[n], frame[5] ? freqB : freqA, 10);
+            n += 5;
+        }
+        else
+        {
+            long long f = from_bcd(&frame[6], 10);
+
+            if (frame[5]) { freqB = f; } else { freqA = f; }
+
+            r[n++] = 0xfb;
+        }
+
+        break;
+
+    case 0x26:
+        if (len == 7)
+        {
+            r[n++] = 0x26;
+            r[n++] = frame[5];
+            r[n++] = frame[5] ? modeB : modeA;
+            r[n++] = 0;
+            r[n++] = 1;
+        }
+        else
+        {
+            if (frame[5]) { modeB = frame[6]; } else { modeA = frame[6]; }
+
+            r[n++] = 0xfb;
+        }
+
+        break;
+
+    case 0x1c:
+        if (frame[5] == 0x00 && len == 7)
+        {
+            r[n++] = 0x1c;
+            r[n++] = 0x00;
+            r[n++] = ptt;
+        }
+        else if (frame[5] == 0x00)
+        {
+            ptt = frame[6];
+            r[n++] = 0xfb;
+        }
+        else
+        {
+            r[n++] = 0xfa;
+        }
+
+        break;
+
+    case 0x19:
+        r[n++] = 0x19;
+        r[n++] = 0x00;
+        r[n++] = CIVADDR;
+        break;
+
+    case 0x15:
+        r[n++] = 0x15;
+        r[n++] = frame[5];
+        to_bcd_be(&r[n], 120, 4);
+        n += 2;
+        break;
+
+    default:
+        r[n++] = 0xfa;
+    }
+
+    r[n++] = 0xfd;
+    civ_reply(r, n);
+}
+
+void civ_data(const unsigned char *buf, int len)
+{
+    const unsigned char *p = buf + ICOMLAN_DATA_HEADER;
+    int n = get16(buf + 0x11), i, start = -1;
+
+    if (n > len - ICOMLAN_DATA_HEADER) { n = len - ICOMLAN_DATA_HEADER; }
+
+    for (i = 0; i < n; i++)
+    {
+        if (start < 0 && i + 1 < n && p[i] == 0xfe && p[i + 1] == 0xfe) { start = i; }
+
+        if (start >= 0 && p[i] == 0xfd)
+        {
+            civ_frame(p + start, i - start + 1);
+            start = -1;
+        }
+    }
+}
+
+// what both streams share, returns 1 for a data packet to look at
+int stream_packet(struct stream *s, unsigned char *buf, int len)
+{
+    unsigned char out[ICOMLAN_PING_SIZE];
+    int i;
+
+    if (len < ICOMLAN_HEADER_SIZE || (int)get32(buf) != len) { return 0; }
+
+    switch (get16(buf + 4))
+    {
+    case ICOMLAN_TYPE_ARE_YOU_THERE:
+        s->remoteid = get32(buf + 8);
+        s->seq = 1;
+        header(s, out, ICOMLAN_HEADER_SIZE, ICOMLAN_TYPE_I_AM_HERE, 0);
+        send_raw(s, out, ICOMLAN_HEADER_SIZE);
+        return 0;
+
+    case ICOMLAN_TYPE_READY:
+        header(s, out, ICOMLAN_HEADER_SIZE, ICOMLAN_TYPE_READY, 1);
+        send_raw(s, out, ICOMLAN_HEADER_SIZE);
+        return 0;
+
+    case ICOMLAN_TYPE_DISCONNECT:
+        printf("%s disconnect: civ in=%lu out=%lu dropped=%lu resent=%lu\n",
+               s == &ctl ? "control" : "civ", civ_in, civ_out, dropped, resent);
+        fflush(stdout);
+        return 0;
+
+    case ICOMLAN_TYPE_PING:
+        if (len == ICOMLAN_PING_SIZE && buf[0x10] == 0)
+        {
+            put32(buf + 8, s->myid);
+            put32(buf + 12, s->remoteid);
+            buf[0x10] = 1;
+            send_raw(s, buf, len);
+        }
+
+        return 0;
+
+    case ICOMLAN_TYPE_RETRANSMIT:
+        if (len == ICOMLAN_HEADER_SIZE) { resend(s, get16(buf + 6)); }
+        else for (i = ICOMLAN_HEADER_SIZE; i + 1 < len; i += 2) { resend(s, get16(buf + i)); }
+
+        return 0;
+
+    case ICOMLAN_TYPE_DATA:
+        return len > ICOMLAN_HEADER_SIZE;
+    }
+
+    return 0;
+}
+
+void ctl_inner(unsigned char *req, int len)
+{
+    unsigned char buf[MAXPKT];
+    unsigned char u[16], p[16];
+
+    switch (len)
+    {
+    case ICOMLAN_LOGIN_SIZE:
+        icomlan_encode(user, u);
+        icomlan_encode(password, p);
+        inner(buf, ICOMLAN_LOGIN_REPLY_SIZE, 0x02, 0x00, req);
+        put32(buf + 0x1c, (uint32_t)rand());
+
+        if (memcmp(u, req + 0x40, 16) || memcmp(p, req + 0x50, 16))
+        {
+            printf("login refused\n");
+            put32(buf + 0x30, ICOMLAN_LOGIN_BAD);
+        }
+        else
+        {
+            printf("login ok\n");
+            memcpy(buf + 0x40, "FTTH", 4);
+        }
+
+        fflush(stdout);
+        send_tracked(&ctl, buf, ICOMLAN_LOGIN_REPLY_SIZE, 0);
+        break;
+
+    case ICOMLAN_TOKEN_SIZE:
+        if (req[0x15] == 0x02)
+        {
+            // token confirmed, say who we are
+            inner(buf, ICOMLAN_CONNINFO_SIZE, 0x00, 0x00, req);
+            memcpy(buf + 0x2a, "\x00\x90\xc7\x01\x02\x03", 6);
+            memcpy(buf + 0x40, "IC-705", 6);
+            send_tracked(&ctl, buf, ICOMLAN_CONNINFO_SIZE, 0);
+        }
+        else if (req[0x15] == 0x05)
+        {
+            inner(buf, ICOMLAN_TOKEN_SIZE, 0x02, 0x05, req);
+            send_tracked(&ctl, buf, ICOMLAN_TOKEN_SIZE, 0);
+        }
+
+        break;
+
+    case ICOMLAN_CONNINFO_SIZE:
+        inner(buf, ICOMLAN_STATUS_SIZE, 0x00, 0x00, req);
+        put16be(buf + 0x42, civport);
+        send_tracked(&ctl, buf, ICOMLAN_STATUS_SIZE, 0);
+        printf("CI-V stream open on %d\n", civport);
+        fflush(stdout);
+        break;
+    }
+}
+
+int open_udp(int port)
+{
+    struct sockaddr_in sin;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port = htons(port);
+
+    if (fd < 0 || bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+    {
+        perror("bind");
+        exit(1);
+    }
+
+    return fd;
+}
+
+void keepalive(struct stream *s, long now, long *last_ping)
+{
+    unsigned char buf[ICOMLAN_PING_SIZE];
+
+    if (s->peerlen == 0 || s->remoteid == 0) { return; }
+
+    if (now - *last_ping >= 500)
+    {
+        header(s, buf, ICOMLAN_PING_SIZE, ICOMLAN_TYPE_PING, s->pingseq++);
+        put32(buf + 0x11, (uint32_t)now);
+        send_raw(s, buf, ICOMLAN_PING_SIZE);
+        *last_ping = now;
+    }
+
+    if (now - s->last_tx >= 100)
+    {
+        header(s, buf, ICOMLAN_HEADER_SIZE, ICOMLAN_TYPE_DATA, 0);
+        send_tracked(s, buf, ICOMLAN_HEADER_SIZE, 0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : ICOMLAN_CONTROL_PORT;
+    long ctl_ping = 0, civ_ping = 0;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    if (argc > 2) { loss = atoi(argv[2]); }
+
+    if (argc > 3) { user = argv[3]; }
+
+    if (argc > 4) { password = argv[4]; }
+
+    civport = port + 1;
+    ctl.fd = open_udp(port);
+    civ.fd = open_udp(civport);
+    ctl.myid = 0x7f000000 | port;
+    civ.myid = 0x7f000000 | civport;
+
+    printf("control=%d civ=%d loss=%d%%\n", port, civport, loss);
+    fflush(stdout);
+
+    while (1)
+    {
+        struct pollfd pfd[2] = { { ctl.fd, POLLIN, 0 }, { civ.fd, POLLIN, 0 } };
+        unsigned char buf[MAXPKT];
+        int i, n;
+
+        poll(pfd, 2, 50);
+
+        for (i = 0; i < 2; i++)
+        {
+            struct stream *s = i ? &civ : &ctl;
+
+            if (!(pfd[i].revents & POLLIN)) { continue; }
+
+            s->peerlen = sizeof(s->peer);
+            n = recvfrom(s->fd, buf, sizeof(buf), 0, (struct sockaddr *)&s->peer,
+                         &s->peerlen);
+
+            if (n <= 0 || stream_packet(s, buf, n) != 1) { continue; }
+
+            if (s == &ctl) { ctl_inner(buf, n); }
+            else if (n > ICOMLAN_DATA_HEADER && buf[0x10] == 0xc1) { civ_data(buf, n); }
+        }
+
+        keepalive(&ctl, now_ms(), &ctl_ping);
+        keepalive(&civ, now_ms(), &civ_ping);
+    }
+
+    return 0;
+}
@@ -0,0 +1,1442 @@
+// simrig is a single table-driven simulator engine for CI-V, Kenwood/Yaesu
+// ';' terminated ASCII and Elecraft protocols.
+// It creates a pty pair and prints the slave name to use with rigctl/rigctld
+//   simrig -m ic7300
+//   simrig -m ts2000 -l /tmp/simrig -d 20 -b 9600 -j 5 -x 1
+// -d reply latency in ms, -b serial speed to pace the wire time of each
+// request/reply, -j max random jitter in ms, -x percentage of replies dropped
+// -s seeds the jitter/loss generator so runs are repeatable
+// -k turns the VFO knob every so many ms, CI-V models send transceive frames
+#define _XOPEN_SOURCE 700
+// since we are POSIX here we need this
+#if 0
+struct ip_mreq
+{
+    int dummy;
+};
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <errno.h>
+#include <termios.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <hamlib/rig.h>
+#include "../src/misc.h"
+
+#define BUFSIZE 256
+
+enum sim_proto
+{
+    SIM_PROTO_CIV,
+    SIM_PROTO_KENWOOD,
+    SIM_PROTO_YAESU,
+    SIM_PROTO_ELECRAFT
+};
+
+/* model flags */
+#define SIM_F_ECHO      (1<<0)  /* CI-V bus echo of every command */
+#define SIM_F_X25       (1<<1)  /* CI-V 0x25/0x26 targeted VFO commands */
+#define SIM_F_RMALL     (1<<2)  /* RM; answers all three meters (TS-480/590) */
+
+struct sim_model
+{
+    const char *name;
+    rig_model_t model;
+    enum sim_proto proto;
+    int id;             /* ID; reply for ASCII protocols, CI-V address for Icom */
+    int freq_digits;    /* FA/FB digits for ASCII protocols */
+    int flags;
+};
+
+static const struct sim_model sim_models[] =
+{
+    { "ic7300", RIG_MODEL_IC7300, SIM_PROTO_CIV, 0x94, 0, SIM_F_X25 },
+    { "ic7610", RIG_MODEL_IC7610, SIM_PROTO_CIV, 0x98, 0, SIM_F_X25 },
+    { "ic9700", RIG_MODEL_IC9700, SIM_PROTO_CIV, 0xa2, 0, SIM_F_X25 },
+    { "ic705", RIG_MODEL_IC705, SIM_PROTO_CIV, 0xa4, 0, SIM_F_X25 },
+    { "ic905", RIG_MODEL_IC905, SIM_PROTO_CIV, 0xac, 0, SIM_F_X25 },
+    { "ic7100", RIG_MODEL_IC7100, SIM_PROTO_CIV, 0x88, 0, 0 },
+    { "ic7000", RIG_MODEL_IC7000, SIM_PROTO_CIV, 0x70, 0, 0 },
+    { "ic7600", RIG_MODEL_IC7600, SIM_PROTO_CIV, 0x7a, 0, 0 },
+    { "ts2000", RIG_MODEL_TS2000, SIM_PROTO_KENWOOD, 19, 11, 0 },
+    { "ts590s", RIG_MODEL_TS590S, SIM_PROTO_KENWOOD, 21, 11, SIM_F_RMALL },
+    { "ts590sg", RIG_MODEL_TS590SG, SIM_PROTO_KENWOOD, 23, 11, SIM_F_RMALL },
+    { "ts890s", RIG_MODEL_TS890S, SIM_PROTO_KENWOOD, 24, 11, 0 },
+    { "ts990s", RIG_MODEL_TS990S, SIM_PROTO_KENWOOD, 22, 11, 0 },
+    { "ft991", RIG_MODEL_FT991, SIM_PROTO_YAESU, 570, 9, 0 },
+    { "ftdx101d", RIG_MODEL_FTDX101D, SIM_PROTO_YAESU, 681, 9, 0 },
+    { "ftdx10", RIG_MODEL_FTDX10, SIM_PROTO_YAESU, 761, 9, 0 },
+    { "ft710", RIG_MODEL_FT710, SIM_PROTO_YAESU, 800, 9, 0 },
+    { "k3", RIG_MODEL_K3, SIM_PROTO_ELECRAFT, 17, 11, 0 },
+    { "kx3", RIG_MODEL_KX3, SIM_PROTO_ELECRAFT, 17, 11, 0 },
+    { NULL }
+};
+
+struct sim_timing
+{
+    int latency_ms;     /* fixed reply latency */
+    int baud;           /* wire pacing, 0 disables */
+    int jitter_ms;      /* random extra latency 0..jitter_ms */
+    int loss_pct;       /* percentage of replies dropped */
+};
+
+struct sim_state
+{
+    const struct sim_model *m;
+    struct sim_timing timing;
+    int verbose;
+    unsigned long long freq[2];
+    int mode[2];        /* protocol mode code */
+    int datamode[2];
+    int filter[2];
+    int vfo;            /* 0=A/Main 1=B/Sub */
+    int tx_vfo;
+    int split;
+    int ptt;
+    int ai;
+    int powerstat;
+    int meter;          /* Kenwood RM meter selection */
+    int width;          /* SH width index */
+    int narrow;
+    int af, rf, sql, mic, power, keyspd, comp;
+    int smeter, swr, alc, po;
+    long requests, replies, dropped, knob_turns;
+};
+
+static void sim_state_init(struct sim_state *s, const struct sim_model *m)
+{
+    memset(s, 0, sizeof(*s));
+    s->m = m;
+    // we make B different from A to ensure we see a difference at startup
+    s->freq[0] = 14074000;
+    s->freq[1] = 14074500;
+    s->powerstat = 1;
+    s->af = 100;
+    s->rf = 255;
+    s->sql = 0;
+    s->mic = 50;
+    s->power = 100;
+    s->keyspd = 20;
+    s->comp = 10;
+    s->smeter = 120;
+    s->swr = 30;
+    s->alc = 10;
+    s->po = 0;
+    s->filter[0] = s->filter[1] = 1;
+    s->width = 10;
+
+    switch (m->proto)
+    {
+    case SIM_PROTO_CIV:
+        s->mode[0] = s->mode[1] = 0x01;     /* USB */
+        s->datamode[0] = s->datamode[1] = 1;
+        break;
+
+    case SIM_PROTO_YAESU:
+        s->mode[0] = s->mode[1] = 'C';      /* DATA-USB */
+        break;
+
+    default:
+        s->mode[0] = s->mode[1] = '2';      /* USB */
+        break;
+    }
+}
+
+/* time a byte spends on the wire with 8N1 framing */
+static long sim_wire_us(const struct sim_state *s, int nbytes)
+{
+    if (s->timing.baud <= 0) { return 0; }
+
+    return (long)nbytes * 10L * 1000000L / s->timing.baud;
+}
+
+/*
+ * Send a reply after the configured latency, jitter and wire time,
+ * or drop it if the loss generator says so
+ */
+static int sim_reply(struct sim_state *s, int fd, const unsigned char *buf,
+                     int len, int reqlen)
+{
+    long delay_us;
+    int n;
+
+    if (s->timing.loss_pct > 0 && rand() % 100 < s->timing.loss_pct)
+    {
+        s->dropped++;
+
+        if (s->verbose) { printf("  dropped reply\n"); }
+
+        return 0;
+    }
+
+    delay_us = s->timing.latency_ms * 1000L + sim_wire_us(s, reqlen + len);
+
+    if (s->timing.jitter_ms > 0)
+    {
+        delay_us += (rand() % (s->timing.jitter_ms * 1000L + 1));
+    }
+
+    if (delay_us > 0) { hl_usleep(delay_us); }
+
+    if (s->verbose)
+    {
+        if (s->m->proto == SIM_PROTO_CIV)
+        {
+            int i;
+
+            printf("  reply:");
+
+            for (i = 0; i < len; ++i) { printf(" %02x", buf[i]); }
+
+            printf("\n");
+        }
+        else
+        {
+            printf("  reply: %.*s\n", len, buf);
+        }
+    }
+
+    n = write(fd, buf, len);
+
+    if (n <= 0)
+    {
+        fprintf(stderr, "%s(%d) write error %s\n", __func__, __LINE__,
+                strerror(errno));
+        return -1;
+    }
+
+    s->replies++;
+    return n;
+}
+
+/*
+ * Kenwood/Yaesu/Elecraft ';' terminated ASCII protocol
+ * Set commands get no reply, queries are answered from the state table
+ * and anything not understood gets "?;"
+ */
+struct sim_ascii_cmd
+{
+    const char *cmd;
+    int (*query)(struct sim_state *s, const char *arg, char *reply, int len);
+    int (*set)(struct sim_state *s, const char *arg);
+    int protos;     /* bitmask of (1<<SIM_PROTO_xxx), 0 for all */
+    int qmax;       /* longest selector argument that is still a query */
+};
+
+#define P_KW  (1<<SIM_PROTO_KENWOOD)
+#define P_YS  (1<<SIM_PROTO_YAESU)
+#define P_EC  (1<<SIM_PROTO_ELECRAFT)
+
+static int q_fa(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "FA%0*llu;", s->m->freq_digits, s->freq[0]);
+}
+
+static int s_fa(struct sim_state *s, const char *arg)
+{
+    s->freq[0] = strtoull(arg, NULL, 10);
+    return 0;
+}
+
+static int q_fb(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "FB%0*llu;", s->m->freq_digits, s->freq[1]);
+}
+
+static int s_fb(struct sim_state *s, const char *arg)
+{
+    s->freq[1] = strtoull(arg, NULL, 10);
+    return 0;
+}
+
+static int q_fr(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "FR%d;", s->vfo);
+}
+
+static int s_fr(struct sim_state *s, const char *arg)
+{
+    s->vfo = atoi(arg) & 1;
+    s->split = s->vfo != s->tx_vfo;
+    return 0;
+}
+
+static int q_ft(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "FT%d;", s->tx_vfo);
+}
+
+static int s_ft(struct sim_state *s, const char *arg)
+{
+    // Yaesu uses FT2/FT3 to set and FT0/FT1 to report
+    s->tx_vfo = atoi(arg) & 1;
+    s->split = s->vfo != s->tx_vfo;
+    return 0;
+}
+
+static int q_vs(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "VS%d;", s->vfo);
+}
+
+static int s_vs(struct sim_state *s, const char *arg)
+{
+    s->vfo = atoi(arg) & 1;
+    return 0;
+}
+
+static int q_st(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "ST%d;", s->split);
+}
+
+static int s_st(struct sim_state *s, const char *arg)
+{
+    s->split = atoi(arg) ? 1 : 0;
+    s->tx_vfo = s->split ? !s->vfo : s->vfo;
+    return 0;
+}
+
+static int q_md(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    if (s->m->proto == SIM_PROTO_YAESU)
+    {
+        int v = arg[0] == '1';
+        return snprintf(reply, len, "MD%d%c;", v, s->mode[v]);
+    }
+
+    if (arg[0] == '$')
+    {
+        return snprintf(reply, len, "MD$%c;", s->mode[1]);
+    }
+
+    return snprintf(reply, len, "MD%c;", s->mode[s->vfo]);
+}
+
+static int s_md(struct sim_state *s, const char *arg)
+{
+    if (s->m->proto == SIM_PROTO_YAESU)
+    {
+        s->mode[arg[0] == '1'] = arg[1];
+    }
+    else if (arg[0] == '$')
+    {
+        s->mode[1] = arg[1];
+    }
+    else
+    {
+        s->mode[s->vfo] = arg[0];
+    }
+
+    return 0;
+}
+
+static int q_if(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    if (s->m->proto == SIM_PROTO_YAESU)
+    {
+        return snprintf(reply, len, "IF001%09llu+000000%c00000;",
+                        s->freq[s->vfo], s->mode[s->vfo]);
+    }
+
+    // P1 freq, P2 step, P3 RIT, P4/P5 RIT/XIT, P6 mem, P7 TX, P8 mode,
+    // P9 VFO, P10 scan, P11 split, P12-P14 tone, P15 shift
+    return snprintf(reply, len, "IF%011llu    +0000000000%d%c%d0%d0000;",
+                    s->freq[s->vfo], s->ptt, s->mode[s->vfo], s->vfo, s->split);
+}
+
+static int q_id(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    if (s->m->proto == SIM_PROTO_YAESU)
+    {
+        return snprintf(reply, len, "ID%04d;", s->m->id);
+    }
+
+    return snprintf(reply, len, "ID%03d;", s->m->id);
+}
+
+static int q_ps(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "PS%d;", s->powerstat);
+}
+
+static int s_ps(struct sim_state *s, const char *arg)
+{
+    s->powerstat = atoi(arg) ? 1 : 0;
+    return 0;
+}
+
+static int q_ai(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "AI%d;", s->ai);
+}
+
+static int s_ai(struct sim_state *s, const char *arg)
+{
+    s->ai = atoi(arg);
+    return 0;
+}
+
+static int q_tx(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "TX%d;", s->ptt);
+}
+
+static int s_tx(struct sim_state *s, const char *arg)
+{
+    // Kenwood TX; TX0; TX1; TX2; all key up, Yaesu TX0; unkeys
+    s->ptt = s->m->proto == SIM_PROTO_YAESU ? atoi(arg) != 0 : 1;
+    s->po = s->ptt ? s->power : 0;
+    return 0;
+}
+
+static int s_rx(struct sim_state *s, const char *arg)
+{
+    s->ptt = 0;
+    s->po = 0;
+    return 0;
+}
+
+static int q_tq(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "TQ%d;", s->ptt);
+}
+
+static int q_sm(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    switch (s->m->proto)
+    {
+    case SIM_PROTO_YAESU:
+        return snprintf(reply, len, "SM0%03d;", s->smeter);
+
+    case SIM_PROTO_ELECRAFT:
+        if (arg[0] == 'H')
+        {
+            return snprintf(reply, len, "SMH%03d;", s->smeter / 2);
+        }
+
+        return snprintf(reply, len, "SM%04d;", s->smeter / 12);
+
+    default:
+        return snprintf(reply, len, "SM0%04d;", s->smeter / 8);
+    }
+}
+
+static int q_rm(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    int val;
+
+    if (s->m->proto == SIM_PROTO_YAESU)
+    {
+        int meter = atoi(arg);
+
+        switch (meter)
+        {
+        case 4: val = s->alc; break;
+
+        case 5: val = s->po; break;
+
+        case 6: val = s->swr; break;
+
+        default: val = s->smeter; break;
+        }
+
+        return snprintf(reply, len, "RM%d%03d000;", meter, val);
+    }
+
+    if (s->m->flags & SIM_F_RMALL)
+    {
+        return snprintf(reply, len, "RM1%04d;RM2%04d;RM3%04d;", s->swr / 8,
+                        s->comp / 8, s->alc / 8);
+    }
+
+    switch (s->meter)
+    {
+    case 1: val = s->swr / 8; break;
+
+    case 2: val = s->comp / 8; break;
+
+    default: val = s->alc / 8; break;
+    }
+
+    return snprintf(reply, len, "RM%d%04d;", s->meter, val);
+}
+
+static int s_rm(struct sim_state *s, const char *arg)
+{
+    s->meter = arg[0] - '0';
+    return 0;
+}
+
+/* helper for the 3 digit level commands, some with a leading '0' P1 */
+static int sim_level_query(struct sim_state *s, const char *cmd,
+                           const char *arg, int val, char *reply, int len)
+{
+    if (arg[0] == '0' && s->m->proto != SIM_PROTO_ELECRAFT)
+    {
+        return snprintf(reply, len, "%s0%03d;", cmd, val);
+    }
+
+    return snprintf(reply, len, "%s%03d;", cmd, val);
+}
+
+static int sim_level_set(const char *arg)
+{
+    // "0nnn" with P1 or plain "nnn"
+    return atoi(strlen(arg) == 4 ? arg + 1 : arg);
+}
+
+static int q_ag(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return sim_level_query(s, "AG", arg, s->af, reply, len);
+}
+
+static int s_ag(struct sim_state *s, const char *arg)
+{
+    s->af = sim_level_set(arg);
+    return 0;
+}
+
+static int q_rg(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return sim_level_query(s, "RG", arg, s->rf, reply, len);
+}
+
+static int s_rg(struct sim_state *s, const char *arg)
+{
+    s->rf = sim_level_set(arg);
+    return 0;
+}
+
+static int q_sq(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return sim_level_query(s, "SQ", arg, s->sql, reply, len);
+}
+
+static int s_sq(struct sim_state *s, const char *arg)
+{
+    s->sql = sim_level_set(arg);
+    return 0;
+}
+
+static int q_mg(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "MG%03d;", s->mic);
+}
+
+static int s_mg(struct sim_state *s, const char *arg)
+{
+    s->mic = atoi(arg);
+    return 0;
+}
+
+static int q_pc(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "PC%03d;", s->power);
+}
+
+static int s_pc(struct sim_state *s, const char *arg)
+{
+    s->power = atoi(arg);
+    return 0;
+}
+
+static int q_ks(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "KS%03d;", s->keyspd);
+}
+
+static int s_ks(struct sim_state *s, const char *arg)
+{
+    s->keyspd = atoi(arg);
+    return 0;
+}
+
+static int q_fw(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "FW%04d;", 2400);
+}
+
+static int q_sh(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    if (s->m->proto == SIM_PROTO_YAESU)
+    {
+        return snprintf(reply, len, "SH0%02d;", s->width);
+    }
+
+    return snprintf(reply, len, "SH%02d;", s->width);
+}
+
+static int s_sh(struct sim_state *s, const char *arg)
+{
+    s->width = atoi(s->m->proto == SIM_PROTO_YAESU ? arg + 1 : arg);
+    return 0;
+}
+
+static int q_na(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "NA0%d;", s->narrow);
+}
+
+static int s_na(struct sim_state *s, const char *arg)
+{
+    s->narrow = atoi(arg + 1) ? 1 : 0;
+    return 0;
+}
+
+static int q_fv(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "FV1.00;");
+}
+
+static int q_k2(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "K20;");
+}
+
+static int q_k3(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "K30;");
+}
+
+static int q_om(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "OM AP----------;");
+}
+
+static int q_rv(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "RV%c05.67;", arg[0] ? arg[0] : 'M');
+}
+
+static int q_bw(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    if (arg[0] == '$') { return snprintf(reply, len, "BW$%04d;", 270); }
+
+    return snprintf(reply, len, "BW%04d;", 270);
+}
+
+static int q_dt(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    return snprintf(reply, len, "DT%d;", s->datamode[s->vfo]);
+}
+
+static int s_dt(struct sim_state *s, const char *arg)
+{
+    s->datamode[s->vfo] = atoi(arg);
+    return 0;
+}
+
+static int q_is(struct sim_state *s, const char *arg, char *reply, int len)
+{
+    if (s->m->proto == SIM_PROTO_ELECRAFT)
+    {
+        return snprintf(reply, len, "IS 0000;");
+    }
+
+    return snprintf(reply, len, "IS+0000;");
+}
+
+static const struct sim_ascii_cmd sim_ascii_cmds[] =
+{
+    { "FA", q_fa, s_fa, 0, 0 },
+    { "FB", q_fb, s_fb, 0, 0 },
+    { "FR", q_fr, s_fr, P_KW | P_EC, 0 },
+    { "FT", q_ft, s_ft, 0, 0 },
+    { "VS", q_vs, s_vs, P_YS, 0 },
+    { "ST", q_st, s_st, P_YS, 0 },
+    { "MD", q_md, s_md, P_YS, 1 },
+    { "MD", q_md, s_md, P_KW | P_EC, 0 },
+    { "IF", q_if, NULL, 0, 0 },
+    { "ID", q_id, NULL, 0, 0 },
+    { "PS", q_ps, s_ps, 0, 0 },
+    { "AI", q_ai, s_ai, 0, 0 },
+    { "TX", q_tx, s_tx, P_YS, 0 },
+    { "TX", NULL, s_tx, P_KW | P_EC, 0 },
+    { "RX", NULL, s_rx, 0, 0 },
+    { "TQ", q_tq, NULL, P_KW | P_EC, 0 },
+    { "SM", q_sm, NULL, 0, 1 },
+    { "RM", q_rm, s_rm, P_YS, 1 },
+    { "RM", q_rm, s_rm, P_KW | P_EC, 0 },
+    { "AG", q_ag, s_ag, P_KW | P_YS, 1 },
+    { "RG", q_rg, s_rg, P_KW | P_YS, 1 },
+    { "SQ", q_sq, s_sq, P_KW | P_YS, 1 },
+    { "AG", q_ag, s_ag, P_EC, 0 },
+    { "RG", q_rg, s_rg, P_EC, 0 },
+    { "SQ", q_sq, s_sq, P_EC, 0 },
+    { "MG", q_mg, s_mg, 0, 0 },
+    { "PC", q_pc, s_pc, 0, 0 },
+    { "KS", q_ks, s_ks, 0, 0 },
+    { "FW", q_fw, NULL, P_KW | P_EC, 0 },
+    { "SH", q_sh, s_sh, 0, 1 },
+    { "NA", q_na, s_na, P_YS, 1 },
+    { "FV", q_fv, NULL, P_KW, 0 },
+    { "K2", q_k2, NULL, P_EC, 0 },
+    { "K3", q_k3, NULL, P_EC, 0 },
+    { "OM", q_om, NULL, P_EC, 0 },
+    { "RV", q_rv, NULL, P_EC, 1 },
+    { "BW", q_bw, NULL, P_EC, 0 },
+    { "DT", q_dt, s_dt, P_EC, 0 },
+    { "IS", q_is, NULL, 0, 0 },
+    { NULL }
+};
+
+static void sim_ascii_handle(struct sim_state *s, int fd, char *frame,
+                             int framelen)
+{
+    char reply[BUFSIZE];
+    char cmd[3];
+    char *arg;
+    int i, n;
+
+    if (framelen < 3)
+    {
+        // a bare ';' is used by some backends to flush
+        sim_reply(s, fd, (unsigned char *)"?;", 2, framelen);
+        return;
+    }
+
+    cmd[0] = frame[0];
+    cmd[1] = frame[1];
+    cmd[2] = 0;
+    frame[framelen - 1] = 0;    /* drop the ';' */
+    arg = frame + 2;
+
+    for (i = 0; sim_ascii_cmds[i].cmd; ++i)
+    {
+        const struct sim_ascii_cmd *c = &sim_ascii_cmds[i];
+
+        if (strcmp(c->cmd, cmd) != 0) { continue; }
+
+        if (c->protos && !(c->protos & (1 << s->m->proto))) { continue; }
+
+        // a query is the bare command, the command with its selector
+        // digits (MD0; SM0; RM6;) or an Elecraft sub receiver query (MD$;)
+        if (c->query && (strlen(arg) <= c->qmax || strcmp(arg, "$") == 0))
+        {
+            n = c->query(s, arg, reply, sizeof(reply));
+            sim_reply(s, fd, (unsigned char *)reply, n, framelen);
+            return;
+        }
+
+        if (c->set)
+        {
+            c->set(s, arg);
+            return;
+        }
+
+        break;
+    }
+
+    if (s->verbose) { printf("  unknown command %s\n", frame); }
+
+    sim_reply(s, fd, (unsigned char *)"?;", 2, framelen);
+}
+
+/*
+ * Icom CI-V protocol
+ * FE FE <to> <from> <cmd> [sub] [data] FD
+ */
+#define CIV_PR  0xfe
+#define CIV_EOM 0xfd
+#define CIV_ACK 0xfb
+#define CIV_NAK 0xfa
+
+static int sim_civ_frame(const struct sim_state *s, unsigned char *out,
+                         unsigned char to, const unsigned char *payload, int plen)
+{
+    out[0] = CIV_PR;
+    out[1] = CIV_PR;
+    out[2] = to;
+    out[3] = s->m->id;
+    memcpy(out + 4, payload, plen);
+    out[4 + plen] = CIV_EOM;
+    return plen + 5;
+}
+
+/*
+ * Turn the VFO knob: step the current VFO and, on CI-V, send the
+ * transceive frame a real rig sends when its dial moves
+ */
+static void sim_knob(struct sim_state *s, int fd, int step)
+{
+    unsigned char p[8];
+    unsigned char out[BUFSIZE];
+    int n;
+
+    s->freq[s->vfo] += step;
+    s->knob_turns++;
+
+    if (s->m->proto != SIM_PROTO_CIV) { return; }
+
+    p[0] = 0x00;    /* transceive frequency */
+    to_bcd(p + 1, s->freq[s->vfo], 10);
+    n = sim_civ_frame(s, out, 0x00, p, 6);
+
+    if (s->verbose)
+    {
+        printf("knob: %llu\n", s->freq[s->vfo]);
+        fflush(stdout);
+    }
+
+    if (write(fd, out, n) <= 0)
+    {
+        fprintf(stderr, "%s(%d) write error %s\n", __func__, __LINE__,
+                strerror(errno));
+    }
+}
+
+static long sim_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static void sim_civ_level(int val, unsigned char *bcd)
+{
+    to_bcd_be(bcd, val, 4);
+}
+
+static void sim_civ_handle(struct sim_state *s, int fd, unsigned char *frame,
+                           int framelen)
+{
+    unsigned char reply[BUFSIZE];
+    unsigned char p[BUFSIZE];
+    unsigned char to = frame[3];
+    unsigned char *data = frame + 5;
+    int dlen = framelen - 6;    /* bytes between cmd and FD */
+    int plen = 0;
+    int ack = 0;
+    int v;
+
+    if (framelen < 6 || frame[2] != s->m->id)
+    {
+        // not for us -- a real bus would stay silent
+        return;
+    }
+
+    if (s->m->flags & SIM_F_ECHO)
+    {
+        if (write(fd, frame, framelen) <= 0)
+        {
+            fprintf(stderr, "%s(%d) write error %s\n", __func__, __LINE__,
+                    strerror(errno));
+        }
+    }
+
+    p[plen++] = frame[4];
+
+    switch (frame[4])
+    {
+    case 0x03:  /* read frequency */
+        to_bcd(p + plen, s->freq[s->vfo], 10);
+        plen += 5;
+        break;
+
+    case 0x04:  /* read mode */
+        p[plen++] = s->mode[s->vfo];
+        p[plen++] = s->filter[s->vfo];
+        break;
+
+    case 0x05:  /* set frequency */
+        s->freq[s->vfo] = from_bcd(data, 10);
+        ack = 1;
+        break;
+
+    case 0x06:  /* set mode */
+        s->mode[s->vfo] = data[0];
+
+        if (dlen > 1) { s->filter[s->vfo] = data[1]; }
+
+        ack = 1;
+        break;
+
+    case 0x07:  /* select VFO */
+        switch (dlen > 0 ? data[0] : 0xff)
+        {
+        case 0x00:
+        case 0xd0: s->vfo = 0; break;
+
+        case 0x01:
+        case 0xd1: s->vfo = 1; break;
+
+        case 0xb0:
+        {
+            unsigned long long f = s->freq[0];
+            int m = s->mode[0];
+            s->freq[0] = s->freq[1];
+            s->freq[1] = f;
+            s->mode[0] = s->mode[1];
+            s->mode[1] = m;
+            break;
+        }
+
+        case 0xa0:
+            s->freq[1] = s->freq[0];
+            s->mode[1] = s->mode[0];
+            break;
+
+        default:
+            ack = -1;
+        }
+
+        if (ack == 0) { ack = 1; }
+
+        break;
+
+    case 0x0f:  /* split */
+        if (dlen == 0)
+        {
+            p[plen++] = s->split;
+        }
+        else
+        {
+            s->split = data[0] == 0x01;
+            s->tx_vfo = s->split ? !s->vfo : s->vfo;
+            ack = 1;
+        }
+
+        break;
+
+    case 0x14:  /* levels */
+    {
+        int *lvl = NULL;
+
+        switch (data[0])
+        {
+        case 0x01: lvl = &s->af; break;
+
+        case 0x02: lvl = &s->rf; break;
+
+        case 0x03: lvl = &s->sql; break;
+
+        case 0x0a: lvl = &s->power; break;
+
+        case 0x0b: lvl = &s->mic; break;
+
+        case 0x0c: lvl = &s->keyspd; break;
+
+        case 0x0e: lvl = &s->comp; break;
+        }
+
+        if (lvl == NULL)
+        {
+            ack = -1;
+        }
+        else if (dlen == 1)
+        {
+            p[plen++] = data[0];
+            sim_civ_level(*lvl, p + plen);
+            plen += 2;
+        }
+        else
+        {
+            *lvl = from_bcd_be(data + 1, 4);
+            ack = 1;
+        }
+
+        break;
+    }
+
+    case 0x15:  /* meters */
+        switch (data[0])
+        {
+        case 0x01: v = s->sql > s->smeter ? 0 : 1; break;
+
+        case 0x02: v = s->smeter; break;
+
+        case 0x11: v = s->po; break;
+
+        case 0x12: v = s->swr; break;
+
+        case 0x13: v = s->alc; break;
+
+        case 0x14: v = s->comp; break;
+
+        case 0x15: v = 200; break;     /* Vd */
+
+        case 0x16: v = s->ptt ? 50 : 0; break; /* Id */
+
+        default: v = -1;
+        }
+
+        if (v < 0)
+        {
+            ack = -1;
+            break;
+        }
+
+        if (data[0] == 0x01)
+        {
+            p[plen++] = data[0];
+            p[plen++] = v;
+            break;
+        }
+
+        p[plen++] = data[0];
+        sim_civ_level(v, p + plen);
+        plen += 2;
+        break;
+
+    case 0x16:  /* functions -- report everything off */
+        if (dlen == 1)
+        {
+            p[plen++] = data[0];
+            p[plen++] = 0;
+        }
+        else
+        {
+            ack = 1;
+        }
+
+        break;
+
+    case 0x18:  /* power on/off */
+        s->powerstat = data[0];
+        ack = 1;
+        break;
+
+    case 0x19:  /* transceiver ID */
+        p[plen++] = 0x00;
+        p[plen++] = s->m->id;
+        break;
+
+    case 0x1a:
+        if (data[0] == 0x06)    /* data mode */
+        {
+            if (dlen == 1)
+            {
+                p[plen++] = data[0];
+                p[plen++] = s->datamode[s->vfo];
+                p[plen++] = s->datamode[s->vfo] ? s->filter[s->vfo] : 0;
+            }
+            else
+            {
+                s->datamode[s->vfo] = data[1];
+                ack = 1;
+            }
+        }
+        else
+        {
+            ack = -1;
+        }
+
+        break;
+
+    case 0x1c:
+        if (data[0] == 0x00)    /* PTT */
+        {
+            if (dlen == 1)
+            {
+                p[plen++] = data[0];
+                p[plen++] = s->ptt;
+            }
+            else
+            {
+                s->ptt = data[1];
+                s->po = s->ptt ? s->power : 0;
+                ack = 1;
+            }
+        }
+        else if (data[0] == 0x01 && dlen == 1)  /* tuner */
+        {
+            p[plen++] = data[0];
+            p[plen++] = 0;
+        }
+        else
+        {
+            ack = dlen > 1 ? 1 : -1;
+        }
+
+        break;
+
+    case 0x25:  /* targeted frequency, 00=selected 01=unselected */
+        if (!(s->m->flags & SIM_F_X25))
+        {
+            ack = -1;
+            break;
+        }
+
+        v = data[0] ? !s->vfo : s->vfo;
+
+        if (dlen == 1)
+        {
+            p[plen++] = data[0];
+            to_bcd(p + plen, s->freq[v], 10);
+            plen += 5;
+        }
+        else
+        {
+            s->freq[v] = from_bcd(data + 1, 10);
+            ack = 1;
+        }
+
+        break;
+
+    case 0x26:  /* targeted mode, 00=selected 01=unselected */
+        if (!(s->m->flags & SIM_F_X25))
+        {
+            ack = -1;
+            break;
+        }
+
+        v = data[0] ? !s->vfo : s->vfo;
+
+        if (dlen == 1)
+        {
+            p[plen++] = data[0];
+            p[plen++] = s->mode[v];
+            p[plen++] = s->datamode[v];
+            p[plen++] = s->filter[v];
+        }
+        else
+        {
+            s->mode[v] = data[1];
+
+            if (dlen > 2) { s->datamode[v] = data[2]; }
+
+            if (dlen > 3) { s->filter[v] = data[3]; }
+
+            ack = 1;
+        }
+
+        break;
+
+    default:
+        ack = -1;
+    }
+
+    if (ack != 0)
+    {
+        p[0] = ack > 0 ? CIV_ACK : CIV_NAK;
+        plen = 1;
+    }
+
+    if (ack < 0 && s->verbose) { printf("  NAK cmd 0x%02x\n", frame[4]); }
+
+    plen = sim_civ_frame(s, reply, to, p, plen);
+    sim_reply(s, fd, reply, plen, framelen);
+}
+
+/*
+ * Read one protocol frame
+ * returns frame length, 0 on EOF
+ */
+static int sim_frame_get(struct sim_state *s, int fd, unsigned char *buf)
+{
+    int i = 0;
+    unsigned char c;
+    unsigned char eom = s->m->proto == SIM_PROTO_CIV ? CIV_EOM : ';';
+
+    while (read(fd, &c, 1) > 0)
+    {
+        if (s->m->proto == SIM_PROTO_CIV && i < 2 && c != CIV_PR)
+        {
+            // resynchronise on the preamble
+            i = 0;
+            continue;
+        }
+
+        if (s->m->proto != SIM_PROTO_CIV && (c == '\r' || c == '\n'))
+        {
+            continue;
+        }
+
+        buf[i++] = c;
+
+        if (c == eom) { return i; }
+
+        if (i >= BUFSIZE - 1) { i = 0; }
+    }
+
+    return i;
+}
+
+#if defined(WIN32) || defined(_WIN32)
+static int sim_open_pty(const char *link)
+{
+    fprintf(stderr, "pty support is not available on this platform\n");
+    return -1;
+}
+
+#else
+static int sim_open_pty(const char *link)
+{
+    struct termios tio;
+    const char *name;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd == -1 || grantpt(fd) == -1 || unlockpt(fd) == -1)
+    {
+        perror("posix_openpt");
+        return -1;
+    }
+
+    name = ptsname(fd);
+
+    if (name == NULL)
+    {
+        perror("ptsname");
+        return -1;
+    }
+
+    // keep a slave open so the master doesn't see EIO between clients
+    if (open(name, O_RDWR | O_NOCTTY) < 0)
+    {
+        perror(name);
+        return -1;
+    }
+
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR
+                         | ICRNL | IXON);
+        tio.c_oflag &= ~OPOST;
+        tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+        tio.c_cflag &= ~(CSIZE | PARENB);
+        tio.c_cflag |= CS8;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    printf("name=%s\n", name);
+
+    if (link)
+    {
+        unlink(link);
+
+        if (symlink(name, link) < 0)
+        {
+            perror(link);
+            return -1;
+        }
+
+        printf("link=%s\n", link);
+    }
+
+    fflush(stdout);
+
+    return fd;
+}
+#endif
+
+static volatile sig_atomic_t sim_exit;
+
+static void sim_signal(int sig)
+{
+    sim_exit = 1;
+}
+
+static void usage(const char *argv0)
+{
+    int i;
+
+    printf("Usage: %s -m model [-l link] [-d latency_ms] [-b baud] [-j jitter_ms]\n"
+           "          [-x loss_pct] [-s seed] [-k knob_ms] [-e] [-v] [-L]\n\n", argv0);
+    printf("  -m, --model     simulated model\n"
+           "  -l, --link      create a symlink to the pty slave\n"
+           "  -d, --latency   reply latency in ms\n"
+           "  -b, --baud      pace requests/replies at this serial speed\n"
+           "  -j, --jitter    random extra latency up to this many ms\n"
+           "  -x, --loss      percentage of replies to drop\n"
+           "  -s, --seed      random seed for jitter and loss\n"
+           "  -k, --knob      step the VFO by 100 Hz every knob_ms, as if turning the dial\n"
+           "  -e, --echo      echo CI-V commands like a real CI-V bus\n"
+           "  -v, --verbose   print every frame\n"
+           "  -L, --list      list the simulated models and their hamlib numbers\n\n"
+           "Models:");
+
+    for (i = 0; sim_models[i].name; ++i)
+    {
+        printf(" %s", sim_models[i].name);
+    }
+
+    printf("\n");
+}
+
+static struct option long_options[] =
+{
+    {"model",   1, 0, 'm'},
+    {"link",    1, 0, 'l'},
+    {"latency", 1, 0, 'd'},
+    {"baud",    1, 0, 'b'},
+    {"jitter",  1, 0, 'j'},
+    {"loss",    1, 0, 'x'},
+    {"seed",    1, 0, 's'},
+    {"knob",    1, 0, 'k'},
+    {"echo",    0, 0, 'e'},
+    {"verbose", 0, 0, 'v'},
+    {"list",    0, 0, 'L'},
+    {"help",    0, 0, 'h'},
+    {0, 0, 0, 0}
+};
+
+int main(int argc, char *argv[])
+{
+    static struct sim_state s;
+    static struct sim_model m;
+    unsigned char buf[BUFSIZE];
+    const char *model = "ic7300";
+    const char *link = NULL;
+    struct sim_timing timing = { 0 };
+    unsigned int seed = 1;
+    int echo = 0, verbose = 0;
+    int knob_ms = 0;
+    long knob_next = 0;
+    int fd, i, c, n;
+
+    while ((c = getopt_long(argc, argv, "m:l:d:b:j:x:s:k:evLh", long_options,
+                            NULL)) != -1)
+    {
+        switch (c)
+        {
+        case 'm': model = optarg; break;
+
+        case 'l': link = optarg; break;
+
+        case 'd': timing.latency_ms = atoi(optarg); break;
+
+        case 'b': timing.baud = atoi(optarg); break;
+
+        case 'j': timing.jitter_ms = atoi(optarg); break;
+
+        case 'x': timing.loss_pct = atoi(optarg); break;
+
+        case 's': seed = strtoul(optarg, NULL, 0); break;
+
+        case 'k': knob_ms = atoi(optarg); break;
+
+        case 'e': echo = 1; break;
+
+        case 'v': verbose = 1; break;
+
+        case 'L':
+            for (i = 0; sim_models[i].name; ++i)
+            {
+                printf("%s %u\n", sim_models[i].name, (unsigned)sim_models[i].model);
+            }
+
+            return 0;
+
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+
+    for (i = 0; sim_models[i].name; ++i)
+    {
+        if (strcmp(sim_models[i].name, model) == 0) { break; }
+    }
+
+    if (sim_models[i].name == NULL)
+    {
+        fprintf(stderr, "%s: unknown model '%s'\n", argv[0], model);
+        usage(argv[0]);
+        return 1;
+    }
+
+    m = sim_models[i];
+
+    if (echo) { m.flags |= SIM_F_ECHO; }
+
+    sim_state_init(&s, &m);
+    s.timing = timing;
+    s.verbose = verbose;
+    srand(seed);
+
+    printf("%s: %s simulating %s (hamlib model %u)\n", argv[0], rig_version(),
+           m.name, (unsigned)m.model);
+
+    fd = sim_open_pty(link);
+
+    if (fd < 0) { return 1; }
+
+#if !defined(WIN32) && !defined(_WIN32)
+    {
+        struct sigaction sa;
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = sim_signal;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+    }
+#endif
+
+    knob_next = sim_now_ms() + knob_ms;
+
+    while (!sim_exit)
+    {
+        if (knob_ms > 0)
+        {
+            struct pollfd pfd;
+            long wait_ms = knob_next - sim_now_ms();
+
+            if (wait_ms <= 0)
+            {
+                sim_knob(&s, fd, 100);
+                knob_next += knob_ms;
+                continue;
+            }
+
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+
+            if (poll(&pfd, 1, (int)wait_ms) <= 0) { continue; }
+        }
+
+        n = sim_frame_get(&s, fd, buf);
+
+        if (n <= 0)
+        {
+            if (!sim_exit) { hl_usleep(10 * 1000); }
+
+            continue;
+        }
+
+        s.requests++;
+
+        if (verbose)
+        {
+            if (m.proto == SIM_PROTO_CIV)
+            {
+                printf("cmd:");
+
+                for (i = 0; i < n; ++i) { printf(" %02x", buf[i]); }
+
+                printf("\n");
+            }
+            else
+            {
+                printf("cmd: %.*s\n", n, buf);
+            }
+
+            fflush(stdout);
+        }
+
+        if (m.proto == SIM_PROTO_CIV)
+        {
+            sim_civ_handle(&s, fd, buf, n);
+        }
+        else
+        {
+            buf[n] = 0;
+            sim_ascii_handle(&s, fd, (char *)buf, n);
+        }
+    }
+
+    printf("requests=%ld replies=%ld dropped=%ld knob=%ld\n", s.requests,
+           s.replies, s.dropped, s.knob_turns);
+
+    if (link) { unlink(link); }
+
+    return 0;
+}
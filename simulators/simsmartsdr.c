@@ -0,0 +1,404 @@
+// FlexRadio SmartSDR API stand-in for rigs/flexradio/smartsdr.c
+// simsmartsdr [port [script]]
+// serves the TCP API on port (default 4992) with two slices, answers the
+// commands the backend uses, pushes status for what changes and streams
+// meters as VITA-49 packets to the client's udpport at 10 Hz.
+// The script, if given, holds lines of "<ms> <status>" sent as status
+// S<handle>|<status> that many ms after the client connects, as if the
+// knob was turned on the radio; slice lines also change the slice, e.g.
+//   500 slice 0 RF_frequency=7.074000 mode=LSB
+//   900 interlock state=TRANSMITTING
+// rigctl -m 23005 -r 127.0.0.1:4992
+#define _XOPEN_SOURCE 700
+// since we are POSIX here we need this
+#if 0
+struct ip_mreq
+{
+    int dummy;
+};
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <math.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define HANDLE 0x5a17c0de
+#define SLICES 2
+#define MAXSCRIPT 256
+
+struct slice
+{
+    double freq;
+    char mode[8];
+    int filter_lo, filter_hi;
+    int tx;
+    int audio_level;
+} slices[SLICES] =
+{
+    { 14.074, "USB", 100, 2900, 1, 50 },
+    { 7.074, "DIGU", 100, 3100, 0, 50 },
+};
+
+struct
+{
+    long ms;
+    char text[256];
+} script[MAXSCRIPT];
+int nscript;
+
+int client = -1;
+int udp_fd = -1;
+struct sockaddr_in udp_peer;
+int transmitting;
+int rfpower = 100;
+unsigned long commands, statuses, meter_packets;
+
+long now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000L + tv.tv_usec / 1000;
+}
+
+void sendline(const char *fmt, ...)
+__attribute__((format(printf, 1, 2)));
+
+#include <stdarg.h>
+void sendline(const char *fmt, ...)
+{
+    char buf[1024];
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(buf, sizeof(buf) - 1, fmt, ap);
+    va_end(ap);
+
+    if (n < 0 || n > (int)sizeof(buf) - 2) { return; }
+
+    buf[n++] = '\n';
+
+    if (client >= 0 && write(client, buf, n) != n) { perror("write"); }
+
+    if (buf[0] == 'S') { statuses++; }
+}
+
+void slice_status(int n)
+{
+    struct slice *s = &slices[n];
+
+    sendline("S%08X|slice %d in_use=1 RF_frequency=%.6f mode=%s filter_lo=%d "
+             "filter_hi=%d tx=%d audio_level=%d", HANDLE, n, s->freq, s->mode,
+             s->filter_lo, s->filter_hi, s->tx, s->audio_level);
+}
+
+// key=value pairs as in "slice set" and status lines
+void slice_apply(int n, char *kv)
+{
+    char *tok, *save;
+
+    for (tok = strtok_r(kv, " ", &save); tok; tok = strtok_r(NULL, " ", &save))
+    {
+        char *val = strchr(tok, '=');
+
+        if (!val) { continue; }
+
+        *val++ = 0;
+
+        if (strcmp(tok, "RF_frequency") == 0) { slices[n].freq = atof(val); }
+        else if (strcmp(tok, "mode") == 0) { snprintf(slices[n].mode, sizeof(slices[n].mode), "%s", val); }
+        else if (strcmp(tok, "audio_level") == 0) { slices[n].audio_level = atoi(val); }
+        else if (strcmp(tok, "filter_lo") == 0) { slices[n].filter_lo = atoi(val); }
+        else if (strcmp(tok, "filter_hi") == 0) { slices[n].filter_hi = atoi(val); }
+        else if (strcmp(tok, "tx") == 0 && atoi(val))
+        {
+            int i;
+
+            for (i = 0; i < SLICES; i++) { slices[i].tx = i == n; }
+        }
+    }
+}
+
+void meter_list(void)
+{
+    static const char *const meters[] =
+    {
+        "1.src=SLC#1.num=0#1.nam=LEVEL#1.low=-150.0#1.hi=20.0#1.desc=Signal strength#1.unit=dBm#1.fps=10#",
+        "2.src=SLC#2.num=1#2.nam=LEVEL#2.low=-150.0#2.hi=20.0#2.desc=Signal strength#2.unit=dBm#2.fps=10#",
+        "3.src=TX-#3.num=1#3.nam=FWDPWR#3.low=0.0#3.hi=60.0#3.desc=RF Power Forward#3.unit=dBm#3.fps=10#",
+        "4.src=TX-#4.num=1#4.nam=SWR#4.low=1.0#4.hi=999.0#4.desc=RF SWR#4.unit=SWR#4.fps=10#",
+        "5.src=RAD#5.num=0#5.nam=+13.8A#5.low=0.0#5.hi=20.0#5.desc=13.8V supply#5.unit=Volts#5.fps=10#",
+        "6.src=RAD#6.num=0#6.nam=PATEMP#6.low=0.0#6.hi=100.0#6.desc=PA temperature#6.unit=degC#6.fps=10#",
+    };
+    int i;
+
+    for (i = 0; i < 6; i++) { sendline("S%08X|meter %s", HANDLE, meters[i]); }
+}
+
+void put32be(unsigned char *p, uint32_t v)
+{
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+void put16be(unsigned char *p, int v) { p[0] = (v >> 8) & 0xff; p[1] = v & 0xff; }
+
+// one VITA-49 packet with all meters, header with stream id, class id and
+// both timestamps as the radio sends them
+void send_meters(void)
+{
+    static int count;
+    unsigned char buf[28 + 6 * 4];
+    double level = -73.0 + (rand() % 61 - 30) / 10.0;
+    double fwd = transmitting ? 10 * log10(rfpower * 1000.0) : -10.0;
+    struct timeval tv;
+    int off = 28, i;
+    const struct { int id; double v; int scale; } m[] =
+    {
+        { 1, level, 128 }, { 2, level - 20, 128 }, { 3, fwd, 128 },
+        { 4, transmitting ? 1.2 : 1.0, 128 }, { 5, 13.8, 256 }, { 6, 38.5, 64 },
+    };
+
+    if (udp_fd < 0 || udp_peer.sin_port == 0) { return; }
+
+    gettimeofday(&tv, NULL);
+    put32be(buf, (3u << 28) | (1u << 27) | (1u << 22) | (1u << 20)
+            | ((count++ & 15) << 16) | (sizeof(buf) / 4));
+    put32be(buf + 4, 0x00000700);
+    put32be(buf + 8, 0x00001c2d);
+    put32be(buf + 12, 0x534c8002);
+    put32be(buf + 16, tv.tv_sec);
+    put32be(buf + 20, 0);
+    put32be(buf + 24, tv.tv_usec);
+
+    for (i = 0; i < 6; i++, off += 4)
+    {
+        put16be(buf + off, m[i].id);
+        put16be(buf + off + 2, (int) lround(m[i].v * m[i].scale));
+    }
+
+    sendto(udp_fd, buf, sizeof(buf), 0, (struct sockaddr *) &udp_peer,
+           sizeof(udp_peer));
+    meter_packets++;
+}
+
+void command(unsigned seq, char *cmd)
+{
+    int n, lo, hi;
+    double f;
+    char rest[512];
+
+    commands++;
+
+    if (strcmp(cmd, "sub slice all") == 0)
+    {
+        sendline("R%u|0|", seq);
+
+        for (n = 0; n < SLICES; n++) { slice_status(n); }
+    }
+    else if (strcmp(cmd, "sub tx all") == 0)
+    {
+        sendline("R%u|0|", seq);
+        sendline("S%08X|interlock state=%s", HANDLE, transmitting ? "TRANSMITTING" : "READY");
+        sendline("S%08X|transmit rfpower=%d", HANDLE, rfpower);
+    }
+    else if (strcmp(cmd, "sub meter all") == 0)
+    {
+        sendline("R%u|0|", seq);
+        meter_list();
+    }
+    else if (sscanf(cmd, "client udpport %d", &n) == 1)
+    {
+        socklen_t len = sizeof(udp_peer);
+
+        getpeername(client, (struct sockaddr *) &udp_peer, &len);
+        udp_peer.sin_port = htons(n);
+        sendline("R%u|0|", seq);
+    }
+    else if (sscanf(cmd, "slice tune %d %lf", &n, &f) == 2 && n >= 0 && n < SLICES)
+    {
+        slices[n].freq = f;
+        sendline("R%u|0|", seq);
+        sendline("S%08X|slice %d RF_frequency=%.6f", HANDLE, n, f);
+    }
+    else if (sscanf(cmd, "slice set %d %511[^\n]", &n, rest) == 2 && n >= 0 && n < SLICES)
+    {
+        slice_apply(n, rest);
+        sendline("R%u|0|", seq);
+
+        for (n = 0; n < SLICES; n++) { slice_status(n); }
+    }
+    else if (sscanf(cmd, "filt %d %d %d", &n, &lo, &hi) == 3 && n >= 0 && n < SLICES)
+    {
+        slices[n].filter_lo = lo;
+        slices[n].filter_hi = hi;
+        sendline("R%u|0|", seq);
+        sendline("S%08X|slice %d filter_lo=%d filter_hi=%d", HANDLE, n, lo, hi);
+    }
+    else if (sscanf(cmd, "xmit %d", &n) == 1)
+    {
+        sendline("R%u|0|", seq);
+        sendline("S%08X|interlock state=%s", HANDLE, n ? "PTT_REQUESTED" : "UNKEY_REQUESTED");
+        transmitting = n != 0;
+        sendline("S%08X|interlock state=%s", HANDLE, n ? "TRANSMITTING" : "READY");
+    }
+    else if (sscanf(cmd, "transmit set rfpower=%d", &n) == 1)
+    {
+        rfpower = n;
+        sendline("R%u|0|", seq);
+        sendline("S%08X|transmit rfpower=%d", HANDLE, rfpower);
+    }
+    else
+    {
+        sendline("R%u|50000015|Unknown command", seq);
+    }
+}
+
+void load_script(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[300];
+
+    if (!fp) { perror(path); exit(1); }
+
+    while (nscript < MAXSCRIPT && fgets(line, sizeof(line), fp))
+    {
+        char *nl = strchr(line, '\n');
+
+        if (nl) { *nl = 0; }
+
+        if (line[0] == '#' || sscanf(line, "%ld %255[^\n]", &script[nscript].ms,
+                                     script[nscript].text) != 2)
+        {
+            continue;
+        }
+
+        nscript++;
+    }
+
+    fclose(fp);
+}
+
+void run_script(long elapsed, int *next)
+{
+    while (*next < nscript && script[*next].ms <= elapsed)
+    {
+        char text[256];
+        int n;
+
+        snprintf(text, sizeof(text), "%s", script[*next].text);
+        sendline("S%08X|%s", HANDLE, text);
+
+        if (sscanf(text, "slice %d", &n) == 1 && n >= 0 && n < SLICES)
+        {
+            char *kv = strchr(text + 6, ' ');
+
+            if (kv) { slice_apply(n, kv + 1); }
+        }
+        else if (strstr(text, "interlock state=TRANSMITTING")) { transmitting = 1; }
+        else if (strstr(text, "interlock state=READY")) { transmitting = 0; }
+
+        (*next)++;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 4992;
+    struct sockaddr_in sin;
+    int lfd, on = 1;
+
+    if (argc > 2) { load_script(argv[2]); }
+
+    lfd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port = htons(port);
+
+    if (bind(lfd, (struct sockaddr *) &sin, sizeof(sin)) < 0 || listen(lfd, 1) < 0)
+    {
+        perror("bind");
+        return 1;
+    }
+
+    udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    printf("SmartSDR stand-in on %d, %d script lines\n", port, nscript);
+    fflush(stdout);
+
+    while (1)
+    {
+        char buf[1024], line[1024];
+        long start, last_meter = 0;
+        int len = 0, next = 0;
+
+        client = accept(lfd, NULL, NULL);
+
+        if (client < 0) { continue; }
+
+        memset(&udp_peer, 0, sizeof(udp_peer));
+        commands = statuses = meter_packets = 0;
+        start = now_ms();
+        sendline("V1.4.0.0");
+        sendline("H%08X", HANDLE);
+        printf("client connected\n");
+        fflush(stdout);
+
+        while (1)
+        {
+            struct pollfd pfd = { client, POLLIN, 0 };
+            long now;
+            int n, i;
+
+            poll(&pfd, 1, 10);
+            now = now_ms();
+            run_script(now - start, &next);
+
+            if (now - last_meter >= 100) { send_meters(); last_meter = now; }
+
+            if (!(pfd.revents & (POLLIN | POLLHUP))) { continue; }
+
+            n = read(client, buf, sizeof(buf));
+
+            if (n <= 0) { break; }
+
+            for (i = 0; i < n; i++)
+            {
+                unsigned seq;
+                char *bar;
+
+                if (buf[i] != '\n')
+                {
+                    if (len < (int)sizeof(line) - 1) { line[len++] = buf[i]; }
+
+                    continue;
+                }
+
+                line[len] = 0;
+                len = 0;
+                bar = strchr(line, '|');
+
+                if (line[0] == 'C' && bar && sscanf(line + 1, "%u", &seq) == 1)
+                {
+                    command(seq, bar + 1);
+                }
+            }
+        }
+
+        close(client);
+        client = -1;
+        printf("client gone: commands=%lu status=%lu meter_packets=%lu\n",
+               commands, statuses, meter_packets);
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -28,6 +28,15 @@ LOCAL_SRC_FILES := \
         microham.c \
         rot_ext.c \
         cm108.c \
+        portrec.c \
+        uring.c \
+        icomlan.c \
+        capindex.c \
+        tokindex.c \
+        vfoplan.c \
+        swscan.c \
+        meter.c \
+        asyncop.c \
         sprintflst.c
 
 
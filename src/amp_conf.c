@@ -70,6 +70,16 @@ static const struct confparams ampfrontend_cfg_params[] =
         TOK_RETRY, "retry", "Retry", "Max number of retry",
         "0", RIG_CONF_NUMERIC, { .n = { 0, 10, 1 } }
     },
+    {
+        TOK_CACHE_TIMEOUT, "cache_timeout", "Cache timeout",
+        "ms a status frame answers level/powerstat/freq queries, 0 to read it every time",
+        "500", RIG_CONF_NUMERIC, { .n = { 0, 60000, 1 } }
+    },
+    {
+        TOK_STATUS_REFRESH, "status_refresh", "Status refresh",
+        "ms between status frame reads in the background, 0 for none, set before open",
+        "0", RIG_CONF_NUMERIC, { .n = { 0, 60000, 1 } }
+    },
 
     { RIG_CONF_END, NULL, }
 };
@@ -161,6 +171,24 @@ int frontamp_set_conf(AMP *amp, token_t token, const char *val)
         rs->ampport_deprecated.retry = val_i;
         break;
 
+    case TOK_CACHE_TIMEOUT:
+        if (1 != sscanf(val, "%d", &val_i) || val_i < 0)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->cache_timeout = val_i;
+        break;
+
+    case TOK_STATUS_REFRESH:
+        if (1 != sscanf(val, "%d", &val_i) || val_i < 0)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->status_refresh = val_i;
+        break;
+
     case TOK_SERIAL_SPEED:
         if (rs->ampport.type.rig != RIG_PORT_SERIAL)
         {
@@ -397,6 +425,14 @@ int frontamp_get_conf2(AMP *amp, token_t token, char *val, int val_len)
         SNPRINTF(val, val_len, "%d", rs->ampport.timeout);
         break;
 
+    case TOK_CACHE_TIMEOUT:
+        SNPRINTF(val, val_len, "%d", rs->cache_timeout);
+        break;
+
+    case TOK_STATUS_REFRESH:
+        SNPRINTF(val, val_len, "%d", rs->status_refresh);
+        break;
+
     case TOK_RETRY:
         SNPRINTF(val, val_len, "%d", rs->ampport.retry);
         break;
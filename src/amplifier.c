@@ -56,7 +56,12 @@
 #include <stdio.h>
 #include <fcntl.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #include <hamlib/amplifier.h>
+#include "misc.h"
 #include "serial.h"
 #include "parallel.h"
 #include "usb_port.h"
@@ -80,6 +85,137 @@ struct opened_amp_l
 static struct opened_amp_l *opened_amp_list = { NULL };
 
 
+/*
+ * Status read by amp_caps.get_status, for backends that have it.  The
+ * mutex also serializes the port between the API calls and the refresher.
+ */
+//! @cond Doxygen_Suppress
+struct amp_status_cache
+{
+    struct amp_status status;
+    struct timespec time;       /* when status was read */
+    char fault[64];             /* AMP_LEVEL_FAULT text handed out */
+    unsigned long hits;         /* queries answered from status */
+    unsigned long reads;        /* status reads for a query */
+    unsigned long refreshes;    /* status reads by the refresher */
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t mutex;
+    pthread_t refresher;
+    int refreshing;
+#endif
+};
+//! @endcond
+
+
+static void amp_lock(const AMP *amp)
+{
+#ifdef HAVE_PTHREAD
+    struct amp_status_cache *sc = amp->state.status_cache_priv;
+
+    if (sc) { pthread_mutex_lock(&sc->mutex); }
+
+#endif
+}
+
+
+static void amp_unlock(const AMP *amp)
+{
+#ifdef HAVE_PTHREAD
+    struct amp_status_cache *sc = amp->state.status_cache_priv;
+
+    if (sc) { pthread_mutex_unlock(&sc->mutex); }
+
+#endif
+}
+
+
+/* a set may change anything in the status, amp_lock held */
+static void amp_status_invalidate(AMP *amp)
+{
+    struct amp_status_cache *sc = amp->state.status_cache_priv;
+
+    if (sc) { elapsed_ms(&sc->time, HAMLIB_ELAPSED_INVALIDATE); }
+}
+
+
+/* read the status from the amp, amp_lock held */
+static int amp_status_read(AMP *amp, struct amp_status_cache *sc)
+{
+    int retval;
+
+    memset(&sc->status, 0, sizeof(sc->status));
+    retval = amp->caps->get_status(amp, &sc->status);
+
+    if (retval != RIG_OK)
+    {
+        elapsed_ms(&sc->time, HAMLIB_ELAPSED_INVALIDATE);
+        return retval;
+    }
+
+    elapsed_ms(&sc->time, HAMLIB_ELAPSED_SET);
+    return RIG_OK;
+}
+
+
+/*
+ * Get a status no older than cache_timeout, amp_lock held.
+ * Returns NULL with *retval set when there is none to use.
+ */
+static const struct amp_status *amp_status_get(AMP *amp, int *retval)
+{
+    struct amp_status_cache *sc = amp->state.status_cache_priv;
+
+    *retval = RIG_OK;
+
+    if (!sc || amp->state.cache_timeout <= 0)
+    {
+        return NULL;
+    }
+
+    if (elapsed_ms(&sc->time, HAMLIB_ELAPSED_GET) < amp->state.cache_timeout)
+    {
+        sc->hits++;
+        return &sc->status;
+    }
+
+    sc->reads++;
+    *retval = amp_status_read(amp, sc);
+
+    return *retval == RIG_OK ? &sc->status : NULL;
+}
+
+
+#ifdef HAVE_PTHREAD
+static void *amp_status_refresher(void *arg)
+{
+    AMP *amp = (AMP *)arg;
+    struct amp_status_cache *sc = amp->state.status_cache_priv;
+
+    amp_debug(RIG_DEBUG_VERBOSE, "%s: every %dms\n", __func__,
+              amp->state.status_refresh);
+
+    for (;;)
+    {
+        pthread_mutex_lock(&sc->mutex);
+
+        if (!sc->refreshing)
+        {
+            pthread_mutex_unlock(&sc->mutex);
+            break;
+        }
+
+        if (amp_status_read(amp, sc) == RIG_OK) { sc->refreshes++; }
+
+        pthread_mutex_unlock(&sc->mutex);
+
+        hl_usleep(amp->state.status_refresh * 1000);
+    }
+
+    return NULL;
+}
+#endif
+
+
 /*
  * track which amp is opened (with amp_open)
  * needed at least for transceive mode
@@ -232,6 +368,7 @@ AMP *HAMLIB_API amp_init(amp_model_t amp_model)
     rs->ampport.timeout = caps->timeout;
     rs->ampport.retry = caps->retry;
     rs->has_get_level = caps->has_get_level;
+    rs->cache_timeout = 500;    /* same as rig cache_timeout */
 
     switch (caps->port_type)
     {
@@ -402,6 +539,20 @@ int HAMLIB_API amp_open(AMP *amp)
 
     rs->comm_state = 1;
 
+    if (caps->get_status && !rs->status_cache_priv)
+    {
+        struct amp_status_cache *sc = calloc(1, sizeof(*sc));
+
+        if (sc)
+        {
+#ifdef HAVE_PTHREAD
+            pthread_mutex_init(&sc->mutex, NULL);
+#endif
+            elapsed_ms(&sc->time, HAMLIB_ELAPSED_INVALIDATE);
+            rs->status_cache_priv = sc;
+        }
+    }
+
     /*
      * Maybe the backend has something to initialize
      * In case of failure, just close down and report error code.
@@ -438,6 +589,23 @@ int HAMLIB_API amp_open(AMP *amp)
     memcpy(&amp->state.ampport_deprecated, &amp->state.ampport,
            sizeof(amp->state.ampport_deprecated));
 
+#ifdef HAVE_PTHREAD
+
+    if (rs->status_cache_priv && rs->status_refresh > 0)
+    {
+        struct amp_status_cache *sc = rs->status_cache_priv;
+
+        sc->refreshing = 1;
+
+        if (pthread_create(&sc->refresher, NULL, amp_status_refresher, amp) != 0)
+        {
+            amp_debug(RIG_DEBUG_ERR, "%s: status refresher not started\n", __func__);
+            sc->refreshing = 0;
+        }
+    }
+
+#endif
+
     return RIG_OK;
 }
 
@@ -487,6 +655,25 @@ int HAMLIB_API amp_close(AMP *amp)
         return -RIG_EINVAL;
     }
 
+#ifdef HAVE_PTHREAD
+
+    if (rs->status_cache_priv)
+    {
+        struct amp_status_cache *sc = rs->status_cache_priv;
+        int refreshing;
+
+        pthread_mutex_lock(&sc->mutex);
+        refreshing = sc->refreshing;
+        sc->refreshing = 0;
+        pthread_mutex_unlock(&sc->mutex);
+
+        if (refreshing) { pthread_join(sc->refresher, NULL); }
+    }
+
+#endif
+
+    amp_status_invalidate(amp);
+
     /*
      * Let the backend say 73s to the amp.
      * and ignore the return code.
@@ -574,6 +761,16 @@ int HAMLIB_API amp_cleanup(AMP *amp)
         amp->caps->amp_cleanup(amp);
     }
 
+    if (amp->state.status_cache_priv)
+    {
+#ifdef HAVE_PTHREAD
+        struct amp_status_cache *sc = amp->state.status_cache_priv;
+
+        pthread_mutex_destroy(&sc->mutex);
+#endif
+        free(amp->state.status_cache_priv);
+    }
+
     free(amp);
 
     return RIG_OK;
@@ -598,6 +795,7 @@ int HAMLIB_API amp_cleanup(AMP *amp)
 int HAMLIB_API amp_reset(AMP *amp, amp_reset_t reset)
 {
     const struct amp_caps *caps;
+    int retval;
 
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -613,7 +811,12 @@ int HAMLIB_API amp_reset(AMP *amp, amp_reset_t reset)
         return -RIG_ENAVAIL;
     }
 
-    return caps->reset(amp, reset);
+    amp_lock(amp);
+    retval = caps->reset(amp, reset);
+    amp_status_invalidate(amp);
+    amp_unlock(amp);
+
+    return retval;
 }
 
 
@@ -637,6 +840,8 @@ int HAMLIB_API amp_reset(AMP *amp, amp_reset_t reset)
 int HAMLIB_API amp_get_freq(AMP *amp, freq_t *freq)
 {
     const struct amp_caps *caps;
+    const struct amp_status *st;
+    int retval;
 
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -652,7 +857,21 @@ int HAMLIB_API amp_get_freq(AMP *amp, freq_t *freq)
         return -RIG_ENAVAIL;
     }
 
-    return caps->get_freq(amp, freq);
+    amp_lock(amp);
+    st = amp_status_get(amp, &retval);
+
+    if (st && st->has_freq)
+    {
+        *freq = st->freq;
+    }
+    else
+    {
+        retval = caps->get_freq(amp, freq);
+    }
+
+    amp_unlock(amp);
+
+    return retval;
 }
 
 
@@ -677,6 +896,7 @@ int HAMLIB_API amp_get_freq(AMP *amp, freq_t *freq)
 int HAMLIB_API amp_set_freq(AMP *amp, freq_t freq)
 {
     const struct amp_caps *caps;
+    int retval;
 
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -692,7 +912,12 @@ int HAMLIB_API amp_set_freq(AMP *amp, freq_t freq)
         return -RIG_ENAVAIL;
     }
 
-    return caps->set_freq(amp, freq);
+    amp_lock(amp);
+    retval = caps->set_freq(amp, freq);
+    amp_status_invalidate(amp);
+    amp_unlock(amp);
+
+    return retval;
 }
 
 
@@ -749,6 +974,8 @@ const char *HAMLIB_API amp_get_info(AMP *amp)
  */
 int HAMLIB_API amp_set_level(AMP *amp, setting_t level, value_t val)
 {
+    int retval;
+
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_AMP_ARG(amp))
@@ -761,7 +988,12 @@ int HAMLIB_API amp_set_level(AMP *amp, setting_t level, value_t val)
         return -RIG_ENAVAIL;
     }
 
-    return amp->caps->set_level(amp, level, val);
+    amp_lock(amp);
+    retval = amp->caps->set_level(amp, level, val);
+    amp_status_invalidate(amp);
+    amp_unlock(amp);
+
+    return retval;
 }
 
 /**
@@ -786,6 +1018,9 @@ int HAMLIB_API amp_set_level(AMP *amp, setting_t level, value_t val)
  */
 int HAMLIB_API amp_get_level(AMP *amp, setting_t level, value_t *val)
 {
+    const struct amp_status *st;
+    int retval;
+
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_AMP_ARG(amp))
@@ -798,7 +1033,30 @@ int HAMLIB_API amp_get_level(AMP *amp, setting_t level, value_t *val)
         return -RIG_ENAVAIL;
     }
 
-    return amp->caps->get_level(amp, level, val);
+    amp_lock(amp);
+    st = amp_status_get(amp, &retval);
+
+    if (st && (st->levels & level))
+    {
+        struct amp_status_cache *sc = amp->state.status_cache_priv;
+
+        *val = st->level[rig_setting2idx(level)];
+
+        /* st->fault changes with the next read */
+        if (AMP_LEVEL_IS_STRING(level))
+        {
+            SNPRINTF(sc->fault, sizeof(sc->fault), "%s", st->fault);
+            val->s = sc->fault;
+        }
+    }
+    else
+    {
+        retval = amp->caps->get_level(amp, level, val);
+    }
+
+    amp_unlock(amp);
+
+    return retval;
 }
 
 
@@ -822,6 +1080,8 @@ int HAMLIB_API amp_get_level(AMP *amp, setting_t level, value_t *val)
  */
 int HAMLIB_API amp_set_ext_level(AMP *amp, token_t level, value_t val)
 {
+    int retval;
+
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_AMP_ARG(amp))
@@ -834,7 +1094,12 @@ int HAMLIB_API amp_set_ext_level(AMP *amp, token_t level, value_t val)
         return -RIG_ENAVAIL;
     }
 
-    return amp->caps->set_ext_level(amp, level, val);
+    amp_lock(amp);
+    retval = amp->caps->set_ext_level(amp, level, val);
+    amp_status_invalidate(amp);
+    amp_unlock(amp);
+
+    return retval;
 }
 
 /**
@@ -857,6 +1122,8 @@ int HAMLIB_API amp_set_ext_level(AMP *amp, token_t level, value_t val)
  */
 int HAMLIB_API amp_get_ext_level(AMP *amp, token_t level, value_t *val)
 {
+    int retval;
+
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_AMP_ARG(amp))
@@ -869,7 +1136,11 @@ int HAMLIB_API amp_get_ext_level(AMP *amp, token_t level, value_t *val)
         return -RIG_ENAVAIL;
     }
 
-    return amp->caps->get_ext_level(amp, level, val);
+    amp_lock(amp);
+    retval = amp->caps->get_ext_level(amp, level, val);
+    amp_unlock(amp);
+
+    return retval;
 }
 
 
@@ -895,6 +1166,8 @@ int HAMLIB_API amp_get_ext_level(AMP *amp, token_t level, value_t *val)
  */
 int HAMLIB_API amp_set_powerstat(AMP *amp, powerstat_t status)
 {
+    int retval;
+
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_AMP_ARG(amp))
@@ -907,7 +1180,12 @@ int HAMLIB_API amp_set_powerstat(AMP *amp, powerstat_t status)
         return -RIG_ENAVAIL;
     }
 
-    return amp->caps->set_powerstat(amp, status);
+    amp_lock(amp);
+    retval = amp->caps->set_powerstat(amp, status);
+    amp_status_invalidate(amp);
+    amp_unlock(amp);
+
+    return retval;
 }
 
 
@@ -932,6 +1210,9 @@ int HAMLIB_API amp_set_powerstat(AMP *amp, powerstat_t status)
  */
 int HAMLIB_API amp_get_powerstat(AMP *amp, powerstat_t *status)
 {
+    const struct amp_status *st;
+    int retval;
+
     amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_AMP_ARG(amp))
@@ -944,7 +1225,131 @@ int HAMLIB_API amp_get_powerstat(AMP *amp, powerstat_t *status)
         return -RIG_ENAVAIL;
     }
 
-    return amp->caps->get_powerstat(amp, status);
+    amp_lock(amp);
+    st = amp_status_get(amp, &retval);
+
+    if (st && st->has_powerstat)
+    {
+        *status = st->powerstat;
+    }
+    else
+    {
+        retval = amp->caps->get_powerstat(amp, status);
+    }
+
+    amp_unlock(amp);
+
+    return retval;
+}
+
+
+/**
+ * \brief Query the whole status of the amplifier at once.
+ *
+ * \param amp The #AMP handle.
+ * \param status The variable to store the status.
+ *
+ * Reads everything the amplifier reports in its status frame with one
+ * transaction.  A status read less than "cache_timeout" ms ago, by an
+ * earlier query or the "status_refresh" thread, is returned without
+ * talking to the amplifier.  Only the fields flagged in \a status are
+ * valid.
+ *
+ * \return RIG_OK if the query was successful, otherwise a **negative value**
+ * if an error occurred (in which case, cause is set appropriately).
+ *
+ * \retval RIG_OK The status was read.
+ * \retval RIG_EINVAL \a amp is NULL or inconsistent.
+ * \retval RIG_ENAVAIL amp_caps#get_status() capability is not available.
+ *
+ * \sa amp_get_level(), amp_get_status_cache_stats()
+ */
+int HAMLIB_API amp_get_status(AMP *amp, struct amp_status *status)
+{
+    struct amp_status_cache *sc;
+    const struct amp_status *st;
+    int retval;
+
+    amp_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
+
+    if (CHECK_AMP_ARG(amp) || !status)
+    {
+        return -RIG_EINVAL;
+    }
+
+    sc = amp->state.status_cache_priv;
+
+    if (amp->caps->get_status == NULL || sc == NULL)
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    amp_lock(amp);
+    st = amp_status_get(amp, &retval);
+
+    if (!st && retval == RIG_OK)
+    {
+        sc->reads++;
+        retval = amp_status_read(amp, sc);
+        st = &sc->status;
+    }
+
+    if (retval == RIG_OK)
+    {
+        *status = *st;
+
+        if (status->levels & AMP_LEVEL_FAULT)
+        {
+            status->level[rig_setting2idx(AMP_LEVEL_FAULT)].s = status->fault;
+        }
+    }
+
+    amp_unlock(amp);
+
+    return retval;
+}
+
+
+/**
+ * \brief Get amplifier status cache statistics.
+ *
+ * \param amp The #AMP handle.
+ * \param hits Queries answered from a recent status, may be NULL.
+ * \param reads Status reads made for a query, may be NULL.
+ * \param refreshes Status reads made by the "status_refresh" thread, may be
+ * NULL.
+ *
+ * Counts are kept from the first amp_open() of a backend that reads its
+ * status in one frame, and are all 0 for the others.
+ *
+ * \return RIG_OK if the operation was successful, otherwise a **negative
+ * value** if an error occurred.
+ *
+ * \sa amp_get_status()
+ */
+int HAMLIB_API amp_get_status_cache_stats(AMP *amp, unsigned long *hits,
+        unsigned long *reads, unsigned long *refreshes)
+{
+    struct amp_status_cache *sc;
+
+    if (!amp || !amp->caps)
+    {
+        return -RIG_EINVAL;
+    }
+
+    sc = amp->state.status_cache_priv;
+
+    amp_lock(amp);
+
+    if (hits) { *hits = sc ? sc->hits : 0; }
+
+    if (reads) { *reads = sc ? sc->reads : 0; }
+
+    if (refreshes) { *refreshes = sc ? sc->refreshes : 0; }
+
+    amp_unlock(amp);
+
+    return RIG_OK;
 }
 
 
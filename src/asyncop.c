@@ -0,0 +1,773 @@
+/*
+ *  Hamlib Interface - asynchronous operations
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig
+ * @{
+ */
+
+/**
+ * \file asyncop.c
+ * \brief Asynchronous operations
+ *
+ * rig_submit() queues an operation for a worker thread, started on first
+ * use, which runs the operations one at a time in the order submitted
+ * with the ordinary rig_* calls.  Each completion goes to the callback
+ * given at submit time, or waits in the queue for rig_async_reap(), with
+ * rig_async_fd() becoming readable so it can sit in an application's
+ * poll() or event loop.
+ *
+ * The queue is a fixed table of slots.  A slot stays taken from
+ * rig_submit() until its completion is delivered, so an application that
+ * never reaps runs into -RIG_ENOMEM instead of growing memory.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "asyncop.h"
+
+#define CHECK_RIG_ARG(r) (!(r) || !(r)->caps || !(r)->state.comm_state)
+
+/* operations queued, running or waiting for rig_async_reap() */
+#define ASYNC_SLOTS 256
+
+#ifdef HAVE_PTHREAD
+
+enum { SLOT_FREE, SLOT_QUEUED, SLOT_RUNNING, SLOT_CANCELLED, SLOT_DONE };
+
+struct async_slot
+{
+    struct rig_async_op op;
+    rig_async_cb_t cb;
+    rig_ptr_t arg;
+    int state;
+    int cancelled;      /* while running: the result is stale */
+};
+
+struct async_worker
+{
+    RIG *rig;
+    pthread_t thread_id;
+    int run;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    long last_id;
+    int rfd, wfd;       /* the same eventfd, or the ends of a pipe */
+    int signalled;
+    struct async_slot slot[ASYNC_SLOTS];
+};
+
+static pthread_mutex_t async_start_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static int async_is_read(enum rig_async_opcode op)
+{
+    switch (op)
+    {
+    case RIG_ASYNC_GET_FREQ:
+    case RIG_ASYNC_GET_MODE:
+    case RIG_ASYNC_GET_VFO:
+    case RIG_ASYNC_GET_PTT:
+    case RIG_ASYNC_GET_DCD:
+    case RIG_ASYNC_GET_SPLIT_VFO:
+    case RIG_ASYNC_GET_SPLIT_FREQ:
+    case RIG_ASYNC_GET_RIT:
+    case RIG_ASYNC_GET_XIT:
+    case RIG_ASYNC_GET_LEVEL:
+    case RIG_ASYNC_GET_FUNC:
+    case RIG_ASYNC_GET_PARM:
+    case RIG_ASYNC_GET_POWERSTAT:
+    case RIG_ASYNC_GET_MEM:
+        return 1;
+
+    default:
+        return 0;
+    }
+}
+
+
+static int async_run(RIG *rig, struct rig_async_op *op)
+{
+    int retcode;
+
+    switch (op->op)
+    {
+    case RIG_ASYNC_CALL:
+        return op->fn(rig, op->fn_arg);
+
+    case RIG_ASYNC_SET_FREQ:
+        return rig_set_freq(rig, op->vfo, op->freq);
+
+    case RIG_ASYNC_GET_FREQ:
+        return rig_get_freq(rig, op->vfo, &op->freq);
+
+    case RIG_ASYNC_SET_MODE:
+        return rig_set_mode(rig, op->vfo, op->mode, op->width);
+
+    case RIG_ASYNC_GET_MODE:
+        return rig_get_mode(rig, op->vfo, &op->mode, &op->width);
+
+    case RIG_ASYNC_SET_VFO:
+        return rig_set_vfo(rig, op->vfo);
+
+    case RIG_ASYNC_GET_VFO:
+        return rig_get_vfo(rig, &op->vfo);
+
+    case RIG_ASYNC_SET_PTT:
+        return rig_set_ptt(rig, op->vfo, (ptt_t) op->status);
+
+    case RIG_ASYNC_GET_PTT:
+    {
+        ptt_t ptt = RIG_PTT_OFF;
+
+        retcode = rig_get_ptt(rig, op->vfo, &ptt);
+        op->status = ptt;
+        return retcode;
+    }
+
+    case RIG_ASYNC_GET_DCD:
+    {
+        dcd_t dcd = RIG_DCD_OFF;
+
+        retcode = rig_get_dcd(rig, op->vfo, &dcd);
+        op->status = dcd;
+        return retcode;
+    }
+
+    case RIG_ASYNC_SET_SPLIT_VFO:
+        return rig_set_split_vfo(rig, op->vfo, (split_t) op->status, op->tx_vfo);
+
+    case RIG_ASYNC_GET_SPLIT_VFO:
+    {
+        split_t split = RIG_SPLIT_OFF;
+
+        retcode = rig_get_split_vfo(rig, op->vfo, &split, &op->tx_vfo);
+        op->status = split;
+        return retcode;
+    }
+
+    case RIG_ASYNC_SET_SPLIT_FREQ:
+        return rig_set_split_freq(rig, op->vfo, op->freq);
+
+    case RIG_ASYNC_GET_SPLIT_FREQ:
+        return rig_get_split_freq(rig, op->vfo, &op->freq);
+
+    case RIG_ASYNC_SET_RIT:
+        return rig_set_rit(rig, op->vfo, op->offset);
+
+    case RIG_ASYNC_GET_RIT:
+        return rig_get_rit(rig, op->vfo, &op->offset);
+
+    case RIG_ASYNC_SET_XIT:
+        return rig_set_xit(rig, op->vfo, op->offset);
+
+    case RIG_ASYNC_GET_XIT:
+        return rig_get_xit(rig, op->vfo, &op->offset);
+
+    case RIG_ASYNC_SET_LEVEL:
+        return rig_set_level(rig, op->vfo, op->setting, op->val);
+
+    case RIG_ASYNC_GET_LEVEL:
+        return rig_get_level(rig, op->vfo, op->setting, &op->val);
+
+    case RIG_ASYNC_SET_FUNC:
+        return rig_set_func(rig, op->vfo, op->setting, op->status);
+
+    case RIG_ASYNC_GET_FUNC:
+        return rig_get_func(rig, op->vfo, op->setting, &op->status);
+
+    case RIG_ASYNC_SET_PARM:
+        return rig_set_parm(rig, op->setting, op->val);
+
+    case RIG_ASYNC_GET_PARM:
+        return rig_get_parm(rig, op->setting, &op->val);
+
+    case RIG_ASYNC_SET_POWERSTAT:
+        return rig_set_powerstat(rig, (powerstat_t) op->status);
+
+    case RIG_ASYNC_GET_POWERSTAT:
+    {
+        powerstat_t stat = RIG_POWER_UNKNOWN;
+
+        retcode = rig_get_powerstat(rig, &stat);
+        op->status = stat;
+        return retcode;
+    }
+
+    case RIG_ASYNC_VFO_OP:
+        return rig_vfo_op(rig, op->vfo, (vfo_op_t) op->status);
+
+    case RIG_ASYNC_SET_MEM:
+        return rig_set_mem(rig, op->vfo, op->status);
+
+    case RIG_ASYNC_GET_MEM:
+        return rig_get_mem(rig, op->vfo, &op->status);
+    }
+
+    return -RIG_EINVAL;
+}
+
+
+/* make rfd readable, called with the lock held */
+static void async_signal(struct async_worker *aw)
+{
+    if (aw->signalled || aw->wfd < 0) { return; }
+
+#ifdef HAVE_SYS_EVENTFD_H
+    {
+        uint64_t one = 1;
+
+        if (write(aw->wfd, &one, sizeof(one)) != sizeof(one)) { return; }
+    }
+#else
+
+    if (write(aw->wfd, "", 1) != 1) { return; }
+
+#endif
+
+    aw->signalled = 1;
+}
+
+
+/* called with the lock held */
+static void async_drain(struct async_worker *aw)
+{
+    char buf[64];
+
+    if (!aw->signalled) { return; }
+
+    while (read(aw->rfd, buf, sizeof(buf)) > 0) { }
+
+    aw->signalled = 0;
+}
+
+
+/* the oldest slot in state, NULL if none */
+static struct async_slot *async_oldest(struct async_worker *aw, int state)
+{
+    struct async_slot *oldest = NULL;
+    int i;
+
+    for (i = 0; i < ASYNC_SLOTS; i++)
+    {
+        struct async_slot *s = &aw->slot[i];
+
+        if (s->state == state && (oldest == NULL || s->op.id < oldest->op.id))
+        {
+            oldest = s;
+        }
+    }
+
+    return oldest;
+}
+
+
+/*
+ * Deliver a completion.  Called with the lock held, which is dropped
+ * around the callback so it may submit more operations.
+ */
+static void async_complete(struct async_worker *aw, struct async_slot *s)
+{
+    struct rig_async_op op;
+    rig_async_cb_t cb = s->cb;
+    rig_ptr_t arg = s->arg;
+
+    if (cb == NULL)
+    {
+        s->state = SLOT_DONE;
+        async_signal(aw);
+        return;
+    }
+
+    op = s->op;
+    s->state = SLOT_FREE;
+
+    pthread_mutex_unlock(&aw->lock);
+    cb(aw->rig, &op, arg);
+    pthread_mutex_lock(&aw->lock);
+}
+
+
+/*
+ * Only marks the slot, async_complete_cancelled() delivers it once the
+ * caller is done walking the slots, so no callback runs in the middle.
+ */
+static void async_cancel_slot(struct async_slot *s)
+{
+    s->op.retcode = -RIG_ECANCELED;
+    s->state = SLOT_CANCELLED;
+}
+
+
+/* called with the lock held, dropped around each callback */
+static void async_complete_cancelled(struct async_worker *aw)
+{
+    struct async_slot *s;
+
+    while ((s = async_oldest(aw, SLOT_CANCELLED)) != NULL)
+    {
+        async_complete(aw, s);
+    }
+}
+
+
+static void *async_worker_thread(void *arg)
+{
+    struct async_worker *aw = arg;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: async worker started\n", __func__);
+
+    pthread_mutex_lock(&aw->lock);
+
+    while (aw->run)
+    {
+        struct async_slot *s = async_oldest(aw, SLOT_QUEUED);
+        struct rig_async_op op;
+
+        if (s == NULL)
+        {
+            pthread_cond_wait(&aw->cond, &aw->lock);
+            continue;
+        }
+
+        s->state = SLOT_RUNNING;
+        s->cancelled = 0;
+        op = s->op;
+        pthread_mutex_unlock(&aw->lock);
+
+        op.retcode = async_run(aw->rig, &op);
+
+        pthread_mutex_lock(&aw->lock);
+
+        s->op = op;
+
+        if (s->cancelled) { s->op.retcode = -RIG_ECANCELED; }
+
+        async_complete(aw, s);
+    }
+
+    pthread_mutex_unlock(&aw->lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: async worker stopped\n", __func__);
+
+    return NULL;
+}
+
+
+static int async_open_fd(struct async_worker *aw)
+{
+#if defined(HAVE_SYS_EVENTFD_H)
+    aw->rfd = aw->wfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    return aw->rfd >= 0 ? RIG_OK : -RIG_EIO;
+#elif !defined(_WIN32)
+    int fds[2];
+
+    if (pipe(fds) < 0) { return -RIG_EIO; }
+
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    aw->rfd = fds[0];
+    aw->wfd = fds[1];
+
+    return RIG_OK;
+#else
+    /* callbacks only */
+    aw->rfd = aw->wfd = -1;
+
+    return RIG_OK;
+#endif
+}
+
+
+static void async_close_fd(struct async_worker *aw)
+{
+    if (aw->rfd >= 0) { close(aw->rfd); }
+
+    if (aw->wfd >= 0 && aw->wfd != aw->rfd) { close(aw->wfd); }
+}
+
+
+/* the rig's worker, started if it isn't running yet */
+static int async_worker_get(RIG *rig, struct async_worker **awp)
+{
+    struct async_worker *aw;
+    int retcode;
+
+    pthread_mutex_lock(&async_start_lock);
+
+    aw = rig->state.async_priv;
+
+    if (aw != NULL)
+    {
+        pthread_mutex_unlock(&async_start_lock);
+        *awp = aw;
+        return RIG_OK;
+    }
+
+    aw = calloc(1, sizeof(*aw));
+
+    if (aw == NULL)
+    {
+        pthread_mutex_unlock(&async_start_lock);
+        return -RIG_ENOMEM;
+    }
+
+    retcode = async_open_fd(aw);
+
+    if (retcode != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: completion fd: %s\n", __func__,
+                  strerror(errno));
+        pthread_mutex_unlock(&async_start_lock);
+        free(aw);
+        return retcode;
+    }
+
+    aw->rig = rig;
+    aw->run = 1;
+    pthread_mutex_init(&aw->lock, NULL);
+    pthread_cond_init(&aw->cond, NULL);
+
+    if (pthread_create(&aw->thread_id, NULL, async_worker_thread, aw))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create error: %s\n", __func__,
+                  strerror(errno));
+        pthread_mutex_unlock(&async_start_lock);
+        async_close_fd(aw);
+        pthread_mutex_destroy(&aw->lock);
+        pthread_cond_destroy(&aw->cond);
+        free(aw);
+        return -RIG_EINTERNAL;
+    }
+
+    rig->state.async_priv = aw;
+    pthread_mutex_unlock(&async_start_lock);
+
+    *awp = aw;
+    return RIG_OK;
+}
+
+
+void rig_async_stop(RIG *rig)
+{
+    struct async_worker *aw;
+    int i;
+
+    aw = rig->state.async_priv;
+
+    if (aw == NULL) { return; }
+
+    pthread_mutex_lock(&aw->lock);
+
+    aw->run = 0;
+
+    for (i = 0; i < ASYNC_SLOTS; i++)
+    {
+        if (aw->slot[i].state == SLOT_QUEUED)
+        {
+            async_cancel_slot(&aw->slot[i]);
+        }
+    }
+
+    async_complete_cancelled(aw);
+    pthread_cond_signal(&aw->cond);
+    pthread_mutex_unlock(&aw->lock);
+
+    pthread_join(aw->thread_id, NULL);
+
+    pthread_mutex_lock(&async_start_lock);
+    rig->state.async_priv = NULL;
+    pthread_mutex_unlock(&async_start_lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: %ld operations submitted\n", __func__,
+              aw->last_id);
+
+    async_close_fd(aw);
+    pthread_mutex_destroy(&aw->lock);
+    pthread_cond_destroy(&aw->cond);
+    free(aw);
+}
+
+#else
+
+void rig_async_stop(RIG *rig)
+{
+}
+
+#endif /* HAVE_PTHREAD */
+
+
+/**
+ * \brief queue an operation for the rig's worker thread
+ * \param rig   The rig handle
+ * \param op    The operation and its arguments, copied
+ * \param cb    Called from the worker thread when the operation is done,
+ *              NULL to keep the completion for rig_async_reap()
+ * \param arg   Passed to \a cb
+ *
+ * Operations run one at a time in the order submitted, through the
+ * same rig_* calls a blocking application would make, so caching and
+ * backend behavior are unchanged.  The callback gets a copy of \a op with
+ * id, retcode and the values read filled in.  It may submit further
+ * operations but must not call rig_close().
+ *
+ * With RIG_ASYNC_SUPERSEDE in op->flags, a read cancels the queued reads
+ * of the same value (same opcode, VFO and setting) that haven't started,
+ * so a GUI polling faster than the rig answers only waits for the newest.
+ *
+ * \return a request id greater than zero, otherwise a negative value if an
+ * error occurred: -RIG_ENOMEM when 256 operations are outstanding.
+ *
+ * \sa rig_async_cancel(), rig_async_fd(), rig_async_reap()
+ */
+long HAMLIB_API rig_submit(RIG *rig, const struct rig_async_op *op,
+                           rig_async_cb_t cb, rig_ptr_t arg)
+{
+#ifdef HAVE_PTHREAD
+    struct async_worker *aw;
+    struct async_slot *s = NULL;
+    long id;
+    int i, retcode;
+
+    if (CHECK_RIG_ARG(rig) || !op) { return -RIG_EINVAL; }
+
+    if ((int) op->op < RIG_ASYNC_CALL || op->op > RIG_ASYNC_GET_MEM
+            || (op->op == RIG_ASYNC_CALL && op->fn == NULL))
+    {
+        return -RIG_EINVAL;
+    }
+
+    retcode = async_worker_get(rig, &aw);
+
+    if (retcode != RIG_OK) { return retcode; }
+
+    pthread_mutex_lock(&aw->lock);
+
+    /* a callback of an operation cancelled by rig_close() */
+    if (!aw->run)
+    {
+        pthread_mutex_unlock(&aw->lock);
+        return -RIG_EINVAL;
+    }
+
+    if ((op->flags & RIG_ASYNC_SUPERSEDE) && async_is_read(op->op))
+    {
+        for (i = 0; i < ASYNC_SLOTS; i++)
+        {
+            struct async_slot *old = &aw->slot[i];
+
+            if (old->state == SLOT_QUEUED && old->op.op == op->op
+                    && old->op.vfo == op->vfo && old->op.setting == op->setting)
+            {
+                async_cancel_slot(old);
+            }
+        }
+    }
+
+    for (i = 0; i < ASYNC_SLOTS; i++)
+    {
+        if (aw->slot[i].state == SLOT_FREE)
+        {
+            s = &aw->slot[i];
+            break;
+        }
+    }
+
+    if (s == NULL)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: %d operations outstanding\n", __func__,
+                  ASYNC_SLOTS);
+        id = -RIG_ENOMEM;
+    }
+    else
+    {
+        id = ++aw->last_id;
+        s->op = *op;
+        s->op.id = id;
+        s->op.retcode = RIG_OK;
+        s->cb = cb;
+        s->arg = arg;
+        s->state = SLOT_QUEUED;
+        pthread_cond_signal(&aw->cond);
+    }
+
+    async_complete_cancelled(aw);
+    pthread_mutex_unlock(&aw->lock);
+
+    return id;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+/**
+ * \brief cancel an operation from rig_submit()
+ * \param rig   The rig handle
+ * \param id    The request id rig_submit() returned
+ *
+ * An operation still queued is dropped.  One already sent to the rig
+ * runs to the end, but its result is thrown away.  Either way it
+ * completes with retcode -RIG_ECANCELED; for a queued one the callback
+ * is called from this thread.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred: -RIG_EINVAL when \a id is
+ * unknown or already complete.
+ *
+ * \sa rig_submit()
+ */
+int HAMLIB_API rig_async_cancel(RIG *rig, long id)
+{
+#ifdef HAVE_PTHREAD
+    struct async_worker *aw;
+    int i, retcode = -RIG_EINVAL;
+
+    if (CHECK_RIG_ARG(rig)) { return -RIG_EINVAL; }
+
+    aw = rig->state.async_priv;
+
+    if (aw == NULL) { return -RIG_EINVAL; }
+
+    pthread_mutex_lock(&aw->lock);
+
+    for (i = 0; i < ASYNC_SLOTS; i++)
+    {
+        struct async_slot *s = &aw->slot[i];
+
+        if (s->op.id != id) { continue; }
+
+        if (s->state == SLOT_QUEUED)
+        {
+            async_cancel_slot(s);
+            retcode = RIG_OK;
+        }
+        else if (s->state == SLOT_RUNNING)
+        {
+            s->cancelled = 1;
+            retcode = RIG_OK;
+        }
+
+        break;
+    }
+
+    async_complete_cancelled(aw);
+    pthread_mutex_unlock(&aw->lock);
+
+    return retcode;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+/**
+ * \brief get a file descriptor that signals completions
+ * \param rig   The rig handle
+ *
+ * The descriptor is readable while completions of operations submitted
+ * without a callback wait for rig_async_reap().  Don't read or close it;
+ * rig_async_reap() resets it and rig_close() closes it.  It is an eventfd
+ * where available, otherwise a pipe.
+ *
+ * \return the descriptor, otherwise a negative value if an error occurred.
+ *
+ * \sa rig_async_reap()
+ */
+int HAMLIB_API rig_async_fd(RIG *rig)
+{
+#ifdef HAVE_PTHREAD
+    struct async_worker *aw;
+    int retcode;
+
+    if (CHECK_RIG_ARG(rig)) { return -RIG_EINVAL; }
+
+    retcode = async_worker_get(rig, &aw);
+
+    if (retcode != RIG_OK) { return retcode; }
+
+    return aw->rfd >= 0 ? aw->rfd : -RIG_ENIMPL;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+/**
+ * \brief take completions of operations submitted without a callback
+ * \param rig   The rig handle
+ * \param done  Where to store the completed operations, oldest first
+ * \param max   Room in \a done
+ *
+ * Doesn't wait; poll rig_async_fd() for that.
+ *
+ * \return the number of completions stored, otherwise a negative value if
+ * an error occurred.
+ *
+ * \sa rig_submit(), rig_async_fd()
+ */
+int HAMLIB_API rig_async_reap(RIG *rig, struct rig_async_op *done, int max)
+{
+#ifdef HAVE_PTHREAD
+    struct async_worker *aw;
+    struct async_slot *s;
+    int n = 0;
+
+    if (CHECK_RIG_ARG(rig) || !done || max < 0) { return -RIG_EINVAL; }
+
+    aw = rig->state.async_priv;
+
+    if (aw == NULL) { return 0; }
+
+    pthread_mutex_lock(&aw->lock);
+
+    while (n < max && (s = async_oldest(aw, SLOT_DONE)) != NULL)
+    {
+        done[n++] = s->op;
+        s->state = SLOT_FREE;
+    }
+
+    if (async_oldest(aw, SLOT_DONE) == NULL) { async_drain(aw); }
+
+    pthread_mutex_unlock(&aw->lock);
+
+    return n;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+/*! @} */
@@ -0,0 +1,440 @@
+/*
+ *  Hamlib Interface - per-rig capability index
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * rig_passband_*(), rig_get_resolution(), rig_power2mW()/rig_mW2power()
+ * and rig_get_band() used to walk the filter, tuning step, tx range and
+ * band lists on every call.  rig_open() now folds those lists into:
+ *
+ *  - per-mode tables of normal/narrow/wide passband and best resolution,
+ *    indexed by mode bit, so single-mode lookups are O(1)
+ *
+ *  - interval tables for the tx ranges and bands: the range ends are cut
+ *    into sorted, non-overlapping segments, each listing the entries that
+ *    cover it in the order the old scan would have tried them, so a
+ *    lookup is a binary search plus a check of the few overlapping
+ *    entries (usually one).
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "capindex.h"
+
+#define CAPINDEX_MODES 64
+
+struct capindex_intervals
+{
+    int nseg;
+    freq_t *start;  /* nseg+1 bounds, segment i is [start[i], start[i+1]) */
+    int *first;     /* segment i covered by cand[first[i] .. first[i+1]) */
+    int *cand;      /* entry numbers, in lookup order */
+};
+
+struct capindex
+{
+    pbwidth_t passband[3][CAPINDEX_MODES];
+    shortfreq_t ts[CAPINDEX_MODES];
+
+    struct capindex_intervals tx;
+    const freq_range_t **tx_range;
+    unsigned char *tx_state;    /* entry is from rig->state.tx_range_list */
+
+    struct capindex_intervals band;
+    hamlib_band_t *band_id;
+};
+
+
+static int mode_bit(rmode_t mode)
+{
+    int bit = 0;
+
+    if (mode == 0 || (mode & (mode - 1)) != 0) { return -1; }
+
+#if defined(__GNUC__)
+    bit = __builtin_ctzll(mode);
+#else
+
+    while (!(mode & 1))
+    {
+        mode >>= 1;
+        bit++;
+    }
+
+#endif
+
+    return bit;
+}
+
+
+static int cmp_freq(const void *a, const void *b)
+{
+    freq_t fa = *(const freq_t *)a;
+    freq_t fb = *(const freq_t *)b;
+
+    return fa < fb ? -1 : fa > fb;
+}
+
+
+/* entries are [lo[e], hi[e]), earlier entries are preferred */
+static int intervals_build(struct capindex_intervals *iv, int n,
+                           const freq_t *lo, const freq_t *hi)
+{
+    int i, e, nb, ncand;
+
+    memset(iv, 0, sizeof(*iv));
+
+    if (n == 0) { return RIG_OK; }
+
+    iv->start = calloc(2 * n, sizeof(freq_t));
+
+    if (iv->start == NULL) { return -RIG_ENOMEM; }
+
+    memcpy(iv->start, lo, n * sizeof(freq_t));
+    memcpy(iv->start + n, hi, n * sizeof(freq_t));
+    qsort(iv->start, 2 * n, sizeof(freq_t), cmp_freq);
+
+    for (i = 1, nb = 1; i < 2 * n; i++)
+    {
+        if (iv->start[i] != iv->start[nb - 1]) { iv->start[nb++] = iv->start[i]; }
+    }
+
+    iv->nseg = nb - 1;
+    iv->first = calloc(nb, sizeof(int));
+
+    if (iv->first == NULL) { return -RIG_ENOMEM; }
+
+    for (i = 0, ncand = 0; i < iv->nseg; i++)
+    {
+        for (e = 0; e < n; e++)
+        {
+            ncand += lo[e] <= iv->start[i] && hi[e] >= iv->start[i + 1];
+        }
+    }
+
+    iv->cand = calloc(ncand ? ncand : 1, sizeof(int));
+
+    if (iv->cand == NULL) { return -RIG_ENOMEM; }
+
+    for (i = 0, ncand = 0; i < iv->nseg; i++)
+    {
+        iv->first[i] = ncand;
+
+        for (e = 0; e < n; e++)
+        {
+            if (lo[e] <= iv->start[i] && hi[e] >= iv->start[i + 1])
+            {
+                iv->cand[ncand++] = e;
+            }
+        }
+    }
+
+    iv->first[iv->nseg] = ncand;
+
+    return RIG_OK;
+}
+
+
+static void intervals_free(struct capindex_intervals *iv)
+{
+    free(iv->start);
+    free(iv->first);
+    free(iv->cand);
+}
+
+
+/* returns the number of entries covering freq, *cand points at them */
+static int intervals_find(const struct capindex_intervals *iv, freq_t freq,
+                          const int **cand)
+{
+    int lo = 0, hi = iv->nseg;
+
+    if (iv->nseg == 0 || freq < iv->start[0] || freq >= iv->start[iv->nseg])
+    {
+        return 0;
+    }
+
+    /* last segment starting at or below freq */
+    while (hi - lo > 1)
+    {
+        int mid = (lo + hi) / 2;
+
+        if (iv->start[mid] <= freq) { lo = mid; }
+        else { hi = mid; }
+    }
+
+    *cand = &iv->cand[iv->first[lo]];
+
+    return iv->first[lo + 1] - iv->first[lo];
+}
+
+
+/* same walk as rig_passband_normal/narrow/wide() for a single mode */
+static void build_passband(struct capindex *ci, const struct rig_state *rs)
+{
+    int bit, i;
+
+    for (bit = 0; bit < CAPINDEX_MODES; bit++)
+    {
+        rmode_t mode = (rmode_t)1 << bit;
+
+        for (i = 0; i < HAMLIB_FLTLSTSIZ && rs->filters[i].modes; i++)
+        {
+            if (rs->filters[i].modes & mode)
+            {
+                ci->passband[CAPINDEX_NORMAL][bit] = rs->filters[i].width;
+                break;
+            }
+        }
+
+        for (i = 0; i < HAMLIB_FLTLSTSIZ - 1 && rs->filters[i].modes; i++)
+        {
+            if (rs->filters[i].modes & mode)
+            {
+                pbwidth_t normal = rs->filters[i].width;
+                int narrow = 0, wide = 0;
+
+                for (i++; i < HAMLIB_FLTLSTSIZ && rs->filters[i].modes; i++)
+                {
+                    if (!(rs->filters[i].modes & mode)) { continue; }
+
+                    if (!narrow && rs->filters[i].width < normal)
+                    {
+                        ci->passband[CAPINDEX_NARROW][bit] = rs->filters[i].width;
+                        narrow = 1;
+                    }
+
+                    if (!wide && rs->filters[i].width > normal)
+                    {
+                        ci->passband[CAPINDEX_WIDE][bit] = rs->filters[i].width;
+                        wide = 1;
+                    }
+                }
+
+                break;
+            }
+        }
+
+        for (i = 0; i < HAMLIB_TSLSTSIZ && rs->tuning_steps[i].ts; i++)
+        {
+            if (rs->tuning_steps[i].modes & mode)
+            {
+                ci->ts[bit] = rs->tuning_steps[i].ts;
+                break;
+            }
+        }
+    }
+}
+
+
+/* rig->state.tx_range_list first, then the caps lists, as rig_power2mW() */
+static int build_tx(struct capindex *ci, const RIG *rig)
+{
+    const freq_range_t *lists[6];
+    freq_t *lo, *hi;
+    int l, i, n = 0, ret;
+
+    lists[0] = rig->state.tx_range_list;
+    lists[1] = rig->caps->tx_range_list1;
+    lists[2] = rig->caps->tx_range_list2;
+    lists[3] = rig->caps->tx_range_list3;
+    lists[4] = rig->caps->tx_range_list4;
+    lists[5] = rig->caps->tx_range_list5;
+
+    ci->tx_range = calloc(6 * HAMLIB_FRQRANGESIZ, sizeof(*ci->tx_range));
+    ci->tx_state = calloc(6 * HAMLIB_FRQRANGESIZ, 1);
+    lo = calloc(6 * HAMLIB_FRQRANGESIZ, sizeof(freq_t));
+    hi = calloc(6 * HAMLIB_FRQRANGESIZ, sizeof(freq_t));
+
+    if (!ci->tx_range || !ci->tx_state || !lo || !hi)
+    {
+        free(lo);
+        free(hi);
+        return -RIG_ENOMEM;
+    }
+
+    for (l = 0; l < 6; l++)
+    {
+        for (i = 0; i < HAMLIB_FRQRANGESIZ; i++)
+        {
+            const freq_range_t *r = &lists[l][i];
+
+            if (r->startf == 0 && r->endf == 0) { break; }
+
+            if (r->endf < r->startf) { continue; }
+
+            ci->tx_range[n] = r;
+            ci->tx_state[n] = l == 0;
+            lo[n] = r->startf;
+            hi[n] = nextafter(r->endf, HUGE_VAL);    /* endf is inclusive */
+            n++;
+        }
+    }
+
+    ret = intervals_build(&ci->tx, n, lo, hi);
+
+    free(lo);
+    free(hi);
+
+    return ret;
+}
+
+
+static int build_band(struct capindex *ci)
+{
+    freq_t lo[64], hi[64];
+    hamlib_band_t band;
+    freq_t start, stop;
+    int n;
+
+    ci->band_id = calloc(64, sizeof(hamlib_band_t));
+
+    if (ci->band_id == NULL) { return -RIG_ENOMEM; }
+
+    for (n = 0; n < 64 && rig_get_band_range(n, &band, &start, &stop); n++)
+    {
+        ci->band_id[n] = band;
+        lo[n] = start;
+        hi[n] = nextafter(stop, HUGE_VAL);
+    }
+
+    return intervals_build(&ci->band, n, lo, hi);
+}
+
+
+int capindex_build(RIG *rig)
+{
+    struct capindex *ci;
+    int ret;
+
+    capindex_free(rig);
+
+    ci = calloc(1, sizeof(*ci));
+
+    if (ci == NULL) { return -RIG_ENOMEM; }
+
+    build_passband(ci, &rig->state);
+    ret = build_tx(ci, rig);
+
+    if (ret == RIG_OK) { ret = build_band(ci); }
+
+    rig->state.capindex_priv = ci;
+
+    if (ret != RIG_OK)
+    {
+        capindex_free(rig);
+        return ret;
+    }
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: %d tx range segments, %d band segments\n",
+              __func__, ci->tx.nseg, ci->band.nseg);
+
+    return RIG_OK;
+}
+
+
+void capindex_free(RIG *rig)
+{
+    struct capindex *ci = rig->state.capindex_priv;
+
+    if (ci == NULL) { return; }
+
+    rig->state.capindex_priv = NULL;
+
+    intervals_free(&ci->tx);
+    free(ci->tx_range);
+    free(ci->tx_state);
+    intervals_free(&ci->band);
+    free(ci->band_id);
+    free(ci);
+}
+
+
+int capindex_passband(RIG *rig, rmode_t mode, enum capindex_passband which,
+                      pbwidth_t *width)
+{
+    const struct capindex *ci = rig->state.capindex_priv;
+    int bit = mode_bit(mode);
+
+    if (ci == NULL || bit < 0) { return 0; }
+
+    *width = ci->passband[which][bit];
+
+    return 1;
+}
+
+
+int capindex_resolution(RIG *rig, rmode_t mode, shortfreq_t *ts)
+{
+    const struct capindex *ci = rig->state.capindex_priv;
+    int bit = mode_bit(mode);
+
+    if (ci == NULL || bit < 0) { return 0; }
+
+    *ts = ci->ts[bit];
+
+    return 1;
+}
+
+
+int capindex_tx_range(RIG *rig, freq_t freq, rmode_t mode, int state_only,
+                      const freq_range_t **range)
+{
+    const struct capindex *ci = rig->state.capindex_priv;
+    const int *cand;
+    int i, n;
+
+    if (ci == NULL) { return 0; }
+
+    *range = NULL;
+    n = intervals_find(&ci->tx, freq, &cand);
+
+    for (i = 0; i < n; i++)
+    {
+        if (state_only && !ci->tx_state[cand[i]]) { continue; }
+
+        if (ci->tx_range[cand[i]]->modes & mode)
+        {
+            *range = ci->tx_range[cand[i]];
+            break;
+        }
+    }
+
+    return 1;
+}
+
+
+int capindex_band(RIG *rig, freq_t freq, hamlib_band_t *band)
+{
+    const struct capindex *ci;
+    const int *cand;
+
+    if (rig == NULL || (ci = rig->state.capindex_priv) == NULL) { return 0; }
+
+    *band = intervals_find(&ci->band, freq, &cand) ? ci->band_id[cand[0]]
+            : RIG_BANDSELECT_GEN;
+
+    return 1;
+}
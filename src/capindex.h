@@ -0,0 +1,54 @@
+/*
+ *  Hamlib Interface - per-rig capability index header
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _CAPINDEX_H
+#define _CAPINDEX_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/*
+ * Built by rig_open() from rig->state once the backend has opened, so
+ * the lookups below give the same answers as scanning the lists in
+ * rig->state and rig->caps.  Each lookup returns 0 when the index can't
+ * answer (not built, or \a mode is not a single mode) and the caller
+ * has to scan as before.
+ */
+enum capindex_passband
+{
+    CAPINDEX_NORMAL,
+    CAPINDEX_NARROW,
+    CAPINDEX_WIDE
+};
+
+int capindex_build(RIG *rig);
+void capindex_free(RIG *rig);
+
+int capindex_passband(RIG *rig, rmode_t mode, enum capindex_passband which,
+                      pbwidth_t *width);
+int capindex_resolution(RIG *rig, rmode_t mode, shortfreq_t *ts);
+int capindex_tx_range(RIG *rig, freq_t freq, rmode_t mode, int state_only,
+                      const freq_range_t **range);
+int capindex_band(RIG *rig, freq_t freq, hamlib_band_t *band);
+
+__END_DECLS
+
+#endif /* _CAPINDEX_H */
@@ -39,6 +39,7 @@
 
 #include <hamlib/rig.h>
 #include "token.h"
+#include "tokindex.h"
 
 
 /*
@@ -94,6 +95,41 @@ static const struct confparams frontend_cfg_params[] =
         "User-specified device ID for multicast state data and commands",
         "", RIG_CONF_STRING,
     },
+    {
+        TOK_PORT_RECORD, "port_record", "Port record file",
+        "Record all rig port traffic with timestamps to this file",
+        "", RIG_CONF_STRING,
+    },
+    {
+        TOK_PORT_REPLAY, "port_replay", "Port replay file",
+        "Answer the rig port from a file made with port_record instead of opening the port",
+        "", RIG_CONF_STRING,
+    },
+    {
+        TOK_PORT_REPLAY_SCALE, "replay_scale", "Replay time scale",
+        "Multiplier for the recorded reply delays, 0 replies immediately",
+        "1", RIG_CONF_NUMERIC, { .n = { 0, 100, .01 } }
+    },
+    {
+        TOK_TCP_KEEPALIVE, "tcp_keepalive", "TCP keepalive",
+        "Seconds a network port may sit idle before the connection is probed, 0 disables",
+        "10", RIG_CONF_NUMERIC, { .n = { 0, 3600, 1 } }
+    },
+    {
+        TOK_TCP_USER_TIMEOUT, "tcp_user_timeout", "TCP user timeout",
+        "Milliseconds unacknowledged data may wait before a network port is declared dead, 0 for the system default",
+        "0", RIG_CONF_NUMERIC, { .n = { 0, 600000, 1 } }
+    },
+    {
+        TOK_RECONNECT, "reconnect", "Reconnect",
+        "True reconnects a lost network port and restores the rig state",
+        "1", RIG_CONF_CHECKBUTTON, { }
+    },
+    {
+        TOK_IO_URING, "io_uring", "io_uring port I/O",
+        "True drives a serial or network port through io_uring on Linux, falling back to select() when unavailable",
+        "0", RIG_CONF_CHECKBUTTON, { }
+    },
 
     {
         TOK_VFO_COMP, "vfo_comp", "VFO compensation",
@@ -220,6 +256,11 @@ static const struct confparams frontend_cfg_params[] =
         "Multicast data UDP port for sending commands to rig",
         "4532", RIG_CONF_NUMERIC, { .n = { 0, 1000000, 1 } }
     },
+    {
+        TOK_FREQ_COALESCE, "freq_coalesce", "Coalesce frequency changes",
+        "True drops intermediate set_freq targets for a VFO while another set_freq is in flight, the latest target is always applied",
+        "0", RIG_CONF_CHECKBUTTON, { }
+    },
 
     { RIG_CONF_END, NULL, }
 };
@@ -643,6 +684,60 @@ static int frontend_set_conf(RIG *rig, token_t token, const char *val)
         strncpy(rs->device_id, val, HAMLIB_RIGNAMSIZ - 1);
         break;
 
+    case TOK_PORT_RECORD:
+        free(rs->port_record_pathname);
+        rs->port_record_pathname = val[0] ? strdup(val) : NULL;
+        break;
+
+    case TOK_PORT_REPLAY:
+        free(rs->port_replay_pathname);
+        rs->port_replay_pathname = val[0] ? strdup(val) : NULL;
+        break;
+
+    case TOK_PORT_REPLAY_SCALE:
+        if (1 != sscanf(val, "%lf", &rs->port_replay_scale))
+        {
+            return -RIG_EINVAL;
+        }
+
+        break;
+
+    case TOK_TCP_KEEPALIVE:
+        if (1 != sscanf(val, "%ld", &val_i) || val_i < 0)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->tcp_keepalive = val_i;
+        break;
+
+    case TOK_TCP_USER_TIMEOUT:
+        if (1 != sscanf(val, "%ld", &val_i) || val_i < 0)
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->tcp_user_timeout = val_i;
+        break;
+
+    case TOK_RECONNECT:
+        if (1 != sscanf(val, "%ld", &val_i))
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->net_reconnect = val_i ? 1 : 0;
+        break;
+
+    case TOK_IO_URING:
+        if (1 != sscanf(val, "%ld", &val_i))
+        {
+            return -RIG_EINVAL;
+        }
+
+        rs->io_uring = val_i ? 1 : 0;
+        break;
+
 
     case TOK_VFO_COMP:
         rs->vfo_comp = atof(val);
@@ -806,6 +901,14 @@ static int frontend_set_conf(RIG *rig, token_t token, const char *val)
         rs->multicast_cmd_port = val_i;
         break;
 
+    case TOK_FREQ_COALESCE:
+        if (1 != sscanf(val, "%ld", &val_i))
+        {
+            return -RIG_EINVAL; //value format error
+        }
+
+        return rig_set_freq_coalesce(rig, val_i ? 1 : 0);
+
     default:
         return -RIG_EINVAL;
     }
@@ -1009,6 +1112,36 @@ static int frontend_get_conf2(RIG *rig, token_t token, char *val, int val_len)
         SNPRINTF(val, val_len, "%s", rs->device_id);
         break;
 
+    case TOK_PORT_RECORD:
+        SNPRINTF(val, val_len, "%s",
+                 rs->port_record_pathname ? rs->port_record_pathname : "");
+        break;
+
+    case TOK_PORT_REPLAY:
+        SNPRINTF(val, val_len, "%s",
+                 rs->port_replay_pathname ? rs->port_replay_pathname : "");
+        break;
+
+    case TOK_PORT_REPLAY_SCALE:
+        SNPRINTF(val, val_len, "%g", rs->port_replay_scale);
+        break;
+
+    case TOK_TCP_KEEPALIVE:
+        SNPRINTF(val, val_len, "%d", rs->tcp_keepalive);
+        break;
+
+    case TOK_TCP_USER_TIMEOUT:
+        SNPRINTF(val, val_len, "%d", rs->tcp_user_timeout);
+        break;
+
+    case TOK_RECONNECT:
+        SNPRINTF(val, val_len, "%d", rs->net_reconnect);
+        break;
+
+    case TOK_IO_URING:
+        SNPRINTF(val, val_len, "%d", rs->io_uring);
+        break;
+
     case TOK_VFO_COMP:
         SNPRINTF(val, val_len, "%f", rs->vfo_comp);
         break;
@@ -1185,6 +1318,10 @@ static int frontend_get_conf2(RIG *rig, token_t token, char *val, int val_len)
         SNPRINTF(val, val_len, "%d", rs->multicast_cmd_port);
         break;
 
+    case TOK_FREQ_COALESCE:
+        SNPRINTF(val, val_len, "%d", rs->freq_coalesce);
+        break;
+
     default:
         return -RIG_EINVAL;
     }
@@ -1277,8 +1414,6 @@ const struct confparams *HAMLIB_API rig_confparam_lookup(RIG *rig,
     const struct confparams *cfp;
     token_t token;
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called for %s\n", __func__, name);
-
     if (!rig || !rig->caps)
     {
         return NULL;
@@ -1287,6 +1422,14 @@ const struct confparams *HAMLIB_API rig_confparam_lookup(RIG *rig,
     /* 0 returned for invalid format */
     token = strtol(name, NULL, 0);
 
+    if (tokindex_conf(rig, name, &cfp) && (cfp || token == 0
+                                           || tokindex_conf_tok(rig, token, &cfp)))
+    {
+        return cfp;
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s called for %s\n", __func__, name);
+
     for (cfp = rig->caps->cfgparams; cfp && cfp->name; cfp++)
     {
         if (!strcmp(cfp->name, name) || token == cfp->token)
@@ -1318,6 +1461,15 @@ const struct confparams *HAMLIB_API rig_confparam_lookup(RIG *rig,
 }
 
 
+/*
+ * Index the conf tables for rig_confparam_lookup, see tokindex.c
+ */
+int rig_conf_tokindex_build(RIG *rig)
+{
+    return tokindex_build(rig, frontend_cfg_params, frontend_serial_cfg_params);
+}
+
+
 /**
  * \brief lookup a token id
  * \param rig   The rig handle
@@ -1331,12 +1483,12 @@ token_t HAMLIB_API rig_token_lookup(RIG *rig, const char *name)
 {
     const struct confparams *cfp;
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called for %s\n", __func__, name);
-
+    /* no debug on the way in, formatting it costs more than the lookup */
     cfp = rig_confparam_lookup(rig, name);
 
     if (!cfp)
     {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: %s not found\n", __func__, name);
         return RIG_CONF_END;
     }
 
@@ -1391,6 +1543,9 @@ int HAMLIB_API rig_set_conf(RIG *rig, token_t token, const char *val)
         rig_debug(RIG_DEBUG_VERBOSE, "%s: %s='%s'\n", __func__, cfp->name, val);
     }
 
+    /* conf can change ptt type, ranges and what dump_state reports */
+    rs->state_gen++;
+
     if (IS_TOKEN_FRONTEND(token))
     {
         return frontend_set_conf(rig, token, val);
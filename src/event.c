@@ -531,13 +531,48 @@ int HAMLIB_API rig_set_spectrum_callback(RIG *rig, spectrum_cb_t cb,
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    spectrum_cb_lock(rig, 1);
     rig->callbacks.spectrum_event = cb;
     rig->callbacks.spectrum_arg = arg;
+    spectrum_cb_lock(rig, 0);
 
     RETURNFUNC(RIG_OK);
 }
 
 
+/* recursive, so the callback itself may change the callback */
+void spectrum_cb_lock(RIG *rig, int lock)
+{
+#ifdef HAVE_PTHREAD
+
+    if (lock) { pthread_mutex_lock(&rig->state.spectrum_cb_lock); }
+    else { pthread_mutex_unlock(&rig->state.spectrum_cb_lock); }
+
+#endif
+}
+
+
+void spectrum_cb_lock_init(RIG *rig)
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&rig->state.spectrum_cb_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+#endif
+}
+
+
+void spectrum_cb_lock_cleanup(RIG *rig)
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_destroy(&rig->state.spectrum_cb_lock);
+#endif
+}
+
+
 /**
  * \brief control the transceive mode
  * \param rig   The rig handle
@@ -787,11 +822,15 @@ int rig_fire_spectrum_event(RIG *rig, struct rig_spectrum_line *line)
 
     network_publish_rig_spectrum_data(rig, line);
 
+    spectrum_cb_lock(rig, 1);
+
     if (rig->callbacks.spectrum_event)
     {
         rig->callbacks.spectrum_event(rig, line, rig->callbacks.spectrum_arg);
     }
 
+    spectrum_cb_lock(rig, 0);
+
     RETURNFUNC(RIG_OK);
 }
 
@@ -35,5 +35,14 @@ int rig_fire_dcd_event(RIG *rig, vfo_t vfo, dcd_t dcd);
 int rig_fire_pltune_event(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode, pbwidth_t *width);
 int rig_fire_spectrum_event(RIG *rig, struct rig_spectrum_line *line);
 
+/*
+ * Once rig_set_spectrum_callback() returns, the old callback is no longer
+ * running.  rig_init() calls spectrum_cb_lock_init() and rig_cleanup()
+ * spectrum_cb_lock_cleanup().
+ */
+void spectrum_cb_lock(RIG *rig, int lock);
+void spectrum_cb_lock_init(RIG *rig);
+void spectrum_cb_lock_cleanup(RIG *rig);
+
 #endif /* _EVENT_H */
 
@@ -43,6 +43,7 @@
 #include <hamlib/rig.h>
 
 #include "token.h"
+#include "tokindex.h"
 
 static int rig_has_ext_token(RIG *rig, token_t token)
 {
@@ -227,12 +228,14 @@ int HAMLIB_API rig_ext_parm_foreach(RIG *rig,
  *
  * Returns NULL if nothing found
  *
- * TODO: should use Lex to speed it up, strcmp hurts!
+ * Answered from the index rig_init builds, see tokindex.c
  */
 const struct confparams *HAMLIB_API rig_ext_lookup(RIG *rig, const char *name)
 {
     const struct confparams *cfp;
 
+    if (tokindex_ext(rig, name, &cfp)) { return cfp; }
+
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (!rig || !rig->caps)
@@ -280,6 +283,8 @@ const struct confparams *HAMLIB_API rig_ext_lookup_tok(RIG *rig, token_t token)
 {
     const struct confparams *cfp;
 
+    if (tokindex_ext_tok(rig, token, &cfp)) { return cfp; }
+
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (!rig || !rig->caps)
@@ -324,12 +329,11 @@ token_t HAMLIB_API rig_ext_token_lookup(RIG *rig, const char *name)
 {
     const struct confparams *cfp;
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
-
     cfp = rig_ext_lookup(rig, name);
 
     if (!cfp)
     {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: %s not found\n", __func__, name);
         return RIG_CONF_END;
     }
 
@@ -0,0 +1,1077 @@
+/*
+ *  Hamlib Interface - Icom LAN (UDP) transport
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file icomlan.c
+ * \brief Talk CI-V to an Icom radio over its own UDP LAN protocol
+ *
+ * The IC-705, IC-7610, IC-9700, IC-905 and friends serve CI-V on a UDP
+ * protocol of their own (the one RS-BA1 and wfview use).  Until now that
+ * needed one of those programs to turn it back into a virtual serial
+ * port.  Here the port layer speaks it directly:
+ *
+ *  - the control stream (port 50001): are-you-there/ready, login with the
+ *    radio's user and password, token confirmation and renewal, and a
+ *    conninfo exchange that makes the radio open the CI-V stream
+ *
+ *  - the CI-V stream (port given in the radio's status packet): the same
+ *    handshake, an open packet, then one CI-V frame per data packet
+ *
+ * Both streams number their packets, keep each other alive with pings and
+ * idle packets, and ask for missing sequence numbers to be sent again, so
+ * we keep the last packets we sent for that.
+ *
+ * A thread per port runs the streams.  The backend gets one end of a
+ * socket pair as the port descriptor, so frame.c reads and writes CI-V
+ * bytes as it does on a serial port, with no pty or external proxy.
+ *
+ * Ports are registered by the Icom backend from its lan_user and
+ * lan_password conf and tracked in a private list, as portrec.c does, so
+ * hamlib_port_t is unchanged.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>
+#  include <poll.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#  include <netinet/in.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "icomlan.h"
+
+#define ICOMLAN_HISTORY 64          /* packets kept for retransmission */
+#define ICOMLAN_MAXPKT  512
+#define ICOMLAN_PING_MS 500
+#define ICOMLAN_IDLE_MS 100
+#define ICOMLAN_TOKEN_MS 60000
+#define ICOMLAN_WATCHDOG_MS 5000
+#define ICOMLAN_HANDSHAKE_MS 3000
+
+struct icomlan_sent
+{
+    uint16_t seq;
+    int len;
+    unsigned char buf[ICOMLAN_MAXPKT];
+};
+
+struct icomlan_stream
+{
+    int fd;
+    uint32_t myid;
+    uint32_t remoteid;
+    uint16_t seq;                   /* next tracked sequence number */
+    uint16_t pingseq;
+    int rx_started;
+    uint16_t rx_seq;                /* next one expected from the radio */
+    uint16_t missing[16];           /* asked for, not seen yet */
+    int nmissing;
+    long last_tx, last_rx, last_ping;
+    struct icomlan_sent sent[ICOMLAN_HISTORY];
+};
+
+struct icomlan
+{
+    struct icomlan *next;
+    hamlib_port_t *port;
+    char user[17];
+    char password[17];
+
+    struct icomlan_stream ctl;
+    struct icomlan_stream civ;
+    int peer_fd;                    /* our end of the backend's socket pair */
+    uint16_t innerseq;
+    uint16_t tokrequest;
+    uint32_t token;
+    uint16_t civ_sendseq;
+    long last_token;
+
+    pthread_t thread;
+    volatile int run;
+    struct icomlan_stats stats;
+};
+
+static struct icomlan *icomlan_list;
+static pthread_mutex_t icomlan_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* caller holds icomlan_lock */
+static struct icomlan *icomlan_find(const hamlib_port_t *p)
+{
+    struct icomlan *il;
+
+    for (il = icomlan_list; il != NULL; il = il->next)
+    {
+        if (il->port == p) { return il; }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Credentials are not sent in clear but through this substitution,
+ * character i of the string going through entry c + i.
+ */
+static const unsigned char icomlan_sequence[128] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0x47, 0x5d, 0x4c, 0x42, 0x66, 0x20, 0x23, 0x46, 0x4e, 0x57, 0x45, 0x3d, 0x67, 0x76, 0x60, 0x41,
+    0x62, 0x39, 0x59, 0x2d, 0x68, 0x7e, 0x7c, 0x65, 0x7d, 0x49, 0x29, 0x72, 0x73, 0x78, 0x21, 0x6e,
+    0x5a, 0x5e, 0x4a, 0x3e, 0x71, 0x2c, 0x2a, 0x54, 0x3c, 0x3a, 0x63, 0x4f, 0x43, 0x75, 0x27, 0x79,
+    0x5b, 0x35, 0x70, 0x48, 0x6b, 0x56, 0x6f, 0x34, 0x32, 0x6c, 0x30, 0x61, 0x6d, 0x7b, 0x2f, 0x4b,
+    0x64, 0x38, 0x2b, 0x2e, 0x50, 0x40, 0x3f, 0x55, 0x33, 0x37, 0x25, 0x77, 0x24, 0x26, 0x74, 0x6a,
+    0x28, 0x53, 0x4d, 0x69, 0x22, 0x5c, 0x44, 0x31, 0x36, 0x58, 0x3b, 0x7a, 0x51, 0x5f, 0x52, 0
+};
+
+
+void icomlan_encode(const char *in, unsigned char out[16])
+{
+    int i;
+
+    memset(out, 0, 16);
+
+    for (i = 0; i < 16 && in[i]; i++)
+    {
+        int c = (unsigned char) in[i] + i;
+
+        if (c > 126) { c = 32 + c % 127; }
+
+        out[i] = icomlan_sequence[c];
+    }
+}
+
+
+static long now_ms(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec * 1000L + tv.tv_usec / 1000;
+}
+
+
+static void put16(unsigned char *p, unsigned v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+
+static void put16be(unsigned char *p, unsigned v)
+{
+    p[0] = (v >> 8) & 0xff;
+    p[1] = v & 0xff;
+}
+
+
+static void put32(unsigned char *p, uint32_t v)
+{
+    put16(p, v & 0xffff);
+    put16(p + 2, v >> 16);
+}
+
+
+static void put32be(unsigned char *p, uint32_t v)
+{
+    put16be(p, v >> 16);
+    put16be(p + 2, v & 0xffff);
+}
+
+
+static unsigned get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+
+static unsigned get16be(const unsigned char *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+
+static uint32_t get32(const unsigned char *p)
+{
+    return get16(p) | ((uint32_t) get16(p + 2) << 16);
+}
+
+
+#ifdef HAVE_SYS_SOCKET_H
+
+static void header(const struct icomlan_stream *s, unsigned char *buf, int len,
+                   int type, uint16_t seq)
+{
+    memset(buf, 0, len);
+    put32(buf, len);
+    put16(buf + 4, type);
+    put16(buf + 6, seq);
+    put32(buf + 8, s->myid);
+    put32(buf + 12, s->remoteid);
+}
+
+
+static int send_raw(struct icomlan *il, struct icomlan_stream *s,
+                    const unsigned char *buf, int len)
+{
+    if (send(s->fd, buf, len, 0) != len)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: send: %s\n", __func__, strerror(errno));
+        return -RIG_EIO;
+    }
+
+    il->stats.tx_packets++;
+    s->last_tx = now_ms();
+
+    return RIG_OK;
+}
+
+
+/* stamps the next sequence number and keeps a copy for retransmission */
+static int send_tracked(struct icomlan *il, struct icomlan_stream *s,
+                        unsigned char *buf, int len)
+{
+    struct icomlan_sent *h = &s->sent[s->seq % ICOMLAN_HISTORY];
+
+    put16(buf + 6, s->seq);
+    h->seq = s->seq++;
+    h->len = len;
+    memcpy(h->buf, buf, len);
+
+    return send_raw(il, s, buf, len);
+}
+
+
+static int send_control(struct icomlan *il, struct icomlan_stream *s, int type,
+                        uint16_t seq)
+{
+    unsigned char buf[ICOMLAN_HEADER_SIZE];
+
+    header(s, buf, sizeof(buf), type, seq);
+
+    return send_raw(il, s, buf, sizeof(buf));
+}
+
+
+static int send_ping(struct icomlan *il, struct icomlan_stream *s)
+{
+    unsigned char buf[ICOMLAN_PING_SIZE];
+
+    header(s, buf, sizeof(buf), ICOMLAN_TYPE_PING, s->pingseq++);
+    put32(buf + 0x11, (uint32_t) now_ms());
+    s->last_ping = now_ms();
+
+    return send_raw(il, s, buf, sizeof(buf));
+}
+
+
+static int send_idle(struct icomlan *il, struct icomlan_stream *s)
+{
+    unsigned char buf[ICOMLAN_HEADER_SIZE];
+
+    header(s, buf, sizeof(buf), ICOMLAN_TYPE_DATA, 0);
+
+    return send_tracked(il, s, buf, sizeof(buf));
+}
+
+
+static void resend(struct icomlan *il, struct icomlan_stream *s, uint16_t seq)
+{
+    const struct icomlan_sent *h = &s->sent[seq % ICOMLAN_HISTORY];
+
+    if (h->len > 0 && h->seq == seq)
+    {
+        il->stats.resent++;
+        send_raw(il, s, h->buf, h->len);
+    }
+    else
+    {
+        /* gone from the history, fill the hole with an idle */
+        unsigned char buf[ICOMLAN_HEADER_SIZE];
+
+        header(s, buf, sizeof(buf), ICOMLAN_TYPE_DATA, seq);
+        send_raw(il, s, buf, sizeof(buf));
+    }
+}
+
+
+/* the inner header of the login, token, conninfo and status packets */
+static void inner(struct icomlan *il, unsigned char *buf, int len,
+                  int requestreply, int requesttype)
+{
+    header(&il->ctl, buf, len, ICOMLAN_TYPE_DATA, 0);
+    put16be(buf + 0x12, len - 0x10);
+    buf[0x14] = requestreply;
+    buf[0x15] = requesttype;
+    put16be(buf + 0x16, il->innerseq++);
+    put16(buf + 0x1a, il->tokrequest);
+    put32(buf + 0x1c, il->token);
+}
+
+
+/*
+ * Returns 1 if the packet is new, 0 if it is a duplicate.  Gaps are
+ * asked for again right away.
+ */
+static int track_rx(struct icomlan *il, struct icomlan_stream *s, uint16_t seq)
+{
+    int i;
+
+    if (!s->rx_started)
+    {
+        s->rx_started = 1;
+        s->rx_seq = seq + 1;
+        return 1;
+    }
+
+    if (seq == s->rx_seq)
+    {
+        s->rx_seq++;
+        return 1;
+    }
+
+    if ((uint16_t)(seq - s->rx_seq) < 0x8000)
+    {
+        /* ahead: everything in between went missing */
+        unsigned char buf[ICOMLAN_HEADER_SIZE + 2 * 16];
+        int n = 0;
+        uint16_t m;
+
+        header(s, buf, sizeof(buf), ICOMLAN_TYPE_RETRANSMIT, 0);
+
+        for (m = s->rx_seq; m != seq && n < 16; m++, n++)
+        {
+            put16(buf + ICOMLAN_HEADER_SIZE + 2 * n, m);
+
+            if (s->nmissing < 16) { s->missing[s->nmissing++] = m; }
+        }
+
+        if (n == 1)
+        {
+            send_control(il, s, ICOMLAN_TYPE_RETRANSMIT, s->rx_seq);
+        }
+        else
+        {
+            put32(buf, ICOMLAN_HEADER_SIZE + 2 * n);
+            send_raw(il, s, buf, ICOMLAN_HEADER_SIZE + 2 * n);
+        }
+
+        il->stats.requested += n;
+        s->rx_seq = seq + 1;
+        return 1;
+    }
+
+    /* behind: a retransmission we asked for, or a duplicate */
+    for (i = 0; i < s->nmissing; i++)
+    {
+        if (s->missing[i] == seq)
+        {
+            s->missing[i] = s->missing[--s->nmissing];
+            return 1;
+        }
+    }
+
+    il->stats.duplicates++;
+
+    return 0;
+}
+
+
+/*
+ * Handles what both streams share: retransmit requests, pings and
+ * sequence tracking.  Returns 1 for a new data packet the caller has to
+ * look at, 0 when done with, -1 when the radio disconnected.
+ */
+static int stream_packet(struct icomlan *il, struct icomlan_stream *s,
+                         unsigned char *buf, int len)
+{
+    int type;
+
+    if (len < ICOMLAN_HEADER_SIZE || (int) get32(buf) != len) { return 0; }
+
+    il->stats.rx_packets++;
+    s->last_rx = now_ms();
+    type = get16(buf + 4);
+
+    switch (type)
+    {
+    case ICOMLAN_TYPE_RETRANSMIT:
+        if (len == ICOMLAN_HEADER_SIZE)
+        {
+            resend(il, s, get16(buf + 6));
+        }
+        else
+        {
+            int i;
+
+            for (i = ICOMLAN_HEADER_SIZE; i + 1 < len; i += 2)
+            {
+                resend(il, s, get16(buf + i));
+            }
+        }
+
+        return 0;
+
+    case ICOMLAN_TYPE_PING:
+        if (len != ICOMLAN_PING_SIZE) { return 0; }
+
+        if (buf[0x10] == 0)
+        {
+            /* answer with the same seq and time */
+            put32(buf + 8, s->myid);
+            put32(buf + 12, s->remoteid);
+            buf[0x10] = 1;
+            send_raw(il, s, buf, len);
+        }
+        else
+        {
+            il->stats.rtt_ms = (double)((uint32_t) now_ms() - get32(buf + 0x11));
+        }
+
+        return 0;
+
+    case ICOMLAN_TYPE_DISCONNECT:
+        return -1;
+
+    case ICOMLAN_TYPE_DATA:
+        if (!track_rx(il, s, get16(buf + 6))) { return 0; }
+
+        return len > ICOMLAN_HEADER_SIZE;
+
+    default:
+        return 0;
+    }
+}
+
+
+static int wait_packet(struct icomlan_stream *s, unsigned char *buf,
+                       int size, int timeout_ms)
+{
+    struct pollfd pfd = { s->fd, POLLIN, 0 };
+    int n;
+
+    if (poll(&pfd, 1, timeout_ms) <= 0) { return 0; }
+
+    n = recv(s->fd, buf, size, 0);
+
+    return n < 0 ? 0 : n;
+}
+
+
+/*
+ * are-you-there until the radio says it is here, then are-you-ready
+ * until it says it is.
+ */
+static int stream_hello(struct icomlan *il, struct icomlan_stream *s)
+{
+    unsigned char buf[ICOMLAN_MAXPKT];
+    long deadline = now_ms() + ICOMLAN_HANDSHAKE_MS;
+    int type = ICOMLAN_TYPE_ARE_YOU_THERE;
+
+    while (now_ms() < deadline)
+    {
+        long until = now_ms() + 250;
+        int n;
+
+        send_control(il, s, type, type == ICOMLAN_TYPE_ARE_YOU_THERE ? 0 : 1);
+
+        while ((n = wait_packet(s, buf, sizeof(buf), (int)(until - now_ms()))) > 0)
+        {
+            if (n != ICOMLAN_HEADER_SIZE) { continue; }
+
+            if (type == ICOMLAN_TYPE_ARE_YOU_THERE
+                    && get16(buf + 4) == ICOMLAN_TYPE_I_AM_HERE)
+            {
+                s->remoteid = get32(buf + 8);
+                type = ICOMLAN_TYPE_READY;
+                break;
+            }
+
+            if (type == ICOMLAN_TYPE_READY && get16(buf + 4) == ICOMLAN_TYPE_READY)
+            {
+                s->seq = 1;
+                return RIG_OK;
+            }
+        }
+    }
+
+    rig_debug(RIG_DEBUG_ERR, "%s: no answer from the radio\n", __func__);
+
+    return -RIG_ETIMEOUT;
+}
+
+
+/* waits on the control stream for an inner packet of the given size */
+static int wait_inner(struct icomlan *il, unsigned char *buf, int want)
+{
+    long deadline = now_ms() + ICOMLAN_HANDSHAKE_MS;
+    int n;
+
+    while (now_ms() < deadline)
+    {
+        n = wait_packet(&il->ctl, buf, ICOMLAN_MAXPKT, (int)(deadline - now_ms()));
+
+        if (n > 0 && stream_packet(il, &il->ctl, buf, n) == 1 && n == want)
+        {
+            return RIG_OK;
+        }
+    }
+
+    return -RIG_ETIMEOUT;
+}
+
+
+static int login(struct icomlan *il, uint16_t civ_local_port)
+{
+    unsigned char buf[ICOMLAN_MAXPKT];
+    unsigned char mac[6];
+    char name[32];
+    int ret;
+
+    il->tokrequest = (uint16_t) rand();
+
+    inner(il, buf, ICOMLAN_LOGIN_SIZE, 0x01, 0x00);
+    icomlan_encode(il->user, buf + 0x40);
+    icomlan_encode(il->password, buf + 0x50);
+    memcpy(buf + 0x60, "hamlib", 6);
+
+    if ((ret = send_tracked(il, &il->ctl, buf, ICOMLAN_LOGIN_SIZE)) != RIG_OK)
+    {
+        return ret;
+    }
+
+    if ((ret = wait_inner(il, buf, ICOMLAN_LOGIN_REPLY_SIZE)) != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: no login reply\n", __func__);
+        return ret;
+    }
+
+    if (get32(buf + 0x30) == ICOMLAN_LOGIN_BAD)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: radio refused user '%s'\n", __func__,
+                  il->user);
+        return -RIG_ESECURITY;
+    }
+
+    il->token = get32(buf + 0x1c);
+
+    /* confirm the token, the radio then tells who it is */
+    inner(il, buf, ICOMLAN_TOKEN_SIZE, 0x01, 0x02);
+
+    if ((ret = send_tracked(il, &il->ctl, buf, ICOMLAN_TOKEN_SIZE)) != RIG_OK)
+    {
+        return ret;
+    }
+
+    il->last_token = now_ms();
+
+    if ((ret = wait_inner(il, buf, ICOMLAN_CONNINFO_SIZE)) != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: no conninfo from the radio\n", __func__);
+        return ret;
+    }
+
+    memcpy(mac, buf + 0x2a, sizeof(mac));
+    memcpy(name, buf + 0x40, sizeof(name));
+    name[sizeof(name) - 1] = '\0';
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: logged in to '%s'\n", __func__, name);
+
+    /* ask for the CI-V stream only, no audio */
+    inner(il, buf, ICOMLAN_CONNINFO_SIZE, 0x01, 0x03);
+    memcpy(buf + 0x2a, mac, sizeof(mac));
+    memcpy(buf + 0x40, name, sizeof(name));
+    icomlan_encode(il->user, buf + 0x60);
+    put32be(buf + 0x7c, civ_local_port);
+
+    if ((ret = send_tracked(il, &il->ctl, buf, ICOMLAN_CONNINFO_SIZE)) != RIG_OK)
+    {
+        return ret;
+    }
+
+    if ((ret = wait_inner(il, buf, ICOMLAN_STATUS_SIZE)) != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: no status from the radio\n", __func__);
+        return ret;
+    }
+
+    if (get32(buf + 0x30) != 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: radio busy (error 0x%08x)\n", __func__,
+                  (unsigned) get32(buf + 0x30));
+        return -RIG_EIO;
+    }
+
+    return get16be(buf + 0x42);
+}
+
+
+static uint32_t stream_id(int fd)
+{
+    struct sockaddr_in sin;
+    socklen_t len = sizeof(sin);
+
+    if (getsockname(fd, (struct sockaddr *) &sin, &len) < 0
+            || sin.sin_family != AF_INET)
+    {
+        return (uint32_t) rand();
+    }
+
+    return ((ntohl(sin.sin_addr.s_addr) & 0xffff) << 16) | ntohs(sin.sin_port);
+}
+
+
+/* a second socket to the radio's address on the given port */
+static int civ_socket(int ctl_fd, uint16_t *local_port)
+{
+    struct sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+    int fd;
+
+    if (getpeername(ctl_fd, (struct sockaddr *) &ss, &len) < 0) { return -1; }
+
+    fd = socket(ss.ss_family, SOCK_DGRAM, 0);
+
+    if (fd < 0) { return -1; }
+
+    /* bind now so conninfo can tell the radio our port */
+    if (ss.ss_family == AF_INET)
+    {
+        struct sockaddr_in sin;
+        socklen_t sl = sizeof(sin);
+
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        bind(fd, (struct sockaddr *) &sin, sizeof(sin));
+        getsockname(fd, (struct sockaddr *) &sin, &sl);
+        *local_port = ntohs(sin.sin_port);
+    }
+    else
+    {
+        *local_port = 0;
+    }
+
+    return fd;
+}
+
+
+static int civ_connect(int fd, int ctl_fd, uint16_t port)
+{
+    struct sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+
+    if (getpeername(ctl_fd, (struct sockaddr *) &ss, &len) < 0) { return -1; }
+
+    if (ss.ss_family == AF_INET)
+    {
+        ((struct sockaddr_in *) &ss)->sin_port = htons(port);
+    }
+#ifdef AF_INET6
+    else if (ss.ss_family == AF_INET6)
+    {
+        ((struct sockaddr_in6 *) &ss)->sin6_port = htons(port);
+    }
+#endif
+
+    return connect(fd, (struct sockaddr *) &ss, len);
+}
+
+
+static int send_openclose(struct icomlan *il, int open)
+{
+    unsigned char buf[ICOMLAN_OPENCLOSE_SIZE];
+
+    header(&il->civ, buf, sizeof(buf), ICOMLAN_TYPE_DATA, 0);
+    put16(buf + 0x10, 0x01c0);
+    put16be(buf + 0x13, il->civ_sendseq++);
+    buf[0x15] = open ? 0x04 : 0x00;
+
+    return send_tracked(il, &il->civ, buf, sizeof(buf));
+}
+
+
+/* backend wrote some CI-V, one data packet per write */
+static int civ_from_backend(struct icomlan *il)
+{
+    unsigned char buf[ICOMLAN_MAXPKT];
+    unsigned char civ[ICOMLAN_MAXPKT - ICOMLAN_DATA_HEADER];
+    int n = read(il->peer_fd, civ, sizeof(civ));
+
+    if (n <= 0) { return n == 0 || errno != EAGAIN ? -1 : 0; }
+
+    header(&il->civ, buf, ICOMLAN_DATA_HEADER + n, ICOMLAN_TYPE_DATA, 0);
+    memcpy(buf + ICOMLAN_DATA_HEADER, civ, n);
+    buf[0x10] = 0xc1;
+    put16(buf + 0x11, n);
+    put16be(buf + 0x13, il->civ_sendseq++);
+    il->stats.civ_tx++;
+
+    return send_tracked(il, &il->civ, buf, ICOMLAN_DATA_HEADER + n) == RIG_OK ? 0
+           : -1;
+}
+
+
+static int civ_to_backend(struct icomlan *il, const unsigned char *buf,
+                          int len)
+{
+    int n;
+
+    if (len < ICOMLAN_DATA_HEADER || buf[0x10] != 0xc1) { return 0; }
+
+    n = get16(buf + 0x11);
+
+    if (n > len - ICOMLAN_DATA_HEADER) { n = len - ICOMLAN_DATA_HEADER; }
+
+    il->stats.civ_rx++;
+
+    return write(il->peer_fd, buf + ICOMLAN_DATA_HEADER, n) == n ? 0 : -1;
+}
+
+
+static void keepalive(struct icomlan *il, struct icomlan_stream *s, long now)
+{
+    if (now - s->last_ping >= ICOMLAN_PING_MS) { send_ping(il, s); }
+
+    if (now - s->last_tx >= ICOMLAN_IDLE_MS) { send_idle(il, s); }
+}
+
+
+static void *icomlan_thread(void *arg)
+{
+    struct icomlan *il = arg;
+    unsigned char buf[ICOMLAN_MAXPKT];
+    int lost = 0;
+
+    while (il->run)
+    {
+        struct pollfd pfd[3] =
+        {
+            { il->ctl.fd, POLLIN, 0 },
+            { il->civ.fd, POLLIN, 0 },
+            { il->peer_fd, POLLIN, 0 },
+        };
+        long now;
+        int n;
+
+        poll(pfd, 3, ICOMLAN_IDLE_MS / 2);
+
+        if (pfd[2].revents & (POLLIN | POLLHUP) && civ_from_backend(il) < 0)
+        {
+            break;
+        }
+
+        if (pfd[1].revents & POLLIN
+                && (n = recv(il->civ.fd, buf, sizeof(buf), 0)) > 0)
+        {
+            int ret = stream_packet(il, &il->civ, buf, n);
+
+            if (ret == 1) { civ_to_backend(il, buf, n); }
+            else if (ret < 0) { break; }
+        }
+
+        if (pfd[0].revents & POLLIN
+                && (n = recv(il->ctl.fd, buf, sizeof(buf), 0)) > 0)
+        {
+            if (stream_packet(il, &il->ctl, buf, n) < 0) { break; }
+        }
+
+        now = now_ms();
+        keepalive(il, &il->ctl, now);
+        keepalive(il, &il->civ, now);
+
+        if (now - il->last_token >= ICOMLAN_TOKEN_MS)
+        {
+            inner(il, buf, ICOMLAN_TOKEN_SIZE, 0x01, 0x05);
+            send_tracked(il, &il->ctl, buf, ICOMLAN_TOKEN_SIZE);
+            il->last_token = now;
+        }
+
+        if (!lost && now - il->civ.last_rx > ICOMLAN_WATCHDOG_MS)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: nothing from the radio for %d ms\n",
+                      __func__, ICOMLAN_WATCHDOG_MS);
+            lost = 1;
+        }
+        else if (lost && now - il->civ.last_rx <= ICOMLAN_WATCHDOG_MS)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: radio is back\n", __func__);
+            lost = 0;
+        }
+    }
+
+    return NULL;
+}
+
+#endif /* HAVE_SYS_SOCKET_H */
+
+
+/**
+ * \brief Use the Icom LAN protocol on a port
+ * \param p the rig port, opened later as a UDP network port
+ * \param user radio user name, NULL or "" to stop using the protocol
+ * \param password radio password
+ */
+int icomlan_set_login(hamlib_port_t *p, const char *user,
+                      const char *password)
+{
+    struct icomlan *il;
+
+    if (user == NULL || user[0] == '\0')
+    {
+        icomlan_forget(p);
+        return RIG_OK;
+    }
+
+    pthread_mutex_lock(&icomlan_lock);
+    il = icomlan_find(p);
+
+    if (il == NULL)
+    {
+        il = calloc(1, sizeof(*il));
+
+        if (il == NULL)
+        {
+            pthread_mutex_unlock(&icomlan_lock);
+            return -RIG_ENOMEM;
+        }
+
+        il->port = p;
+        il->peer_fd = il->ctl.fd = il->civ.fd = -1;
+        il->next = icomlan_list;
+        icomlan_list = il;
+    }
+
+    snprintf(il->user, sizeof(il->user), "%s", user);
+    snprintf(il->password, sizeof(il->password), "%s",
+             password ? password : "");
+    pthread_mutex_unlock(&icomlan_lock);
+
+    return RIG_OK;
+}
+
+
+/**
+ * \brief Forget a port registered with icomlan_set_login()
+ */
+void icomlan_forget(hamlib_port_t *p)
+{
+    struct icomlan **pp;
+
+    if (icomlan_list == NULL) { return; }
+
+    icomlan_close(p);
+
+    pthread_mutex_lock(&icomlan_lock);
+
+    for (pp = &icomlan_list; *pp != NULL; pp = &(*pp)->next)
+    {
+        if ((*pp)->port == p)
+        {
+            struct icomlan *il = *pp;
+
+            *pp = il->next;
+            free(il);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&icomlan_lock);
+}
+
+
+/**
+ * \brief Log in to the radio on a freshly opened UDP port
+ * \param p port being opened, p->fd talking to the radio's control port
+ * \return 0 if p does not use the protocol, 1 if p->fd now carries CI-V,
+ * or a negative error code
+ */
+int icomlan_connect(hamlib_port_t *p)
+{
+    struct icomlan *il;
+
+    if (icomlan_list == NULL) { return 0; }
+
+    pthread_mutex_lock(&icomlan_lock);
+    il = icomlan_find(p);
+    pthread_mutex_unlock(&icomlan_lock);
+
+    if (il == NULL) { return 0; }
+
+#ifdef HAVE_SYS_SOCKET_H
+    {
+        uint16_t civ_local_port;
+        int civ_port, sv[2], ret;
+
+        memset(&il->ctl, 0, sizeof(il->ctl));
+        memset(&il->civ, 0, sizeof(il->civ));
+        memset(&il->stats, 0, sizeof(il->stats));
+        il->ctl.fd = p->fd;
+        il->ctl.myid = stream_id(p->fd);
+        il->civ.fd = civ_socket(p->fd, &civ_local_port);
+        il->innerseq = 0;
+        il->civ_sendseq = 0;
+        il->token = 0;
+
+        if (il->civ.fd < 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: CI-V socket: %s\n", __func__,
+                      strerror(errno));
+            return -RIG_EIO;
+        }
+
+        il->civ.myid = stream_id(il->civ.fd);
+
+        if ((ret = stream_hello(il, &il->ctl)) != RIG_OK
+                || (ret = civ_port = login(il, civ_local_port)) < 0)
+        {
+            close(il->civ.fd);
+            il->civ.fd = -1;
+            return ret;
+        }
+
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: CI-V stream on port %d\n", __func__,
+                  civ_port);
+
+        if (civ_connect(il->civ.fd, p->fd, civ_port) < 0
+                || (ret = stream_hello(il, &il->civ)) != RIG_OK
+                || (ret = send_openclose(il, 1)) != RIG_OK)
+        {
+            send_control(il, &il->ctl, ICOMLAN_TYPE_DISCONNECT, 0);
+            close(il->civ.fd);
+            il->civ.fd = -1;
+            return ret < 0 ? ret : -RIG_EIO;
+        }
+
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: socketpair: %s\n", __func__,
+                      strerror(errno));
+            send_control(il, &il->ctl, ICOMLAN_TYPE_DISCONNECT, 0);
+            close(il->civ.fd);
+            il->civ.fd = -1;
+            return -RIG_EIO;
+        }
+
+        /* behave like a serial port opened with O_NDELAY */
+        fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+        fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+
+        il->civ.last_rx = now_ms();
+        il->peer_fd = sv[1];
+        il->run = 1;
+
+        if (pthread_create(&il->thread, NULL, icomlan_thread, il) != 0)
+        {
+            close(sv[0]);
+            close(sv[1]);
+            il->peer_fd = -1;
+            send_control(il, &il->ctl, ICOMLAN_TYPE_DISCONNECT, 0);
+            close(il->civ.fd);
+            il->civ.fd = -1;
+            return -RIG_EINTERNAL;
+        }
+
+        p->fd = sv[0];
+    }
+
+    return 1;
+#else
+    rig_debug(RIG_DEBUG_ERR, "%s: Icom LAN not supported on this platform\n",
+              __func__);
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+/**
+ * \brief Log out and hand the control socket back to the port
+ *
+ * p->fd is the radio's control socket again when this returns, so
+ * network_close() closes it as usual.
+ */
+int icomlan_close(hamlib_port_t *p)
+{
+    struct icomlan *il;
+
+    if (icomlan_list == NULL) { return RIG_OK; }
+
+    pthread_mutex_lock(&icomlan_lock);
+    il = icomlan_find(p);
+    pthread_mutex_unlock(&icomlan_lock);
+
+    if (il == NULL || il->peer_fd < 0) { return RIG_OK; }
+
+#ifdef HAVE_SYS_SOCKET_H
+    il->run = 0;
+    pthread_join(il->thread, NULL);
+
+    send_openclose(il, 0);
+    send_control(il, &il->civ, ICOMLAN_TYPE_DISCONNECT, 0);
+    send_control(il, &il->ctl, ICOMLAN_TYPE_DISCONNECT, 0);
+
+    rig_debug(RIG_DEBUG_VERBOSE,
+              "%s: %lu packets out, %lu in, %lu resent, %lu asked again, rtt %.0f ms\n",
+              __func__, il->stats.tx_packets, il->stats.rx_packets,
+              il->stats.resent, il->stats.requested, il->stats.rtt_ms);
+
+    close(il->civ.fd);
+    il->civ.fd = -1;
+    close(il->peer_fd);
+    il->peer_fd = -1;
+    close(p->fd);
+    p->fd = il->ctl.fd;
+#endif
+
+    return RIG_OK;
+}
+
+
+/**
+ * \brief Link counters of a port using the Icom LAN protocol
+ * \return RIG_OK, or -RIG_EINVAL if the port does not use it
+ */
+int icomlan_get_stats(hamlib_port_t *p, struct icomlan_stats *stats)
+{
+    struct icomlan *il;
+
+    pthread_mutex_lock(&icomlan_lock);
+    il = icomlan_find(p);
+
+    if (il != NULL) { *stats = il->stats; }
+
+    pthread_mutex_unlock(&icomlan_lock);
+
+    return il ? RIG_OK : -RIG_EINVAL;
+}
@@ -0,0 +1,82 @@
+/*
+ *  Hamlib Interface - Icom LAN (UDP) transport header
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _ICOMLAN_H
+#define _ICOMLAN_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/*
+ * All packets start with this header, integers little endian unless
+ * noted otherwise:
+ *
+ *   len(4) type(2) seq(2) sentid(4) rcvdid(4)
+ */
+#define ICOMLAN_CONTROL_PORT    50001
+
+#define ICOMLAN_HEADER_SIZE     0x10
+#define ICOMLAN_PING_SIZE       0x15
+#define ICOMLAN_OPENCLOSE_SIZE  0x16
+#define ICOMLAN_DATA_HEADER     0x15    /* + CI-V bytes */
+#define ICOMLAN_TOKEN_SIZE      0x40
+#define ICOMLAN_STATUS_SIZE     0x50
+#define ICOMLAN_LOGIN_REPLY_SIZE 0x60
+#define ICOMLAN_LOGIN_SIZE      0x80
+#define ICOMLAN_CONNINFO_SIZE   0x90
+
+#define ICOMLAN_TYPE_DATA       0x00    /* also the idle packet */
+#define ICOMLAN_TYPE_RETRANSMIT 0x01
+#define ICOMLAN_TYPE_ARE_YOU_THERE 0x03
+#define ICOMLAN_TYPE_I_AM_HERE  0x04
+#define ICOMLAN_TYPE_DISCONNECT 0x05
+#define ICOMLAN_TYPE_READY      0x06
+#define ICOMLAN_TYPE_PING       0x07
+
+#define ICOMLAN_LOGIN_BAD       0xfeffffff
+
+/* Link counters, see icomlan_get_stats() */
+struct icomlan_stats
+{
+    unsigned long tx_packets;
+    unsigned long rx_packets;
+    unsigned long civ_tx;           /* CI-V packets sent */
+    unsigned long civ_rx;           /* CI-V packets delivered */
+    unsigned long resent;           /* packets resent on the radio's request */
+    unsigned long requested;        /* retransmits we asked for */
+    unsigned long duplicates;
+    double rtt_ms;                  /* last ping round trip */
+};
+
+/* Hamlib internal use, see iofunc.c and the Icom backend */
+int icomlan_set_login(hamlib_port_t *p, const char *user,
+                      const char *password);
+void icomlan_forget(hamlib_port_t *p);
+int icomlan_connect(hamlib_port_t *p);
+int icomlan_close(hamlib_port_t *p);
+int icomlan_get_stats(hamlib_port_t *p, struct icomlan_stats *stats);
+
+/* credentials as they go in the login and conninfo packets */
+void icomlan_encode(const char *in, unsigned char out[16]);
+
+__END_DECLS
+
+#endif /* _ICOMLAN_H */
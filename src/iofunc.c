@@ -52,6 +52,9 @@
 #include "network.h"
 #include "cm108.h"
 #include "asyncpipe.h"
+#include "portrec.h"
+#include "icomlan.h"
+#include "uring.h"
 
 #define HAMLIB_TRACE2 rig_debug(RIG_DEBUG_TRACE,"%s trace(%d)\n",  __FILE__, __LINE__)
 
@@ -245,6 +248,20 @@ int HAMLIB_API port_open(hamlib_port_t *p)
         }
     }
 
+    /* served from a recording instead of the real port */
+    status = portrec_replay_connect(p);
+
+    if (status != 0)
+    {
+        if (status < 0)
+        {
+            close_sync_data_pipe(p);
+            return (status);
+        }
+
+        return (RIG_OK);
+    }
+
     switch (p->type.rig)
     {
     case RIG_PORT_SERIAL:
@@ -360,6 +377,20 @@ int HAMLIB_API port_open(hamlib_port_t *p)
             return (status);
         }
 
+        /* an Icom radio's own LAN protocol, if the backend asked for it */
+        if (p->type.rig == RIG_PORT_UDP_NETWORK)
+        {
+            status = icomlan_connect(p);
+
+            if (status < 0)
+            {
+                network_close(p);
+                p->fd = -1;
+                close_sync_data_pipe(p);
+                return (status);
+            }
+        }
+
         break;
 
     default:
@@ -381,6 +412,14 @@ int HAMLIB_API port_close(hamlib_port_t *p, rig_port_t port_type)
 {
     int ret = RIG_OK;
 
+    /* a replayed port closes its own descriptor */
+    portrec_close(p);
+
+    /* hands the radio's control socket back for network_close() */
+    icomlan_close(p);
+
+    uring_port_detach(p);
+
     if (p->fd != -1)
     {
         switch (port_type)
@@ -419,6 +458,23 @@ int HAMLIB_API port_close(hamlib_port_t *p, rig_port_t port_type)
 }
 
 
+/* clear the MSB of what a 7 data bit serial port read */
+static void port_clear_msb(const hamlib_port_t *p, void *buf,
+                           ssize_t bytes_read)
+{
+    if (p->type.rig == RIG_PORT_SERIAL && p->parm.serial.data_bits == 7)
+    {
+        unsigned char *pbuf = buf;
+        ssize_t i;
+
+        for (i = 0; i < bytes_read; i++)
+        {
+            pbuf[i] &= ~0x80;
+        }
+    }
+}
+
+
 #if defined(WIN32) && !defined(HAVE_TERMIOS_H)
 #  include "win32termios.h"
 
@@ -606,7 +662,6 @@ static ssize_t port_read_generic(hamlib_port_t *p, void *buf, size_t count,
                                  int direct)
 {
     int fd = p->fd;
-    int i;
     ssize_t bytes_read;
 
     if (!direct)
@@ -628,17 +683,7 @@ static ssize_t port_read_generic(hamlib_port_t *p, void *buf, size_t count,
     if (p->type.rig == RIG_PORT_SERIAL)
     {
         bytes_read = win32_serial_read(fd, buf, (int) count);
-
-        if (p->parm.serial.data_bits == 7)
-        {
-            unsigned char *pbuf = buf;
-
-            /* clear MSB */
-            for (i = 0; i < bytes_read; i++)
-            {
-                pbuf[i] &= ~0x80;
-            }
-        }
+        port_clear_msb(p, buf, bytes_read);
 
         return bytes_read;
     }
@@ -805,31 +850,33 @@ static ssize_t port_read_generic(hamlib_port_t *p, void *buf, size_t count,
                                  int direct)
 {
     int fd = direct ? p->fd : p->fd_sync_read;
+    ssize_t ret;
 
-    if (p->type.rig == RIG_PORT_SERIAL && p->parm.serial.data_bits == 7)
+    if (direct && uring_port_active(p))
     {
-        unsigned char *pbuf = buf;
-
-        ssize_t ret = read(fd, buf, count);
+        ret = uring_port_read(p, buf, count);
+    }
+    else
+    {
+        ret = read(fd, buf, count);
+    }
 
-        /* clear MSB */
-        ssize_t i;
+    port_clear_msb(p, buf, ret);
 
-        for (i = 0; i < ret; i++)
-        {
-            pbuf[i] &= ~0x80;
-        }
+    return ret;
+}
 
-        return ret;
-    }
-    else
+static ssize_t port_write(hamlib_port_t *p, const void *buf, size_t count)
+{
+    if (uring_port_active(p))
     {
-        return read(fd, buf, count);
+        return uring_port_write(p, buf, count);
     }
+
+    return write(p->fd, buf, count);
 }
 
 //! @cond Doxygen_Suppress
-#define port_write(p,b,c) write((p)->fd,(b),(c))
 #define port_select(p,n,r,w,e,t,d) select((n),(r),(w),(e),(t))
 //! @endcond
 
@@ -896,6 +943,11 @@ static int port_wait_for_data(hamlib_port_t *p, int direct)
     struct timeval tv, tv_timeout;
     int result;
 
+    if (direct && uring_port_active(p))
+    {
+        return uring_port_wait(p);
+    }
+
     fd = direct ? p->fd : p->fd_sync_read;
     errorfd = direct ? -1 : p->fd_sync_error_read;
     maxfd = (fd > errorfd) ? fd : errorfd;
@@ -1043,11 +1095,34 @@ int HAMLIB_API port_flush_sync_pipes(hamlib_port_t *p)
  * it could work very well also with any file handle, like a socket.
  */
 
+/*
+ * EOF, a reset or a kernel timeout on a TCP port means the peer is gone.
+ * Report it at once, and let network.c shut the socket down so the next
+ * write_block() reconnects, instead of timing out every command after.
+ */
+static int port_gone(hamlib_port_t *p, ssize_t ret)
+{
+    if (p->type.rig != RIG_PORT_NETWORK) { return 0; }
+
+    if (ret == 0 || errno == ECONNRESET || errno == EPIPE || errno == ETIMEDOUT)
+    {
+        network_lost(p);
+        return 1;
+    }
+
+    return 0;
+}
+
 int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
                            size_t count)
 {
     int ret;
 
+    if (p->type.rig == RIG_PORT_NETWORK && network_reconnect(p) != RIG_OK)
+    {
+        return (-RIG_EIO);
+    }
+
     if (p->fd < 0)
     {
         rig_debug(RIG_DEBUG_ERR, "%s: port not open\n", __func__);
@@ -1097,6 +1172,8 @@ int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
                           ret,
                           strerror(errno));
 
+                if (ret < 0) { port_gone(p, ret); }
+
                 return -RIG_EIO;
             }
 
@@ -1116,10 +1193,14 @@ int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
                       ret,
                       strerror(errno));
 
+            if (ret < 0) { port_gone(p, ret); }
+
             return -RIG_EIO;
         }
     }
 
+    portrec_write(p, txbuffer, count);
+
     rig_debug(RIG_DEBUG_TRACE, "%s(): TX %d bytes\n", __func__,
               (int)count);
     dump_hex((unsigned char *) txbuffer, count);
@@ -1162,6 +1243,8 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
         return -RIG_EINTERNAL;
     }
 
+    if (direct && p->fd < 0) { return -RIG_EIO; }
+
     /* Store the time of the read loop start */
     gettimeofday(&start_time, NULL);
 
@@ -1223,13 +1306,23 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
          */
         rd_count = (int) port_read_generic(p, rxbuffer + total_count, count, direct);
 
-        if (rd_count < 0)
+        /* select() said readable, so 0 bytes from a socket is EOF */
+        if (rd_count < 0
+                || (direct && rd_count == 0 && p->type.rig == RIG_PORT_NETWORK))
         {
             rig_debug(RIG_DEBUG_ERR, "%s(): read failed, direct=%d - %s\n", __func__,
-                      direct, strerror(errno));
+                      direct, rd_count ? strerror(errno) : "connection closed");
+
+            if (direct) { port_gone(p, rd_count); }
+
             return -RIG_EIO;
         }
 
+        if (direct && rd_count > 0)
+        {
+            portrec_read(p, rxbuffer + total_count, rd_count);
+        }
+
         total_count += rd_count;
         count -= rd_count;
     }
@@ -1329,6 +1422,8 @@ static int read_string_generic(hamlib_port_t *p,
         return 0;
     }
 
+    if (direct && p->fd < 0) { return -RIG_EIO; }
+
     /* Store the time of the read loop start */
     gettimeofday(&start_time, NULL);
 
@@ -1454,11 +1549,18 @@ static int read_string_generic(hamlib_port_t *p,
             }
 
             rig_debug(RIG_DEBUG_ERR, "%s(): read failed, direct=%d - %s\n", __func__,
-                      direct, strerror(errno));
+                      direct, rd_count ? strerror(errno) : "connection closed");
+
+            if (direct) { port_gone(p, rd_count); }
 
             return -RIG_EIO;
         }
 
+        if (direct)
+        {
+            portrec_read(p, &rxbuffer[total_count], rd_count);
+        }
+
         // check to see if our string startis with \...if so we need more chars
         if (total_count == 0 && rxbuffer[total_count] == '\\') { rxmax = (rxmax - 1) * 5; }
 
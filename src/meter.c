@@ -0,0 +1,552 @@
+/*
+ *  Hamlib Interface - meter streaming
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig
+ * @{
+ */
+
+/**
+ * \file meter.c
+ * \brief Meter streaming
+ *
+ * A thread reads a set of meter levels at a target rate and hands out
+ * timestamped samples through a callback or a ring buffer.  Meters the
+ * backend can read together (caps->get_meters, e.g. Kenwood RM; giving
+ * SWR, COMP and ALC in one reply) cost one transaction per sweep, the
+ * rest one rig_get_level() each.
+ *
+ * The stream holds the rig's meter lock for one sweep at a time, and the
+ * rig_* calls take the same lock, so other commands go between sweeps.
+ * When a sweep takes longer than the period the thread still sleeps as
+ * long as the sweep took, leaving at least half of the port time to
+ * everybody else.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "meter.h"
+
+#define CHECK_RIG_ARG(r) (!(r) || !(r)->caps || !(r)->state.comm_state)
+
+/* samples kept for rig_meter_stream_read() */
+#define METER_RING_SIZE 256
+#define METER_MAX_RATE 1000
+
+#ifdef HAVE_PTHREAD
+
+struct meter_stream
+{
+    RIG *rig;
+    vfo_t vfo;
+    setting_t levels;
+    long period_ns;
+    meter_cb_t cb;
+    rig_ptr_t arg;
+
+    pthread_t thread_id;
+    volatile int run;
+    volatile int detached;      /* stopped from its own callback, frees itself */
+    pthread_mutex_t ring_lock;  /* ring and stats */
+
+    struct rig_meter_sample ring[METER_RING_SIZE];
+    unsigned int head, count;
+
+    struct rig_meter_stream_stats stats;
+    struct timespec rate_start;
+    unsigned long rate_sweeps;
+};
+
+
+static void timespec_add_ns(struct timespec *ts, long ns)
+{
+    ts->tv_nsec += ns;
+
+    while (ts->tv_nsec >= 1000000000L)
+    {
+        ts->tv_nsec -= 1000000000L;
+        ts->tv_sec++;
+    }
+}
+
+
+static long timespec_diff_ns(const struct timespec *a, const struct timespec *b)
+{
+    return (a->tv_sec - b->tv_sec) * 1000000000L + (a->tv_nsec - b->tv_nsec);
+}
+
+
+/*
+ * Taken whether a stream runs or not, so a stream starting or stopping
+ * between a caller's lock and unlock can't unbalance them.
+ */
+void meter_stream_lock(RIG *rig, int lock)
+{
+    if (lock) { pthread_mutex_lock(&rig->state.meter_lock); }
+    else { pthread_mutex_unlock(&rig->state.meter_lock); }
+}
+
+
+void meter_lock_init(RIG *rig)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&rig->state.meter_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+
+void meter_lock_cleanup(RIG *rig)
+{
+    pthread_mutex_destroy(&rig->state.meter_lock);
+}
+
+
+static void meter_stream_free(struct meter_stream *ms)
+{
+    pthread_mutex_destroy(&ms->ring_lock);
+    free(ms);
+}
+
+
+/* one read of every meter, returns the number of samples */
+static int meter_sweep(struct meter_stream *ms, struct rig_meter_sample *out,
+                       unsigned long *transactions, unsigned long *errors)
+{
+    RIG *rig = ms->rig;
+    setting_t left = ms->levels;
+    value_t vals[RIG_SETTING_MAX];
+    struct timespec now;
+    int i, n = 0;
+
+    meter_stream_lock(rig, 1);
+
+    if (rig->caps->get_meters)
+    {
+        setting_t got = left;
+
+        if (rig->caps->get_meters(rig, ms->vfo, &got, vals) == RIG_OK)
+        {
+            clock_gettime(CLOCK_REALTIME, &now);
+
+            for (i = 0; i < RIG_SETTING_MAX; i++)
+            {
+                setting_t level = rig_idx2setting(i);
+
+                if (!(got & left & level)) { continue; }
+
+                out[n].level = level;
+                out[n].val = vals[i];
+                out[n].ts = now;
+                n++;
+            }
+
+            left &= ~got;
+        }
+        else
+        {
+            (*errors)++;
+        }
+
+        (*transactions)++;
+    }
+
+    for (i = 0; i < RIG_SETTING_MAX && left; i++)
+    {
+        setting_t level = rig_idx2setting(i);
+
+        if (!(left & level)) { continue; }
+
+        left &= ~level;
+        (*transactions)++;
+
+        if (rig_get_level(rig, ms->vfo, level, &out[n].val) != RIG_OK)
+        {
+            (*errors)++;
+            continue;
+        }
+
+        out[n].level = level;
+        clock_gettime(CLOCK_REALTIME, &out[n].ts);
+        n++;
+    }
+
+    meter_stream_lock(rig, 0);
+
+    return n;
+}
+
+
+static void meter_deliver(struct meter_stream *ms,
+                          const struct rig_meter_sample *samples, int n,
+                          unsigned long transactions, unsigned long errors)
+{
+    struct timespec now;
+    int i;
+
+    pthread_mutex_lock(&ms->ring_lock);
+
+    ms->stats.transactions += transactions;
+    ms->stats.errors += errors;
+    ms->stats.sweeps++;
+    ms->stats.samples += n;
+    ms->rate_sweeps++;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    if (timespec_diff_ns(&now, &ms->rate_start) >= 1000000000L)
+    {
+        ms->stats.rate = ms->rate_sweeps * 1e9
+                         / timespec_diff_ns(&now, &ms->rate_start);
+        ms->rate_start = now;
+        ms->rate_sweeps = 0;
+    }
+
+    if (ms->cb == NULL)
+    {
+        for (i = 0; i < n; i++)
+        {
+            ms->ring[(ms->head + ms->count) % METER_RING_SIZE] = samples[i];
+
+            if (ms->count < METER_RING_SIZE) { ms->count++; }
+            else
+            {
+                ms->head = (ms->head + 1) % METER_RING_SIZE;
+                ms->stats.dropped++;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&ms->ring_lock);
+
+    if (ms->cb && n > 0) { ms->cb(ms->rig, samples, n, ms->arg); }
+}
+
+
+static void *meter_stream_thread(void *arg)
+{
+    struct meter_stream *ms = arg;
+    struct rig_meter_sample samples[RIG_SETTING_MAX];
+    struct timespec next, start, now;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: meter stream started\n", __func__);
+
+    clock_gettime(CLOCK_REALTIME, &next);
+    ms->rate_start = next;
+
+    while (ms->run)
+    {
+        unsigned long transactions = 0, errors = 0;
+        long took, wait;
+        int n;
+
+        clock_gettime(CLOCK_REALTIME, &start);
+        n = meter_sweep(ms, samples, &transactions, &errors);
+        meter_deliver(ms, samples, n, transactions, errors);
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        took = timespec_diff_ns(&now, &start);
+        timespec_add_ns(&next, ms->period_ns);
+        wait = timespec_diff_ns(&next, &now);
+
+        /* behind: don't try to catch up, give the port away for a while */
+        if (wait < 0)
+        {
+            wait = took;
+            next = now;
+            timespec_add_ns(&next, wait);
+        }
+
+        hl_usleep(wait / 1000);
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: meter stream stopped\n", __func__);
+
+    if (ms->detached) { meter_stream_free(ms); }
+
+    return NULL;
+}
+
+#else
+
+void meter_stream_lock(RIG *rig, int lock)
+{
+}
+
+void meter_lock_init(RIG *rig)
+{
+}
+
+void meter_lock_cleanup(RIG *rig)
+{
+}
+
+#endif /* HAVE_PTHREAD */
+
+
+/**
+ * \brief start reading meters in the background
+ * \param rig     The rig handle
+ * \param vfo     The target VFO
+ * \param levels  The RIG_LEVEL_* meters to read, e.g.
+ *                RIG_LEVEL_STRENGTH | RIG_LEVEL_SWR | RIG_LEVEL_ALC
+ * \param rate_hz Sweeps over all the meters per second
+ * \param cb      Called from the stream thread with each sweep's samples,
+ *                NULL to keep them for rig_meter_stream_read()
+ * \param arg     Passed to \a cb
+ *
+ * Reads \a levels \a rate_hz times a second until rig_meter_stream_stop()
+ * or rig_close().  Other calls on \a rig from any thread are serialized
+ * with the stream and go between sweeps.  If the rig can't keep up, the
+ * stream slows down rather than starving those calls; the achieved rate
+ * is in rig_meter_stream_stats().
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ * \sa rig_meter_stream_stop(), rig_meter_stream_read(), rig_get_level()
+ */
+int HAMLIB_API rig_meter_stream_start(RIG *rig, vfo_t vfo, setting_t levels,
+                                      int rate_hz, meter_cb_t cb, rig_ptr_t arg)
+{
+#ifdef HAVE_PTHREAD
+    struct meter_stream *ms;
+    setting_t missing;
+
+    if (CHECK_RIG_ARG(rig))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: rig or rig->caps is null\n", __func__);
+        return -RIG_EINVAL;
+    }
+
+    ENTERFUNC;
+
+    if (levels == 0 || rate_hz <= 0 || rate_hz > METER_MAX_RATE)
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    missing = levels & ~rig_has_get_level(rig, levels);
+
+    if (missing)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: can't read %s\n", __func__,
+                  rig_strlevel(missing & -missing));
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    ms = calloc(1, sizeof(*ms));
+
+    if (ms == NULL) { RETURNFUNC(-RIG_ENOMEM); }
+
+    ms->rig = rig;
+    ms->vfo = vfo;
+    ms->levels = levels;
+    ms->period_ns = 1000000000L / rate_hz;
+    ms->cb = cb;
+    ms->arg = arg;
+    ms->run = 1;
+
+    pthread_mutex_init(&ms->ring_lock, NULL);
+
+    meter_stream_lock(rig, 1);
+
+    if (rig->state.meter_stream_priv != NULL)
+    {
+        meter_stream_lock(rig, 0);
+        meter_stream_free(ms);
+        rig_debug(RIG_DEBUG_ERR, "%s: meter stream already running\n", __func__);
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    /* the thread's first sweep waits for this lock */
+    if (pthread_create(&ms->thread_id, NULL, meter_stream_thread, ms))
+    {
+        meter_stream_lock(rig, 0);
+        rig_debug(RIG_DEBUG_ERR, "%s: pthread_create error: %s\n", __func__,
+                  strerror(errno));
+        meter_stream_free(ms);
+        RETURNFUNC(-RIG_EINTERNAL);
+    }
+
+    rig->state.meter_stream_priv = ms;
+    meter_stream_lock(rig, 0);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: levels 0x%llx at %d Hz, %s\n", __func__,
+              (unsigned long long)levels, rate_hz,
+              rig->caps->get_meters ? "batched" : "one by one");
+
+    RETURNFUNC(RIG_OK);
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+/**
+ * \brief stop the meter stream
+ * \param rig   The rig handle
+ *
+ * Samples not yet read with rig_meter_stream_read() are discarded.  May
+ * be called from the stream's callback; the stream then ends after the
+ * callback returns.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ * \sa rig_meter_stream_start()
+ */
+int HAMLIB_API rig_meter_stream_stop(RIG *rig)
+{
+#ifdef HAVE_PTHREAD
+    struct meter_stream *ms;
+
+    if (CHECK_RIG_ARG(rig)) { return -RIG_EINVAL; }
+
+    meter_stream_lock(rig, 1);
+    ms = rig->state.meter_stream_priv;
+    rig->state.meter_stream_priv = NULL;
+    meter_stream_lock(rig, 0);
+
+    if (ms == NULL) { return RIG_OK; }
+
+    ms->run = 0;
+
+    /* from the stream's own callback: it can't join itself */
+    if (pthread_equal(pthread_self(), ms->thread_id))
+    {
+        ms->detached = 1;
+        pthread_detach(ms->thread_id);
+        return RIG_OK;
+    }
+
+    pthread_join(ms->thread_id, NULL);
+
+    rig_debug(RIG_DEBUG_VERBOSE,
+              "%s: %lu sweeps, %lu samples, %lu transactions, %lu errors\n",
+              __func__, ms->stats.sweeps, ms->stats.samples, ms->stats.transactions,
+              ms->stats.errors);
+
+    meter_stream_free(ms);
+
+    return RIG_OK;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+/**
+ * \brief take samples from the meter stream
+ * \param rig     The rig handle
+ * \param samples Where to store the samples, oldest first
+ * \param max     Room in \a samples
+ *
+ * For a stream started without a callback.  Doesn't wait; the stream
+ * keeps the last 256 samples.
+ *
+ * \return the number of samples stored, otherwise a negative value if an
+ * error occurred.
+ *
+ * \sa rig_meter_stream_start()
+ */
+int HAMLIB_API rig_meter_stream_read(RIG *rig, struct rig_meter_sample *samples,
+                                     int max)
+{
+#ifdef HAVE_PTHREAD
+    struct meter_stream *ms;
+    int n;
+
+    if (CHECK_RIG_ARG(rig) || !samples || max < 0) { return -RIG_EINVAL; }
+
+    /* stop clears and frees it under the same lock */
+    meter_stream_lock(rig, 1);
+    ms = rig->state.meter_stream_priv;
+
+    if (ms == NULL) { meter_stream_lock(rig, 0); return -RIG_EINVAL; }
+
+    pthread_mutex_lock(&ms->ring_lock);
+
+    for (n = 0; n < max && ms->count > 0; n++)
+    {
+        samples[n] = ms->ring[ms->head];
+        ms->head = (ms->head + 1) % METER_RING_SIZE;
+        ms->count--;
+    }
+
+    pthread_mutex_unlock(&ms->ring_lock);
+    meter_stream_lock(rig, 0);
+
+    return n;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+/**
+ * \brief get the meter stream counters
+ * \param rig   The rig handle
+ * \param stats Where to store the counters
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ * \sa rig_meter_stream_start()
+ */
+int HAMLIB_API rig_meter_stream_stats(RIG *rig,
+                                      struct rig_meter_stream_stats *stats)
+{
+#ifdef HAVE_PTHREAD
+    struct meter_stream *ms;
+
+    if (CHECK_RIG_ARG(rig) || !stats) { return -RIG_EINVAL; }
+
+    meter_stream_lock(rig, 1);
+    ms = rig->state.meter_stream_priv;
+
+    if (ms == NULL) { meter_stream_lock(rig, 0); return -RIG_EINVAL; }
+
+    pthread_mutex_lock(&ms->ring_lock);
+    *stats = ms->stats;
+    pthread_mutex_unlock(&ms->ring_lock);
+    meter_stream_lock(rig, 0);
+
+    return RIG_OK;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+/*! @} */
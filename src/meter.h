@@ -0,0 +1,40 @@
+/*
+ *  Hamlib Interface - meter streaming header
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _METER_H
+#define _METER_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/*
+ * Serializes rig access with the meter stream.  Recursive, taken by the
+ * LOCK() of the rig_* calls and by rig_get_level()/rig_set_level().  The
+ * lock lives as long as the rig: rig_init() calls meter_lock_init() and
+ * rig_cleanup() meter_lock_cleanup().
+ */
+void meter_stream_lock(RIG *rig, int lock);
+void meter_lock_init(RIG *rig);
+void meter_lock_cleanup(RIG *rig);
+
+__END_DECLS
+
+#endif /* _METER_H */
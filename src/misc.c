@@ -52,7 +52,9 @@
 #include "misc.h"
 #include "serial.h"
 #include "network.h"
+#include "uring.h"
 #include "sprintflst.h"
+#include "capindex.h"
 #include "../rigs/icom/icom.h"
 
 #if defined(_WIN32)
@@ -2263,6 +2265,8 @@ int HAMLIB_API rig_flush_force(hamlib_port_t *port, int flush_async_data)
         port_flush_sync_pipes(port);
     }
 
+    uring_port_flush(port);
+
 #ifndef RIG_FLUSH_REMOVE
 //    rig_debug(RIG_DEBUG_TRACE, "%s: called for %s device\n", __func__,
 //              port->type.rig == RIG_PORT_SERIAL ? "serial" : "network");
@@ -2907,8 +2911,11 @@ const char* rig_get_band_str(RIG *rig, hamlib_band_t band, int which)
 // returns the rig's backend hamlib_band_t that can used to lookup the band str
 hamlib_band_t rig_get_band(RIG *rig, freq_t freq, int band)
 {
+    hamlib_band_t found;
     int i;
 
+    if (freq != 0 && capindex_band(rig, freq, &found)) { return found; }
+
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (freq == 0) 
@@ -2945,6 +2952,22 @@ hamlib_band_t rig_get_band(RIG *rig, freq_t freq, int band)
     return RIG_BANDSELECT_GEN;
 }
 
+// Returns the n'th entry of the band table, 0 past the end -- see capindex.c
+int rig_get_band_range(int n, hamlib_band_t *band, freq_t *start, freq_t *stop)
+{
+    if (n < 0 || n >= (int)(sizeof(rig_bandselect_str) / sizeof(rig_bandselect_str[0]))
+            || rig_bandselect_str[n].str == NULL)
+    {
+        return 0;
+    }
+
+    *band = rig_bandselect_str[n].bandselect;
+    *start = rig_bandselect_str[n].start;
+    *stop = rig_bandselect_str[n].stop;
+
+    return 1;
+}
+
 // Gets the rig's band index from the hamlib_band_t
 int rig_get_band_rig(RIG *rig, freq_t freq, const char *band)
 {
@@ -216,6 +216,7 @@ extern int check_level_param(RIG *rig, setting_t level, value_t val, gran_t **gr
 extern HAMLIB_EXPORT(hamlib_band_t) rig_get_band(RIG *rig, freq_t freq, int band);
 extern HAMLIB_EXPORT(const char*) rig_get_band_str(RIG *rig, hamlib_band_t band, int which);
 extern HAMLIB_EXPORT(int) rig_get_band_rig(RIG *rig, freq_t freq, const char *band);
+int rig_get_band_range(int n, hamlib_band_t *band, freq_t *start, freq_t *stop);
 
 __END_DECLS
 
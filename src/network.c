@@ -43,9 +43,11 @@
 #include <sys/types.h>
 #include <signal.h>
 #include <pthread.h>
+#include <time.h>
 
 #ifdef HAVE_NETINET_IN_H
 #  include <netinet/in.h>
+#  include <netinet/tcp.h>
 #endif
 
 #if HAVE_NETDB_H
@@ -209,6 +211,164 @@ int network_init()
     return retval;
 }
 
+/*
+ * Lost TCP connections.  A network port that reads EOF or a reset is
+ * closed and marked lost by network_lost(); the next write_block() calls
+ * network_reconnect(), which connects again once the backoff allows and
+ * tells the owner's notify hook.  The hook runs inside write_block(), so
+ * it must not talk to the rig itself; rig.c only flags a resync there.
+ * Kept on a private list keyed by port, as portrec.c does, so that
+ * hamlib_port_t is unchanged.
+ */
+#define NETWORK_BACKOFF_MIN_MS  100
+#define NETWORK_BACKOFF_MAX_MS  8000
+
+struct network_link
+{
+    struct network_link *next;
+    hamlib_port_t *port;
+    int default_port;
+    int keepalive;      /* seconds idle before probing, 0 = off */
+    int user_timeout;   /* ms of unacked data before the kernel gives up */
+    int reconnect;
+    int lost;
+    int backoff_ms;
+    struct timespec retry_at;
+    int reconnects;
+    network_notify_t notify;
+    void *arg;
+};
+
+static struct network_link *network_links;
+static pthread_mutex_t network_links_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* caller holds network_links_lock */
+static struct network_link *network_link_find(const hamlib_port_t *rp)
+{
+    struct network_link *l;
+
+    for (l = network_links; l; l = l->next)
+    {
+        if (l->port == rp) { return l; }
+    }
+
+    return NULL;
+}
+
+/*
+ * Latency and liveness options for a connected TCP socket.  Nagle only
+ * delays the short CAT commands hamlib sends, so it is always off.
+ */
+static void network_tune(int fd, const struct network_link *l)
+{
+    int on = 1;
+
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&on,
+                   sizeof(on)) < 0)
+    {
+        handle_error(RIG_DEBUG_WARN, "TCP_NODELAY");
+    }
+
+    if (!l) { return; }
+
+    if (l->keepalive > 0)
+    {
+        if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, (const char *)&on,
+                       sizeof(on)) < 0)
+        {
+            handle_error(RIG_DEBUG_WARN, "SO_KEEPALIVE");
+        }
+
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+        {
+            int idle = l->keepalive;
+            int intvl = l->keepalive / 3 > 0 ? l->keepalive / 3 : 1;
+            int cnt = 3;
+
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof(intvl));
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &cnt, sizeof(cnt));
+        }
+#endif
+    }
+
+#ifdef TCP_USER_TIMEOUT
+
+    if (l->user_timeout > 0)
+    {
+        unsigned int ut = l->user_timeout;
+
+        if (setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &ut, sizeof(ut)) < 0)
+        {
+            handle_error(RIG_DEBUG_WARN, "TCP_USER_TIMEOUT");
+        }
+    }
+
+#endif
+}
+
+/*
+ * connect() bounded by timeout_ms, or a plain blocking connect() when
+ * timeout_ms < 0.  A reconnect must not hang the caller for the kernel's
+ * SYN retry period (over two minutes on Linux) when the host is down.
+ */
+static int network_connect_fd(int fd, const struct sockaddr *addr,
+                              socklen_t addrlen, int timeout_ms)
+{
+#ifdef __MINGW32__
+    return connect(fd, addr, addrlen);
+#else
+    int flags, err;
+    socklen_t errlen = sizeof(err);
+    fd_set wfds;
+    struct timeval tv;
+
+    if (timeout_ms < 0) { return connect(fd, addr, addrlen); }
+
+    flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    if (connect(fd, addr, addrlen) == 0)
+    {
+        fcntl(fd, F_SETFL, flags);
+        return 0;
+    }
+
+    if (errno != EINPROGRESS)
+    {
+        fcntl(fd, F_SETFL, flags);
+        return -1;
+    }
+
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    if (select(fd + 1, NULL, &wfds, NULL, &tv) <= 0)
+    {
+        errno = ETIMEDOUT;
+        fcntl(fd, F_SETFL, flags);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, flags);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0) { return -1; }
+
+    if (err != 0)
+    {
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+#endif
+}
+
+static int network_connect(hamlib_port_t *rp, int default_port, int timeout_ms,
+                           int replace);
+
 /**
  * \brief Open network port using rig.state data
  *
@@ -220,6 +380,31 @@ int network_init()
  * \return RIG_OK or < 0 if error
  */
 int network_open(hamlib_port_t *rp, int default_port)
+{
+    struct network_link *l;
+
+    if (!rp)
+    {
+        return (-RIG_EINVAL);
+    }
+
+    pthread_mutex_lock(&network_links_lock);
+    l = network_link_find(rp);
+
+    if (l)
+    {
+        l->default_port = default_port;
+        l->lost = 0;
+        l->backoff_ms = 0;
+    }
+
+    pthread_mutex_unlock(&network_links_lock);
+
+    return network_connect(rp, default_port, -1, 0);
+}
+
+static int network_connect(hamlib_port_t *rp, int default_port, int timeout_ms,
+                           int replace)
 {
     int fd;             /* File descriptor for the port */
     int status;
@@ -331,7 +516,7 @@ int network_open(hamlib_port_t *rp, int default_port)
             return (-RIG_EIO);
         }
 
-        if (connect(fd, res->ai_addr, res->ai_addrlen) == 0)
+        if (network_connect_fd(fd, res->ai_addr, res->ai_addrlen, timeout_ms) == 0)
         {
             break;
         }
@@ -359,8 +544,39 @@ int network_open(hamlib_port_t *rp, int default_port)
         return (-RIG_EIO);
     }
 
+#ifndef __MINGW32__
+
+    /*
+     * A reconnect moves the new socket onto the old descriptor number, so
+     * a thread still waiting on rp->fd never sees it closed or reused.
+     */
+    if (replace && rp->fd >= 0)
+    {
+        if (dup2(fd, rp->fd) < 0)
+        {
+            handle_error(RIG_DEBUG_ERR, "dup2");
+            close(fd);
+            return (-RIG_EIO);
+        }
+
+        close(fd);
+        fd = rp->fd;
+    }
+
+#else
+
+    if (replace && rp->fd >= 0) { closesocket(rp->fd); }
+
+#endif
     rp->fd = fd;
 
+    if (hints.ai_socktype == SOCK_STREAM)
+    {
+        pthread_mutex_lock(&network_links_lock);
+        network_tune(fd, network_link_find(rp));
+        pthread_mutex_unlock(&network_links_lock);
+    }
+
     socklen_t clientLen = sizeof(client);
     getsockname(rp->fd, (struct sockaddr *)&client, &clientLen);
     rig_debug(RIG_DEBUG_TRACE, "%s: client port=%d\n", __func__, client.sin_port);
@@ -461,6 +677,209 @@ int network_close(hamlib_port_t *rp)
 #endif
     return (ret);
 }
+
+static void network_after_ms(struct timespec *ts, int ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+
+    if (ts->tv_nsec >= 1000000000L)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/*
+ * Register socket options and the reconnect policy for a TCP port before
+ * it is opened.  notify is called with up=0 when the connection is lost
+ * and up=1 once it is back, outside of any network.c lock.
+ */
+int network_link_setup(hamlib_port_t *rp, int keepalive, int user_timeout,
+                       int reconnect, network_notify_t notify, void *arg)
+{
+    struct network_link *l;
+
+    pthread_mutex_lock(&network_links_lock);
+    l = network_link_find(rp);
+
+    if (!l)
+    {
+        l = calloc(1, sizeof(*l));
+
+        if (!l)
+        {
+            pthread_mutex_unlock(&network_links_lock);
+            return -RIG_ENOMEM;
+        }
+
+        l->port = rp;
+        l->next = network_links;
+        network_links = l;
+    }
+
+    l->keepalive = keepalive;
+    l->user_timeout = user_timeout;
+    l->reconnect = reconnect;
+    l->notify = notify;
+    l->arg = arg;
+    pthread_mutex_unlock(&network_links_lock);
+
+    return RIG_OK;
+}
+
+void network_link_forget(hamlib_port_t *rp)
+{
+    struct network_link **pl, *l;
+
+    pthread_mutex_lock(&network_links_lock);
+
+    for (pl = &network_links; *pl; pl = &(*pl)->next)
+    {
+        if ((*pl)->port == rp)
+        {
+            l = *pl;
+            *pl = l->next;
+
+            if (l->reconnects)
+            {
+                rig_debug(RIG_DEBUG_VERBOSE, "%s: %s reconnected %d time(s)\n",
+                          __func__, rp->pathname, l->reconnects);
+            }
+
+            free(l);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&network_links_lock);
+}
+
+/*
+ * The peer closed or reset the connection.  Rather than letting every
+ * following command run into its own timeout, shut the socket down now
+ * and let the next write_block() reconnect.  The descriptor stays open:
+ * the async data handler or another caller may be in select() or read()
+ * on it, and shutdown() wakes them with EOF instead of pulling the fd
+ * from under them.  Ports without a reconnect policy are left alone;
+ * either way the caller gets -RIG_EIO at once.
+ */
+int network_lost(hamlib_port_t *rp)
+{
+    struct network_link *l;
+    network_notify_t notify = NULL;
+    void *arg = NULL;
+
+    pthread_mutex_lock(&network_links_lock);
+    l = network_link_find(rp);
+
+    if (l && l->reconnect && !l->lost && rp->fd >= 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: connection to %s lost\n", __func__,
+                  rp->pathname);
+#ifdef __MINGW32__
+        shutdown(rp->fd, SD_BOTH);
+#else
+        shutdown(rp->fd, SHUT_RDWR);
+#endif
+        l->lost = 1;
+        l->backoff_ms = 0;
+        network_after_ms(&l->retry_at, 0);
+        notify = l->notify;
+        arg = l->arg;
+    }
+
+    pthread_mutex_unlock(&network_links_lock);
+
+    if (notify) { notify(arg, 0); }
+
+    return -RIG_EIO;
+}
+
+/*
+ * Try to bring a lost port back.  Attempts are spaced by an exponential
+ * backoff so a dead host costs the caller one bounded connect() now and
+ * then, and an immediate -RIG_EIO in between.  RIG_OK at once for a port
+ * that isn't lost.
+ */
+int network_reconnect(hamlib_port_t *rp)
+{
+    struct network_link *l;
+    struct timespec now;
+    network_notify_t notify = NULL;
+    void *arg = NULL;
+    int default_port, timeout_ms, backoff_ms, retval;
+
+    pthread_mutex_lock(&network_links_lock);
+    l = network_link_find(rp);
+
+    if (!l || !l->lost)
+    {
+        pthread_mutex_unlock(&network_links_lock);
+        return RIG_OK;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (now.tv_sec < l->retry_at.tv_sec
+            || (now.tv_sec == l->retry_at.tv_sec
+                && now.tv_nsec < l->retry_at.tv_nsec))
+    {
+        pthread_mutex_unlock(&network_links_lock);
+        return -RIG_EIO;
+    }
+
+    default_port = l->default_port;
+    pthread_mutex_unlock(&network_links_lock);
+
+    timeout_ms = rp->timeout;
+
+    if (timeout_ms < 500) { timeout_ms = 500; }
+
+    if (timeout_ms > 3000) { timeout_ms = 3000; }
+
+    retval = network_connect(rp, default_port, timeout_ms, 1);
+
+    pthread_mutex_lock(&network_links_lock);
+    l = network_link_find(rp);
+
+    if (!l)
+    {
+        pthread_mutex_unlock(&network_links_lock);
+        return retval;
+    }
+
+    if (retval != RIG_OK)
+    {
+        l->backoff_ms = l->backoff_ms ? l->backoff_ms * 2 : NETWORK_BACKOFF_MIN_MS;
+
+        if (l->backoff_ms > NETWORK_BACKOFF_MAX_MS)
+        {
+            l->backoff_ms = NETWORK_BACKOFF_MAX_MS;
+        }
+
+        backoff_ms = l->backoff_ms;
+        network_after_ms(&l->retry_at, backoff_ms);
+        pthread_mutex_unlock(&network_links_lock);
+        rig_debug(RIG_DEBUG_WARN, "%s: %s still down, next try in %dms\n",
+                  __func__, rp->pathname, backoff_ms);
+        return -RIG_EIO;
+    }
+
+    l->lost = 0;
+    l->backoff_ms = 0;
+    l->reconnects++;
+    notify = l->notify;
+    arg = l->arg;
+    pthread_mutex_unlock(&network_links_lock);
+
+    rig_debug(RIG_DEBUG_WARN, "%s: reconnected to %s\n", __func__, rp->pathname);
+
+    if (notify) { notify(arg, 1); }
+
+    return RIG_OK;
+}
 //! @endcond
 
 extern void sync_callback(int lock);
@@ -31,6 +31,13 @@ __BEGIN_DECLS
 int network_open(hamlib_port_t *p, int default_port);
 int network_close(hamlib_port_t *rp);
 void network_flush(hamlib_port_t *rp);
+
+typedef void (*network_notify_t)(void *arg, int up);
+int network_link_setup(hamlib_port_t *rp, int keepalive, int user_timeout,
+                       int reconnect, network_notify_t notify, void *arg);
+void network_link_forget(hamlib_port_t *rp);
+int network_lost(hamlib_port_t *rp);
+int network_reconnect(hamlib_port_t *rp);
 int network_publish_rig_poll_data(RIG *rig);
 int network_publish_rig_transceive_data(RIG *rig);
 int network_publish_rig_spectrum_data(RIG *rig, struct rig_spectrum_line *line);
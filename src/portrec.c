@@ -0,0 +1,712 @@
+/*
+ *  Hamlib Interface - port session recorder/replayer
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file portrec.c
+ * \brief Record a port session to a file and replay it without the rig
+ *
+ * The recorder logs every block written to and read from a rig port,
+ * with microsecond timestamps, to a compact binary file.  The replayer
+ * stands in for the rig: the backend talks to one end of a socket pair
+ * and every write is answered with the reads that followed the same
+ * write in the recording, using the original timing multiplied by a
+ * scale factor (0 replays as fast as possible).  The same hooks can
+ * also just count traffic, which the performance tools use.
+ *
+ * Ports are tracked in a private list so hamlib_port_t is unchanged.
+ * While no port has an entry the hooks cost one atomic load; otherwise
+ * they take the list lock shared, so ports don't wait on each other, and
+ * lock their own entry.  portrec_close() takes the list lock exclusive
+ * to unlink an entry and frees it once the entry lock is free, so a hook
+ * answering a replayed write keeps its entry alive.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#ifdef HAVE_SYS_SOCKET_H
+#  include <sys/socket.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "portrec.h"
+#include "sleep.h"
+
+struct portrec_entry
+{
+    char type;                  /* 'W' or 'R' */
+    uint64_t ts;                /* us since start of recording */
+    size_t len;
+    const unsigned char *data;  /* points into trace */
+};
+
+struct portrec
+{
+    struct portrec *next;
+    hamlib_port_t *port;
+    pthread_mutex_t lock;       /* everything below */
+
+    /* recorder */
+    FILE *fp;
+    struct timeval last;
+
+    /* counters */
+    int counting;
+    struct portrec_counts counts;
+
+    /* replayer */
+    int peer_fd;
+    double scale;
+    unsigned char *trace;
+    struct portrec_entry *entries;
+    int nentries;
+    int cursor;
+};
+
+static struct portrec *portrec_list;
+static pthread_rwlock_t portrec_lock = PTHREAD_RWLOCK_INITIALIZER;
+static int portrec_ports;       /* entries on portrec_list */
+
+
+/* caller holds portrec_lock */
+static struct portrec *portrec_find(const hamlib_port_t *p)
+{
+    struct portrec *pr;
+
+    for (pr = portrec_list; pr != NULL; pr = pr->next)
+    {
+        if (pr->port == p) { return pr; }
+    }
+
+    return NULL;
+}
+
+
+/* caller holds portrec_lock exclusive */
+static struct portrec *portrec_get(hamlib_port_t *p)
+{
+    struct portrec *pr = portrec_find(p);
+
+    if (pr != NULL) { return pr; }
+
+    pr = calloc(1, sizeof(*pr));
+
+    if (pr == NULL) { return NULL; }
+
+    pr->port = p;
+    pr->peer_fd = -1;
+    pthread_mutex_init(&pr->lock, NULL);
+    pr->next = portrec_list;
+    portrec_list = pr;
+    __atomic_store_n(&portrec_ports, portrec_ports + 1, __ATOMIC_RELEASE);
+
+    return pr;
+}
+
+
+/*
+ * Find p's entry and lock it.  The list lock is dropped only once the
+ * entry is locked, so portrec_close() can't free it before it is
+ * unlocked again.
+ */
+static struct portrec *portrec_hold(const hamlib_port_t *p)
+{
+    struct portrec *pr;
+
+    if (__atomic_load_n(&portrec_ports, __ATOMIC_ACQUIRE) == 0) { return NULL; }
+
+    pthread_rwlock_rdlock(&portrec_lock);
+    pr = portrec_find(p);
+
+    if (pr != NULL) { pthread_mutex_lock(&pr->lock); }
+
+    pthread_rwlock_unlock(&portrec_lock);
+
+    return pr;
+}
+
+
+static void portrec_put_varint(FILE *fp, uint64_t v)
+{
+    do
+    {
+        unsigned char c = v & 0x7f;
+
+        v >>= 7;
+
+        if (v) { c |= 0x80; }
+
+        fputc(c, fp);
+    }
+    while (v);
+}
+
+
+static int portrec_get_varint(const unsigned char **pp,
+                              const unsigned char *end, uint64_t *v)
+{
+    const unsigned char *s = *pp;
+    int shift = 0;
+
+    *v = 0;
+
+    while (s < end && shift < 64)
+    {
+        *v |= (uint64_t)(*s & 0x7f) << shift;
+
+        if (!(*s++ & 0x80))
+        {
+            *pp = s;
+            return RIG_OK;
+        }
+
+        shift += 7;
+    }
+
+    return -RIG_EPROTO;
+}
+
+
+/* caller holds pr->lock */
+static void portrec_log(struct portrec *pr, char type,
+                        const unsigned char *buf, size_t count)
+{
+    struct timeval now;
+    int64_t delta;
+
+    gettimeofday(&now, NULL);
+    delta = (int64_t)(now.tv_sec - pr->last.tv_sec) * 1000000
+            + (now.tv_usec - pr->last.tv_usec);
+    pr->last = now;
+
+    fputc(type, pr->fp);
+    portrec_put_varint(pr->fp, delta > 0 ? (uint64_t)delta : 0);
+    portrec_put_varint(pr->fp, count);
+    fwrite(buf, 1, count, pr->fp);
+}
+
+
+/*
+ * Hand the peer the replies recorded after entry index w, honouring the
+ * recorded gaps, and return the index of the first entry not delivered.
+ */
+static int portrec_deliver(struct portrec *pr, int w)
+{
+    uint64_t ts = w < 0 ? 0 : pr->entries[w].ts;
+    int i;
+
+    for (i = w + 1; i < pr->nentries && pr->entries[i].type == 'R'; i++)
+    {
+        const struct portrec_entry *e = &pr->entries[i];
+
+        if (w >= 0 && pr->scale > 0 && e->ts > ts)
+        {
+            hl_usleep((rig_useconds_t)((e->ts - ts) * pr->scale));
+        }
+
+        ts = e->ts;
+
+        if (write(pr->peer_fd, e->data, e->len) != (ssize_t)e->len)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: replay write failed: %s\n", __func__,
+                      strerror(errno));
+        }
+    }
+
+    return i;
+}
+
+
+static void portrec_answer(struct portrec *pr, const unsigned char *buf,
+                           size_t count)
+{
+    unsigned char junk[256];
+    size_t drained = 0;
+    int i;
+
+    /* throw away what the backend just sent us */
+    while (drained < count)
+    {
+        size_t n = count - drained;
+        ssize_t ret = read(pr->peer_fd, junk, n < sizeof(junk) ? n : sizeof(junk));
+
+        if (ret <= 0) { break; }
+
+        drained += ret;
+    }
+
+    for (i = pr->cursor; i < pr->nentries; i++)
+    {
+        const struct portrec_entry *e = &pr->entries[i];
+
+        if (e->type == 'W' && e->len == count && !memcmp(e->data, buf, count))
+        {
+            break;
+        }
+    }
+
+    if (i >= pr->nentries)
+    {
+        rig_debug(RIG_DEBUG_WARN,
+                  "%s: %d byte write not found in recording, no reply\n",
+                  __func__, (int)count);
+        return;
+    }
+
+    if (i != pr->cursor)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: skipped %d recorded entries\n",
+                  __func__, i - pr->cursor);
+    }
+
+    pr->cursor = portrec_deliver(pr, i);
+}
+
+
+/* caller holds portrec_lock exclusive */
+static void portrec_unlink(struct portrec *pr)
+{
+    struct portrec **pp;
+
+    for (pp = &portrec_list; *pp != NULL; pp = &(*pp)->next)
+    {
+        if (*pp == pr)
+        {
+            *pp = pr->next;
+            __atomic_store_n(&portrec_ports, portrec_ports - 1, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+}
+
+
+/* pr is unlinked, wait for a hook still holding it */
+static void portrec_free(struct portrec *pr)
+{
+    pthread_mutex_lock(&pr->lock);
+    pthread_mutex_unlock(&pr->lock);
+    pthread_mutex_destroy(&pr->lock);
+
+    free(pr->entries);
+    free(pr->trace);
+    free(pr);
+}
+
+
+static int portrec_load(struct portrec *pr, const char *pathname,
+                        rig_model_t model)
+{
+    const unsigned char *s, *end;
+    uint32_t file_model;
+    long size;
+    FILE *fp;
+    int n = 0;
+
+    fp = fopen(pathname, "rb");
+
+    if (fp == NULL)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s: %s\n", __func__, pathname,
+                  strerror(errno));
+        return -RIG_EIO;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    pr->trace = size > 0 ? malloc(size) : NULL;
+
+    if (pr->trace == NULL || fread(pr->trace, 1, size, fp) != (size_t)size)
+    {
+        fclose(fp);
+        return -RIG_EIO;
+    }
+
+    fclose(fp);
+
+    if (size < 12 || memcmp(pr->trace, PORTREC_MAGIC, 4)
+            || pr->trace[4] != PORTREC_VERSION)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s is not a port recording\n", __func__,
+                  pathname);
+        return -RIG_EPROTO;
+    }
+
+    file_model = pr->trace[8] | (pr->trace[9] << 8) | (pr->trace[10] << 16)
+                 | ((uint32_t)pr->trace[11] << 24);
+
+    if (file_model != model)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: %s was recorded with model %u\n",
+                  __func__, pathname, (unsigned)file_model);
+    }
+
+    /* a record is at least 3 bytes, so this bounds the entry count */
+    pr->entries = calloc(size / 3 + 1, sizeof(*pr->entries));
+
+    if (pr->entries == NULL) { return -RIG_ENOMEM; }
+
+    s = pr->trace + 12;
+    end = pr->trace + size;
+
+    while (s < end)
+    {
+        struct portrec_entry *e = &pr->entries[n];
+        uint64_t delta, len;
+
+        e->type = *s++;
+
+        if ((e->type != 'W' && e->type != 'R')
+                || portrec_get_varint(&s, end, &delta) != RIG_OK
+                || portrec_get_varint(&s, end, &len) != RIG_OK
+                || len > (uint64_t)(end - s))
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: %s is corrupt at offset %d\n",
+                      __func__, pathname, (int)(s - pr->trace));
+            return -RIG_EPROTO;
+        }
+
+        e->ts = (n > 0 ? pr->entries[n - 1].ts : 0) + delta;
+        e->len = len;
+        e->data = s;
+        s += len;
+        n++;
+    }
+
+    pr->nentries = n;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: %s has %d entries\n", __func__, pathname,
+              n);
+
+    return RIG_OK;
+}
+
+
+/**
+ * \brief Start recording traffic on an open port
+ * \param p port being recorded
+ * \param pathname file to write, truncated if it exists
+ * \param model rig model stored in the file header
+ * \return RIG_OK or a negative error code
+ */
+int portrec_record_start(hamlib_port_t *p, const char *pathname,
+                         rig_model_t model)
+{
+    unsigned char hdr[12] = PORTREC_MAGIC;
+    struct portrec *pr;
+    FILE *fp;
+
+    fp = fopen(pathname, "wb");
+
+    if (fp == NULL)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s: %s\n", __func__, pathname,
+                  strerror(errno));
+        return -RIG_EIO;
+    }
+
+    hdr[4] = PORTREC_VERSION;
+    hdr[8] = model & 0xff;
+    hdr[9] = (model >> 8) & 0xff;
+    hdr[10] = (model >> 16) & 0xff;
+    hdr[11] = (model >> 24) & 0xff;
+    fwrite(hdr, 1, sizeof(hdr), fp);
+
+    pthread_rwlock_wrlock(&portrec_lock);
+    pr = portrec_get(p);
+
+    if (pr == NULL)
+    {
+        pthread_rwlock_unlock(&portrec_lock);
+        fclose(fp);
+        return -RIG_ENOMEM;
+    }
+
+    pthread_mutex_lock(&pr->lock);
+    pthread_rwlock_unlock(&portrec_lock);
+    pr->fp = fp;
+    gettimeofday(&pr->last, NULL);
+    pthread_mutex_unlock(&pr->lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: recording to %s\n", __func__, pathname);
+
+    return RIG_OK;
+}
+
+
+/**
+ * \brief Arrange for the next port_open() to be served from a recording
+ * \param p port that will be opened
+ * \param pathname recording made by portrec_record_start()
+ * \param model rig model, only used to warn about mismatched recordings
+ * \param scale multiplier for the recorded reply delays, 0 for none
+ * \return RIG_OK or a negative error code
+ */
+int portrec_replay_open(hamlib_port_t *p, const char *pathname,
+                        rig_model_t model, double scale)
+{
+    struct portrec *pr;
+    int ret;
+
+    pthread_rwlock_wrlock(&portrec_lock);
+    pr = portrec_get(p);
+
+    if (pr == NULL)
+    {
+        pthread_rwlock_unlock(&portrec_lock);
+        return -RIG_ENOMEM;
+    }
+
+    pthread_mutex_lock(&pr->lock);
+    pthread_rwlock_unlock(&portrec_lock);
+
+    free(pr->entries);
+    free(pr->trace);
+    pr->entries = NULL;
+    pr->trace = NULL;
+    pr->scale = scale;
+
+    ret = portrec_load(pr, pathname, model);
+    pthread_mutex_unlock(&pr->lock);
+
+    if (ret != RIG_OK)
+    {
+        pthread_rwlock_wrlock(&portrec_lock);
+        portrec_unlink(pr);
+        pthread_rwlock_unlock(&portrec_lock);
+        portrec_free(pr);
+        return ret;
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: replaying %s, scale %g\n", __func__,
+              pathname, scale);
+
+    return RIG_OK;
+}
+
+
+/**
+ * \brief Connect a port registered with portrec_replay_open()
+ * \param p port being opened
+ * \return 0 if p is not replayed, 1 if p->fd now talks to the
+ * recording, or a negative error code
+ */
+int portrec_replay_connect(hamlib_port_t *p)
+{
+    struct portrec *pr = portrec_hold(p);
+
+    if (pr == NULL) { return 0; }
+
+    if (pr->trace == NULL)
+    {
+        pthread_mutex_unlock(&pr->lock);
+        return 0;
+    }
+
+#ifdef HAVE_SYS_SOCKET_H
+    {
+        int sv[2];
+
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: socketpair: %s\n", __func__,
+                      strerror(errno));
+            pthread_mutex_unlock(&pr->lock);
+            return -RIG_EIO;
+        }
+
+        /* behave like a serial port opened with O_NDELAY */
+        fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+        fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+
+        p->fd = sv[0];
+        pr->peer_fd = sv[1];
+    }
+
+    /* anything the rig sent before the first command */
+    pr->cursor = portrec_deliver(pr, -1);
+    pthread_mutex_unlock(&pr->lock);
+
+    return 1;
+#else
+    rig_debug(RIG_DEBUG_ERR, "%s: replay not supported on this platform\n",
+              __func__);
+    pthread_mutex_unlock(&pr->lock);
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+/**
+ * \brief Stop recording and/or replaying a port
+ * \param p port being closed
+ *
+ * A replayed port has its descriptor closed here and p->fd reset.
+ */
+int portrec_close(hamlib_port_t *p)
+{
+    struct portrec *pr;
+
+    if (__atomic_load_n(&portrec_ports, __ATOMIC_ACQUIRE) == 0) { return RIG_OK; }
+
+    pthread_rwlock_wrlock(&portrec_lock);
+    pr = portrec_find(p);
+
+    if (pr == NULL)
+    {
+        pthread_rwlock_unlock(&portrec_lock);
+        return RIG_OK;
+    }
+
+    portrec_unlink(pr);
+    pthread_rwlock_unlock(&portrec_lock);
+
+    /* a hook may still be answering on peer_fd */
+    pthread_mutex_lock(&pr->lock);
+
+    if (pr->fp != NULL)
+    {
+        fclose(pr->fp);
+    }
+
+    if (pr->peer_fd >= 0)
+    {
+        close(pr->peer_fd);
+        close(p->fd);
+        p->fd = -1;
+    }
+
+    pthread_mutex_unlock(&pr->lock);
+    portrec_free(pr);
+
+    return RIG_OK;
+}
+
+
+/**
+ * \brief Hook for every block successfully written to a port
+ */
+void portrec_write(hamlib_port_t *p, const unsigned char *buf, size_t count)
+{
+    struct portrec *pr = portrec_hold(p);
+
+    if (pr == NULL) { return; }
+
+    if (pr->fp != NULL)
+    {
+        portrec_log(pr, 'W', buf, count);
+    }
+
+    if (pr->counting)
+    {
+        pr->counts.writes++;
+        pr->counts.write_bytes += count;
+    }
+
+    if (pr->peer_fd >= 0)
+    {
+        portrec_answer(pr, buf, count);
+    }
+
+    pthread_mutex_unlock(&pr->lock);
+}
+
+
+/**
+ * \brief Hook for every block read directly from a port
+ */
+void portrec_read(hamlib_port_t *p, const unsigned char *buf, size_t count)
+{
+    struct portrec *pr = portrec_hold(p);
+
+    if (pr == NULL) { return; }
+
+    if (pr->fp != NULL)
+    {
+        portrec_log(pr, 'R', buf, count);
+    }
+
+    if (pr->counting)
+    {
+        pr->counts.reads++;
+        pr->counts.read_bytes += count;
+    }
+
+    pthread_mutex_unlock(&pr->lock);
+}
+
+
+/**
+ * \brief Start counting the blocks and bytes moved through a port
+ * \param p port to count, may be called before the port is opened
+ *
+ * Counting stops when the port is closed.
+ */
+int portrec_count_start(hamlib_port_t *p)
+{
+    struct portrec *pr;
+
+    pthread_rwlock_wrlock(&portrec_lock);
+    pr = portrec_get(p);
+
+    if (pr != NULL)
+    {
+        pthread_mutex_lock(&pr->lock);
+        pr->counting = 1;
+        memset(&pr->counts, 0, sizeof(pr->counts));
+        pthread_mutex_unlock(&pr->lock);
+    }
+
+    pthread_rwlock_unlock(&portrec_lock);
+
+    return pr != NULL ? RIG_OK : -RIG_ENOMEM;
+}
+
+
+/**
+ * \brief Read the counters started by portrec_count_start()
+ */
+int portrec_get_counts(hamlib_port_t *p, struct portrec_counts *counts)
+{
+    struct portrec *pr = portrec_hold(p);
+    int ret = -RIG_EINVAL;
+
+    if (pr == NULL) { return ret; }
+
+    if (pr->counting)
+    {
+        *counts = pr->counts;
+        ret = RIG_OK;
+    }
+
+    pthread_mutex_unlock(&pr->lock);
+
+    return ret;
+}
@@ -0,0 +1,67 @@
+/*
+ *  Hamlib Interface - port session recorder/replayer header
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _PORTREC_H
+#define _PORTREC_H 1
+
+#include <hamlib/rig.h>
+#include "iofunc.h"
+
+__BEGIN_DECLS
+
+/*
+ * Session file layout, all integers little endian:
+ *
+ *   "HLRC" version(1) reserved(3) rig_model(4)
+ *
+ * followed by records of
+ *
+ *   type('W' or 'R') delta_us(varint) length(varint) data[length]
+ *
+ * where delta_us is the time since the previous record and the
+ * varints are unsigned LEB128.
+ */
+#define PORTREC_MAGIC   "HLRC"
+#define PORTREC_VERSION 1
+
+/* Traffic counters, see portrec_count_start() */
+struct portrec_counts
+{
+    unsigned long writes;
+    unsigned long write_bytes;
+    unsigned long reads;
+    unsigned long read_bytes;
+};
+
+/* Hamlib internal use, see rig.c and iofunc.c */
+int portrec_record_start(hamlib_port_t *p, const char *pathname,
+                         rig_model_t model);
+int portrec_replay_open(hamlib_port_t *p, const char *pathname,
+                        rig_model_t model, double scale);
+int portrec_replay_connect(hamlib_port_t *p);
+int portrec_close(hamlib_port_t *p);
+void portrec_write(hamlib_port_t *p, const unsigned char *buf, size_t count);
+void portrec_read(hamlib_port_t *p, const unsigned char *buf, size_t count);
+int portrec_count_start(hamlib_port_t *p);
+int portrec_get_counts(hamlib_port_t *p, struct portrec_counts *counts);
+
+__END_DECLS
+
+#endif /* _PORTREC_H */
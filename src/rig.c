@@ -60,6 +60,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <math.h>
 #ifdef HAVE_PTHREAD
 #include <pthread.h>
 #endif
@@ -69,6 +70,7 @@
 #include "serial.h"
 #include "parallel.h"
 #include "network.h"
+#include "uring.h"
 #include "event.h"
 #include "cm108.h"
 #include "gpio.h"
@@ -76,6 +78,12 @@
 #include "sprintflst.h"
 #include "hamlibdatetime.h"
 #include "cache.h"
+#include "portrec.h"
+#include "capindex.h"
+#include "tokindex.h"
+#include "vfoplan.h"
+#include "meter.h"
+#include "asyncop.h"
 
 /**
  * \brief Hamlib release number
@@ -169,7 +177,7 @@ const char hamlib_copyright[231] = /* hamlib 1.2 ABI specifies 231 bytes */
 #define CHECK_RIG_ARG(r) (!(r) || !(r)->caps || !(r)->state.comm_state)
 #define CHECK_RIG_CAPS(r) (!(r) || !(r)->caps)
 
-#define LOCK(n) if (rig->state.depth == 1) { rig_debug(RIG_DEBUG_CACHE, "%s: %s\n", n?"lock":"unlock", __func__);  rig_lock(rig,n); }
+#define LOCK(n) { meter_stream_lock(rig,n); if (rig->state.depth == 1) { rig_debug(RIG_DEBUG_CACHE, "%s: %s\n", n?"lock":"unlock", __func__);  rig_lock(rig,n); if (n && rig->state.net_resync) { rig_net_resync(rig); } } }
 
 #ifdef PTHREAD
 #define MUTEX(var) static pthread_mutex_t var = PTHREAD_MUTEX_INITIALIZER
@@ -218,7 +226,8 @@ static const char *const rigerror_table[] =
     "Argument out of domain of func",
     "Function deprecated",
     "Security error password not provided or crypto failure",
-    "Rig is not powered on"
+    "Rig is not powered on",
+    "Operation cancelled"
 };
 
 
@@ -259,6 +268,47 @@ static int morse_data_handler_stop(RIG *rig);
 int morse_data_handler_set_keyspd(RIG *rig, int keyspd);
 void *morse_data_handler(void *arg);
 
+/*
+ * Latest-wins frequency changes.
+ *
+ * While one thread is sending a set_freq to the rig, set_freq calls from
+ * other threads only record their target and wait.  The sending thread
+ * then applies the newest target recorded for each VFO before it returns,
+ * so the intermediate frequencies of a fast tuning knob are dropped and
+ * the final one always reaches the rig.  Each waiter gets the result of
+ * the set that applied its target, or the later target that replaced it.
+ */
+#define FREQ_COALESCE_MAX_VFO 8
+
+struct freq_coalesce_waiter
+{
+    vfo_t vfo;
+    int taken;          /* its target is being sent */
+    int done;
+    int retcode;
+    struct freq_coalesce_waiter *next;
+};
+
+struct freq_coalesce_s
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t owner;
+#endif
+    struct freq_coalesce_waiter *waiters;
+    int busy;
+    int npending;
+    struct
+    {
+        vfo_t vfo;
+        freq_t freq;
+    } pending[FREQ_COALESCE_MAX_VFO];
+    unsigned long requests;
+    unsigned long sent;
+    unsigned long coalesced;
+};
+
 /*
  * track which rig is opened (with rig_open)
  * needed at least for transceive mode
@@ -575,7 +625,10 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
     rs = &rig->state;
 #ifdef HAVE_PTHREAD
     pthread_mutex_init(&rs->mutex_set_transaction, NULL);
+    pthread_mutex_init(&rs->morse_start_lock, NULL);
 #endif
+    meter_lock_init(rig);
+    spectrum_cb_lock_init(rig);
 
     rs->rig_model = caps->rig_model;
     rs->priv = NULL;
@@ -678,6 +731,9 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
     rs->multicast_cmd_port = 4532;
     rs->lo_freq = 0;
     rs->cache.timeout_ms = 500;  // 500ms cache timeout by default
+    rs->port_replay_scale = 1.0; // replay recordings in real time
+    rs->tcp_keepalive = 10;
+    rs->net_reconnect = 1;
     rs->cache.ptt = 0;
     rs->targetable_vfo = rig->caps->targetable_vfo;
     rs->model_name = rig->caps->model_name;
@@ -858,10 +914,73 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
         }
     }
 
+    /* a scan still answers conf/ext lookups without it */
+    if (rig_conf_tokindex_build(rig) != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: no token index, using list scans\n", __func__);
+    }
+
     return (rig);
 }
 
 
+/*
+ * network.c calls this when the rig's TCP port drops and again once it
+ * has reconnected, from inside the write_block() that reconnected it.
+ * Only what a fresh connection loses is put back, the transceive mode
+ * and the selected VFO, as rig_open leaves them; cached values are
+ * dropped so the next reads go to the rig.
+ */
+static void rig_net_notify(void *arg, int up)
+{
+    RIG *rig = arg;
+    struct rig_state *rs = &rig->state;
+
+    if (!up)
+    {
+        rs->comm_status = RIG_COMM_STATUS_DISCONNECTED;
+        return;
+    }
+
+    rs->comm_status = RIG_COMM_STATUS_OK;
+    rig_set_cache_freq(rig, RIG_VFO_ALL, (freq_t)0);
+
+    /*
+     * We are inside write_block() of some backend transaction, whose
+     * command may still sit in a buffer the backend would reuse.  Leave
+     * the rig commands to rig_net_resync() at the next API entry.
+     */
+    rs->net_resync = 1;
+}
+
+
+/*
+ * restore transceive mode and VFO after a reconnect, called from the
+ * outermost LOCK(1) so it never lands inside another operation
+ */
+static void rig_net_resync(RIG *rig)
+{
+    struct rig_state *rs = &rig->state;
+
+    rs->net_resync = 0;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: restoring state after reconnect\n",
+              __func__);
+
+    /* only the transceive mode Hamlib asked for, the user's stays as is */
+    if (rig->caps->set_trn && rs->async_data_enabled)
+    {
+        rig->caps->set_trn(rig, RIG_TRN_RIG);
+    }
+
+    if (rig->caps->set_vfo && rs->current_vfo != RIG_VFO_CURR
+            && rs->current_vfo != RIG_VFO_NONE)
+    {
+        rig->caps->set_vfo(rig, rs->current_vfo);
+    }
+}
+
+
 /**
  * \brief open the communication to the rig
  * \param rig   The #RIG handle of the radio to be opened
@@ -1090,8 +1209,45 @@ int HAMLIB_API rig_open(RIG *rig)
     }
 
     rs->rigport.timeout = caps->timeout;
+
+    if (rs->port_replay_pathname)
+    {
+        status = portrec_replay_open(&rs->rigport, rs->port_replay_pathname,
+                                     caps->rig_model, rs->port_replay_scale);
+
+        if (status < 0)
+        {
+            rs->comm_state = 0;
+            rig->state.comm_status = RIG_COMM_STATUS_ERROR;
+            RETURNFUNC2(status);
+        }
+    }
+
+    if (rs->rigport.type.rig == RIG_PORT_NETWORK && !rs->port_replay_pathname)
+    {
+        network_link_setup(&rs->rigport, rs->tcp_keepalive, rs->tcp_user_timeout,
+                           rs->net_reconnect, rig_net_notify, rig);
+    }
+
     status = port_open(&rs->rigport);
 
+    if (status >= 0 && rs->port_record_pathname)
+    {
+        status = portrec_record_start(&rs->rigport, rs->port_record_pathname,
+                                      caps->rig_model);
+
+        if (status < 0)
+        {
+            port_close(&rs->rigport, rs->rigport.type.rig);
+        }
+    }
+
+    /* optional, the port keeps working on select() if this fails */
+    if (status >= 0 && rs->io_uring && !rs->port_replay_pathname)
+    {
+        uring_port_attach(&rs->rigport);
+    }
+
     if (status < 0)
     {
         rig_debug(RIG_DEBUG_VERBOSE, "%s: rs->comm_state==0?=%d\n", __func__,
@@ -1386,6 +1542,13 @@ int HAMLIB_API rig_open(RIG *rig)
         }
     }
 
+    /* after the backend open, which may adjust filters and ranges */
+    if (capindex_build(rig) != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: no capability index, using list scans\n",
+                  __func__);
+    }
+
     /*
      * trigger state->current_vfo first retrieval
      */
@@ -1431,14 +1594,7 @@ int HAMLIB_API rig_open(RIG *rig)
         }
     }
 
-    status = morse_data_handler_start(rig);
-
-    if (status < 0)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: cw_data_handler_start failed: %s\n", __func__, rigerror(status));
-        port_close(&rs->rigport, rs->rigport.type.rig);
-        RETURNFUNC2(status);
-    }
+    /* the morse handler is started by the first rig_send_morse() */
 
     if (rs->auto_disable_screensaver)
     {
@@ -1525,6 +1681,9 @@ int HAMLIB_API rig_open(RIG *rig)
 
     rig->state.comm_status = RIG_COMM_STATUS_OK;
 
+    /* backend open may have changed the lists, see rig_state.state_gen */
+    rig->state.state_gen++;
+
     add_opened_rig(rig);
 
     RETURNFUNC2(RIG_OK);
@@ -1570,6 +1729,8 @@ int HAMLIB_API rig_close(RIG *rig)
 
     rig->state.comm_status = RIG_COMM_STATUS_DISCONNECTED;
 
+    rig_async_stop(rig);
+    rig_meter_stream_stop(rig);
     morse_data_handler_stop(rig);
     async_data_handler_stop(rig);
     rig_poll_routine_stop(rig);
@@ -1585,6 +1746,9 @@ int HAMLIB_API rig_close(RIG *rig)
         caps->rig_close(rig);
     }
 
+    capindex_free(rig);
+    rs->state_gen++;
+
 
     /*
      * FIXME: what happens if PTT and rig ports are the same?
@@ -1688,6 +1852,7 @@ int HAMLIB_API rig_close(RIG *rig)
     rs->dcdport.fd = rs->pttport.fd = -1;
 
     port_close(&rs->rigport, rs->rigport.type.rig);
+    network_link_forget(&rs->rigport);
 
     // zero split so it will allow it to be set again on open for rigctld
     rig->state.cache.split = 0;
@@ -1736,6 +1901,29 @@ int HAMLIB_API rig_cleanup(RIG *rig)
         rig->caps->rig_cleanup(rig);
     }
 
+    network_link_forget(&rig->state.rigport);
+    capindex_free(rig);
+    tokindex_free(rig);
+    free(rig->state.dump_state_priv);
+    free(rig->state.dump_caps_priv);
+    free(rig->state.port_record_pathname);
+    free(rig->state.port_replay_pathname);
+
+    if (rig->state.freq_coalesce_priv)
+    {
+#ifdef HAVE_PTHREAD
+        struct freq_coalesce_s *fc = rig->state.freq_coalesce_priv;
+        pthread_mutex_destroy(&fc->mutex);
+        pthread_cond_destroy(&fc->cond);
+#endif
+        free(rig->state.freq_coalesce_priv);
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_destroy(&rig->state.morse_start_lock);
+#endif
+    meter_lock_cleanup(rig);
+    spectrum_cb_lock_cleanup(rig);
     free(rig);
 
     return (RIG_OK);
@@ -1871,6 +2059,292 @@ static int twiddling(RIG *rig)
     RETURNFUNC2(0);
 }
 
+#ifdef HAVE_PTHREAD
+/* record a target for a set in flight, caller holds the mutex */
+static int freq_coalesce_store(struct freq_coalesce_s *fc, vfo_t vfo,
+                               freq_t freq)
+{
+    int i;
+
+    for (i = 0; i < fc->npending; i++)
+    {
+        if (fc->pending[i].vfo == vfo)
+        {
+            fc->pending[i].freq = freq;
+            fc->coalesced++;
+            return 1;
+        }
+    }
+
+    if (fc->npending == FREQ_COALESCE_MAX_VFO) { return 0; }
+
+    fc->pending[fc->npending].vfo = vfo;
+    fc->pending[fc->npending].freq = freq;
+    fc->npending++;
+
+    return 1;
+}
+
+/* hand the result of a pending target to its waiters, caller holds the mutex */
+static void freq_coalesce_done(struct freq_coalesce_s *fc, int retcode)
+{
+    struct freq_coalesce_waiter **pw = &fc->waiters;
+
+    while (*pw)
+    {
+        struct freq_coalesce_waiter *w = *pw;
+
+        if (!w->taken)
+        {
+            pw = &w->next;
+            continue;
+        }
+
+        *pw = w->next;
+        w->retcode = retcode;
+        w->done = 1;
+    }
+
+    pthread_cond_broadcast(&fc->cond);
+}
+
+/*
+ * Returns 0 if the caller should go ahead with the set_freq itself,
+ * otherwise the request was handled here and *retcode is its result.
+ */
+static int freq_coalesce_set(RIG *rig, vfo_t vfo, freq_t freq, int *retcode)
+{
+    struct freq_coalesce_s *fc = rig->state.freq_coalesce_priv;
+    struct freq_coalesce_waiter *w;
+
+    pthread_mutex_lock(&fc->mutex);
+
+    if (fc->busy && pthread_equal(fc->owner, pthread_self()))
+    {
+        /* one of our own set_freq calls, let it through */
+        pthread_mutex_unlock(&fc->mutex);
+        return 0;
+    }
+
+    fc->requests++;
+
+    if (fc->busy && freq_coalesce_store(fc, vfo, freq))
+    {
+        struct freq_coalesce_waiter self;
+
+        self.vfo = vfo;
+        self.taken = 0;
+        self.done = 0;
+        self.retcode = RIG_OK;
+        self.next = fc->waiters;
+        fc->waiters = &self;
+
+        while (!self.done) { pthread_cond_wait(&fc->cond, &fc->mutex); }
+
+        pthread_mutex_unlock(&fc->mutex);
+        *retcode = self.retcode;
+        return 1;
+    }
+
+    /* too many VFOs pending, wait our turn */
+    while (fc->busy) { pthread_cond_wait(&fc->cond, &fc->mutex); }
+
+    fc->busy = 1;
+    fc->owner = pthread_self();
+    pthread_mutex_unlock(&fc->mutex);
+
+    *retcode = rig_set_freq(rig, vfo, freq);
+
+    pthread_mutex_lock(&fc->mutex);
+    fc->sent++;
+
+    while (fc->npending > 0)
+    {
+        int rc;
+
+        vfo = fc->pending[0].vfo;
+        freq = fc->pending[0].freq;
+        fc->npending--;
+        memmove(&fc->pending[0], &fc->pending[1],
+                fc->npending * sizeof(fc->pending[0]));
+
+        /* whoever asks for this VFO from now on waits for the next round */
+        for (w = fc->waiters; w != NULL; w = w->next)
+        {
+            if (w->vfo == vfo) { w->taken = 1; }
+        }
+
+        rig_debug(RIG_DEBUG_TRACE, "%s: applying latest %s freq=%.0f\n", __func__,
+                  rig_strvfo(vfo), freq);
+        pthread_mutex_unlock(&fc->mutex);
+
+        rc = rig_set_freq(rig, vfo, freq);
+
+        pthread_mutex_lock(&fc->mutex);
+        fc->sent++;
+        freq_coalesce_done(fc, rc);
+    }
+
+    fc->busy = 0;
+    pthread_cond_broadcast(&fc->cond);
+    pthread_mutex_unlock(&fc->mutex);
+
+    return 1;
+}
+#endif
+
+
+/**
+ * \brief enable or disable latest-wins frequency changes
+ * \param rig   The rig handle
+ * \param enable    1 to coalesce set_freq calls, 0 to send each one
+ *
+ * With coalescing enabled a rig_set_freq() call made while another thread
+ * is still sending a set_freq to the rig does not queue a command of its
+ * own.  Its target replaces any earlier one still pending for the same
+ * VFO; the thread already talking to the rig applies the latest target for
+ * each VFO before its own rig_set_freq() returns.  The waiting call returns
+ * the result of the set that carried its target or the one replacing it.
+ *
+ * This is also the "freq_coalesce" configuration token.
+ *
+ * \return RIG_OK if the operation has been successful, -RIG_ENIMPL when
+ * built without thread support.
+ *
+ * \sa rig_get_freq_coalesce_stats(), rig_freq_coalesce_defer()
+ */
+int HAMLIB_API rig_set_freq_coalesce(RIG *rig, int enable)
+{
+    if (CHECK_RIG_CAPS(rig))
+    {
+        return -RIG_EINVAL;
+    }
+
+#ifdef HAVE_PTHREAD
+
+    if (enable && rig->state.freq_coalesce_priv == NULL)
+    {
+        struct freq_coalesce_s *fc = calloc(1, sizeof(*fc));
+
+        if (fc == NULL) { return -RIG_ENOMEM; }
+
+        pthread_mutex_init(&fc->mutex, NULL);
+        pthread_cond_init(&fc->cond, NULL);
+        rig->state.freq_coalesce_priv = fc;
+    }
+
+    /* the state is kept until rig_cleanup, a set may still be in flight */
+    rig->state.freq_coalesce = enable ? 1 : 0;
+
+    return RIG_OK;
+#else
+    return enable ? -RIG_ENIMPL : RIG_OK;
+#endif
+}
+
+
+/**
+ * \brief hand a frequency to a set_freq already in flight
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param freq  The frequency to set to
+ *
+ * For applications that serialize rig access with their own lock (e.g.
+ * rigctld) and would otherwise queue behind it: if coalescing is enabled
+ * and a set_freq is being sent by another thread, \a freq is recorded as
+ * the latest target for \a vfo and will be applied by that thread.
+ *
+ * \return 1 if the frequency was handed over, 0 if the caller has to call
+ * rig_set_freq() itself.
+ *
+ * \sa rig_set_freq_coalesce()
+ */
+int HAMLIB_API rig_freq_coalesce_defer(RIG *rig, vfo_t vfo, freq_t freq)
+{
+#ifdef HAVE_PTHREAD
+    struct freq_coalesce_s *fc;
+    int deferred = 0;
+
+    if (CHECK_RIG_CAPS(rig) || !rig->state.freq_coalesce)
+    {
+        return 0;
+    }
+
+    fc = rig->state.freq_coalesce_priv;
+
+    pthread_mutex_lock(&fc->mutex);
+
+    if (fc->busy && !pthread_equal(fc->owner, pthread_self())
+            && freq_coalesce_store(fc, vfo, freq))
+    {
+        fc->requests++;
+        deferred = 1;
+    }
+
+    pthread_mutex_unlock(&fc->mutex);
+
+    return deferred;
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * \brief get frequency coalescing statistics
+ * \param rig   The rig handle
+ * \param requests  Number of set_freq requests seen, may be NULL
+ * \param sent  Number of set_freq commands sent to the rig, may be NULL
+ * \param coalesced Number of targets dropped for a later one, may be NULL
+ *
+ * Counters start when coalescing is first enabled.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_set_freq_coalesce()
+ */
+int HAMLIB_API rig_get_freq_coalesce_stats(RIG *rig, unsigned long *requests,
+        unsigned long *sent, unsigned long *coalesced)
+{
+    struct freq_coalesce_s *fc;
+
+    if (CHECK_RIG_CAPS(rig))
+    {
+        return -RIG_EINVAL;
+    }
+
+    fc = rig->state.freq_coalesce_priv;
+
+    if (fc == NULL)
+    {
+        if (requests) { *requests = 0; }
+
+        if (sent) { *sent = 0; }
+
+        if (coalesced) { *coalesced = 0; }
+
+        return RIG_OK;
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&fc->mutex);
+#endif
+
+    if (requests) { *requests = fc->requests; }
+
+    if (sent) { *sent = fc->sent; }
+
+    if (coalesced) { *coalesced = fc->coalesced; }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&fc->mutex);
+#endif
+
+    return RIG_OK;
+}
+
+
 /**
  * \brief set the frequency of the target VFO
  * \param rig   The rig handle
@@ -1904,6 +2378,16 @@ int rig_set_freq(RIG *rig, vfo_t vfo, freq_t freq)
         return -RIG_EINVAL;
     }
 
+#ifdef HAVE_PTHREAD
+
+    if (rig->state.freq_coalesce
+            && freq_coalesce_set(rig, vfo, freq, &retcode))
+    {
+        return retcode;
+    }
+
+#endif
+
     ELAPSED1;
     ENTERFUNC;
     LOCK(1);
@@ -2534,6 +3018,7 @@ int HAMLIB_API rig_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 
     if (locked_mode)
     {
+        LOCK(0);
         ELAPSED2;
         RETURNFUNC(RIG_OK);
     }
@@ -2542,6 +3027,7 @@ int HAMLIB_API rig_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
     if (rig->state.cache.ptt)
     {
         rig_debug(RIG_DEBUG_VERBOSE, "%s PTT on so set_mode ignored\n", __func__);
+        LOCK(0);
         ELAPSED2;
         RETURNFUNC(RIG_OK);
     }
@@ -2550,6 +3036,7 @@ int HAMLIB_API rig_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 
     if (caps->set_mode == NULL)
     {
+        LOCK(0);
         ELAPSED2;
         RETURNFUNC(-RIG_ENAVAIL);
     }
@@ -2854,6 +3341,7 @@ int HAMLIB_API rig_get_mode(RIG *rig,
 pbwidth_t HAMLIB_API rig_passband_normal(RIG *rig, rmode_t mode)
 {
     const struct rig_state *rs;
+    pbwidth_t width;
     int i;
 
     if (!rig)
@@ -2862,15 +3350,17 @@ pbwidth_t HAMLIB_API rig_passband_normal(RIG *rig, rmode_t mode)
         return(RIG_PASSBAND_NORMAL);    /* huhu! */
     }
 
-    ENTERFUNC;
-
-    rs = &rig->state;
-
     // return CW for CWR and RTTY for RTTYR
     if (mode == RIG_MODE_CWR) { mode = RIG_MODE_CW; }
 
     if (mode == RIG_MODE_RTTYR) { mode = RIG_MODE_RTTY; }
 
+    if (capindex_passband(rig, mode, CAPINDEX_NORMAL, &width)) { return width; }
+
+    ENTERFUNC;
+
+    rs = &rig->state;
+
     for (i = 0; i < HAMLIB_FLTLSTSIZ && rs->filters[i].modes; i++)
     {
         if (rs->filters[i].modes & mode)
@@ -2915,6 +3405,8 @@ pbwidth_t HAMLIB_API rig_passband_narrow(RIG *rig, rmode_t mode)
         return(0);   /* huhu! */
     }
 
+    if (capindex_passband(rig, mode, CAPINDEX_NARROW, &normal)) { return normal; }
+
     ENTERFUNC;
 
     rs = &rig->state;
@@ -2968,6 +3460,8 @@ pbwidth_t HAMLIB_API rig_passband_wide(RIG *rig, rmode_t mode)
         return 0 ;   /* huhu! */
     }
 
+    if (capindex_passband(rig, mode, CAPINDEX_WIDE, &normal)) { return normal; }
+
     ENTERFUNC;
 
     rs = &rig->state;
@@ -3439,6 +3933,7 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
                           "%s: cannot open PTT device \"%s\"\n",
                           __func__,
                           rs->pttport.pathname);
+                LOCK(0);
                 ELAPSED2;
                 RETURNFUNC(-RIG_EIO);
             }
@@ -3450,6 +3945,7 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
 
             if (RIG_OK != retcode)
             {
+                LOCK(0);
                 ELAPSED2;
                 RETURNFUNC(retcode);
             }
@@ -3489,6 +3985,7 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
                           "%s: cannot open PTT device \"%s\"\n",
                           __func__,
                           rs->pttport.pathname);
+                LOCK(0);
                 ELAPSED2;
                 RETURNFUNC(-RIG_EIO);
             }
@@ -3501,6 +3998,7 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
             if (RIG_OK != retcode)
             {
                 rig_debug(RIG_DEBUG_ERR, "%s: ser_set_dtr retcode=%d\n", __func__, retcode);
+                LOCK(0);
                 ELAPSED2;
                 RETURNFUNC(retcode);
             }
@@ -3539,6 +4037,7 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
 
     default:
         rig_debug(RIG_DEBUG_WARN, "%s: unknown PTT type=%d\n", __func__, rig->state.pttport.type.ptt);
+        LOCK(0);
         ELAPSED2;
         RETURNFUNC(-RIG_EINVAL);
     }
@@ -3561,6 +4060,7 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
     memcpy(&rig->state.pttport_deprecated, &rig->state.pttport,
            sizeof(rig->state.pttport_deprecated));
     if (rig->state.rigport.post_ptt_delay > 0) hl_usleep(rig->state.rigport.post_ptt_delay*1000);
+    LOCK(0);
     ELAPSED2;
 
     RETURNFUNC(retcode);
@@ -5149,6 +5649,74 @@ int HAMLIB_API rig_set_split_freq_mode(RIG *rig,
 }
 
 
+/**
+ * \brief set frequency and mode of several VFOs at once
+ * \param rig   The rig handle
+ * \param settings  The targets, one per VFO
+ * \param count The number of \a settings
+ *
+ * Applies the frequency and mode changes with as few rig transactions
+ * and VFO swaps as the backend allows.  Changes on the current VFO, on
+ * VFOs the backend can address directly (see RIG_TARGETABLE_FREQ and
+ * RIG_TARGETABLE_MODE) and on the split TX VFO go out without swapping.
+ * The rest are grouped per VFO with one swap each and a single swap back
+ * at the end.  Changes matching the cache are skipped.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ * \sa rig_get_vfo_plan_stats(), rig_set_split_freq_mode()
+ */
+int HAMLIB_API rig_set_vfo_settings(RIG *rig, const rig_vfo_setting_t *settings,
+                                    int count)
+{
+    int retcode;
+
+    if (CHECK_RIG_ARG(rig) || !settings || count < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: rig or rig->caps is null\n",__func__);
+        return -RIG_EINVAL;
+    }
+
+    ELAPSED1;
+    ENTERFUNC;
+    LOCK(1);
+
+    retcode = vfo_plan_run(rig, settings, count);
+
+    LOCK(0);
+    ELAPSED2;
+    RETURNFUNC(retcode);
+}
+
+
+/**
+ * \brief get the transaction counts of the VFO planner
+ * \param rig   The rig handle
+ * \param stats The location where to store the counts
+ *
+ * Counts backend calls made by rig_set_vfo_settings() and by
+ * rig_set_split_freq_mode() on backends without set_split_freq_mode.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_set_vfo_settings()
+ */
+int HAMLIB_API rig_get_vfo_plan_stats(RIG *rig, struct rig_vfo_plan_stats *stats)
+{
+    if (CHECK_RIG_CAPS(rig) || !stats)
+    {
+        return -RIG_EINVAL;
+    }
+
+    *stats = rig->state.vfo_plan_stats;
+
+    return RIG_OK;
+}
+
+
 /**
  * \brief get the current split frequency and mode
  * \param rig   The rig handle
@@ -6185,6 +6753,14 @@ int HAMLIB_API rig_power2mW(RIG *rig,
         return -RIG_EINVAL;
     }
 
+    /* common case, without the debug traffic of the full path below */
+    if (rig->caps->power2mW == NULL
+            && capindex_tx_range(rig, freq, mode, 0, &txrange) && txrange != NULL)
+    {
+        *mwpower = (unsigned int)rint(power * txrange->high_power);
+        return RIG_OK;
+    }
+
     ENTERFUNC;
 
     if (rig->caps->power2mW != NULL)
@@ -6192,18 +6768,22 @@ int HAMLIB_API rig_power2mW(RIG *rig,
         RETURNFUNC(rig->caps->power2mW(rig, mwpower, power, freq, mode));
     }
 
-    txrange = rig_get_range(rig->state.tx_range_list, freq, mode);
+    // the index covers all the range lists below
+    if (!capindex_tx_range(rig, freq, mode, 0, &txrange))
+    {
+        txrange = rig_get_range(rig->state.tx_range_list, freq, mode);
 
-    // check all the range lists
-    if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list1, freq, mode); }
+        // check all the range lists
+        if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list1, freq, mode); }
 
-    if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list2, freq, mode); }
+        if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list2, freq, mode); }
 
-    if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list3, freq, mode); }
+        if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list3, freq, mode); }
 
-    if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list4, freq, mode); }
+        if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list4, freq, mode); }
 
-    if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list5, freq, mode); }
+        if (txrange == NULL) { txrange = rig_get_range(rig->caps->tx_range_list5, freq, mode); }
+    }
 
     if (txrange == NULL)
     {
@@ -6262,7 +6842,10 @@ int HAMLIB_API rig_mW2power(RIG *rig,
         RETURNFUNC2(rig->caps->mW2power(rig, power, mwpower, freq, mode));
     }
 
-    txrange = rig_get_range(rig->state.tx_range_list, freq, mode);
+    if (!capindex_tx_range(rig, freq, mode, 1, &txrange))
+    {
+        txrange = rig_get_range(rig->state.tx_range_list, freq, mode);
+    }
 
     if (!txrange)
     {
@@ -6309,6 +6892,7 @@ int HAMLIB_API rig_mW2power(RIG *rig,
 shortfreq_t HAMLIB_API rig_get_resolution(RIG *rig, rmode_t mode)
 {
     const struct rig_state *rs;
+    shortfreq_t ts;
     int i;
 
     if (!rig || !rig->caps || !mode)
@@ -6317,6 +6901,8 @@ shortfreq_t HAMLIB_API rig_get_resolution(RIG *rig, rmode_t mode)
         return -RIG_EINVAL;
     }
 
+    if (capindex_resolution(rig, mode, &ts)) { return ts ? ts : -RIG_EINVAL; }
+
     ENTERFUNC;
 
     rs = &rig->state;
@@ -6975,6 +7561,23 @@ int HAMLIB_API rig_send_morse(RIG *rig, vfo_t vfo, const char *msg)
         retcode = caps->send_morse(rig, vfo, msg);
         LOCK(0);
 #endif
+        pthread_mutex_lock(&rig->state.morse_start_lock);
+
+        if (rig->state.morse_data_handler_priv_data == NULL)
+        {
+            retcode = morse_data_handler_start(rig);
+
+            if (retcode != RIG_OK)
+            {
+                pthread_mutex_unlock(&rig->state.morse_start_lock);
+                rig_debug(RIG_DEBUG_ERR, "%s: morse_data_handler_start failed: %s\n",
+                          __func__, rigerror(retcode));
+                RETURNFUNC(retcode);
+            }
+        }
+
+        pthread_mutex_unlock(&rig->state.morse_start_lock);
+
         push(rig->state.fifo_morse, msg);
         RETURNFUNC(RIG_OK);
     }
@@ -7039,7 +7642,11 @@ int HAMLIB_API rig_stop_morse(RIG *rig, vfo_t vfo)
         RETURNFUNC(-RIG_ENAVAIL);
     }
 
-    resetFIFO(rig->state.fifo_morse); // clear out the CW queue
+    if (rig->state.fifo_morse)
+    {
+        resetFIFO(rig->state.fifo_morse); // clear out the CW queue
+    }
+
     if (vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
@@ -7557,6 +8164,29 @@ int HAMLIB_API rig_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq,
     vfo = vfo_fixup(rig, vfo, rig->state.cache.split);
     // we can't use the cached values as some clients may only call this function
     // like Log4OM which mostly does polling
+
+    if (rig->caps->rig_get_vfo_info)
+    {
+        // backends that can read freq/mode/width in one exchange
+        HAMLIB_TRACE;
+        retval = rig->caps->rig_get_vfo_info(rig, vfo, freq, mode, width, split);
+
+        if (retval == RIG_OK)
+        {
+            rig_set_cache_freq(rig, vfo, *freq);
+            rig_set_cache_mode(rig, vfo, *mode, *width);
+            *satmode = rig->state.cache.satmode;
+            ELAPSED2;
+            RETURNFUNC(RIG_OK);
+        }
+
+        if (retval != -RIG_ENAVAIL && retval != -RIG_ENIMPL)
+        {
+            ELAPSED2;
+            RETURNFUNC(retval);
+        }
+    }
+
     HAMLIB_TRACE;
     retval = rig_get_freq(rig, vfo, freq);
 
@@ -7911,6 +8541,13 @@ static int async_data_handler_start(RIG *rig)
                   rs->async_data_enabled);
         RETURNFUNC(RIG_OK);
     }
+
+    // backends with a reader thread of their own (SmartSDR) have no frames for us
+    if (rig->caps->read_frame_direct == NULL)
+    {
+        RETURNFUNC(RIG_OK);
+    }
+
     sleep(2);  // give other things a chance to finish opening up the rig
 
 #ifdef HAVE_PTHREAD
@@ -7949,6 +8586,19 @@ static int morse_data_handler_start(RIG *rig)
 
     ENTERFUNC;
 
+    if (rs->fifo_morse == NULL)
+    {
+        rs->fifo_morse = calloc(1, sizeof(FIFO_RIG));
+
+        if (rs->fifo_morse == NULL)
+        {
+            RETURNFUNC(-RIG_ENOMEM);
+        }
+    }
+
+    /* before the thread runs, rig_send_morse() pushes as soon as we return */
+    initFIFO(rs->fifo_morse);
+
     rs->morse_data_handler_thread_run = 1;
     rs->morse_data_handler_priv_data = calloc(1,
                                        sizeof(morse_data_handler_priv_data));
@@ -7973,6 +8623,9 @@ static int morse_data_handler_start(RIG *rig)
     {
         rig_debug(RIG_DEBUG_ERR, "%s: pthread_create error: %s\n", __func__,
                   strerror(errno));
+        /* so the next rig_send_morse() tries again */
+        free(rs->morse_data_handler_priv_data);
+        rs->morse_data_handler_priv_data = NULL;
         RETURNFUNC(-RIG_EINTERNAL);
     }
 
@@ -8033,6 +8686,12 @@ static int morse_data_handler_stop(RIG *rig)
     morse_data_handler_priv = (morse_data_handler_priv_data *)
                               rs->morse_data_handler_priv_data;
 
+    if (morse_data_handler_priv == NULL)
+    {
+        // never started, nothing to flush
+        RETURNFUNC(RIG_OK);
+    }
+
     // wait until fifo queue is flushed
     //HAMLIB_TRACE;
     hl_usleep(100*1000);
@@ -8069,6 +8728,10 @@ static int morse_data_handler_stop(RIG *rig)
         rs->morse_data_handler_priv_data = NULL;
     }
 
+    // the thread was cancelled before it could free the queue
+    free(rs->fifo_morse);
+    rs->fifo_morse = NULL;
+
     RETURNFUNC(RIG_OK);
 }
 
@@ -8169,13 +8832,6 @@ void *morse_data_handler(void *arg)
     rig_debug(RIG_DEBUG_VERBOSE, "%s: Starting morse data handler thread\n",
               __func__);
 
-    if (rig->state.fifo_morse == NULL)
-    {
-        rig->state.fifo_morse = calloc(1,sizeof(FIFO_RIG));
-    }
-
-    initFIFO(rig->state.fifo_morse);
-
     char *c;
     int qsize = rig->caps->morse_qsize; // if backend overrides qsize
     if (qsize == 0) qsize = 20; // shortest length of any rig's CW morse capability
@@ -44,6 +44,7 @@
 #include <hamlib/rig.h>
 #include "cal.h"
 #include "misc.h"
+#include "meter.h"
 
 
 #ifndef DOC_HIDDEN
@@ -53,36 +54,12 @@
 #endif /* !DOC_HIDDEN */
 
 
-/**
- * \brief set a radio level setting
- * \param rig   The rig handle
- * \param vfo   The target VFO
- * \param level The level setting
- * \param val   The value to set the level setting to
- *
- * Sets the level of a setting.
- * The level value \a val can be a float or an integer. See #value_t
- * for more information.
- *
- * \return RIG_OK if the operation has been successful, otherwise
- * a negative value if an error occurred (in which case, cause is
- * set appropriately).
- *
- * \sa rig_has_set_level(), rig_get_level()
- */
-int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
+static int set_level_locked(RIG *rig, vfo_t vfo, setting_t level, value_t val)
 {
     const struct rig_caps *caps;
     int retcode;
     vfo_t curr_vfo;
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
-
-    if (CHECK_RIG_ARG(rig))
-    {
-        return -RIG_EINVAL;
-    }
-
     caps = rig->caps;
 
     if (caps->set_level == NULL || !rig_has_set_level(rig, level))
@@ -122,43 +99,50 @@ int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
 
 
 /**
- * \brief get the value of a level
+ * \brief set a radio level setting
  * \param rig   The rig handle
  * \param vfo   The target VFO
  * \param level The level setting
- * \param val   The location where to store the value of \a level
- *
- *  Retrieves the value of a \a level.
- *  The level value \a val can be a float or an integer. See #value_t
- *  for more information.
+ * \param val   The value to set the level setting to
  *
- *      RIG_LEVEL_STRENGTH: \a val is an integer, representing the S Meter
- *      level in dB relative to S9, according to the ideal S Meter scale.
- *      The ideal S Meter scale is as follow: S0=-54, S1=-48, S2=-42, S3=-36,
- *      S4=-30, S5=-24, S6=-18, S7=-12, S8=-6, S9=0, +10=10, +20=20,
- *      +30=30, +40=40, +50=50 and +60=60. This is the responsibility
- *      of the backend to return values calibrated for this scale.
+ * Sets the level of a setting.
+ * The level value \a val can be a float or an integer. See #value_t
+ * for more information.
  *
  * \return RIG_OK if the operation has been successful, otherwise
  * a negative value if an error occurred (in which case, cause is
  * set appropriately).
  *
- * \sa rig_has_get_level(), rig_set_level()
+ * \sa rig_has_set_level(), rig_get_level()
  */
-int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
+int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
 {
-    const struct rig_caps *caps;
     int retcode;
-    vfo_t curr_vfo;
 
-    // too verbose
-    //rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
+    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
-    if (CHECK_RIG_ARG(rig) || !val)
+    if (CHECK_RIG_ARG(rig))
     {
         return -RIG_EINVAL;
     }
 
+    meter_stream_lock(rig, 1);
+    retcode = set_level_locked(rig, vfo, level, val);
+    meter_stream_lock(rig, 0);
+
+    return retcode;
+}
+
+
+static int get_level_locked(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
+{
+    const struct rig_caps *caps;
+    int retcode;
+    vfo_t curr_vfo;
+
+    // too verbose
+    //rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
+
     caps = rig->caps;
 
     if (caps->get_level == NULL || !rig_has_get_level(rig, level))
@@ -216,6 +200,47 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
 }
 
 
+/**
+ * \brief get the value of a level
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param level The level setting
+ * \param val   The location where to store the value of \a level
+ *
+ *  Retrieves the value of a \a level.
+ *  The level value \a val can be a float or an integer. See #value_t
+ *  for more information.
+ *
+ *      RIG_LEVEL_STRENGTH: \a val is an integer, representing the S Meter
+ *      level in dB relative to S9, according to the ideal S Meter scale.
+ *      The ideal S Meter scale is as follow: S0=-54, S1=-48, S2=-42, S3=-36,
+ *      S4=-30, S5=-24, S6=-18, S7=-12, S8=-6, S9=0, +10=10, +20=20,
+ *      +30=30, +40=40, +50=50 and +60=60. This is the responsibility
+ *      of the backend to return values calibrated for this scale.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ * \sa rig_has_get_level(), rig_set_level()
+ */
+int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
+{
+    int retcode;
+
+    if (CHECK_RIG_ARG(rig) || !val)
+    {
+        return -RIG_EINVAL;
+    }
+
+    meter_stream_lock(rig, 1);
+    retcode = get_level_locked(rig, vfo, level, val);
+    meter_stream_lock(rig, 0);
+
+    return retcode;
+}
+
+
 /**
  * \brief set a radio parameter
  * \param rig   The rig handle
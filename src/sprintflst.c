@@ -22,6 +22,7 @@
 
 #include <hamlib/config.h>
 
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>   /* Standard input/output definitions */
 #include <string.h>  /* String function definitions */
@@ -53,6 +54,28 @@ int check_buffer_overflow(char *str, int len, int nlen)
 }
 
 
+/*
+ * Formats at str + len, the end of what the caller has written so far, so
+ * building a list is one pass instead of strcat walking it for every item.
+ * Output is cut at nlen.  Returns the new length.
+ */
+static int sprintf_append(char *str, int nlen, int len, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    if (len >= nlen - 1) { return len; }
+
+    va_start(ap, fmt);
+    n = vsnprintf(str + len, nlen - len, fmt, ap);
+    va_end(ap);
+
+    if (n < 0) { return len; }
+
+    return len + n < nlen ? len + n : nlen - 1;
+}
+
+
 int rig_sprintf_vfo(char *str, int nlen, vfo_t vfo)
 {
     unsigned int i, len = 0;
@@ -100,10 +123,7 @@ int rig_sprintf_mode(char *str, int nlen, rmode_t mode)
         {
             continue;    /* unknown, FIXME! */
         }
-        if (i > 0) strcat(str, " ");
-
-        strcat(str, ms);
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, i > 0 ? " %s" : "%s", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -179,9 +199,7 @@ int rig_sprintf_func(char *str, int nlen, setting_t func)
             continue;    /* unknown, FIXME! */
         }
 
-        strcat(str, ms);
-        strcat(str, " ");
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, "%s ", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -209,9 +227,7 @@ int rot_sprintf_func(char *str, int nlen, setting_t func)
             continue;    /* unknown, FIXME! */
         }
 
-        strcat(str, ms);
-        strcat(str, " ");
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, "%s ", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -239,9 +255,7 @@ int rig_sprintf_level(char *str, int nlen, setting_t level)
             continue;    /* unknown, FIXME! */
         }
 
-        strcat(str, ms);
-        strcat(str, " ");
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, "%s ", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -269,9 +283,7 @@ int rot_sprintf_level(char *str, int nlen, setting_t level)
             continue;    /* unknown, FIXME! */
         }
 
-        strcat(str, ms);
-        strcat(str, " ");
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, "%s ", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -299,9 +311,7 @@ int amp_sprintf_level(char *str, int nlen, setting_t level)
             continue;    /* unknown, FIXME! */
         }
 
-        strcat(str, ms);
-        strcat(str, " ");
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, "%s ", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -335,9 +345,7 @@ int sprintf_level_ext(char *str, int nlen, const struct confparams *extlevels)
         case RIG_CONF_NUMERIC:
         case RIG_CONF_STRING:
         case RIG_CONF_BINARY:
-            strcat(str, extlevels->name);
-            strcat(str, " ");
-            len += strlen(extlevels->name) + 1;
+            len = sprintf_append(str, nlen, len, "%s ", extlevels->name);
             break;
 
         case RIG_CONF_BUTTON:
@@ -490,9 +498,7 @@ int rig_sprintf_parm(char *str, int nlen, setting_t parm)
             continue;    /* unknown, FIXME! */
         }
 
-        strcat(str, ms);
-        strcat(str, " ");
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, "%s ", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -520,9 +526,7 @@ int rot_sprintf_parm(char *str, int nlen, setting_t parm)
             continue;    /* unknown, FIXME! */
         }
 
-        strcat(str, ms);
-        strcat(str, " ");
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, "%s ", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -679,9 +683,7 @@ int rig_sprintf_vfop(char *str, int nlen, vfo_op_t op)
             continue;    /* unknown, FIXME! */
         }
 
-        strcat(str, ms);
-        strcat(str, " ");
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, "%s ", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -709,9 +711,7 @@ int rig_sprintf_scan(char *str, int nlen, scan_t rscan)
             continue;    /* unknown, FIXME! */
         }
 
-        strcat(str, ms);
-        strcat(str, " ");
-        len += strlen(ms) + 1;
+        len = sprintf_append(str, nlen, len, "%s ", ms);
         check_buffer_overflow(str, len, nlen);
     }
 
@@ -922,7 +922,6 @@ int rig_sprintf_agc_levels(RIG *rig, char *str, int lenstr)
 
     int len = 0;
     int i;
-    char tmpbuf[256];
 
     str[len] = 0;
 
@@ -933,42 +932,26 @@ int rig_sprintf_agc_levels(RIG *rig, char *str, int lenstr)
                 && priv_caps->agc_levels[i].level != RIG_AGC_LAST
                 ;i++)
         {
-            if (strlen(str) > 0) { strcat(str, " "); }
-
-            sprintf(tmpbuf, "%d=%s", priv_caps->agc_levels[i].icom_level,
-                    rig_stragclevel(priv_caps->agc_levels[i].level));
-
-            if (strlen(str) + strlen(tmpbuf) < lenstr - 1)
-            {
-                strncat(str, tmpbuf, lenstr - 1);
-            }
-            else
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s: buffer overrun!!  len=%d > maxlen=%d\n",
-                          __func__, (int)(strlen(str) + strlen(tmpbuf)), lenstr - 1);
-            }
+            len = sprintf_append(str, lenstr, len, len > 0 ? " %d=%s" : "%d=%s",
+                                 priv_caps->agc_levels[i].icom_level,
+                                 rig_stragclevel(priv_caps->agc_levels[i].level));
         }
     }
     else
     {
         for (i = 0; i < HAMLIB_MAX_AGC_LEVELS && i < rig->caps->agc_level_count; i++)
         {
-            if (strlen(str) > 0) { strcat(str, " "); }
-
-            sprintf(tmpbuf, "%d=%s", rig->caps->agc_levels[i],
-                    rig_stragclevel(rig->caps->agc_levels[i]));
-
-            if (strlen(str) + strlen(tmpbuf) < lenstr - 1)
-            {
-                strncat(str, tmpbuf, lenstr - 1);
-            }
-            else
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s: buffer overrun!!  len=%d > maxlen=%d\n",
-                          __func__, (int)(strlen(str) + strlen(tmpbuf)), lenstr - 1);
-            }
+            len = sprintf_append(str, lenstr, len, len > 0 ? " %d=%s" : "%d=%s",
+                                 rig->caps->agc_levels[i],
+                                 rig_stragclevel(rig->caps->agc_levels[i]));
         }
     }
 
-    return strlen(str);
+    if (len >= lenstr - 1)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: buffer overrun!!  maxlen=%d\n", __func__,
+                  lenstr - 1);
+    }
+
+    return len;
 }
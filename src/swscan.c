@@ -0,0 +1,504 @@
+/*
+ *  Hamlib Interface - software scanning
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig
+ * @{
+ */
+
+/**
+ * \file swscan.c
+ * \brief Software scanning for rigs without (suitable) built-in scan
+ *
+ * rig_sw_scan() tunes through a channel list or range, samples each
+ * channel and reports the active ones.  Compared to a rig_set_freq() +
+ * sleep() + rig_get_level() loop:
+ *
+ *  - mode and VFO are set once, not per channel
+ *  - the dwell clock starts when the tune command returns, so time the
+ *    rig spends tuning (rigs that don't acknowledge set_freq return at
+ *    once) and our own bookkeeping are not added on top of it
+ *  - with RIG_SW_SCAN_SPECTRUM, every channel the last scope line covers
+ *    is judged from that line without tuning at all; the rig is only
+ *    retuned to move the scope or to stop on an active channel
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "event.h"
+
+/* how often an active channel is sampled while holding */
+#define SW_SCAN_HOLD_MIN_MS 50
+/* how long to wait for a scope line after tuning */
+#define SW_SCAN_SPECTRUM_TIMEOUT_MS 2000
+
+struct sw_scan_spectrum
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t lock;
+#endif
+    spectrum_cb_t user_cb;
+    rig_ptr_t user_arg;
+    unsigned long seq;          /* lines received */
+    freq_t low, high;
+    int data_min, data_max;
+    double db_min, db_max;
+    size_t length;
+    unsigned char *data;
+    size_t size;
+};
+
+struct sw_scan_ctx
+{
+    RIG *rig;
+    const struct rig_sw_scan *scan;
+    struct rig_sw_scan_stats *stats;
+    freq_t tuned;
+    struct timespec tuned_at;
+    unsigned long tuned_seq;    /* spectrum lines seen when tuned */
+    struct sw_scan_spectrum *spec;
+};
+
+
+static void spectrum_lock(struct sw_scan_spectrum *spec, int lock)
+{
+#ifdef HAVE_PTHREAD
+
+    if (lock) { pthread_mutex_lock(&spec->lock); }
+    else { pthread_mutex_unlock(&spec->lock); }
+
+#endif
+}
+
+
+/* runs in the async reader, keeps a copy of the line and passes it on */
+static int sw_scan_spectrum_cb(RIG *rig, struct rig_spectrum_line *line,
+                               rig_ptr_t arg)
+{
+    struct sw_scan_spectrum *spec = arg;
+
+    spectrum_lock(spec, 1);
+
+    if (line->spectrum_data_length > spec->size)
+    {
+        unsigned char *data = realloc(spec->data, line->spectrum_data_length);
+
+        if (data)
+        {
+            spec->data = data;
+            spec->size = line->spectrum_data_length;
+        }
+    }
+
+    if (line->spectrum_data_length <= spec->size)
+    {
+        if (line->spectrum_mode == RIG_SPECTRUM_MODE_CENTER
+                || line->high_edge_freq <= line->low_edge_freq)
+        {
+            spec->low = line->center_freq - line->span_freq / 2;
+            spec->high = line->center_freq + line->span_freq / 2;
+        }
+        else
+        {
+            spec->low = line->low_edge_freq;
+            spec->high = line->high_edge_freq;
+        }
+
+        spec->data_min = line->data_level_min;
+        spec->data_max = line->data_level_max;
+        spec->db_min = line->signal_strength_min;
+        spec->db_max = line->signal_strength_max;
+        spec->length = line->spectrum_data_length;
+        memcpy(spec->data, line->spectrum_data, spec->length);
+        spec->seq++;
+    }
+
+    spectrum_lock(spec, 0);
+
+    if (spec->user_cb) { return spec->user_cb(rig, line, spec->user_arg); }
+
+    return RIG_OK;
+}
+
+
+/*
+ * Peak of the last line over freq +/- width/2.  Returns 1 and the level
+ * in dB, or 0 when there is no line since seq or it doesn't cover freq.
+ */
+static int spectrum_peak(struct sw_scan_spectrum *spec, unsigned long seq,
+                         freq_t freq, pbwidth_t width, int *level)
+{
+    freq_t lo = freq - width / 2, hi = freq + width / 2;
+    int ret = 0;
+
+    spectrum_lock(spec, 1);
+
+    if (spec->seq > seq && spec->length > 0 && spec->high > spec->low
+            && lo >= spec->low && hi <= spec->high)
+    {
+        double bin = (spec->high - spec->low) / spec->length;
+        size_t i = (size_t)((lo - spec->low) / bin);
+        size_t last = (size_t)((hi - spec->low) / bin);
+        int peak = spec->data_min;
+
+        if (last >= spec->length) { last = spec->length - 1; }
+
+        for (; i <= last; i++)
+        {
+            if (spec->data[i] > peak) { peak = spec->data[i]; }
+        }
+
+        if (spec->data_max > spec->data_min)
+        {
+            *level = (int)lrint(spec->db_min + (peak - spec->data_min)
+                                * (spec->db_max - spec->db_min)
+                                / (spec->data_max - spec->data_min));
+        }
+        else
+        {
+            *level = (int)lrint(spec->db_min);
+        }
+
+        ret = 1;
+    }
+
+    spectrum_lock(spec, 0);
+
+    return ret;
+}
+
+
+static int sw_scan_tune(struct sw_scan_ctx *ctx, freq_t freq)
+{
+    int retcode;
+
+    retcode = rig_set_freq(ctx->rig, RIG_VFO_CURR, freq);
+
+    if (retcode != RIG_OK) { return retcode; }
+
+    ctx->tuned = freq;
+    elapsed_ms(&ctx->tuned_at, HAMLIB_ELAPSED_SET);
+    ctx->stats->tunes++;
+
+    if (ctx->spec)
+    {
+        spectrum_lock(ctx->spec, 1);
+        ctx->tuned_seq = ctx->spec->seq;
+        spectrum_lock(ctx->spec, 0);
+    }
+
+    return RIG_OK;
+}
+
+
+/* wait out what is left of the dwell time since the last tune */
+static void sw_scan_settle(struct sw_scan_ctx *ctx)
+{
+    double left = ctx->scan->dwell_ms - elapsed_ms(&ctx->tuned_at,
+                  HAMLIB_ELAPSED_GET);
+
+    if (left > 0) { hl_usleep((rig_useconds_t)(left * 1000)); }
+}
+
+
+/* returns 1 if active, 0 if quiet, or a negative error code */
+static int sw_scan_sample(struct sw_scan_ctx *ctx, freq_t freq, int *level)
+{
+    const struct rig_sw_scan *scan = ctx->scan;
+    value_t val;
+    dcd_t dcd;
+    int retcode, waited;
+
+    switch (scan->signal)
+    {
+    case RIG_SW_SCAN_DCD:
+        retcode = rig_get_dcd(ctx->rig, RIG_VFO_CURR, &dcd);
+
+        if (retcode != RIG_OK) { return retcode; }
+
+        *level = dcd == RIG_DCD_ON;
+        return *level;
+
+    case RIG_SW_SCAN_STRENGTH:
+        retcode = rig_get_level(ctx->rig, RIG_VFO_CURR, RIG_LEVEL_STRENGTH, &val);
+
+        if (retcode != RIG_OK) { return retcode; }
+
+        *level = val.i;
+        return *level >= scan->threshold;
+
+    case RIG_SW_SCAN_SPECTRUM:
+        /* a line from before the last tune may not show this channel yet */
+        for (waited = 0; !spectrum_peak(ctx->spec, ctx->tuned_seq, freq, scan->width,
+                                        level); waited += 10)
+        {
+            if (waited >= SW_SCAN_SPECTRUM_TIMEOUT_MS)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: no spectrum data covering %.0f Hz\n",
+                          __func__, freq);
+                return -RIG_ETIMEOUT;
+            }
+
+            hl_usleep(10 * 1000);
+        }
+
+        return *level >= scan->threshold;
+    }
+
+    return -RIG_EINVAL;
+}
+
+
+static int sw_scan_channel(struct sw_scan_ctx *ctx, freq_t freq, int *level)
+{
+    int retcode;
+
+    /* channels the current scope line already shows need no tuning */
+    if (ctx->spec == NULL || !spectrum_peak(ctx->spec, ctx->tuned_seq, freq,
+                                            ctx->scan->width, level))
+    {
+        if (ctx->tuned != freq)
+        {
+            retcode = sw_scan_tune(ctx, freq);
+
+            if (retcode != RIG_OK) { return retcode; }
+        }
+
+        sw_scan_settle(ctx);
+    }
+
+    ctx->stats->channels++;
+
+    return sw_scan_sample(ctx, freq, level);
+}
+
+
+/* stay on an active channel until it goes quiet or hold_ms runs out */
+static int sw_scan_hold(struct sw_scan_ctx *ctx, freq_t freq)
+{
+    const struct rig_sw_scan *scan = ctx->scan;
+    int interval = scan->dwell_ms > SW_SCAN_HOLD_MIN_MS ? scan->dwell_ms :
+                   SW_SCAN_HOLD_MIN_MS;
+    struct timespec hold_start;
+    int retcode, level;
+
+    if (ctx->tuned != freq)
+    {
+        retcode = sw_scan_tune(ctx, freq);
+
+        if (retcode != RIG_OK) { return retcode; }
+    }
+
+    elapsed_ms(&hold_start, HAMLIB_ELAPSED_SET);
+
+    do
+    {
+        if (scan->hold_ms > 0
+                && elapsed_ms(&hold_start, HAMLIB_ELAPSED_GET) >= scan->hold_ms)
+        {
+            break;
+        }
+
+        hl_usleep(interval * 1000);
+
+        if (ctx->spec)
+        {
+            /* only a line from after this point counts */
+            spectrum_lock(ctx->spec, 1);
+            ctx->tuned_seq = ctx->spec->seq;
+            spectrum_lock(ctx->spec, 0);
+        }
+
+        retcode = sw_scan_sample(ctx, freq, &level);
+    }
+    while (retcode == 1);
+
+    return retcode < 0 ? retcode : RIG_OK;
+}
+
+
+/**
+ * \brief scan channels in software
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param scan  The channels, activity criterion and timing
+ * \param cb    Called for each active channel, may be NULL
+ * \param arg   Passed to \a cb
+ * \param stats Counters for the scan, may be NULL
+ *
+ * Tunes \a vfo through the channels in \a scan and samples each one after
+ * \c dwell_ms with the criterion in \c signal.  On an active channel \a cb
+ * is called with the frequency and the sampled level (1 for DCD), then
+ * the scan stays there while it is active, up to \c hold_ms, and moves on.
+ * \a cb is also called with a frequency of 0 after each pass.  If \a cb
+ * returns non-zero the scan stops, leaving the rig on that channel.
+ *
+ * \a vfo is selected once and stays selected.  RIG_SW_SCAN_SPECTRUM needs
+ * the rig to be streaming spectrum data (async data and the scope on);
+ * the spectrum callback set with rig_set_spectrum_callback() keeps being
+ * called during the scan.
+ *
+ * \return RIG_OK if the scan completed or was stopped by \a cb, otherwise
+ * a negative value if an error occurred (in which case, cause is set
+ * appropriately).
+ *
+ * \sa rig_scan()
+ */
+int HAMLIB_API rig_sw_scan(RIG *rig, vfo_t vfo, const struct rig_sw_scan *scan,
+                           sw_scan_cb_t cb, rig_ptr_t arg,
+                           struct rig_sw_scan_stats *stats)
+{
+    struct rig_sw_scan_stats local_stats;
+    struct sw_scan_spectrum spec;
+    struct sw_scan_ctx ctx;
+    struct timespec start;
+    long nchan, i;
+    int pass, level, retcode = RIG_OK;
+
+    if (!rig || !rig->caps || !rig->state.comm_state)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: rig or rig->caps is null\n", __func__);
+        return -RIG_EINVAL;
+    }
+
+    ENTERFUNC;
+
+    if (scan == NULL
+            || (scan->freqs && scan->nfreqs <= 0)
+            || (!scan->freqs && (scan->step <= 0 || scan->stop < scan->start)))
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    if ((scan->signal == RIG_SW_SCAN_DCD
+            && rig->state.dcdport.type.dcd == RIG_DCD_NONE)
+            || (scan->signal == RIG_SW_SCAN_STRENGTH
+                && !rig_has_get_level(rig, RIG_LEVEL_STRENGTH)))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: rig can't sample the scan signal\n", __func__);
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    nchan = scan->freqs ? scan->nfreqs : (long)((scan->stop - scan->start)
+            / scan->step) + 1;
+
+    if (stats == NULL) { stats = &local_stats; }
+
+    memset(stats, 0, sizeof(*stats));
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.rig = rig;
+    ctx.scan = scan;
+    ctx.stats = stats;
+    elapsed_ms(&start, HAMLIB_ELAPSED_SET);
+
+    if (vfo != RIG_VFO_CURR && vfo != rig->state.current_vfo)
+    {
+        retcode = rig_set_vfo(rig, vfo);
+
+        if (retcode != RIG_OK) { RETURNFUNC(retcode); }
+    }
+
+    if (scan->mode != RIG_MODE_NONE)
+    {
+        retcode = rig_set_mode(rig, RIG_VFO_CURR, scan->mode, scan->width);
+
+        if (retcode != RIG_OK) { RETURNFUNC(retcode); }
+    }
+
+    if (scan->signal == RIG_SW_SCAN_SPECTRUM)
+    {
+        memset(&spec, 0, sizeof(spec));
+#ifdef HAVE_PTHREAD
+        pthread_mutex_init(&spec.lock, NULL);
+#endif
+        ctx.spec = &spec;
+        spectrum_cb_lock(rig, 1);
+        spec.user_cb = rig->callbacks.spectrum_event;
+        spec.user_arg = rig->callbacks.spectrum_arg;
+        rig_set_spectrum_callback(rig, sw_scan_spectrum_cb, &spec);
+        spectrum_cb_lock(rig, 0);
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: %ld channels, dwell %d ms\n", __func__,
+              nchan, scan->dwell_ms);
+
+    for (pass = 0; scan->passes == 0 || pass < scan->passes; pass++)
+    {
+        for (i = 0; i < nchan; i++)
+        {
+            freq_t freq = scan->freqs ? scan->freqs[i] : scan->start + i * scan->step;
+
+            retcode = sw_scan_channel(&ctx, freq, &level);
+
+            if (retcode < 0) { break; }
+
+            if (retcode == 0) { continue; }
+
+            stats->hits++;
+
+            rig_debug(RIG_DEBUG_VERBOSE, "%s: active %.0f Hz, level %d\n", __func__,
+                      freq, level);
+
+            if (cb && cb(rig, vfo, freq, level, arg))
+            {
+                if (ctx.tuned != freq) { sw_scan_tune(&ctx, freq); }
+
+                break;
+            }
+
+            retcode = sw_scan_hold(&ctx, freq);
+
+            if (retcode < 0) { break; }
+        }
+
+        if (retcode < 0 || i < nchan) { break; }
+
+        if (cb && cb(rig, vfo, 0, 0, arg)) { break; }
+    }
+
+    if (ctx.spec)
+    {
+        /* waits for a line the async reader is handing to spec */
+        rig_set_spectrum_callback(rig, spec.user_cb, spec.user_arg);
+#ifdef HAVE_PTHREAD
+        pthread_mutex_destroy(&spec.lock);
+#endif
+        free(spec.data);
+    }
+
+    stats->elapsed_ms = elapsed_ms(&start, HAMLIB_ELAPSED_GET);
+
+    rig_debug(RIG_DEBUG_VERBOSE,
+              "%s: %lu channels, %lu tunes, %lu hits in %.0f ms\n", __func__,
+              stats->channels, stats->tunes, stats->hits, stats->elapsed_ms);
+
+    RETURNFUNC(retcode < 0 ? retcode : RIG_OK);
+}
+
+/*! @} */
@@ -99,6 +99,20 @@
 #define TOK_TIMEOUT_RETRY       TOKEN_FRONTEND(39)
 #define TOK_POST_PTT_DELAY       TOKEN_FRONTEND(40)
 #define TOK_DEVICE_ID            TOKEN_FRONTEND(41)
+/** \brief  Record port traffic to this file */
+#define TOK_PORT_RECORD          TOKEN_FRONTEND(42)
+/** \brief  Serve the port from this recording instead of the rig */
+#define TOK_PORT_REPLAY          TOKEN_FRONTEND(43)
+/** \brief  Multiplier for recorded reply delays during replay */
+#define TOK_PORT_REPLAY_SCALE    TOKEN_FRONTEND(44)
+/** \brief  TCP keepalive idle time in seconds, 0 disables */
+#define TOK_TCP_KEEPALIVE        TOKEN_FRONTEND(45)
+/** \brief  TCP_USER_TIMEOUT in ms, 0 leaves the kernel default */
+#define TOK_TCP_USER_TIMEOUT     TOKEN_FRONTEND(46)
+/** \brief  Reconnect a lost network port */
+#define TOK_RECONNECT            TOKEN_FRONTEND(47)
+/** \brief  Drive the rig port through io_uring where available */
+#define TOK_IO_URING             TOKEN_FRONTEND(48)
 
 /*
  * rig specific tokens
@@ -141,6 +155,10 @@
 #define TOK_MULTICAST_CMD_ADDR  TOKEN_FRONTEND(134)
 /** \brief rig: Multicast command server UDP port, default 4532 */
 #define TOK_MULTICAST_CMD_PORT  TOKEN_FRONTEND(135)
+/** \brief rig: Drop intermediate set_freq targets while one is in flight, default 0 */
+#define TOK_FREQ_COALESCE  TOKEN_FRONTEND(136)
+/** \brief amp: ms between background status frame reads, default 0 */
+#define TOK_STATUS_REFRESH  TOKEN_FRONTEND(137)
 
 /*
  * rotator specific tokens
@@ -0,0 +1,346 @@
+/*
+ *  Hamlib Interface - conf/ext token index
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * rig_confparam_lookup(), rig_ext_lookup() and rig_ext_lookup_tok() used
+ * to strcmp their way through caps->cfgparams, the frontend conf tables
+ * and caps->extlevels/extfuncs/extparms on every call.  rig_init() now
+ * folds each group into:
+ *
+ *  - an open addressing hash table by name, at most half full, so a
+ *    lookup is one hash and usually one strcmp
+ *
+ *  - direct maps by token, one for frontend and one for backend tokens
+ *
+ * Entries go in in the order the scans tried them and the first one
+ * wins, so the answers are the same.
+ *
+ * The tables only depend on the caps, so instances of the same model
+ * share one index, counted by refs.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <hamlib/rig.h>
+#include "token.h"
+#include "tokindex.h"
+
+/* larger tokens are left to the scan */
+#define TOKINDEX_MAXTOK 1024
+
+struct tokindex_table
+{
+    unsigned mask;                      /* hash size - 1 */
+    const struct confparams **byname;
+    int nfront, nback;
+    const struct confparams **front;    /* by TOKEN_FRONTEND number */
+    const struct confparams **back;     /* by backend token */
+    int all_tokens;                     /* every token fit the maps */
+};
+
+struct tokindex
+{
+    const struct rig_caps *caps;
+    struct tokindex_table conf;
+    struct tokindex_table ext;
+    int refs;
+    struct tokindex *next;
+};
+
+static struct tokindex *tokindex_list;
+static pthread_mutex_t tokindex_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* FNV-1a */
+static unsigned name_hash(const char *name)
+{
+    unsigned h = 2166136261u;
+
+    while (*name)
+    {
+        h ^= (unsigned char) * name++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+
+/* counts the names, and raises nfront/nback to fit the tokens */
+static int count(const struct confparams *cfp, struct tokindex_table *t)
+{
+    const struct confparams *p;
+    int n = 0;
+
+    for (p = cfp; p && p->name; p++) { n++; }
+
+    for (p = cfp; p && p->token; p++)
+    {
+        long tok = IS_TOKEN_FRONTEND(p->token) ? p->token & ~(1L << 30) : p->token;
+        int *used = IS_TOKEN_FRONTEND(p->token) ? &t->nfront : &t->nback;
+
+        if (tok >= 0 && tok < TOKINDEX_MAXTOK && tok >= *used) { *used = tok + 1; }
+    }
+
+    return n;
+}
+
+
+/* maps sized by count(), which has to run first */
+static int table_alloc(struct tokindex_table *t, int n)
+{
+    unsigned size = 8;
+
+    while (size < 2 * (unsigned) n) { size <<= 1; }
+
+    t->mask = size - 1;
+    t->byname = calloc(size, sizeof(*t->byname));
+    t->front = calloc(t->nfront, sizeof(*t->front));
+    t->back = calloc(t->nback, sizeof(*t->back));
+    t->all_tokens = 1;
+
+    return t->byname && t->front && t->back ? RIG_OK : -RIG_ENOMEM;
+}
+
+
+static void table_free(struct tokindex_table *t)
+{
+    free(t->byname);
+    free(t->front);
+    free(t->back);
+}
+
+
+/*
+ * Names end the name table, tokens end the token table, as in the scans
+ * (rig_ext_lookup_tok stops at the first zero token).
+ */
+static void table_add(struct tokindex_table *t, const struct confparams *cfp)
+{
+    const struct confparams *p;
+
+    for (p = cfp; p && p->name; p++)
+    {
+        unsigned i = name_hash(p->name) & t->mask;
+
+        while (t->byname[i] && strcmp(t->byname[i]->name, p->name))
+        {
+            i = (i + 1) & t->mask;
+        }
+
+        if (!t->byname[i]) { t->byname[i] = p; }
+    }
+
+    for (p = cfp; p && p->token; p++)
+    {
+        long n = IS_TOKEN_FRONTEND(p->token) ? p->token & ~(1L << 30) : p->token;
+        const struct confparams **map = IS_TOKEN_FRONTEND(p->token) ? t->front :
+                                        t->back;
+
+        if (n < 0 || n >= TOKINDEX_MAXTOK)
+        {
+            t->all_tokens = 0;
+            continue;
+        }
+
+        if (!map[n]) { map[n] = p; }
+    }
+}
+
+
+static const struct confparams *table_name(const struct tokindex_table *t,
+        const char *name)
+{
+    unsigned i = name_hash(name) & t->mask;
+
+    while (t->byname[i])
+    {
+        if (!strcmp(t->byname[i]->name, name)) { return t->byname[i]; }
+
+        i = (i + 1) & t->mask;
+    }
+
+    return NULL;
+}
+
+
+/* 0 when the token is outside the maps and the caller has to scan */
+static int table_tok(const struct tokindex_table *t, token_t token,
+                     const struct confparams **cfp)
+{
+    long n = IS_TOKEN_FRONTEND(token) ? token & ~(1L << 30) : token;
+
+    if (n >= 0 && n < (IS_TOKEN_FRONTEND(token) ? t->nfront : t->nback))
+    {
+        *cfp = IS_TOKEN_FRONTEND(token) ? t->front[n] : t->back[n];
+        return 1;
+    }
+
+    *cfp = NULL;
+
+    return t->all_tokens;
+}
+
+
+static struct tokindex *get_index(RIG *rig)
+{
+    struct tokindex *ti = rig ? rig->state.tokindex_priv : NULL;
+
+    return ti && ti->caps == rig->caps ? ti : NULL;
+}
+
+
+static struct tokindex *index_new(const struct rig_caps *caps,
+                                  const struct confparams *frontend,
+                                  const struct confparams *frontend_serial)
+{
+    struct tokindex *ti;
+    int serial = caps->port_type == RIG_PORT_SERIAL;
+    int nconf, next;
+
+    ti = calloc(1, sizeof(*ti));
+
+    if (!ti) { return NULL; }
+
+    ti->caps = caps;
+    ti->conf.nfront = ti->conf.nback = 1;
+    ti->ext.nfront = ti->ext.nback = 1;
+
+    nconf = count(caps->cfgparams, &ti->conf) + count(frontend, &ti->conf)
+            + (serial ? count(frontend_serial, &ti->conf) : 0);
+    next = count(caps->extlevels, &ti->ext) + count(caps->extfuncs, &ti->ext)
+           + count(caps->extparms, &ti->ext);
+
+    if (table_alloc(&ti->conf, nconf) != RIG_OK
+            || table_alloc(&ti->ext, next) != RIG_OK)
+    {
+        table_free(&ti->conf);
+        table_free(&ti->ext);
+        free(ti);
+        return NULL;
+    }
+
+    table_add(&ti->conf, caps->cfgparams);
+    table_add(&ti->conf, frontend);
+
+    if (serial) { table_add(&ti->conf, frontend_serial); }
+
+    table_add(&ti->ext, caps->extlevels);
+    table_add(&ti->ext, caps->extfuncs);
+    table_add(&ti->ext, caps->extparms);
+
+    return ti;
+}
+
+
+int tokindex_build(RIG *rig, const struct confparams *frontend,
+                   const struct confparams *frontend_serial)
+{
+    struct tokindex *ti;
+
+    tokindex_free(rig);
+
+    pthread_mutex_lock(&tokindex_lock);
+
+    for (ti = tokindex_list; ti && ti->caps != rig->caps; ti = ti->next) { }
+
+    if (!ti && (ti = index_new(rig->caps, frontend, frontend_serial)) != NULL)
+    {
+        ti->next = tokindex_list;
+        tokindex_list = ti;
+    }
+
+    if (ti) { ti->refs++; }
+
+    pthread_mutex_unlock(&tokindex_lock);
+
+    rig->state.tokindex_priv = ti;
+
+    return ti ? RIG_OK : -RIG_ENOMEM;
+}
+
+
+void tokindex_free(RIG *rig)
+{
+    struct tokindex *ti = rig->state.tokindex_priv;
+    struct tokindex **pp;
+
+    if (!ti) { return; }
+
+    rig->state.tokindex_priv = NULL;
+
+    pthread_mutex_lock(&tokindex_lock);
+
+    if (--ti->refs == 0)
+    {
+        for (pp = &tokindex_list; *pp != ti; pp = &(*pp)->next) { }
+
+        *pp = ti->next;
+        table_free(&ti->conf);
+        table_free(&ti->ext);
+        free(ti);
+    }
+
+    pthread_mutex_unlock(&tokindex_lock);
+}
+
+
+int tokindex_conf(RIG *rig, const char *name, const struct confparams **cfp)
+{
+    const struct tokindex *ti = get_index(rig);
+
+    if (!ti) { return 0; }
+
+    *cfp = table_name(&ti->conf, name);
+
+    return 1;
+}
+
+
+int tokindex_conf_tok(RIG *rig, token_t token, const struct confparams **cfp)
+{
+    const struct tokindex *ti = get_index(rig);
+
+    return ti ? table_tok(&ti->conf, token, cfp) : 0;
+}
+
+
+int tokindex_ext(RIG *rig, const char *name, const struct confparams **cfp)
+{
+    const struct tokindex *ti = get_index(rig);
+
+    if (!ti) { return 0; }
+
+    *cfp = table_name(&ti->ext, name);
+
+    return 1;
+}
+
+
+int tokindex_ext_tok(RIG *rig, token_t token, const struct confparams **cfp)
+{
+    const struct tokindex *ti = get_index(rig);
+
+    return ti ? table_tok(&ti->ext, token, cfp) : 0;
+}
@@ -0,0 +1,48 @@
+/*
+ *  Hamlib Interface - conf/ext token index header
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _TOKINDEX_H
+#define _TOKINDEX_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/*
+ * Built by rig_init() from the caps conf/ext tables and the frontend conf
+ * tables, and shared by all the instances of a model.  Each lookup returns
+ * 0 when there is no index and the caller has to scan as before, otherwise
+ * 1 with *cfp set, NULL when not found.
+ */
+int tokindex_build(RIG *rig, const struct confparams *frontend,
+                   const struct confparams *frontend_serial);
+void tokindex_free(RIG *rig);
+
+/* in conf.c, calls tokindex_build with the frontend tables */
+int rig_conf_tokindex_build(RIG *rig);
+
+int tokindex_conf(RIG *rig, const char *name, const struct confparams **cfp);
+int tokindex_conf_tok(RIG *rig, token_t token, const struct confparams **cfp);
+int tokindex_ext(RIG *rig, const char *name, const struct confparams **cfp);
+int tokindex_ext_tok(RIG *rig, token_t token, const struct confparams **cfp);
+
+__END_DECLS
+
+#endif /* _TOKINDEX_H */
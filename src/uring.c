@@ -0,0 +1,627 @@
+/*
+ *  Hamlib Interface - io_uring port I/O
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \file uring.c
+ * \brief io_uring port I/O for Linux
+ *
+ * An optional replacement for the select() + read() pair the port layer
+ * makes for every chunk of a reply.  write_block() submits the command
+ * write linked to a read of the reply into a per-port buffer, bounded by
+ * a link timeout, with one io_uring_enter().  The reply usually lands
+ * while the caller is still busy, so the read_string()/read_block() that
+ * follows is served from the buffer without another system call.  When
+ * nothing is in flight a wait costs one io_uring_enter() for read and
+ * timeout together.  The buffer is registered with the kernel when the
+ * memlock limit allows, which saves page pinning on long spectrum frames.
+ *
+ * The ring is driven with raw system calls, so there is no liburing
+ * dependency.  Only ports attached with uring_port_attach() use it; when
+ * the kernel refuses the ring (too old, seccomp, containers) the port
+ * stays on the select() path.  Ports are tracked in a private list, as in
+ * portrec.c, and only the thread holding the rig lock drives a ring.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <hamlib/rig.h>
+#include "uring.h"
+
+#ifdef HAVE_IO_URING
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define URING_ENTRIES   8
+#define URING_BUFSIZE   4096
+
+/* user_data is the request kind plus a generation, see uring_port_flush() */
+#define UD_WRITE        1
+#define UD_READ         2
+#define UD_TIMEOUT      3
+#define UD_CANCEL       4
+#define UD(up, kind)    (((__u64)(up)->gen << 8) | (kind))
+
+struct uring_port
+{
+    struct uring_port *next;
+    hamlib_port_t *port;
+
+    int ring_fd;
+    void *ring;                 /* sq and cq rings, one mapping */
+    size_t ring_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned tail;              /* local sq tail, published on submit */
+
+    int fixed;                  /* buf is registered, use READ_FIXED */
+    unsigned gen;
+    unsigned writes;
+    unsigned read_for;          /* writes when the read in flight was queued */
+    int read_inflight;
+    int timed_out;
+    int eof;
+    int read_err;
+    int write_done;
+    int write_res;
+    struct __kernel_timespec ts;
+
+    size_t head, len;           /* unread part of buf */
+    unsigned char buf[URING_BUFSIZE];
+};
+
+static struct uring_port *uring_list;
+static pthread_mutex_t uring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void uring_port_flush_one(struct uring_port *up);
+
+
+/*
+ * Other rigs attach and detach concurrently, so the list is walked under
+ * uring_lock.  The entry itself stays valid for the thread driving p, only
+ * its port_close() frees it.
+ */
+static struct uring_port *uring_find(const hamlib_port_t *p)
+{
+    struct uring_port *up;
+
+    pthread_mutex_lock(&uring_lock);
+
+    for (up = uring_list; up != NULL; up = up->next)
+    {
+        if (up->port == p) { break; }
+    }
+
+    pthread_mutex_unlock(&uring_lock);
+
+    return up;
+}
+
+
+static int uring_enter(struct uring_port *up, unsigned to_submit,
+                       unsigned min_complete)
+{
+    int ret;
+
+    do
+    {
+        ret = syscall(__NR_io_uring_enter, up->ring_fd, to_submit, min_complete,
+                      min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    }
+    while (ret < 0 && errno == EINTR);
+
+    return ret;
+}
+
+
+static struct io_uring_sqe *uring_get_sqe(struct uring_port *up)
+{
+    unsigned idx = up->tail & *up->sq_mask;
+    struct io_uring_sqe *sqe = &up->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    up->sq_array[idx] = idx;
+    up->tail++;
+
+    return sqe;
+}
+
+
+static int uring_submit(struct uring_port *up, unsigned n, unsigned wait)
+{
+    __atomic_store_n(up->sq_tail, up->tail, __ATOMIC_RELEASE);
+    return uring_enter(up, n, wait);
+}
+
+
+/* collect finished requests, no system call */
+static void uring_reap(struct uring_port *up)
+{
+    unsigned head = *up->cq_head;
+
+    while (head != __atomic_load_n(up->cq_tail, __ATOMIC_ACQUIRE))
+    {
+        const struct io_uring_cqe *cqe = &up->cqes[head & *up->cq_mask];
+        int kind = cqe->user_data & 0xff;
+        int current = (unsigned)(cqe->user_data >> 8) == up->gen;
+
+        if (kind == UD_READ)
+        {
+            /* a read from before a flush still releases the buffer */
+            up->read_inflight = 0;
+
+            if (!current) { }
+            else if (cqe->res > 0)
+            {
+                up->head = 0;
+                up->len = cqe->res;
+            }
+            else if (cqe->res == 0)
+            {
+                up->eof = 1;
+            }
+            else if (cqe->res == -ECANCELED)
+            {
+                up->timed_out = 1;
+            }
+            else
+            {
+                up->read_err = -cqe->res;
+            }
+        }
+        else if (kind == UD_WRITE && current)
+        {
+            up->write_done = 1;
+            up->write_res = cqe->res;
+        }
+
+        head++;
+    }
+
+    __atomic_store_n(up->cq_head, head, __ATOMIC_RELEASE);
+}
+
+
+static void uring_wait_read(struct uring_port *up)
+{
+    uring_reap(up);
+
+    while (up->read_inflight)
+    {
+        if (uring_enter(up, 0, 1) < 0) { break; }
+
+        uring_reap(up);
+    }
+}
+
+
+/* queue a read of the reply into buf, bounded by the port timeout */
+static unsigned uring_queue_read(struct uring_port *up)
+{
+    struct io_uring_sqe *sqe;
+    int timeout = up->port->timeout;
+
+    up->ts.tv_sec = timeout / 1000;
+    up->ts.tv_nsec = (long long)(timeout % 1000) * 1000000;
+
+    sqe = uring_get_sqe(up);
+    sqe->opcode = up->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = up->port->fd;
+    sqe->addr = (unsigned long) up->buf;
+    sqe->len = URING_BUFSIZE;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = UD(up, UD_READ);
+
+    sqe = uring_get_sqe(up);
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->addr = (unsigned long) &up->ts;
+    sqe->len = 1;
+    sqe->user_data = UD(up, UD_TIMEOUT);
+
+    up->read_inflight = 1;
+    up->read_for = up->writes;
+    up->timed_out = 0;
+    up->read_err = 0;
+
+    return 2;
+}
+
+
+static void uring_free(struct uring_port *up)
+{
+    if (up->sqes) { munmap(up->sqes, up->sqes_len); }
+
+    if (up->ring) { munmap(up->ring, up->ring_len); }
+
+    if (up->ring_fd >= 0) { close(up->ring_fd); }
+
+    free(up);
+}
+
+
+/**
+ * \brief Move a port's reads and writes onto an io_uring
+ *
+ * \return RIG_OK, or a negative error when the port stays on select()
+ */
+int uring_port_attach(hamlib_port_t *p)
+{
+    struct uring_port *up;
+    struct io_uring_params params;
+    struct iovec iov;
+    size_t cq_len;
+    char *ring;
+
+    if (p->fd < 0 || p->asyncio)
+    {
+        return -RIG_EINVAL;
+    }
+
+    switch (p->type.rig)
+    {
+    case RIG_PORT_SERIAL:
+    case RIG_PORT_NETWORK:
+    case RIG_PORT_DEVICE:
+        break;
+
+    default:
+        return -RIG_ENIMPL;
+    }
+
+    up = calloc(1, sizeof(*up));
+
+    if (up == NULL) { return -RIG_ENOMEM; }
+
+    up->port = p;
+    memset(&params, 0, sizeof(params));
+    up->ring_fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+
+    if (up->ring_fd < 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: io_uring_setup: %s, using select()\n",
+                  __func__, strerror(errno));
+        free(up);
+        return -RIG_ENIMPL;
+    }
+
+    /* without fast poll, reads of O_NONBLOCK ports would just fail EAGAIN */
+    if (!(params.features & IORING_FEAT_FAST_POLL)
+            || !(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: kernel io_uring too old, using select()\n",
+                  __func__);
+        uring_free(up);
+        return -RIG_ENIMPL;
+    }
+
+    up->ring_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (cq_len > up->ring_len) { up->ring_len = cq_len; }
+
+    ring = mmap(NULL, up->ring_len, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, up->ring_fd, IORING_OFF_SQ_RING);
+
+    if (ring == MAP_FAILED)
+    {
+        uring_free(up);
+        return -RIG_EIO;
+    }
+
+    up->ring = ring;
+    up->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    up->sqes = mmap(NULL, up->sqes_len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, up->ring_fd, IORING_OFF_SQES);
+
+    if (up->sqes == MAP_FAILED)
+    {
+        up->sqes = NULL;
+        uring_free(up);
+        return -RIG_EIO;
+    }
+
+    up->sq_tail = (unsigned *)(ring + params.sq_off.tail);
+    up->sq_mask = (unsigned *)(ring + params.sq_off.ring_mask);
+    up->sq_array = (unsigned *)(ring + params.sq_off.array);
+    up->cq_head = (unsigned *)(ring + params.cq_off.head);
+    up->cq_tail = (unsigned *)(ring + params.cq_off.tail);
+    up->cq_mask = (unsigned *)(ring + params.cq_off.ring_mask);
+    up->cqes = (struct io_uring_cqe *)(ring + params.cq_off.cqes);
+    up->tail = *up->sq_tail;
+
+    iov.iov_base = up->buf;
+    iov.iov_len = URING_BUFSIZE;
+    up->fixed = syscall(__NR_io_uring_register, up->ring_fd,
+                        IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+
+    pthread_mutex_lock(&uring_lock);
+    up->next = uring_list;
+    uring_list = up;
+    pthread_mutex_unlock(&uring_lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: %s on io_uring%s\n", __func__, p->pathname,
+              up->fixed ? ", registered buffer" : "");
+
+    return RIG_OK;
+}
+
+
+/**
+ * \brief Give a port back to select(), called by port_close()
+ */
+void uring_port_detach(hamlib_port_t *p)
+{
+    struct uring_port **pup, *up = NULL;
+
+    pthread_mutex_lock(&uring_lock);
+
+    for (pup = &uring_list; *pup != NULL; pup = &(*pup)->next)
+    {
+        if ((*pup)->port == p)
+        {
+            up = *pup;
+            *pup = up->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&uring_lock);
+
+    if (up == NULL) { return; }
+
+    uring_port_flush_one(up);
+    uring_free(up);
+}
+
+
+int uring_port_active(const hamlib_port_t *p)
+{
+    return uring_find(p) != NULL;
+}
+
+
+/**
+ * \brief Write a command, with a read of the reply linked behind it
+ *
+ * \return bytes written, or -1 with errno set like write()
+ */
+ssize_t uring_port_write(hamlib_port_t *p, const void *buf, size_t count)
+{
+    struct uring_port *up = uring_find(p);
+    struct io_uring_sqe *sqe;
+    unsigned n = 1;
+    int link;
+
+    uring_reap(up);
+
+    /* byte-paced writes would eat into the reply timeout */
+    link = !up->read_inflight && up->len == 0 && !up->eof && p->write_delay == 0;
+
+    sqe = uring_get_sqe(up);
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = p->fd;
+    sqe->addr = (unsigned long) buf;
+    sqe->len = count;
+    sqe->flags = link ? IOSQE_IO_LINK : 0;
+    sqe->user_data = UD(up, UD_WRITE);
+    up->write_done = 0;
+    up->writes++;
+
+    if (link) { n += uring_queue_read(up); }
+
+    if (uring_submit(up, n, 1) < 0) { return -1; }
+
+    for (;;)
+    {
+        uring_reap(up);
+
+        if (up->write_done) { break; }
+
+        if (uring_enter(up, 0, 1) < 0) { return -1; }
+    }
+
+    if (up->write_res < 0)
+    {
+        errno = -up->write_res;
+        return -1;
+    }
+
+    /* a short write broke the link, the read was never a timeout */
+    if (up->write_res != count) { up->timed_out = 0; }
+
+    return up->write_res;
+}
+
+
+/**
+ * \brief Wait for reply data, the io_uring counterpart of select()
+ */
+int uring_port_wait(hamlib_port_t *p)
+{
+    struct uring_port *up = uring_find(p);
+
+    uring_reap(up);
+
+    /* a zero timeout is a poll, as from serial_flush(), not worth a ring trip */
+    if (p->timeout <= 0 && up->len == 0 && !up->eof && !up->read_inflight)
+    {
+        struct pollfd pfd = { p->fd, POLLIN, 0 };
+
+        return poll(&pfd, 1, 0) > 0 ? RIG_OK : -RIG_ETIMEOUT;
+    }
+
+    if (up->len == 0 && !up->eof && !up->read_inflight)
+    {
+        if (uring_submit(up, uring_queue_read(up), 0) < 0)
+        {
+            up->read_inflight = 0;
+            return -RIG_EIO;
+        }
+    }
+
+    for (;;)
+    {
+        if (up->len == 0 && !up->eof)
+        {
+            uring_wait_read(up);
+        }
+
+        if (up->len > 0 || up->eof) { return RIG_OK; }
+
+        if (!up->timed_out) { break; }
+
+        up->timed_out = 0;
+
+        /* that read was timing a command sent before the last one */
+        if (up->read_for == up->writes) { return -RIG_ETIMEOUT; }
+
+        if (uring_submit(up, uring_queue_read(up), 0) < 0)
+        {
+            up->read_inflight = 0;
+            return -RIG_EIO;
+        }
+    }
+
+    if (up->read_err == EAGAIN)
+    {
+        /* let the caller's read() retry */
+        up->read_err = 0;
+        return RIG_OK;
+    }
+
+    rig_debug(RIG_DEBUG_ERR, "%s: read error: %s\n", __func__,
+              strerror(up->read_err));
+    errno = up->read_err;
+    up->read_err = 0;
+
+    return -RIG_EIO;
+}
+
+
+/**
+ * \brief Read what uring_port_wait() found, read() semantics
+ */
+ssize_t uring_port_read(hamlib_port_t *p, void *buf, size_t count)
+{
+    struct uring_port *up = uring_find(p);
+
+    uring_reap(up);
+
+    if (up->len > 0)
+    {
+        size_t n = count < up->len ? count : up->len;
+
+        memcpy(buf, up->buf + up->head, n);
+        up->head += n;
+        up->len -= n;
+        return n;
+    }
+
+    if (up->eof)
+    {
+        up->eof = 0;
+        return 0;
+    }
+
+    /* a second reader would reorder data around the one in flight */
+    if (up->read_inflight)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    return read(p->fd, buf, count);
+}
+
+
+static void uring_port_flush_one(struct uring_port *up)
+{
+    if (up->read_inflight)
+    {
+        struct io_uring_sqe *sqe = uring_get_sqe(up);
+
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = UD(up, UD_READ);
+        sqe->user_data = UD(up, UD_CANCEL);
+        uring_submit(up, 1, 0);
+    }
+
+    /* whatever the cancelled read returns belongs to the old generation */
+    up->gen++;
+    uring_wait_read(up);
+    up->head = up->len = 0;
+    up->eof = up->timed_out = up->read_err = 0;
+}
+
+
+/**
+ * \brief Drop buffered reply data and any read in flight, for rig_flush()
+ */
+void uring_port_flush(hamlib_port_t *p)
+{
+    struct uring_port *up;
+
+    if ((up = uring_find(p)) == NULL) { return; }
+
+    uring_port_flush_one(up);
+}
+
+#else /* !HAVE_IO_URING */
+
+int uring_port_attach(hamlib_port_t *p)
+{
+    rig_debug(RIG_DEBUG_WARN, "%s: built without io_uring, using select()\n",
+              __func__);
+    return -RIG_ENIMPL;
+}
+
+void uring_port_detach(hamlib_port_t *p) { }
+
+int uring_port_active(const hamlib_port_t *p) { return 0; }
+
+ssize_t uring_port_write(hamlib_port_t *p, const void *buf, size_t count)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+int uring_port_wait(hamlib_port_t *p) { return -RIG_ENIMPL; }
+
+ssize_t uring_port_read(hamlib_port_t *p, void *buf, size_t count)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+void uring_port_flush(hamlib_port_t *p) { }
+
+#endif /* HAVE_IO_URING */
@@ -0,0 +1,40 @@
+/*
+ *  Hamlib Interface - io_uring port I/O
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _URING_H
+#define _URING_H 1
+
+#include <sys/types.h>
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/* Hamlib internal use, see iofunc.c */
+int uring_port_attach(hamlib_port_t *p);
+void uring_port_detach(hamlib_port_t *p);
+int uring_port_active(const hamlib_port_t *p);
+ssize_t uring_port_write(hamlib_port_t *p, const void *buf, size_t count);
+int uring_port_wait(hamlib_port_t *p);
+ssize_t uring_port_read(hamlib_port_t *p, void *buf, size_t count);
+void uring_port_flush(hamlib_port_t *p);
+
+__END_DECLS
+
+#endif /* _URING_H */
@@ -0,0 +1,332 @@
+/*
+ *  Hamlib Interface - VFO operation planner
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Applies frequency/mode changes for several VFOs with as few backend
+ * transactions and VFO swaps as the backend allows.
+ *
+ * Each change is sent the cheapest way available:
+ *
+ *  1. on the current VFO, directly
+ *  2. on another VFO the backend can address, i.e. RIG_TARGETABLE_FREQ or
+ *     RIG_TARGETABLE_MODE (FA/FB, Icom 0x25/0x26 and the like), directly
+ *  3. on the split TX VFO through the backend's set_split_freq or
+ *     set_split_mode, which use the rig's TX commands where it has them
+ *  4. otherwise grouped per VFO: one swap to the VFO, all of its changes,
+ *     and a single swap back to the original VFO at the very end
+ *
+ * Changes already in the cache are dropped.  rig_set_split_freq followed
+ * by rig_set_split_mode costs up to 8 transactions on a rig without
+ * targetable VFOs, the plan does the same in 4.
+ */
+
+#include <hamlib/config.h>
+
+#include <string.h>
+
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "cache.h"
+#include "vfoplan.h"
+
+struct plan_op
+{
+    vfo_t vfo;
+    int tx;             /* is the split TX VFO */
+    freq_t freq;        /* 0 for none */
+    rmode_t mode;       /* RIG_MODE_NONE for none */
+    pbwidth_t width;
+};
+
+
+static vfo_t plan_vfo(RIG *rig, vfo_t vfo, int *tx)
+{
+    const struct rig_state *rs = &rig->state;
+
+    /* as rig_set_split_freq does, split or not */
+    if (vfo == RIG_VFO_TX && rs->tx_vfo != RIG_VFO_NONE
+            && rs->tx_vfo != RIG_VFO_CURR)
+    {
+        vfo = rs->tx_vfo;
+    }
+    else if (vfo == RIG_VFO_CURR)
+    {
+        vfo = rs->current_vfo;
+    }
+    else
+    {
+        vfo = vfo_fixup(rig, vfo, rs->cache.split);
+    }
+
+    *tx = rs->cache.split && vfo == rs->tx_vfo;
+
+    return vfo;
+}
+
+
+/* merge the settings per VFO, later ones win, and drop what is cached */
+static int plan_ops(RIG *rig, const rig_vfo_setting_t *settings, int count,
+                    struct plan_op *ops)
+{
+    const struct rig_state *rs = &rig->state;
+    int i, j, nops = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        int tx;
+        vfo_t vfo = plan_vfo(rig, settings[i].vfo, &tx);
+
+        for (j = 0; j < nops && ops[j].vfo != vfo; j++) { }
+
+        if (j == nops)
+        {
+            if (nops == VFO_PLAN_MAX) { return -RIG_EINVAL; }
+
+            memset(&ops[nops], 0, sizeof(ops[nops]));
+            ops[nops].vfo = vfo;
+            ops[nops].tx = tx;
+            nops++;
+        }
+
+        if (settings[i].freq != 0) { ops[j].freq = settings[i].freq; }
+
+        if (settings[i].mode != RIG_MODE_NONE)
+        {
+            ops[j].mode = settings[i].mode;
+            ops[j].width = settings[i].width;
+        }
+    }
+
+    for (i = 0; i < nops; i++)
+    {
+        freq_t freq;
+        rmode_t mode;
+        pbwidth_t width;
+        int ms_freq, ms_mode, ms_width;
+
+        // do not mess with the TX mode while PTT is on, as rig_set_split_mode
+        if (ops[i].tx && rs->cache.ptt) { ops[i].mode = RIG_MODE_NONE; }
+
+        if (rig_get_cache(rig, ops[i].vfo, &freq, &ms_freq, &mode, &ms_mode, &width,
+                          &ms_width) != RIG_OK)
+        {
+            continue;
+        }
+
+        if (ops[i].freq == freq && ms_freq < rs->cache.timeout_ms)
+        {
+            ops[i].freq = 0;
+        }
+
+        if (ops[i].mode == mode && ms_mode < rs->cache.timeout_ms
+                && (ops[i].width == RIG_PASSBAND_NOCHANGE || ops[i].width == width))
+        {
+            ops[i].mode = RIG_MODE_NONE;
+        }
+    }
+
+    return nops;
+}
+
+
+static int plan_freq(RIG *rig, vfo_t target, vfo_t vfo, freq_t freq, int split,
+                     unsigned long *transactions)
+{
+    int retcode;
+
+    HAMLIB_TRACE;
+    retcode = split ? rig->caps->set_split_freq(rig, target, freq)
+              : rig->caps->set_freq(rig, target, freq);
+    (*transactions)++;
+
+    if (retcode == RIG_OK) { rig_set_cache_freq(rig, vfo, freq); }
+
+    return retcode;
+}
+
+
+static int plan_mode(RIG *rig, vfo_t target, vfo_t vfo, rmode_t mode,
+                     pbwidth_t width, int split, unsigned long *transactions)
+{
+    int retcode;
+
+    HAMLIB_TRACE;
+    retcode = split ? rig->caps->set_split_mode(rig, target, mode, width)
+              : rig->caps->set_mode(rig, target, mode, width);
+    (*transactions)++;
+
+    if (retcode == RIG_OK) { rig_set_cache_mode(rig, vfo, mode, width); }
+
+    return retcode;
+}
+
+
+static int plan_swap(RIG *rig, vfo_t vfo, unsigned long *transactions,
+                     unsigned long *swaps)
+{
+    const struct rig_caps *caps = rig->caps;
+    struct rig_state *rs = &rig->state;
+    int retcode;
+
+    (*transactions)++;
+    (*swaps)++;
+
+    HAMLIB_TRACE;
+
+    if (caps->set_vfo) { retcode = caps->set_vfo(rig, vfo); }
+    else { retcode = caps->vfo_op(rig, RIG_VFO_CURR, RIG_OP_TOGGLE); }
+
+    /* as rig_set_vfo does, the later plan steps go by current_vfo */
+    if (retcode == RIG_OK)
+    {
+        rs->current_vfo = vfo;
+        rs->cache.vfo = vfo;
+        elapsed_ms(&rs->cache.time_vfo, HAMLIB_ELAPSED_SET);
+    }
+
+    return retcode;
+}
+
+
+int vfo_plan_run(RIG *rig, const rig_vfo_setting_t *settings, int count)
+{
+    struct rig_state *rs = &rig->state;
+    const struct rig_caps *caps = rig->caps;
+    struct plan_op ops[VFO_PLAN_MAX];
+    unsigned long transactions = 0, swaps = 0;
+    vfo_t curr_vfo = rs->current_vfo;
+    vfo_t at_vfo = curr_vfo;
+    int can_swap = caps->set_vfo != NULL
+                   || (rig_has_vfo_op(rig, RIG_OP_TOGGLE) && caps->vfo_op);
+    int retcode = RIG_OK, rc;
+    int nops, i;
+
+    nops = plan_ops(rig, settings, count, ops);
+
+    if (nops < 0) { return nops; }
+
+    /* the direct ones first */
+    for (i = 0; i < nops; i++)
+    {
+        struct plan_op *op = &ops[i];
+        int current = op->vfo == curr_vfo;
+
+        if (op->freq != 0 && caps->set_freq
+                && (current || (caps->targetable_vfo & RIG_TARGETABLE_FREQ)))
+        {
+            rc = plan_freq(rig, current ? RIG_VFO_CURR : op->vfo, op->vfo, op->freq, 0,
+                           &transactions);
+            op->freq = 0;
+
+            if (retcode == RIG_OK) { retcode = rc; }
+        }
+        else if (op->freq != 0 && op->tx && caps->set_split_freq)
+        {
+            rc = plan_freq(rig, RIG_VFO_CURR, op->vfo, op->freq, 1, &transactions);
+            op->freq = 0;
+
+            if (retcode == RIG_OK) { retcode = rc; }
+        }
+
+        if (op->mode != RIG_MODE_NONE && caps->set_mode
+                && (current || (caps->targetable_vfo & RIG_TARGETABLE_MODE)))
+        {
+            rc = plan_mode(rig, current ? RIG_VFO_CURR : op->vfo, op->vfo, op->mode,
+                           op->width, 0, &transactions);
+            op->mode = RIG_MODE_NONE;
+
+            if (retcode == RIG_OK) { retcode = rc; }
+        }
+        else if (op->mode != RIG_MODE_NONE && op->tx && caps->set_split_mode)
+        {
+            rc = plan_mode(rig, RIG_VFO_CURR, op->vfo, op->mode, op->width, 1,
+                           &transactions);
+            op->mode = RIG_MODE_NONE;
+
+            if (retcode == RIG_OK) { retcode = rc; }
+        }
+    }
+
+    /* then one swap per VFO that is left */
+    for (i = 0; i < nops; i++)
+    {
+        struct plan_op *op = &ops[i];
+
+        if (op->freq == 0 && op->mode == RIG_MODE_NONE) { continue; }
+
+        if (!can_swap)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: can't reach %s without set_vfo\n", __func__,
+                      rig_strvfo(op->vfo));
+            retcode = -RIG_ENAVAIL;
+            continue;
+        }
+
+        if (rs->cache.ptt)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: PTT on, not swapping to %s\n", __func__,
+                      rig_strvfo(op->vfo));
+            continue;
+        }
+
+        rc = plan_swap(rig, op->vfo, &transactions, &swaps);
+
+        if (rc != RIG_OK)
+        {
+            if (retcode == RIG_OK) { retcode = rc; }
+
+            continue;
+        }
+
+        at_vfo = op->vfo;
+
+        if (op->freq != 0 && caps->set_freq)
+        {
+            rc = plan_freq(rig, RIG_VFO_CURR, op->vfo, op->freq, 0, &transactions);
+
+            if (retcode == RIG_OK) { retcode = rc; }
+        }
+
+        if (op->mode != RIG_MODE_NONE && caps->set_mode)
+        {
+            rc = plan_mode(rig, RIG_VFO_CURR, op->vfo, op->mode, op->width, 0,
+                           &transactions);
+
+            if (retcode == RIG_OK) { retcode = rc; }
+        }
+    }
+
+    /* try and revert even if we had an error above */
+    if (at_vfo != curr_vfo)
+    {
+        rc = plan_swap(rig, curr_vfo, &transactions, &swaps);
+
+        if (retcode == RIG_OK) { retcode = rc; }
+    }
+
+    rs->vfo_plan_stats.plans++;
+    rs->vfo_plan_stats.transactions += transactions;
+    rs->vfo_plan_stats.vfo_swaps += swaps;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: %d VFO(s), %lu transaction(s), %lu swap(s)\n",
+              __func__, nops, transactions, swaps);
+
+    return retcode;
+}
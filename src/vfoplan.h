@@ -0,0 +1,36 @@
+/*
+ *  Hamlib Interface - VFO operation planner header
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _VFOPLAN_H
+#define _VFOPLAN_H 1
+
+#include <hamlib/rig.h>
+
+__BEGIN_DECLS
+
+/* most VFOs one plan can touch */
+#define VFO_PLAN_MAX 8
+
+/* Hamlib internal use, see rig_set_vfo_settings() */
+int vfo_plan_run(RIG *rig, const rig_vfo_setting_t *settings, int count);
+
+__END_DECLS
+
+#endif /* _VFOPLAN_H */
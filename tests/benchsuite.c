@@ -0,0 +1,794 @@
+/*
+ * Hamlib benchsuite program
+ *
+ * Microbenchmarks for the library hot paths, run by "make bench".
+ * Results are written as JSON and can be compared against a previous
+ * run to catch performance regressions:
+ *
+ *   ./benchsuite -o new.json -b old.json -t 10
+ *
+ * exits with status 1 if any benchmark got more than 10% slower.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <getopt.h>
+#include <termios.h>
+#include <pthread.h>
+
+#include <hamlib/rig.h>
+#include <hamlib/riglist.h>
+#include <hamlib/rotator.h>
+#include "misc.h"
+#include "iofunc.h"
+#include "network.h"
+#include "snapshot_data.h"
+#include "rigctl_parse.h"
+#include "capindex.h"
+#include "tokindex.h"
+#include "uring.h"
+
+#define MAXBENCH 32
+
+struct bench
+{
+    const char *name;
+    int (*run)(long n);
+};
+
+struct result
+{
+    char name[64];
+    long iterations;
+    double ns_per_op;
+};
+
+static RIG *rig;
+static RIG *caps_rig, *scan_rig;
+static RIG *tok_rig, *tok_scan_rig;
+static int pty_master = -1;
+static hamlib_port_t pty_port;
+static hamlib_port_t txn_port, txn_uring_port, uring_port;
+static int uring_master = -1;
+static FILE *parse_in, *parse_out;
+
+static struct result baseline[MAXBENCH];
+static int nbaseline;
+
+
+static int bench_get_freq(long n)
+{
+    freq_t freq;
+
+    while (n--)
+    {
+        int ret = rig_get_freq(rig, RIG_VFO_CURR, &freq);
+
+        if (ret != RIG_OK) { return ret; }
+    }
+
+    return RIG_OK;
+}
+
+
+static int bench_get_mode(long n)
+{
+    rmode_t mode;
+    pbwidth_t width;
+
+    while (n--)
+    {
+        int ret = rig_get_mode(rig, RIG_VFO_CURR, &mode, &width);
+
+        if (ret != RIG_OK) { return ret; }
+    }
+
+    return RIG_OK;
+}
+
+
+static int bench_set_freq(long n)
+{
+    while (n--)
+    {
+        int ret = rig_set_freq(rig, RIG_VFO_CURR, (n & 1) ? 14074000 : 14075000);
+
+        if (ret != RIG_OK) { return ret; }
+    }
+
+    return RIG_OK;
+}
+
+
+static int bench_read_string(long n)
+{
+    static const char reply[] = "FA00014074000;";
+    unsigned char buf[64];
+
+    while (n--)
+    {
+        int ret;
+
+        if (write(pty_master, reply, sizeof(reply) - 1) != sizeof(reply) - 1)
+        {
+            return -RIG_EIO;
+        }
+
+        ret = read_string(&pty_port, buf, sizeof(buf), ";", 1, 0, 1);
+
+        if (ret != sizeof(reply) - 1) { return ret < 0 ? ret : -RIG_EPROTO; }
+    }
+
+    return RIG_OK;
+}
+
+
+static int bench_read_block(long n)
+{
+    static const unsigned char frame[] =
+    {
+        0xfe, 0xfe, 0xe0, 0x94, 0x03, 0x00, 0x40, 0x07, 0x14, 0x00, 0xfd
+    };
+    unsigned char buf[sizeof(frame)];
+
+    while (n--)
+    {
+        int ret;
+
+        if (write(pty_master, frame, sizeof(frame)) != sizeof(frame))
+        {
+            return -RIG_EIO;
+        }
+
+        ret = read_block(&pty_port, buf, sizeof(frame));
+
+        if (ret != sizeof(frame)) { return ret < 0 ? ret : -RIG_EPROTO; }
+    }
+
+    return RIG_OK;
+}
+
+
+/* reads from a pty already holding the reply, over io_uring */
+static int bench_read_string_uring(long n)
+{
+    static const char reply[] = "FA00014074000;";
+    unsigned char buf[64];
+
+    if (!uring_port_active(&uring_port)) { return -RIG_ENIMPL; }
+
+    while (n--)
+    {
+        int ret;
+
+        if (write(uring_master, reply, sizeof(reply) - 1) != sizeof(reply) - 1)
+        {
+            return -RIG_EIO;
+        }
+
+        ret = read_string(&uring_port, buf, sizeof(buf), ";", 1, 0, 1);
+
+        if (ret != sizeof(reply) - 1) { return ret < 0 ? ret : -RIG_EPROTO; }
+    }
+
+    return RIG_OK;
+}
+
+
+/* command and reply round trip against a responder thread on the pty */
+static int transaction(hamlib_port_t *port, long n)
+{
+    static const unsigned char cmd[] = "FA;";
+    unsigned char buf[64];
+
+    while (n--)
+    {
+        int ret = write_block(port, cmd, sizeof(cmd) - 1);
+
+        if (ret != RIG_OK) { return ret; }
+
+        ret = read_string(port, buf, sizeof(buf), ";", 1, 0, 1);
+
+        if (ret != 14) { return ret < 0 ? ret : -RIG_EPROTO; }
+    }
+
+    return RIG_OK;
+}
+
+
+static int bench_transaction(long n)
+{
+    return transaction(&txn_port, n);
+}
+
+
+static int bench_transaction_uring(long n)
+{
+    if (!uring_port_active(&txn_uring_port)) { return -RIG_ENIMPL; }
+
+    return transaction(&txn_uring_port, n);
+}
+
+
+static int bench_rigctl_parse(long n)
+{
+    int vfo_mode = 0;
+    int ext_resp = 0;
+    char resp_sep = '\n';
+
+    while (n--)
+    {
+        int ret;
+
+        if (feof(parse_in)) { rewind(parse_in); }
+
+        ret = rigctl_parse(rig, parse_in, parse_out, NULL, 0, NULL, 1, 0,
+                           &vfo_mode, '\n', &ext_resp, &resp_sep, 0);
+
+        if (ret < 0 && !feof(parse_in)) { return ret; }
+    }
+
+    return RIG_OK;
+}
+
+
+static int bench_snapshot(long n)
+{
+    char buf[16384];
+
+    while (n--)
+    {
+        int ret = snapshot_serialize(sizeof(buf), buf, rig, NULL);
+
+        if (ret != RIG_OK) { return ret; }
+    }
+
+    return RIG_OK;
+}
+
+
+static int bench_multicast(long n)
+{
+    while (n--)
+    {
+        int ret = network_publish_rig_poll_data(rig);
+
+        if (ret != RIG_OK) { return ret; }
+    }
+
+    return RIG_OK;
+}
+
+
+static int bench_bcd(long n)
+{
+    unsigned char bcd[5];
+    unsigned long long sum = 0;
+
+    while (n--)
+    {
+        to_bcd(bcd, 14074000ULL + (n & 0xff), 10);
+        sum += from_bcd(bcd, 10);
+    }
+
+    return sum ? RIG_OK : -RIG_EINTERNAL;
+}
+
+
+static int bench_locator(long n)
+{
+    double lon1, lat1, lon2, lat2, dist, az;
+
+    while (n--)
+    {
+        if (locator2longlat(&lon1, &lat1, "EM79UT96LW") != RIG_OK
+                || locator2longlat(&lon2, &lat2, "JO91NO") != RIG_OK
+                || qrb(lon1, lat1, lon2, lat2, &dist, &az) != RIG_OK)
+        {
+            return -RIG_EINTERNAL;
+        }
+    }
+
+    return RIG_OK;
+}
+
+
+static int bench_get_caps(long n)
+{
+    static const rig_model_t models[] =
+    {
+        RIG_MODEL_DUMMY, RIG_MODEL_IC7300, RIG_MODEL_TS2000,
+        RIG_MODEL_FT991, RIG_MODEL_K3, RIG_MODEL_FLRIG
+    };
+    int nmodels = sizeof(models) / sizeof(models[0]);
+
+    while (n--)
+    {
+        if (rig_get_caps(models[n % nmodels]) == NULL)
+        {
+            return -RIG_ENIMPL;
+        }
+    }
+
+    return RIG_OK;
+}
+
+
+/*
+ * The caps lookups rig_set_mode/rig_set_freq callers make: passband for
+ * the mode, tuning resolution, tx power range and band.  Same TS-2000
+ * caps (no backend power2mW) with and without the index rig_open builds.
+ */
+static int caps_lookup(RIG *r, long n)
+{
+    static const rmode_t modes[] =
+    {
+        RIG_MODE_USB, RIG_MODE_CW, RIG_MODE_AM, RIG_MODE_FM, RIG_MODE_RTTY
+    };
+    static const freq_t freqs[] =
+    {
+        1840000, 3573000, 7074000, 14074000, 21074000, 28074000, 50313000
+    };
+    long sum = 0;
+
+    while (n--)
+    {
+        rmode_t mode = modes[n % 5];
+        freq_t freq = freqs[n % 7];
+        unsigned int mw = 0;
+
+        sum += rig_passband_normal(r, mode);
+        sum += rig_passband_narrow(r, mode);
+        sum += rig_get_resolution(r, mode);
+        rig_power2mW(r, &mw, 0.5, freq, mode);
+        sum += mw + rig_get_band(r, freq, 0);
+    }
+
+    return sum ? RIG_OK : -RIG_EINTERNAL;
+}
+
+
+static int bench_caps_indexed(long n)
+{
+    return caps_lookup(caps_rig, n);
+}
+
+
+static int bench_caps_scan(long n)
+{
+    return caps_lookup(scan_rig, n);
+}
+
+
+/*
+ * Name and token lookups as rigctld's set_conf/get_conf and
+ * set_ext_level/get_ext_level make them: IC-7300 backend, frontend and
+ * serial conf parameters, ext levels and an unknown ext name.  Same caps
+ * with and without the index rig_init builds.
+ */
+static int token_lookup(RIG *r, long n)
+{
+    static const char *const conf[] =
+    {
+        "civaddr", "async", "serial_speed", "poll_interval", "rig_pathname"
+    };
+    static const char *const ext[] =
+    {
+        "digi_sel_level", "SPECTRUM_EDGE", "no_such_level"
+    };
+    long sum = 0;
+
+    while (n--)
+    {
+        const struct confparams *cfp;
+        token_t token = rig_token_lookup(r, conf[n % 5]);
+
+        cfp = rig_ext_lookup(r, ext[n % 3]);
+
+        if (cfp) { sum += rig_ext_lookup_tok(r, cfp->token) == cfp; }
+
+        sum += token != RIG_CONF_END && rig_confparam_lookup(r, "civaddr") != NULL;
+    }
+
+    return sum ? RIG_OK : -RIG_EINTERNAL;
+}
+
+
+static int bench_tokens_indexed(long n)
+{
+    return token_lookup(tok_rig, n);
+}
+
+
+static int bench_tokens_scan(long n)
+{
+    return token_lookup(tok_scan_rig, n);
+}
+
+
+static const struct bench benches[] =
+{
+    { "rig_get_freq_cached", bench_get_freq },
+    { "rig_get_mode_cached", bench_get_mode },
+    { "rig_set_freq_dummy", bench_set_freq },
+    { "read_string_pty", bench_read_string },
+    { "read_block_pty", bench_read_block },
+    { "read_string_pty_uring", bench_read_string_uring },
+    { "transaction_pty", bench_transaction },
+    { "transaction_pty_uring", bench_transaction_uring },
+    { "rigctl_parse_dispatch", bench_rigctl_parse },
+    { "snapshot_serialize", bench_snapshot },
+    { "multicast_publish_poll", bench_multicast },
+    { "bcd_roundtrip", bench_bcd },
+    { "locator_qrb", bench_locator },
+    { "rig_get_caps", bench_get_caps },
+    { "caps_lookup_indexed", bench_caps_indexed },
+    { "caps_lookup_scan", bench_caps_scan },
+    { "token_lookup_indexed", bench_tokens_indexed },
+    { "token_lookup_scan", bench_tokens_scan },
+    { NULL, NULL }
+};
+
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/* grow the iteration count until a run takes at least min_ns */
+static int measure(const struct bench *b, double min_ns, struct result *r)
+{
+    long n = 1;
+
+    for (;;)
+    {
+        double start = now_ns();
+        double elapsed;
+        int ret = b->run(n);
+
+        elapsed = now_ns() - start;
+
+        if (ret != RIG_OK)
+        {
+            fprintf(stderr, "%s: %s\n", b->name, rigerror(ret));
+            return ret;
+        }
+
+        if (elapsed >= min_ns || n >= 1L << 30)
+        {
+            snprintf(r->name, sizeof(r->name), "%s", b->name);
+            r->iterations = n;
+            r->ns_per_op = elapsed / n;
+            return RIG_OK;
+        }
+
+        /* aim a little past the target, growing at most tenfold a round */
+        if (elapsed < min_ns / 10) { n *= 10; }
+        else { n = (long)(n * min_ns * 1.2 / elapsed) + 1; }
+    }
+}
+
+
+/* answers every "FA;" written to the slave side like a TS-2000 */
+static void *responder(void *arg)
+{
+    static const char reply[] = "FA00014074000;";
+    int master = (int)(long) arg;
+    char c;
+
+    while (read(master, &c, 1) == 1)
+    {
+        if (c == ';' && write(master, reply, sizeof(reply) - 1) < 0) { break; }
+    }
+
+    return NULL;
+}
+
+
+/* raw pty pair, the slave end set up as a rig port */
+static int open_pty(int *master, hamlib_port_t *port)
+{
+    struct termios t;
+    int slave;
+
+    *master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (*master < 0 || grantpt(*master) < 0 || unlockpt(*master) < 0)
+    {
+        return -RIG_EIO;
+    }
+
+    slave = open(ptsname(*master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (slave < 0) { return -RIG_EIO; }
+
+    tcgetattr(slave, &t);
+    t.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL
+                   | IXON);
+    t.c_oflag &= ~OPOST;
+    t.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    t.c_cflag &= ~(CSIZE | PARENB);
+    t.c_cflag |= CS8;
+    tcsetattr(slave, TCSANOW, &t);
+
+    memset(port, 0, sizeof(*port));
+    port->type.rig = RIG_PORT_DEVICE;
+    port->fd = slave;
+    port->timeout = 1000;
+    port->parm.serial.data_bits = 8;
+
+    return RIG_OK;
+}
+
+
+static int setup_pty(void)
+{
+    int masters[2];
+    pthread_t tid;
+    int i;
+
+    if (open_pty(&pty_master, &pty_port) != RIG_OK
+            || open_pty(&masters[0], &txn_port) != RIG_OK
+            || open_pty(&masters[1], &txn_uring_port) != RIG_OK
+            || open_pty(&uring_master, &uring_port) != RIG_OK)
+    {
+        return -RIG_EIO;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        if (pthread_create(&tid, NULL, responder, (void *)(long) masters[i]) != 0)
+        {
+            return -RIG_EIO;
+        }
+
+        pthread_detach(tid);
+    }
+
+    /* the _uring benchmarks are skipped when this fails */
+    if (uring_port_attach(&txn_uring_port) != RIG_OK
+            || uring_port_attach(&uring_port) != RIG_OK)
+    {
+        fprintf(stderr, "io_uring not available, skipping _uring benchmarks\n");
+    }
+
+    return RIG_OK;
+}
+
+
+static int setup_parse(void)
+{
+    static char cmds[4096];
+    size_t i;
+
+    /* rigctld style input: a stream of "get frequency" commands */
+    for (i = 0; i + 2 <= sizeof(cmds) - 1; i += 2)
+    {
+        cmds[i] = 'f';
+        cmds[i + 1] = '\n';
+    }
+
+    parse_in = fmemopen(cmds, strlen(cmds), "r");
+    parse_out = fopen("/dev/null", "w");
+
+    return parse_in && parse_out ? RIG_OK : -RIG_EIO;
+}
+
+
+static void load_baseline(const char *path)
+{
+    char line[256];
+    FILE *fp = fopen(path, "r");
+
+    if (fp == NULL)
+    {
+        perror(path);
+        exit(2);
+    }
+
+    while (nbaseline < MAXBENCH && fgets(line, sizeof(line), fp))
+    {
+        struct result *r = &baseline[nbaseline];
+
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"iterations\": %ld, "
+                   "\"ns_per_op\": %lf", r->name, &r->iterations,
+                   &r->ns_per_op) == 3)
+        {
+            nbaseline++;
+        }
+    }
+
+    fclose(fp);
+}
+
+
+static const struct result *find_baseline(const char *name)
+{
+    int i;
+
+    for (i = 0; i < nbaseline; i++)
+    {
+        if (!strcmp(baseline[i].name, name)) { return &baseline[i]; }
+    }
+
+    return NULL;
+}
+
+
+static void usage(void)
+{
+    printf("Usage: benchsuite [OPTION]...\n"
+           "Run the Hamlib microbenchmarks and write the results as JSON.\n\n"
+           "  -o, --output=FILE      write JSON to FILE instead of stdout\n"
+           "  -b, --baseline=FILE    compare against a previous JSON result\n"
+           "  -t, --threshold=PCT    regression threshold in percent, default 10\n"
+           "  -T, --time=MS          minimum run time per benchmark, default 200\n"
+           "  -f, --filter=STRING    only run benchmarks whose name contains STRING\n"
+           "  -l, --list             list the benchmarks and exit\n"
+           "  -h, --help             display this help and exit\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    static const struct option long_options[] =
+    {
+        {"output",    1, 0, 'o'},
+        {"baseline",  1, 0, 'b'},
+        {"threshold", 1, 0, 't'},
+        {"time",      1, 0, 'T'},
+        {"filter",    1, 0, 'f'},
+        {"list",      0, 0, 'l'},
+        {"help",      0, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    struct result results[MAXBENCH];
+    const char *filter = NULL;
+    double threshold = 10.0;
+    double min_ns = 200e6;
+    FILE *out = stdout;
+    int nresults = 0;
+    int regressions = 0;
+    int i, c;
+
+    while ((c = getopt_long(argc, argv, "o:b:t:T:f:lh", long_options, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case 'o':
+            out = fopen(optarg, "w");
+
+            if (out == NULL)
+            {
+                perror(optarg);
+                return 2;
+            }
+
+            break;
+
+        case 'b':
+            load_baseline(optarg);
+            break;
+
+        case 't':
+            threshold = atof(optarg);
+            break;
+
+        case 'T':
+            min_ns = atof(optarg) * 1e6;
+            break;
+
+        case 'f':
+            filter = optarg;
+            break;
+
+        case 'l':
+            for (i = 0; benches[i].name; i++) { printf("%s\n", benches[i].name); }
+
+            return 0;
+
+        case 'h':
+            usage();
+            return 0;
+
+        default:
+            usage();
+            return 2;
+        }
+    }
+
+    rig_set_debug(RIG_DEBUG_NONE);
+    rig_load_all_backends();
+
+    rig = rig_init(RIG_MODEL_DUMMY);
+
+    if (rig == NULL)
+    {
+        fprintf(stderr, "rig_init failed\n");
+        return 2;
+    }
+
+    /* keep the poll thread from competing with the measurements,
+     * setting poll_interval also sets the cache timeout so restore it */
+    rig_set_conf(rig, rig_token_lookup(rig, "poll_interval"), "0");
+    rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_ALL, 500);
+
+    /* no port needed for lookups, build the index rig_open would */
+    caps_rig = rig_init(RIG_MODEL_TS2000);
+    scan_rig = rig_init(RIG_MODEL_TS2000);
+    tok_rig = rig_init(RIG_MODEL_IC7300);
+    tok_scan_rig = rig_init(RIG_MODEL_IC7300);
+
+    if (tok_scan_rig) { tokindex_free(tok_scan_rig); }
+
+    if (rig_open(rig) != RIG_OK || setup_pty() != RIG_OK
+            || setup_parse() != RIG_OK || caps_rig == NULL || scan_rig == NULL
+            || tok_rig == NULL || tok_scan_rig == NULL
+            || capindex_build(caps_rig) != RIG_OK)
+    {
+        fprintf(stderr, "benchmark setup failed\n");
+        return 2;
+    }
+
+    for (i = 0; benches[i].name; i++)
+    {
+        if (filter && !strstr(benches[i].name, filter)) { continue; }
+
+        if (measure(&benches[i], min_ns, &results[nresults]) == RIG_OK)
+        {
+            nresults++;
+        }
+    }
+
+    fprintf(out, "{\n  \"hamlib_version\": \"%s\",\n  \"benchmarks\": [\n",
+            hamlib_version2);
+
+    for (i = 0; i < nresults; i++)
+    {
+        const struct result *r = &results[i];
+        const struct result *base = find_baseline(r->name);
+
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %ld, "
+                "\"ns_per_op\": %.2f", r->name, r->iterations, r->ns_per_op);
+
+        if (base && base->ns_per_op > 0)
+        {
+            double change = (r->ns_per_op - base->ns_per_op) * 100.0
+                            / base->ns_per_op;
+
+            fprintf(out, ", \"baseline_ns_per_op\": %.2f, \"change_pct\": %.1f",
+                    base->ns_per_op, change);
+
+            if (change > threshold)
+            {
+                fprintf(stderr, "REGRESSION %s: %.2f -> %.2f ns/op (%+.1f%%)\n",
+                        r->name, base->ns_per_op, r->ns_per_op, change);
+                regressions++;
+            }
+        }
+
+        fprintf(out, "}%s\n", i + 1 < nresults ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout) { fclose(out); }
+
+    rig_close(rig);
+    rig_cleanup(rig);
+    rig_cleanup(caps_rig);
+    rig_cleanup(scan_rig);
+
+    return regressions ? 1 : 0;
+}
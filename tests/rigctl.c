@@ -842,6 +842,14 @@ int main(int argc, char *argv[])
             }
         }
 
+        // a dropped network port is reconnected by the next command
+        if (retcode == -RIG_EIO && my_rig->state.comm_state
+                && my_rig->state.comm_status == RIG_COMM_STATUS_DISCONNECTED
+                && my_rig->state.net_reconnect)
+        {
+            retcode = RIG_OK;
+        }
+
         // if we get a hard error we try to reopen the rig again
         // this should cover short dropouts that can occur
         if (retcode < 0 && !RIG_IS_SOFT_ERRCODE(-retcode))
@@ -27,6 +27,7 @@
 
 #include <hamlib/config.h>
 
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -100,12 +101,10 @@ extern int read_history();
 #define ARG_IN  (ARG_IN1|ARG_IN2|ARG_IN3|ARG_IN4)
 #define ARG_OUT (ARG_OUT1|ARG_OUT2|ARG_OUT3|ARG_OUT4|ARG_OUT5)
 
-static int chk_vfo_executed;
 char rigctld_password[64];
 int is_passwordOK;
 int is_rigctld;
 extern int lock_mode; // used by rigctld
-extern powerstat_t rig_powerstat;
 
 
 
@@ -689,6 +688,7 @@ int rigctl_parse(RIG *my_rig, FILE *fin, FILE *fout, char *argv[], int argc,
                  int *ext_resp_ptr, char *resp_sep_ptr, int use_password)
 {
     int retcode = -RIG_EINTERNAL;        /* generic return code from functions */
+    int coalesced;
     unsigned char cmd;
     struct test_table *cmd_entry = NULL;
 
@@ -1684,7 +1684,25 @@ readline_repeat:
 
 #endif // HAVE_LIBREADLINE
 
-    if (sync_cb) { sync_cb(1); }    /* lock if necessary */
+    /*
+     * Latest-wins tuning: a set_freq arriving while another one is being
+     * sent is handed over to it instead of queueing behind the lock.
+     */
+    coalesced = 0;
+
+    if (cmd == 'F' && p1 && my_rig->state.freq_coalesce
+            && (!use_password || is_passwordOK))
+    {
+        freq_t freq;
+
+        if (sscanf(p1, "%"SCNfreq, &freq) == 1
+                && rig_freq_coalesce_defer(my_rig, vfo, freq))
+        {
+            coalesced = 1;
+        }
+    }
+
+    if (sync_cb && !coalesced) { sync_cb(1); }    /* lock if necessary */
 
     if (!prompt)
     {
@@ -1760,7 +1778,8 @@ readline_repeat:
     else
     {
         // Allow only certain commands when the rig is powered off
-        if (my_rig->state.powerstat == RIG_POWER_OFF && (rig_powerstat == RIG_POWER_OFF || rig_powerstat == RIG_POWER_STANDBY)
+        // rig_set_powerstat/rig_get_powerstat keep state.powerstat per rig
+        if (my_rig->state.powerstat == RIG_POWER_OFF
                 && cmd_entry->cmd != '1' // dump_caps
                 && cmd_entry->cmd != '3' // dump_conf
                 && cmd_entry->cmd != 0x8f // dump_state
@@ -1776,6 +1795,10 @@ readline_repeat:
                       cmd_entry->name);
             retcode = -RIG_EPOWER;
         }
+        else if (coalesced)
+        {
+            retcode = RIG_OK;
+        }
         else
         {
             retcode = (*cmd_entry->rig_routine)(my_rig,
@@ -1862,7 +1885,7 @@ readline_repeat:
 
 #endif
 
-    if (sync_cb) { sync_cb(0); }    /* unlock if necessary */
+    if (sync_cb && !coalesced) { sync_cb(0); }    /* unlock if necessary */
 
     return (retcode);
 }
@@ -4475,6 +4498,85 @@ int dump_chan(FILE *fout, RIG *rig, channel_t *chan)
 
 
 /* '1' */
+/*
+ * dump_caps and dump_state only change with the caps and the lists
+ * rig_open/rig_set_conf set up in rig_state, and every netrigctl open
+ * asks for them, so the text is built once per rig and reused until
+ * rig->state.state_gen moves on.  Each is a single allocation hung off
+ * rig_state, rig_cleanup frees it.
+ */
+struct dump_cache
+{
+    unsigned int gen;
+    int variant;        /* rig_state.chk_vfo_executed for dump_state */
+    size_t len;
+    size_t size;
+    char text[];
+};
+
+
+static int dump_cache_valid(const struct dump_cache *dc, const RIG *rig,
+                            int variant)
+{
+    return dc && dc->gen == rig->state.state_gen && dc->variant == variant;
+}
+
+
+static struct dump_cache *dump_cache_new(const RIG *rig, int variant)
+{
+    struct dump_cache *dc = malloc(sizeof(*dc) + 4096);
+
+    if (dc)
+    {
+        dc->gen = rig->state.state_gen;
+        dc->variant = variant;
+        dc->len = 0;
+        dc->size = 4096;
+        dc->text[0] = '\0';
+    }
+
+    return dc;
+}
+
+
+/* appends at the end of the text, *dc is NULL once an allocation failed */
+static void dump_printf(struct dump_cache **dc, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    if (!*dc) { return; }
+
+    va_start(ap, fmt);
+    n = vsnprintf((*dc)->text + (*dc)->len, (*dc)->size - (*dc)->len, fmt, ap);
+    va_end(ap);
+
+    if (n < 0) { return; }
+
+    if ((*dc)->len + n >= (*dc)->size)
+    {
+        size_t size = ((*dc)->len + n + 1) * 2;
+        struct dump_cache *bigger = realloc(*dc, sizeof(**dc) + size);
+
+        if (!bigger)
+        {
+            free(*dc);
+            *dc = NULL;
+            return;
+        }
+
+        bigger->size = size;
+        *dc = bigger;
+
+        va_start(ap, fmt);
+        vsnprintf((*dc)->text + (*dc)->len, (*dc)->size - (*dc)->len, fmt, ap);
+        va_end(ap);
+    }
+
+    (*dc)->len += n;
+}
+
+
 declare_proto_rig(dump_caps)
 {
     ENTERFUNC2;
@@ -4488,39 +4590,86 @@ declare_proto_rig(dump_caps)
     }
     else
 #endif
+#ifdef HAVE_OPEN_MEMSTREAM
+    {
+        struct dump_cache *dc = rig->state.dump_caps_priv;
+
+        if (!dump_cache_valid(dc, rig, 0))
+        {
+            char *text = NULL;
+            size_t len = 0;
+            FILE *f = open_memstream(&text, &len);
+
+            if (!f)
+            {
+                dumpcaps(rig, fout);
+                RETURNFUNC2(RIG_OK);
+            }
+
+            dumpcaps(rig, f);
+            fclose(f);
+
+            dc = dump_cache_new(rig, 0);
+            dump_printf(&dc, "%s", text);
+            free(text);
+            free(rig->state.dump_caps_priv);
+            rig->state.dump_caps_priv = dc;
+
+            if (!dc)
+            {
+                RETURNFUNC2(-RIG_ENOMEM);
+            }
+        }
+
+        fwrite(dc->text, 1, dc->len, fout);
+    }
+#else
     {
         dumpcaps(rig, fout);
     }
+#endif
 
     RETURNFUNC2(RIG_OK);
 }
 
 
-/* For rigctld internal use */
 declare_proto_rig(dump_state)
 {
     int i;
     struct rig_state *rs = &rig->state;
+    struct dump_cache *dc = rs->dump_state_priv;
     char buf[1024];
 
     ENTERFUNC2;
 
+    rig_debug(RIG_DEBUG_ERR, "%s: chk_vfo_executed=%d\n", __func__,
+              rs->chk_vfo_executed);
+    rig->state.rig_model = rig->caps->rig_model;
+
+    if (dump_cache_valid(dc, rig, rs->chk_vfo_executed))
+    {
+        fwrite(dc->text, 1, dc->len, fout);
+        RETURNFUNC2(RIG_OK);
+    }
+
+    dc = dump_cache_new(rig, rs->chk_vfo_executed);
+
     /*
      * - Protocol version
      */
 #define RIGCTLD_PROT_VER 1
-    fprintf(fout, "%d\n", RIGCTLD_PROT_VER);
-    fprintf(fout, "%d\n", rig->caps->rig_model);
+    dump_printf(&dc, "%d\n", RIGCTLD_PROT_VER);
+    dump_printf(&dc, "%d\n", rig->caps->rig_model);
 #if 0 // deprecated -- not one rig uses this
-    fprintf(fout, "%d\n", rs->itu_region);
+    dump_printf(&dc, "%d\n", rs->itu_region);
 #else  // need to print something to maintain backward compatibility
-    fprintf(fout, "%d\n", 0);
+    dump_printf(&dc, "%d\n", 0);
 #endif
 
     for (i = 0; i < HAMLIB_FRQRANGESIZ
             && !RIG_IS_FRNG_END(rs->rx_range_list[i]); i++)
     {
-        fprintf(fout,
+        dump_printf(&dc,
                 "%"FREQFMT" %"FREQFMT" 0x%"PRXll" %d %d 0x%x 0x%x\n",
                 rs->rx_range_list[i].startf,
                 rs->rx_range_list[i].endf,
@@ -4531,12 +4680,12 @@ declare_proto_rig(dump_state)
                 rs->rx_range_list[i].ant);
     }
 
-    fprintf(fout, "0 0 0 0 0 0 0\n");
+    dump_printf(&dc, "0 0 0 0 0 0 0\n");
 
     for (i = 0; i < HAMLIB_FRQRANGESIZ
             && !RIG_IS_FRNG_END(rs->tx_range_list[i]); i++)
     {
-        fprintf(fout,
+        dump_printf(&dc,
                 "%"FREQFMT" %"FREQFMT" 0x%"PRXll" %d %d 0x%x 0x%x\n",
                 rs->tx_range_list[i].startf,
                 rs->tx_range_list[i].endf,
@@ -4547,159 +4696,167 @@ declare_proto_rig(dump_state)
                 rs->tx_range_list[i].ant);
     }
 
-    fprintf(fout, "0 0 0 0 0 0 0\n");
+    dump_printf(&dc, "0 0 0 0 0 0 0\n");
 
     for (i = 0; i < HAMLIB_TSLSTSIZ && !RIG_IS_TS_END(rs->tuning_steps[i]); i++)
     {
-        fprintf(fout,
+        dump_printf(&dc,
                 "0x%"PRXll" %ld\n",
                 rs->tuning_steps[i].modes,
                 rs->tuning_steps[i].ts);
     }
 
-    fprintf(fout, "0 0\n");
+    dump_printf(&dc, "0 0\n");
 
     for (i = 0; i < HAMLIB_FLTLSTSIZ && !RIG_IS_FLT_END(rs->filters[i]); i++)
     {
-        fprintf(fout,
+        dump_printf(&dc,
                 "0x%"PRXll" %ld\n",
                 rs->filters[i].modes,
                 rs->filters[i].width);
     }
 
-    fprintf(fout, "0 0\n");
+    dump_printf(&dc, "0 0\n");
 
 #if 0
     chan_t chan_list[HAMLIB_CHANLSTSIZ]; /*!< Channel list, zero ended */
 #endif
 
-    fprintf(fout, "%ld\n", rs->max_rit);
-    fprintf(fout, "%ld\n", rs->max_xit);
-    fprintf(fout, "%ld\n", rs->max_ifshift);
-    fprintf(fout, "%d\n", rs->announces);
+    dump_printf(&dc, "%ld\n", rs->max_rit);
+    dump_printf(&dc, "%ld\n", rs->max_xit);
+    dump_printf(&dc, "%ld\n", rs->max_ifshift);
+    dump_printf(&dc, "%d\n", rs->announces);
 
     for (i = 0; i < HAMLIB_MAXDBLSTSIZ && rs->preamp[i]; i++)
     {
-        fprintf(fout, "%d ", rs->preamp[i]);
+        dump_printf(&dc, "%d ", rs->preamp[i]);
     }
 
-    fprintf(fout, "\n");
+    dump_printf(&dc, "\n");
 
     for (i = 0; i < HAMLIB_MAXDBLSTSIZ && rs->attenuator[i]; i++)
     {
-        fprintf(fout, "%d ", rs->attenuator[i]);
+        dump_printf(&dc, "%d ", rs->attenuator[i]);
     }
 
-    fprintf(fout, "\n");
+    dump_printf(&dc, "\n");
 
-    fprintf(fout, "0x%"PRXll"\n", rs->has_get_func);
-    fprintf(fout, "0x%"PRXll"\n", rs->has_set_func);
-    fprintf(fout, "0x%"PRXll"\n", rs->has_get_level);
-    fprintf(fout, "0x%"PRXll"\n", rs->has_set_level);
-    fprintf(fout, "0x%"PRXll"\n", rs->has_get_parm);
-    fprintf(fout, "0x%"PRXll"\n", rs->has_set_parm);
+    dump_printf(&dc, "0x%"PRXll"\n", rs->has_get_func);
+    dump_printf(&dc, "0x%"PRXll"\n", rs->has_set_func);
+    dump_printf(&dc, "0x%"PRXll"\n", rs->has_get_level);
+    dump_printf(&dc, "0x%"PRXll"\n", rs->has_set_level);
+    dump_printf(&dc, "0x%"PRXll"\n", rs->has_get_parm);
+    dump_printf(&dc, "0x%"PRXll"\n", rs->has_set_parm);
 
     // protocol 1 fields are "setting=value"
     // protocol 1 allows fields can be listed/processed in any order
     // protocol 1 fields can be multi-line -- just write the thing to allow for it
     // backward compatible as new values will just generate warnings
-    rig_debug(RIG_DEBUG_ERR, "%s: chk_vfo_executed=%d\n", __func__, chk_vfo_executed);
-    if (chk_vfo_executed) // for 3.3 compatiblility
+    if (rs->chk_vfo_executed) // for 3.3 compatiblility
     {
-        fprintf(fout, "vfo_ops=0x%x\n", rig->caps->vfo_ops);
-        fprintf(fout, "ptt_type=0x%x\n",
+        dump_printf(&dc, "vfo_ops=0x%x\n", rig->caps->vfo_ops);
+        dump_printf(&dc, "ptt_type=0x%x\n",
                 rig->state.pttport.type.ptt);
-        fprintf(fout, "targetable_vfo=0x%x\n", rig->caps->targetable_vfo);
-        fprintf(fout, "has_set_vfo=%d\n", rig->caps->set_vfo != NULL);
-        fprintf(fout, "has_get_vfo=%d\n", rig->caps->get_vfo != NULL);
-        fprintf(fout, "has_set_freq=%d\n", rig->caps->set_freq != NULL);
-        fprintf(fout, "has_get_freq=%d\n", rig->caps->get_freq != NULL);
-        fprintf(fout, "has_set_conf=%d\n", rig->caps->set_conf != NULL);
-        fprintf(fout, "has_get_conf=%d\n", rig->caps->get_conf != NULL);
+        dump_printf(&dc, "targetable_vfo=0x%x\n", rig->caps->targetable_vfo);
+        dump_printf(&dc, "has_set_vfo=%d\n", rig->caps->set_vfo != NULL);
+        dump_printf(&dc, "has_get_vfo=%d\n", rig->caps->get_vfo != NULL);
+        dump_printf(&dc, "has_set_freq=%d\n", rig->caps->set_freq != NULL);
+        dump_printf(&dc, "has_get_freq=%d\n", rig->caps->get_freq != NULL);
+        dump_printf(&dc, "has_set_conf=%d\n", rig->caps->set_conf != NULL);
+        dump_printf(&dc, "has_get_conf=%d\n", rig->caps->get_conf != NULL);
 #if 0
-        fprintf(fout, "has_set_parm=%d\n", rig->caps->set_parm != NULL);
-        fprintf(fout, "has_get_parm=%d\n", rig->caps->get_parm != NULL);
-        fprintf(fout, "parm_gran=0x%x\n", rig->caps->parm_gran);
+        dump_printf(&dc, "has_set_parm=%d\n", rig->caps->set_parm != NULL);
+        dump_printf(&dc, "has_get_parm=%d\n", rig->caps->get_parm != NULL);
+        dump_printf(&dc, "parm_gran=0x%x\n", rig->caps->parm_gran);
 #endif
         // for the future
-//        fprintf(fout, "has_set_trn=%d\n", rig->caps->set_trn != NULL);
-//        fprintf(fout, "has_get_trn=%d\n", rig->caps->get_trn != NULL);
-        fprintf(fout, "has_power2mW=%d\n", rig->caps->power2mW != NULL);
-        fprintf(fout, "has_mW2power=%d\n", rig->caps->mW2power != NULL);
-        fprintf(fout, "timeout=%d\n", rig->caps->timeout);
-        fprintf(fout, "rig_model=%d\n", rig->caps->rig_model);
-        fprintf(fout, "rigctld_version=%s\n", hamlib_version2);
+//        dump_printf(&dc, "has_set_trn=%d\n", rig->caps->set_trn != NULL);
+//        dump_printf(&dc, "has_get_trn=%d\n", rig->caps->get_trn != NULL);
+        dump_printf(&dc, "has_power2mW=%d\n", rig->caps->power2mW != NULL);
+        dump_printf(&dc, "has_mW2power=%d\n", rig->caps->mW2power != NULL);
+        dump_printf(&dc, "timeout=%d\n", rig->caps->timeout);
+        dump_printf(&dc, "rig_model=%d\n", rig->caps->rig_model);
+        dump_printf(&dc, "rigctld_version=%s\n", hamlib_version2);
         rig_sprintf_agc_levels(rig, buf, sizeof(buf));
-        fprintf(fout, "agc_levels=%s\n", buf);
+        dump_printf(&dc, "agc_levels=%s\n", buf);
 
         if (rig->caps->ctcss_list)
         {
-            fprintf(fout, "ctcss_list=");
+            dump_printf(&dc, "ctcss_list=");
 
             for (i = 0; i < CTCSS_LIST_SIZE && rig->caps->ctcss_list[i] != 0; i++)
             {
-                fprintf(fout,
+                dump_printf(&dc,
                         " %u.%1u",
                         rig->caps->ctcss_list[i] / 10, rig->caps->ctcss_list[i] % 10);
             }
 
-            fprintf(fout, "\n");
+            dump_printf(&dc, "\n");
         }
 
         if (rig->caps->dcs_list)
         {
-            fprintf(fout, "dcs_list=");
+            dump_printf(&dc, "dcs_list=");
 
             for (i = 0; i < DCS_LIST_SIZE && rig->caps->dcs_list[i] != 0; i++)
             {
-                fprintf(fout,
+                dump_printf(&dc,
                         " %u",
                         rig->caps->dcs_list[i]);
             }
 
-            fprintf(fout, "\n");
+            dump_printf(&dc, "\n");
         }
 
 
-        fprintf(fout, "level_gran=");
+        dump_printf(&dc, "level_gran=");
 
         for (i = 0; i < RIG_SETTING_MAX; ++i)
         {
             if (RIG_LEVEL_IS_FLOAT(i))
             {
-                fprintf(fout, "%d=%g,%g,%g;", i, rig->state.level_gran[i].min.f,
+                dump_printf(&dc, "%d=%g,%g,%g;", i, rig->state.level_gran[i].min.f,
                         rig->state.level_gran[i].max.f, rig->state.level_gran[i].step.f);
             }
             else
             {
-                fprintf(fout, "%d=%d,%d,%d;", i, rig->state.level_gran[i].min.i,
+                dump_printf(&dc, "%d=%d,%d,%d;", i, rig->state.level_gran[i].min.i,
                         rig->state.level_gran[i].max.i, rig->state.level_gran[i].step.i);
             }
         }
 
-        fprintf(fout, "\nparm_gran=");
+        dump_printf(&dc, "\nparm_gran=");
 
         for (i = 0; i < RIG_SETTING_MAX; ++i)
         {
             if (RIG_LEVEL_IS_FLOAT(i))
             {
-                fprintf(fout, "%d=%g,%g,%g;", i, rig->state.parm_gran[i].min.f,
+                dump_printf(&dc, "%d=%g,%g,%g;", i, rig->state.parm_gran[i].min.f,
                         rig->state.parm_gran[i].max.f, rig->state.parm_gran[i].step.f);
             }
             else
             {
-                fprintf(fout, "%d=%d,%d,%d;", i, rig->state.level_gran[i].min.i,
+                dump_printf(&dc, "%d=%d,%d,%d;", i, rig->state.level_gran[i].min.i,
                         rig->state.level_gran[i].max.i, rig->state.level_gran[i].step.i);
             }
         }
-        fprintf(fout, "\n");
-        
-        rig->state.rig_model = rig->caps->rig_model;
-        fprintf(fout, "rig_model=%d\n", rig->state.rig_model);
-        fprintf(fout, "hamlib_version=%s\n", hamlib_version2);
-        fprintf(fout, "done\n");
+        dump_printf(&dc, "\n");
+
+        dump_printf(&dc, "rig_model=%d\n", rig->state.rig_model);
+        dump_printf(&dc, "hamlib_version=%s\n", hamlib_version2);
+        dump_printf(&dc, "done\n");
+    }
+
+    free(rs->dump_state_priv);
+    rs->dump_state_priv = dc;
+
+    if (!dc)
+    {
+        RETURNFUNC2(-RIG_ENOMEM);
     }
 
+    fwrite(dc->text, 1, dc->len, fout);
+
     RETURNFUNC2(RIG_OK);
 }
 
@@ -4897,11 +5054,6 @@ declare_proto_rig(set_powerstat)
 
     retval = rig_set_powerstat(rig, (powerstat_t) stat);
 
-    if (retval == RIG_OK)
-    {
-        rig_powerstat = stat; // update our global so others can see powerstat
-    }
-
     fflush(fin);
     RETURNFUNC2(retval);
 }
@@ -4928,7 +5080,6 @@ declare_proto_rig(get_powerstat)
     }
 
     fprintf(fout, "%d%c", stat, resp_sep);
-    rig_powerstat = stat; // update our global so others can see powerstat
 
     RETURNFUNC2(status);
 }
@@ -5245,7 +5396,7 @@ rig_debug(RIG_DEBUG_ERR, "%s: **********************************\n", __func__);
 
     fprintf(fout, "%d\n", rig->state.vfo_opt);
 
-    chk_vfo_executed = 1; // this allows us to control dump_state version
+    rig->state.chk_vfo_executed = 1; // this allows us to control dump_state version
 
     RETURNFUNC2(RIG_OK);
 }
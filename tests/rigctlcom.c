@@ -75,6 +75,21 @@
 #  endif
 #endif
 
+#ifdef HAVE_SYS_SELECT_H
+// cppcheck-suppress *
+#  include <sys/select.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+// cppcheck-suppress *
+#  include <unistd.h>
+#endif
+
+#ifdef HAVE_PTHREAD
+// cppcheck-suppress *
+#  include <pthread.h>
+#endif
+
 #include <hamlib/rig.h>
 #include "misc.h"
 #include "iofunc.h"
@@ -87,7 +102,7 @@
  * NB: do NOT use -W since it's reserved by POSIX.
  * TODO: add an option to read from a file
  */
-#define SHORT_OPTIONS "B:m:r:R:p:d:P:D:s:S:c:C:lLuvhVZ"
+#define SHORT_OPTIONS "B:m:r:R:p:d:P:D:s:S:c:C:i:NlLuvhVZ"
 static struct option long_options[] =
 {
     {"mapa2b",          0, 0, 'B'},
@@ -102,6 +117,8 @@ static struct option long_options[] =
     {"serial-speed2",   1, 0, 'S'},
     {"civaddr",         1, 0, 'c'},
     {"set-conf",        1, 0, 'C'},
+    {"interval",        1, 0, 'i'},
+    {"poll",            0, 0, 'N'},
     {"list",            0, 0, 'l'},
     {"show-conf",       0, 0, 'L'},
     {"dump-caps",       0, 0, 'u'},
@@ -114,6 +131,8 @@ static struct option long_options[] =
 
 void usage();
 static int handle_ts2000(void *arg);
+static int ts2000_read(int timeout_ms);
+static int ts2000_push(void);
 
 static RIG *my_rig;             /* handle to rig */
 static hamlib_port_t my_com;    /* handle to virtual COM port */
@@ -124,6 +143,7 @@ static int verbose;
 /* This allows working CW Skimmer in split mode and transmit on VFOB */
 static int mapa2b;              /* maps set_freq on VFOA to VFOB instead */
 static int kwidth;
+static int ai_mode;             /* AI level the application asked for */
 
 #ifdef HAVE_SIG_ATOMIC_T
 static sig_atomic_t volatile ctrl_c;
@@ -133,7 +153,6 @@ static int volatile ctrl_c;
 
 #define MAXCONFLEN 2048
 
-#if 0
 # ifdef WIN32
 static BOOL WINAPI CtrlHandler(DWORD fdwCtrlType)
 {
@@ -165,7 +184,160 @@ static void signal_handler(int sig)
     }
 }
 # endif  /* ifdef WIN32 */
-#endif   /* if 0 */
+
+
+/*
+ * What the emulated TS-2000 reports.  The main loop refreshes it from the
+ * rig every interval_ms, or the rig's transceive events do, and the read
+ * queries are answered from here -- an application polling IF; at 10 Hz
+ * costs the rig nothing extra.
+ */
+struct ts2000_cache
+{
+    freq_t freq_a;
+    freq_t freq_b;
+    rmode_t mode;
+    pbwidth_t width;
+    ptt_t ptt;
+    vfo_t vfo;
+    split_t split;
+    vfo_t tx_vfo;
+    int valid;
+    int want_freq_b;            /* only polled once somebody asked for FB; */
+    int changed;                /* since the last AI update */
+};
+
+struct ts2000_stats
+{
+    unsigned long queries;
+    unsigned long cached;       /* queries answered without the rig */
+    unsigned long refreshes;
+    unsigned long events;
+    unsigned long pushed;       /* AI updates sent to the application */
+};
+
+static struct ts2000_cache cache;
+static struct ts2000_stats stats;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#  define CACHE_LOCK() pthread_mutex_lock(&cache_lock)
+#  define CACHE_UNLOCK() pthread_mutex_unlock(&cache_lock)
+#else
+#  define CACHE_LOCK()
+#  define CACHE_UNLOCK()
+#endif
+
+#define CACHE_STORE(field, val) \
+    do { if (cache.field != (val)) { cache.field = (val); cache.changed = 1; } } while (0)
+
+/*
+ * Read the rig into the cache.  With transceive events the rig tells us
+ * about freq and mode changes itself, so only the rest is polled.
+ */
+static void ts2000_refresh(int freq_mode)
+{
+    vfo_t vfo_a = vfo_fixup(my_rig, RIG_VFO_A, my_rig->state.cache.split);
+    vfo_t vfo_b = vfo_fixup(my_rig, RIG_VFO_B, my_rig->state.cache.split);
+    freq_t freq_a = 0, freq_b = 0;
+    rmode_t mode = RIG_MODE_NONE;
+    pbwidth_t width = 0;
+    ptt_t ptt = RIG_PTT_OFF;
+    split_t split = RIG_SPLIT_OFF;
+    vfo_t vfo = RIG_VFO_A, tx_vfo = RIG_VFO_A;
+    int ok_a = 0, ok_b = 0, ok_mode = 0, ok_ptt, ok_split, ok_vfo;
+
+    if (freq_mode)
+    {
+        ok_a = rig_get_freq(my_rig, vfo_a, &freq_a) == RIG_OK;
+        ok_mode = rig_get_mode(my_rig, vfo_a, &mode, &width) == RIG_OK;
+    }
+
+    if (cache.want_freq_b)
+    {
+        ok_b = rig_get_freq(my_rig, vfo_b, &freq_b) == RIG_OK;
+    }
+
+    ok_ptt = rig_get_ptt(my_rig, vfo_a, &ptt) == RIG_OK;
+    ok_split = rig_get_split_vfo(my_rig, RIG_VFO_CURR, &split, &tx_vfo) == RIG_OK;
+    ok_vfo = rig_get_vfo(my_rig, &vfo) == RIG_OK;
+
+    CACHE_LOCK();
+    stats.refreshes++;
+
+    if (ok_a) { CACHE_STORE(freq_a, freq_a); }
+
+    if (ok_b) { CACHE_STORE(freq_b, freq_b); }
+
+    if (ok_mode) { CACHE_STORE(mode, mode); CACHE_STORE(width, width); }
+
+    if (ok_ptt) { CACHE_STORE(ptt, ptt); }
+
+    if (ok_split) { CACHE_STORE(split, split); cache.tx_vfo = tx_vfo; }
+
+    if (ok_vfo) { CACHE_STORE(vfo, vfo); }
+
+    if (ok_a || !freq_mode) { cache.valid = 1; }
+
+    CACHE_UNLOCK();
+}
+
+/* these run on the rig's async data thread */
+static int ts2000_freq_event(RIG *rig, vfo_t vfo, freq_t freq, rig_ptr_t arg)
+{
+    CACHE_LOCK();
+    stats.events++;
+
+    if (vfo == RIG_VFO_CURR) { vfo = cache.vfo; }
+
+    if (vfo == RIG_VFO_B || vfo == RIG_VFO_SUB)
+    {
+        CACHE_STORE(freq_b, freq);
+    }
+    else
+    {
+        CACHE_STORE(freq_a, freq);
+    }
+
+    CACHE_UNLOCK();
+    return RIG_OK;
+}
+
+static int ts2000_mode_event(RIG *rig, vfo_t vfo, rmode_t mode,
+                             pbwidth_t width, rig_ptr_t arg)
+{
+    CACHE_LOCK();
+    stats.events++;
+    CACHE_STORE(mode, mode);
+    CACHE_STORE(width, width);
+    CACHE_UNLOCK();
+    return RIG_OK;
+}
+
+static int ts2000_ptt_event(RIG *rig, vfo_t vfo, ptt_t ptt, rig_ptr_t arg)
+{
+    CACHE_LOCK();
+    stats.events++;
+    CACHE_STORE(ptt, ptt);
+    CACHE_UNLOCK();
+    return RIG_OK;
+}
+
+/* a read query is about to be answered from the cache */
+static void ts2000_query(void)
+{
+    int valid;
+
+    CACHE_LOCK();
+    stats.queries++;
+    valid = cache.valid;
+
+    if (valid) { stats.cached++; }
+
+    CACHE_UNLOCK();
+
+    if (!valid) { ts2000_refresh(1); }
+}
 
 #if 0
 static void handle_error(enum rig_debug_level_e lvl, const char *msg)
@@ -222,6 +394,10 @@ int main(int argc, char *argv[])
     char *civaddr = NULL;       /* NULL means no need to set conf */
     char conf_parms[MAXCONFLEN] = "";
     int status;
+    int interval_ms = 200;      /* how often the cache is refreshed */
+    int force_poll = 0;
+    int use_events;
+    struct timespec last_refresh;
 
     printf("rigctlcom Version 1.4\n");
 
@@ -441,6 +617,23 @@ int main(int argc, char *argv[])
             strncat(conf_parms, optarg, MAXCONFLEN - strlen(conf_parms));
             break;
 
+        case 'i':
+            if (!optarg)
+            {
+                usage();        /* wrong arg count */
+                exit(1);
+            }
+
+            interval_ms = atoi(optarg);
+
+            if (interval_ms < 10) { interval_ms = 10; }
+
+            break;
+
+        case 'N':
+            force_poll = 1;
+            break;
+
         case 'v':
             verbose++;
             break;
@@ -492,13 +685,38 @@ int main(int argc, char *argv[])
         exit(2);
     }
 
-    retcode = -RIG_ENIMPL;
-//    retcode = set_conf(my_rig, conf_parms);
+    char *token = strtok(conf_parms, ",");
 
-    if (retcode != RIG_OK)
+    while (token)
     {
-        fprintf(stderr, "Config parameter error: %s\n", rigerror(retcode));
-        exit(2);
+        char mytoken[100], myvalue[100];
+        token_t lookup;
+
+        if (sscanf(token, "%99[^=]=%99s", mytoken, myvalue) != 2)
+        {
+            fprintf(stderr, "Config parameter '%s' is not PARM=VAL\n", token);
+            usage();
+            exit(1);
+        }
+
+        lookup = rig_token_lookup(my_rig, mytoken);
+
+        if (lookup == RIG_CONF_END)
+        {
+            fprintf(stderr, "No such config parameter: %s\n", mytoken);
+            usage();
+            exit(1);
+        }
+
+        retcode = rig_set_conf(my_rig, lookup, myvalue);
+
+        if (retcode != RIG_OK)
+        {
+            fprintf(stderr, "Config parameter error: %s\n", rigerror(retcode));
+            exit(2);
+        }
+
+        token = strtok(NULL, ",");
     }
 
     if (my_model > 5 && !rig_file)
@@ -579,6 +797,18 @@ int main(int argc, char *argv[])
         exit(0);
     }
 
+    /* follow the rig's transceive data when it can send it */
+    if (!force_poll && my_rig->caps->async_data_supported)
+    {
+        rig_set_conf(my_rig, rig_token_lookup(my_rig, "async"), "1");
+    }
+
+#ifdef WIN32
+    SetConsoleCtrlHandler(CtrlHandler, TRUE);
+#else
+    signal(SIGINT, signal_handler);
+#endif
+
     /* open and close rig connection to check early for issues */
     retcode = rig_open(my_rig);
 
@@ -598,6 +828,30 @@ int main(int argc, char *argv[])
     rig_debug(RIG_DEBUG_VERBOSE, "Backend version: %s, Status: %s\n",
               my_rig->caps->version, rig_strstatus(my_rig->caps->status));
 
+#ifdef HAVE_PTHREAD
+    use_events = my_rig->state.async_data_enabled;
+
+    if (use_events)
+    {
+        /* the callbacks can only be set on an open rig */
+        rig_set_freq_callback(my_rig, ts2000_freq_event, NULL);
+        rig_set_mode_callback(my_rig, ts2000_mode_event, NULL);
+        rig_set_ptt_callback(my_rig, ts2000_ptt_event, NULL);
+    }
+
+#else
+    use_events = 0;
+#endif
+
+    if (verbose > 0)
+    {
+        printf("Following %s by %s\n", my_rig->caps->model_name,
+               use_events ? "freq/mode events" : "polling");
+    }
+
+    ts2000_refresh(1);
+    elapsed_ms(&last_refresh, HAMLIB_ELAPSED_SET);
+
     /*
      * main loop
      */
@@ -623,34 +877,34 @@ int main(int argc, char *argv[])
 
     do
     {
-        char ts2000[1024];
-        char *stop_set = ";\n\r";
-
-        memset(ts2000, 0, sizeof(ts2000));
-
-        status = read_string(&my_com,
-                             (unsigned char *) ts2000,
-                             sizeof(ts2000),
-                             stop_set,
-                             strlen(stop_set),
-                             0,
-                             1);
+        int wait_ms = interval_ms - (int)elapsed_ms(&last_refresh,
+                      HAMLIB_ELAPSED_GET);
 
-        rig_debug(RIG_DEBUG_TRACE, "%s: status=%d\n", __func__, status);
-
-        if (strlen(ts2000) > 0)
+        if (wait_ms <= 0)
         {
-            int retval = handle_ts2000(ts2000);
-
-            if (retval != RIG_OK)
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s: %s\n", __func__, rigerror(retval));
-            }
+            ts2000_refresh(!use_events);
+            elapsed_ms(&last_refresh, HAMLIB_ELAPSED_SET);
+            wait_ms = interval_ms;
         }
 
+        ts2000_push();
+
+        /* events can come in at any time, don't sit on them for long */
+        if (ai_mode && use_events && wait_ms > 50) { wait_ms = 50; }
+
+        retcode = ts2000_read(wait_ms);
     }
     while (retcode == 0 && !ctrl_c);
 
+    if (verbose > 0)
+    {
+        CACHE_LOCK();
+        printf("queries=%lu cached=%lu refreshes=%lu events=%lu pushed=%lu\n",
+               stats.queries, stats.cached, stats.refreshes, stats.events,
+               stats.pushed);
+        CACHE_UNLOCK();
+    }
+
     rig_close(my_rig);          /* close port */
     rig_cleanup(my_rig);        /* if you care about memory */
 
@@ -662,8 +916,11 @@ static rmode_t ts2000_get_mode()
 {
     rmode_t mode;
     pbwidth_t width;
-    rig_get_mode(my_rig, vfo_fixup(my_rig, RIG_VFO_A, my_rig->state.cache.split),
-                 &mode, &width);
+
+    CACHE_LOCK();
+    mode = cache.mode;
+    width = cache.width;
+    CACHE_UNLOCK();
 
     // Perhaps we should emulate a rig that has PKT modes instead??
     int kwidth_ssb[] = { 10, 50, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000 };
@@ -723,123 +980,242 @@ static int write_block2(void *func,
 }
 
 
+/* the IF; answer, also what goes out unsolicited when AI is on */
+static void ts2000_if(char *response, size_t len)
+{
+    int freq_step = 10;     // P2 just use default value for now
+    int rit_xit_freq = 0;   // P3 dummy value for now
+    int rit = 0;            // P4 dummy value for now
+    int xit = 0;            // P5 dummy value for now
+    int bank1 = 0;          // P6 dummy value for now
+    int bank2 = 0;          // P7 dummy value for now
+    int scan = 0;           // P11 dummy value for now
+    int p13 = 0;            // P13 Tone dummy value for now
+    int p14 = 0;            // P14 Tone Freq dummy value for now
+    int p15 = 0;            // P15 Shift status dummy value for now
+    rmode_t mode = ts2000_get_mode();   // P9
+    struct ts2000_cache c;
+    int nvfo = 0;           // P10
+    char *fmt =
+        // cppcheck-suppress *
+        "IF%011"PRIll"%04d+%05d%1d%1d%1d%02d%1d%1"PRIll"%1d%1d%1d%1d%02d%1d;";
+
+    CACHE_LOCK();
+    c = cache;
+    CACHE_UNLOCK();
+
+    switch (c.vfo)
+    {
+    case RIG_VFO_A:
+    case RIG_VFO_MAIN:
+    case RIG_VFO_MAIN_A:
+    case RIG_VFO_SUB_A:
+        nvfo = 0;
+        break;
+
+    case RIG_VFO_B:
+    case RIG_VFO_SUB:
+    case RIG_VFO_MAIN_B:
+    case RIG_VFO_SUB_B:
+        nvfo = 1;
+        break;
+
+    default:
+        rig_debug(RIG_DEBUG_ERR, "%s: unexpected vfo=%d\n", __func__, c.vfo);
+    }
+
+    SNPRINTF(response,
+             len,
+             fmt,
+             (uint64_t)c.freq_a,
+             freq_step,
+             rit_xit_freq,
+             rit, xit,
+             bank1,
+             bank2,
+             c.ptt,
+             mode,
+             nvfo,
+             scan,
+             c.split,
+             p13,
+             p14,
+             p15);
+}
+
+/* FA/FB sets go straight to the rig and into the cache */
+static int ts2000_set_freq(vfo_t vfo, freq_t freq)
+{
+    int retval = rig_set_freq(my_rig, vfo_fixup(my_rig, vfo,
+                              my_rig->state.cache.split), freq);
+
+    if (retval == RIG_OK)
+    {
+        CACHE_LOCK();
+
+        if (vfo == RIG_VFO_B) { cache.freq_b = freq; }
+        else { cache.freq_a = freq; }
+
+        CACHE_UNLOCK();
+    }
+
+    return retval;
+}
+
+/* with AI on, tell the application about what changed on the rig */
+static int ts2000_push(void)
+{
+    char response[64];
+    int changed;
+
+    CACHE_LOCK();
+    changed = cache.changed && cache.valid && ai_mode;
+    cache.changed = 0;
+
+    if (changed) { stats.pushed++; }
+
+    CACHE_UNLOCK();
+
+    if (!changed) { return RIG_OK; }
+
+    ts2000_if(response, sizeof(response));
+    return write_block2((void *)__func__, &my_com, response, strlen(response));
+}
+
 /*
- * This handles the TS-2000 emulation
+ * Wait up to timeout_ms for the application and run every complete command
+ * it sent.  Partial commands are kept for the next call, so the main loop
+ * never blocks on a slow writer and can keep the cache fresh meanwhile.
  */
-static int handle_ts2000(void *arg)
+static int ts2000_read(int timeout_ms)
 {
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: cmd=%s\n", __func__, (char *)arg);
+#if defined(HAVE_SELECT) && !defined(WIN32)
+    static char buf[1024];
+    static int len;
+    char cmd[1024];
+    struct timeval tv;
+    fd_set rfds;
+    int start = 0;
+    int i, n;
 
-    // Handle all the queries
-    if (strcmp(arg, "ID;") == 0)
+    FD_ZERO(&rfds);
+    FD_SET(my_com.fd, &rfds);
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    n = select(my_com.fd + 1, &rfds, NULL, NULL, &tv);
+
+    if (n < 0) { return errno == EINTR ? RIG_OK : -RIG_EIO; }
+
+    if (n == 0) { return RIG_OK; }
+
+    n = read(my_com.fd, buf + len, sizeof(buf) - 1 - len);
+
+    if (n < 0) { return errno == EINTR || errno == EAGAIN ? RIG_OK : -RIG_EIO; }
+
+    len += n;
+
+    for (i = 0; i < len; i++)
     {
-        char *reply = "ID019;";
-        return write_block2((void *)__func__, &my_com, reply, strlen(reply));
+        if (buf[i] == '\n' || buf[i] == '\r')
+        {
+            start = i + 1;
+        }
+        else if (buf[i] == ';')
+        {
+            memcpy(cmd, buf + start, i + 1 - start);
+            cmd[i + 1 - start] = '\0';
+            start = i + 1;
+
+            n = handle_ts2000(cmd);
+
+            if (n != RIG_OK)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: %s\n", __func__, rigerror(n));
+            }
+        }
     }
 
-    if (strcmp(arg, "AI;") == 0)
+    len -= start;
+    memmove(buf, buf + start, len);
+
+    if (len == sizeof(buf) - 1)
     {
-        char *reply = "AI0;";
-        return write_block2((void *)__func__, &my_com, reply, strlen(reply));
+        rig_debug(RIG_DEBUG_ERR, "%s: no ';' in %d bytes, dropped\n", __func__, len);
+        len = 0;
     }
-    else if (strcmp(arg, "IF;") == 0)
-    {
-        freq_t freq;            // P1
-        int freq_step = 10;     // P2 just use default value for now
-        int rit_xit_freq = 0;   // P3 dummy value for now
-        int rit = 0;            // P4 dummy value for now
-        int xit = 0;            // P5 dummy value for now
-        int bank1 = 0;          // P6 dummy value for now
-        int bank2 = 0;          // P7 dummy value for now
-        ptt_t ptt;              // P8
-        rmode_t mode;           // P9
-        vfo_t vfo;              // P10
-        int scan = 0;           // P11 dummy value for now
-        split_t split = 0;      // P1 2
-        int p13 = 0;            // P13 Tone dummy value for now
-        int p14 = 0;            // P14 Tone Freq dummy value for now
-        int p15 = 0;            // P15 Shift status dummy value for now
-        int retval = rig_get_freq(my_rig, vfo_fixup(my_rig, RIG_VFO_A,
-                                  my_rig->state.cache.split), &freq);
-        char response[64];
-        char *fmt =
-            // cppcheck-suppress *
-            "IF%011"PRIll"%04d+%05d%1d%1d%1d%02d%1d%1"PRIll"%1d%1d%1d%1d%02d%1d;";
 
-        if (retval != RIG_OK)
-        {
-            return retval;
-        }
+    return RIG_OK;
+#else
+    char ts2000[1024];
+    char *stop_set = ";\n\r";
+    int status;
 
-        mode = ts2000_get_mode();
-        retval = rig_get_ptt(my_rig, vfo_fixup(my_rig, RIG_VFO_A,
-                                               my_rig->state.cache.split), &ptt);
+    memset(ts2000, 0, sizeof(ts2000));
+    my_com.timeout = timeout_ms;
 
-        if (retval != RIG_OK)
-        {
-            return retval;
-        }
+    status = read_string(&my_com,
+                         (unsigned char *) ts2000,
+                         sizeof(ts2000),
+                         stop_set,
+                         strlen(stop_set),
+                         0,
+                         1);
 
-        // we need to know split status -- don't care about the vfo
-        retval = rig_get_split_vfo(my_rig, RIG_VFO_CURR, &split, &vfo);
+    rig_debug(RIG_DEBUG_TRACE, "%s: status=%d\n", __func__, status);
+
+    if (strlen(ts2000) > 0)
+    {
+        int retval = handle_ts2000(ts2000);
 
         if (retval != RIG_OK)
         {
-            return retval;
+            rig_debug(RIG_DEBUG_ERR, "%s: %s\n", __func__, rigerror(retval));
         }
+    }
 
-        retval = rig_get_vfo(my_rig, &vfo);
+    return RIG_OK;
+#endif
+}
 
-        if (retval != RIG_OK)
-        {
-            return retval;
-        }
 
-        switch (vfo)
-        {
-        case RIG_VFO_A:
-        case RIG_VFO_MAIN:
-        case RIG_VFO_MAIN_A:
-        case RIG_VFO_SUB_A:
-            vfo = 0;
-            break;
+/*
+ * This handles the TS-2000 emulation
+ */
+static int handle_ts2000(void *arg)
+{
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: cmd=%s\n", __func__, (char *)arg);
 
-        case RIG_VFO_B:
-        case RIG_VFO_SUB:
-        case RIG_VFO_MAIN_B:
-        case RIG_VFO_SUB_B:
-            vfo = 1;
-            break;
+    // Handle all the queries
+    if (strcmp(arg, "ID;") == 0)
+    {
+        char *reply = "ID019;";
+        return write_block2((void *)__func__, &my_com, reply, strlen(reply));
+    }
 
-        default:
-            rig_debug(RIG_DEBUG_ERR, "%s: unexpected vfo=%d\n", __func__, vfo);
-        }
+    if (strcmp(arg, "AI;") == 0)
+    {
+        char response[32];
 
-        SNPRINTF(response,
-                 sizeof(response),
-                 fmt,
-                 (uint64_t)freq,
-                 freq_step,
-                 rit_xit_freq,
-                 rit, xit,
-                 bank1,
-                 bank2,
-                 ptt,
-                 mode,
-                 vfo,
-                 scan,
-                 split,
-                 p13,
-                 p14,
-                 p15);
+        SNPRINTF(response, sizeof(response), "AI%d;", ai_mode);
+        return write_block2((void *)__func__, &my_com, response, strlen(response));
+    }
+    else if (strcmp(arg, "IF;") == 0)
+    {
+        char response[64];
 
+        ts2000_query();
+        ts2000_if(response, sizeof(response));
         return write_block2((void *)__func__, &my_com, response, strlen(response));
     }
     else if (strcmp(arg, "MD;") == 0)
     {
-        rmode_t mode = ts2000_get_mode();
+        rmode_t mode;
         char response[32];
 
+        ts2000_query();
+        mode = ts2000_get_mode();
+
         SNPRINTF(response, sizeof(response), "MD%1d;", (int)mode);
         return write_block2((void *)__func__, &my_com, response, strlen(response));
     }
@@ -852,18 +1228,13 @@ static int handle_ts2000(void *arg)
     }
     else if (strcmp(arg, "FA;") == 0)
     {
-        freq_t freq = 0;
+        freq_t freq;
         char response[32];
 
-        int retval = rig_get_freq(my_rig, vfo_fixup(my_rig, RIG_VFO_A,
-                                  my_rig->state.cache.split), &freq);
-
-        if (retval != RIG_OK)
-        {
-            rig_debug(RIG_DEBUG_ERR, "%s: get freqA failed: %s\n", __func__,
-                      rigerror(retval));
-            return retval;
-        }
+        ts2000_query();
+        CACHE_LOCK();
+        freq = cache.freq_a;
+        CACHE_UNLOCK();
 
         SNPRINTF(response, sizeof(response), "FA%011"PRIll";", (uint64_t)freq);
         return write_block2((void *)__func__, &my_com, response, strlen(response));
@@ -872,14 +1243,31 @@ static int handle_ts2000(void *arg)
     {
         char response[32];
         freq_t freq = 0;
-        int retval = rig_get_freq(my_rig, vfo_fixup(my_rig, RIG_VFO_B,
-                                  my_rig->state.cache.split), &freq);
 
-        if (retval != RIG_OK)
+        if (!cache.want_freq_b)
         {
-            rig_debug(RIG_DEBUG_ERR, "%s: get freqB failed: %s\n", __func__,
-                      rigerror(retval));
-            return retval;
+            /* first FB; -- read it now and keep it fresh from here on */
+            int retval = rig_get_freq(my_rig, vfo_fixup(my_rig, RIG_VFO_B,
+                                      my_rig->state.cache.split), &freq);
+
+            if (retval != RIG_OK)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: get freqB failed: %s\n", __func__,
+                          rigerror(retval));
+                return retval;
+            }
+
+            CACHE_LOCK();
+            cache.freq_b = freq;
+            cache.want_freq_b = 1;
+            CACHE_UNLOCK();
+        }
+        else
+        {
+            ts2000_query();
+            CACHE_LOCK();
+            freq = cache.freq_b;
+            CACHE_UNLOCK();
         }
 
         SNPRINTF(response, sizeof(response), "FB%011"PRIll";", (uint64_t)freq);
@@ -896,7 +1284,14 @@ static int handle_ts2000(void *arg)
     {
         char response[32];
 
-        rig_set_ptt(my_rig, vfo_fixup(my_rig, RIG_VFO_A, my_rig->state.cache.split), 0);
+        if (rig_set_ptt(my_rig, vfo_fixup(my_rig, RIG_VFO_A,
+                                          my_rig->state.cache.split), 0) == RIG_OK)
+        {
+            CACHE_LOCK();
+            cache.ptt = RIG_PTT_OFF;
+            CACHE_UNLOCK();
+        }
+
         SNPRINTF(response, sizeof(response), "RX0;");
         return write_block2((void *)__func__, &my_com, response, strlen(response));
     }
@@ -927,42 +1322,64 @@ static int handle_ts2000(void *arg)
     }
     else if (strcmp(arg, "TX;") == 0)
     {
-        return rig_set_ptt(my_rig, vfo_fixup(my_rig, RIG_VFO_A,
-                                             my_rig->state.cache.split), 1);
+        int retval = rig_set_ptt(my_rig, vfo_fixup(my_rig, RIG_VFO_A,
+                                 my_rig->state.cache.split), 1);
+
+        if (retval == RIG_OK)
+        {
+            CACHE_LOCK();
+            cache.ptt = RIG_PTT_ON;
+            CACHE_UNLOCK();
+        }
+
+        return retval;
     }
     else if (strcmp(arg, "AI0;") == 0)
     {
-        // nothing to do
+        ai_mode = 0;
         return RIG_OK;
     }
-    else if (strcmp(arg, ";") == 0)
+    else if (strcmp(arg, "AI1;") == 0 || strcmp(arg, "AI2;") == 0
+             || strcmp(arg, "AI3;") == 0)
     {
-        // nothing to do
+        /* we send IF; on every change, whatever the level */
+        ai_mode = ((char *)arg)[2] - '0';
+        CACHE_LOCK();
+        cache.changed = 0;
+        CACHE_UNLOCK();
         return RIG_OK;
     }
-    else if (strcmp(arg, "FR0;") == 0)
+    else if (strcmp(arg, ";") == 0)
     {
-        return rig_set_vfo(my_rig, vfo_fixup(my_rig, RIG_VFO_A,
-                                             my_rig->state.cache.split));
+        // nothing to do
+        return RIG_OK;
     }
-    else if (strcmp(arg, "FR1;") == 0)
+    else if (strcmp(arg, "FR0;") == 0 || strcmp(arg, "FR1;") == 0)
     {
-        return rig_set_vfo(my_rig, vfo_fixup(my_rig, RIG_VFO_B,
-                                             my_rig->state.cache.split));
+        vfo_t vfo = vfo_fixup(my_rig, ((char *)arg)[2] == '0' ? RIG_VFO_A : RIG_VFO_B,
+                              my_rig->state.cache.split);
+        int retval = rig_set_vfo(my_rig, vfo);
+
+        if (retval == RIG_OK)
+        {
+            CACHE_LOCK();
+            cache.vfo = vfo;
+            CACHE_UNLOCK();
+        }
+
+        return retval;
     }
     else if (strcmp(arg, "FR;") == 0)
     {
         char response[32];
         vfo_t vfo;
-        int retval = rig_get_vfo(my_rig, &vfo);
+        int retval;
         int nvfo = 0;
 
-        if (retval != RIG_OK)
-        {
-            rig_debug(RIG_DEBUG_ERR, "%s: get vfo failed: %s\n", __func__,
-                      rigerror(retval));
-            return retval;
-        }
+        ts2000_query();
+        CACHE_LOCK();
+        vfo = cache.vfo;
+        CACHE_UNLOCK();
 
 
         if (vfo == vfo_fixup(my_rig, RIG_VFO_A, my_rig->state.cache.split)) { nvfo = 0; }
@@ -981,17 +1398,14 @@ static int handle_ts2000(void *arg)
     else if (strcmp(arg, "FT;") == 0)
     {
         char response[32];
-        vfo_t vfo, vfo_curr = vfo_fixup(my_rig, RIG_VFO_A, my_rig->state.cache.split);
-        split_t split;
+        vfo_t vfo;
+        int retval;
         int nvfo = 0;
-        int retval = rig_get_split_vfo(my_rig, vfo_curr, &split, &vfo);
 
-        if (retval != RIG_OK)
-        {
-            rig_debug(RIG_DEBUG_ERR, "%s: get split vfo failed: %s\n", __func__,
-                      rigerror(retval));
-            return retval;
-        }
+        ts2000_query();
+        CACHE_LOCK();
+        vfo = cache.tx_vfo;
+        CACHE_UNLOCK();
 
 
         if (vfo == vfo_fixup(my_rig, RIG_VFO_A, my_rig->state.cache.split)) { nvfo = 0; }
@@ -1535,16 +1949,14 @@ static int handle_ts2000(void *arg)
         if (mapa2b) { vfo = RIG_VFO_B; }
 
         sscanf((char *)arg + 2, "%"SCNfreq, &freq);
-        return rig_set_freq(my_rig, vfo_fixup(my_rig, vfo,
-                                              my_rig->state.cache.split), freq);
+        return ts2000_set_freq(vfo, freq);
     }
     else if (strncmp(arg, "FB0", 3) == 0)
     {
         freq_t freq;
 
         sscanf((char *)arg + 2, "%"SCNfreq, &freq);
-        return rig_set_freq(my_rig, vfo_fixup(my_rig, RIG_VFO_B,
-                                              my_rig->state.cache.split), freq);
+        return ts2000_set_freq(RIG_VFO_B, freq);
     }
     else if (strncmp(arg, "MD", 2) == 0)
     {
@@ -1729,6 +2141,8 @@ void usage()
         "  -c, --civaddr=ID              set CI-V address, decimal (for Icom rigs only)\n"
         "  -C, --set-conf=PARM=VAL       set config parameters\n"
         "  -B, --mapa2b                  maps set_freq on VFOA to VFOB -- useful for CW Skimmer\n"
+        "  -i, --interval=MS             refresh the rig state every MS milliseconds [default=200]\n"
+        "  -N, --poll                    poll the rig even if it can send transceive data\n"
         "  -L, --show-conf               list all config parameters\n"
         "  -l, --list                    list all model numbers and exit\n"
         "  -u, --dump-caps               dump capabilities and exit\n"
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <errno.h>
 #include <signal.h>
@@ -79,7 +80,7 @@
  *      keep up to date SHORT_OPTIONS, usage()'s output and man page. thanks.
  * TODO: add an option to read from a file
  */
-#define SHORT_OPTIONS "m:r:p:d:P:D:s:S:c:T:t:C:W:w:x:z:lLuovhVZMRA:n:"
+#define SHORT_OPTIONS "m:r:p:d:P:D:s:S:c:T:t:C:W:w:x:z:lLuovhVZMRA:n:FQ:"
 static struct option long_options[] =
 {
     {"model",           1, 0, 'm'},
@@ -108,31 +109,110 @@ static struct option long_options[] =
     {"password",        1, 0, 'A'},
     {"rigctld-idle",    0, 0, 'R'},
     {"bind-all",        0, 0, 'b'},
+    {"freq-coalesce",   0, 0, 'F'},
+    {"client-queue",    1, 0, 'Q'},
     {0, 0, 0, 0}
 };
 
 
+#define MAXCONFLEN 2048
+
+/*
+ * With fmemopen() the clients of all rigs are served by one event loop in
+ * the main thread and one worker thread per rig, instead of one thread per
+ * client.  -F needs concurrent callers and keeps the thread per client.
+ */
+#if defined(HAVE_PTHREAD) && defined(HAVE_FMEMOPEN)
+#  define RIGCTLD_REACTOR 1
+#  include <fcntl.h>
+#endif
+
+#define RIGCTLD_MAX_RIGS 16
+#define RIGCTLD_INBUF 4096
+#define RIGCTLD_OUTBUF 65536    /* response buffer without open_memstream() */
+
+struct rigctld_rig;
+
 struct handle_data
 {
     RIG *rig;
+    struct rigctld_rig *r;
     int sock;
     struct sockaddr_storage cli_addr;
     socklen_t clilen;
     int vfo_mode;
     int use_password;
+#ifdef RIGCTLD_REACTOR
+    int ext_resp;
+    char resp_sep;
+    int started;                /* the worker has seen it */
+    int queued;                 /* on the rig's ready list */
+    int busy;                   /* the worker is running one of its commands */
+    int dead;                   /* quit or failed, reaped when not busy */
+    int hangup;                 /* sent EOF, reaped once inbuf is done */
+    size_t inlen;
+    char inbuf[RIGCTLD_INBUF];
+    char *out;                  /* responses not sent yet */
+    size_t outlen;
+    size_t outsize;             /* client_queue, or one larger response */
+    size_t outpeak;             /* most bytes ever waiting in out */
+    unsigned long outsent;
+    struct handle_data *next;           /* all clients, event loop only */
+    struct handle_data *ready_next;
+#endif
+};
+
+/* one per -m */
+struct rigctld_rig
+{
+    RIG *rig;
+    char portno[NI_MAXSERV];
+    int sock_listen;
+    volatile int opened;
+    powerstat_t powerstat;
+    unsigned clients;
+    unsigned long accepted;
+    unsigned long commands;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t lock;       /* rig_open/rig_close, and commands for -F */
+#endif
+#ifdef RIGCTLD_REACTOR
+    pthread_t worker;
+    pthread_cond_t cond;
+    struct handle_data *ready_head;     /* clients with a command waiting */
+    struct handle_data *ready_tail;
+    int idle_close;             /* last client gone, close the rig */
+    char *outbuf;               /* the worker's response of one command */
+    size_t outsize;
+    size_t outpeak;
+    unsigned long dropped;      /* clients that overflowed client_queue */
+#endif
+};
+
+/* the options that follow a -m, up to the next one */
+struct rig_opts
+{
+    rig_model_t model;
+    const char *rig_file;
+    const char *ptt_file;
+    const char *dcd_file;
+    ptt_type_t ptt_type;
+    dcd_type_t dcd_type;
+    int serial_rate;
+    char *civaddr;
+    const char *portno;
+    char conf_parms[MAXCONFLEN];
 };
 
 
 void *handle_socket(void *arg);
 void usage(void);
+static FILE *get_fsockout(struct handle_data *handle_data_arg);
+static FILE *get_fsockin(struct handle_data *handle_data_arg);
 
 
-#ifdef HAVE_PTHREAD
-static unsigned client_count;
-#endif
-
-static RIG *my_rig;             /* handle to rig (instance) */
-static volatile int rig_opened = 0;
+static struct rigctld_rig rigs[RIGCTLD_MAX_RIGS];
+static int nrigs;
 static int verbose;
 
 #ifdef HAVE_SIG_ATOMIC_T
@@ -146,14 +226,36 @@ const char *src_addr = NULL; /* INADDR_ANY */
 extern char rigctld_password[65];
 char resp_sep = '\n';
 extern int lock_mode;
-extern powerstat_t rig_powerstat;
 static int rigctld_idle =
     0; // if true then rig will close when no clients are connected
 static int skip_open = 0;
 static int bind_all = 0;
+static int freq_coalesce = 0;
+static int twiddle_timeout = 0;
+static int twiddle_rit = 0;
+static int uplink = 0;
+static size_t client_queue = 4 * RIGCTLD_OUTBUF;
 
-#define MAXCONFLEN 2048
 
+static void rigctld_lock(struct rigctld_rig *r, int lock)
+{
+#ifdef HAVE_PTHREAD
+
+    if (lock) { pthread_mutex_lock(&r->lock); }
+    else { pthread_mutex_unlock(&r->lock); }
+
+#endif
+}
+
+#ifdef HAVE_PTHREAD
+/* the rig of the client thread, rigctl_parse's sync_cb has no argument */
+static pthread_key_t rig_key;
+
+static void rigctld_sync(int lock)
+{
+    rigctld_lock(pthread_getspecific(rig_key), lock);
+}
+#endif
 
 void mutex_rigctld(int lock)
 {
@@ -179,109 +281,1115 @@ static BOOL WINAPI CtrlHandler(DWORD fdwCtrlType)
 {
     rig_debug(RIG_DEBUG_VERBOSE, "%s: called\n", __func__);
 
-    switch (fdwCtrlType)
-    {
-    case CTRL_C_EVENT:
-    case CTRL_CLOSE_EVENT:
-        ctrl_c = 1;
-        return TRUE;
+    switch (fdwCtrlType)
+    {
+    case CTRL_C_EVENT:
+    case CTRL_CLOSE_EVENT:
+        ctrl_c = 1;
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+#else
+static void signal_handler(int sig)
+{
+    switch (sig)
+    {
+    case SIGINT:
+    case SIGTERM:
+        fprintf(stderr, "\nTerminating application, caught signal %d\n", sig);
+        // Close stdin to stop reading input
+        fclose(stdin);
+        ctrl_c = 1;
+        break;
+
+    default:
+        /* do nothing */
+        break;
+    }
+}
+#endif
+
+static void handle_error(enum rig_debug_level_e lvl, const char *msg)
+{
+    int e;
+#ifdef __MINGW32__
+    LPVOID lpMsgBuf;
+
+    lpMsgBuf = (LPVOID)"Unknown error";
+    e = WSAGetLastError();
+
+    if (FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER
+                      | FORMAT_MESSAGE_FROM_SYSTEM
+                      | FORMAT_MESSAGE_IGNORE_INSERTS,
+                      NULL, e,
+                      MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                      // Default language
+                      (LPTSTR)&lpMsgBuf, 0, NULL))
+    {
+
+        rig_debug(lvl, "%s: Network error %d: %s\n", msg, e, (char *)lpMsgBuf);
+        LocalFree(lpMsgBuf);
+    }
+    else
+    {
+        rig_debug(lvl, "%s: Network error %d\n", msg, e);
+    }
+
+#else
+    e = errno;
+    rig_debug(lvl, "%s: Network error %d: %s\n", msg, e, strerror(e));
+#endif
+}
+
+/* set up the rig one -m and the options after it describe */
+static RIG *rigctld_rig_init(struct rig_opts *o)
+{
+    RIG *my_rig = rig_init(o->model);
+    char *token;
+    int retcode;
+
+    if (!my_rig)
+    {
+        fprintf(stderr,
+                "Unknown rig num %u, or initialization error.\n",
+                o->model);
+
+        fprintf(stderr, "Please check with --list option.\n");
+        exit(2);
+    }
+    
+    token=strtok(o->conf_parms,",");
+    while(token)
+    {
+        char mytoken[100], myvalue[100];
+        token_t lookup;
+        sscanf(token,"%99[^=]=%99s", mytoken, myvalue);
+        //printf("mytoken=%s,myvalue=%s\n",mytoken, myvalue);
+        lookup = rig_token_lookup(my_rig,mytoken);
+        if (lookup == 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: no such token as '%s'\n", __func__, mytoken);
+            token = strtok(NULL, ",");
+            continue;
+        }
+        retcode = rig_set_conf(my_rig, rig_token_lookup(my_rig,mytoken), myvalue);
+        if (retcode != RIG_OK)
+        {
+            fprintf(stderr, "Config parameter error: %s\n", rigerror(retcode));
+            exit(2);
+        }
+        token = strtok(NULL, ",");
+    }
+
+    if (o->rig_file)
+    {
+        strncpy(my_rig->state.rigport.pathname, o->rig_file, HAMLIB_FILPATHLEN - 1);
+    }
+
+    if (freq_coalesce)
+    {
+        rig_set_conf(my_rig, rig_token_lookup(my_rig, "freq_coalesce"), "1");
+    }
+
+    my_rig->state.twiddle_timeout = twiddle_timeout;
+    my_rig->state.twiddle_rit = twiddle_rit;
+    my_rig->state.uplink = uplink;
+    rig_debug(RIG_DEBUG_TRACE, "%s: twiddle=%d, uplink=%d, twiddle_rit=%d\n",
+              __func__,
+              my_rig->state.twiddle_timeout, my_rig->state.uplink, my_rig->state.twiddle_rit);
+
+    /*
+     * ex: RIG_PTT_PARALLEL and /dev/parport0
+     */
+    if (o->ptt_type != RIG_PTT_NONE)
+    {
+        my_rig->state.pttport.type.ptt = o->ptt_type;
+        my_rig->state.pttport_deprecated.type.ptt = o->ptt_type;
+        // This causes segfault since backend rig_caps are const
+        // rigctld will use the rig->state version of this for clients
+        //my_rig->caps->ptt_type = o->ptt_type;
+    }
+
+    if (o->dcd_type != RIG_DCD_NONE)
+    {
+        my_rig->state.dcdport.type.dcd = o->dcd_type;
+        my_rig->state.dcdport_deprecated.type.dcd = o->dcd_type;
+    }
+
+    if (o->ptt_file)
+    {
+        strncpy(my_rig->state.pttport.pathname, o->ptt_file, HAMLIB_FILPATHLEN - 1);
+        strncpy(my_rig->state.pttport_deprecated.pathname, o->ptt_file,
+                HAMLIB_FILPATHLEN - 1);
+    }
+
+    if (o->dcd_file)
+    {
+        strncpy(my_rig->state.dcdport.pathname, o->dcd_file, HAMLIB_FILPATHLEN - 1);
+        strncpy(my_rig->state.dcdport_deprecated.pathname, o->dcd_file,
+                HAMLIB_FILPATHLEN - 1);
+    }
+
+    /* FIXME: bound checking and port type == serial */
+    if (o->serial_rate != 0)
+    {
+        my_rig->state.rigport.parm.serial.rate = o->serial_rate;
+        my_rig->state.rigport_deprecated.parm.serial.rate = o->serial_rate;
+    }
+
+    if (o->civaddr)
+    {
+        rig_set_conf(my_rig, rig_token_lookup(my_rig, "civaddr"), o->civaddr);
+    }
+
+    return my_rig;
+}
+
+/* bind and listen on port, exits when that is not possible */
+static int rigctld_listen(const char *port)
+{
+    struct addrinfo hints, *result, *saved_result;
+    int sock_listen;
+    int retcode;
+
+    /*
+     * Prepare listening socket
+     */
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;    /* Allow IPv4 or IPv6 */
+    hints.ai_socktype = SOCK_STREAM;/* TCP socket */
+    hints.ai_flags = AI_PASSIVE;    /* For wildcard IP address */
+    hints.ai_protocol = 0;          /* Any protocol */
+
+    retcode = getaddrinfo(src_addr, port, &hints, &result);
+
+    if (retcode == 0 && result->ai_family == AF_INET6)
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s: Using IPV6\n", __func__);
+    }
+    else if (retcode == 0)
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s: Using IPV4\n", __func__);
+    }
+    else
+    {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(retcode));
+        exit(2);
+    }
+
+    saved_result = result;
+
+    do
+    {
+        sock_listen = socket(result->ai_family,
+                             result->ai_socktype,
+                             result->ai_protocol);
+
+        if (sock_listen < 0)
+        {
+            handle_error(RIG_DEBUG_ERR, "socket");
+            freeaddrinfo(saved_result);     /* No longer needed */
+            exit(2);
+        }
+    int optval = 1;
+#ifdef __MINGW32__
+    if (setsockopt(sock_listen, SOL_SOCKET, SO_REUSEADDR, (PCHAR)&optval, sizeof(optval)) < 0)
+#else
+    if (setsockopt(sock_listen, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) < 0)
+#endif
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: error enabling UDP address reuse: %s\n", __func__,
+                strerror(errno));
+    }
+
+    // Windows does not have SO_REUSEPORT. However, SO_REUSEADDR works in a similar way.
+#if defined(SO_REUSEPORT)
+    if (setsockopt(sock_listen, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: error enabling UDP port reuse: %s\n", __func__,
+                strerror(errno));
+    }
+#endif
+
+
+#if 0
+        if (setsockopt(sock_listen,
+                       SOL_SOCKET,
+                       SO_REUSEADDR,
+                       (char *)&reuseaddr,
+                       sizeof(reuseaddr))
+                < 0)
+        {
+
+            handle_error(RIG_DEBUG_ERR, "setsockopt");
+            freeaddrinfo(saved_result);     /* No longer needed */
+            exit(1);
+        }
+#endif
+
+#ifdef IPV6_V6ONLY
+
+        if (AF_INET6 == result->ai_family)
+        {
+            /* allow IPv4 mapped to IPv6 clients Windows and BSD default
+               this to 1 (i.e. disallowed) and we prefer it off */
+            int sockopt = 0;
+
+            if (setsockopt(sock_listen,
+                           IPPROTO_IPV6,
+                           IPV6_V6ONLY,
+                           (char *)&sockopt,
+                           sizeof(sockopt))
+                    < 0)
+            {
+
+                handle_error(RIG_DEBUG_ERR, "setsockopt");
+                freeaddrinfo(saved_result);     /* No longer needed */
+                exit(1);
+            }
+        }
+
+#endif
+
+        int retval = bind(sock_listen, result->ai_addr, result->ai_addrlen);
+        if (retval == 0)
+        {
+            break;
+        }
+        {
+            rig_debug(RIG_DEBUG_ERR,"%s: bind: %s\n", __func__, strerror(errno));
+        }
+
+        if (bind_all)
+            handle_error(RIG_DEBUG_WARN, "binding failed (trying next interface)");
+        else
+            handle_error(RIG_DEBUG_WARN, "binding failed");
+#ifdef __MINGW32__
+        closesocket(sock_listen);
+#else
+        close(sock_listen);
+#endif
+    }
+    while (bind_all && ((result = result->ai_next) != NULL));
+
+    freeaddrinfo(saved_result);     /* No longer needed */
+
+    if (NULL == result)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: bind error - no available interface\n", __func__);
+        exit(1);
+    }
+
+    if (listen(sock_listen, 4) < 0)
+    {
+        handle_error(RIG_DEBUG_ERR, "listening");
+        exit(1);
+    }
+
+    return sock_listen;
+}
+
+/* add the listening sockets of all rigs to set */
+static void rigctld_fd_set_listen(fd_set *set, int *maxfd)
+{
+    int i;
+
+    for (i = 0; i < nrigs; i++)
+    {
+        FD_SET(rigs[i].sock_listen, set);
+
+        if (rigs[i].sock_listen > *maxfd) { *maxfd = rigs[i].sock_listen; }
+    }
+}
+
+/* accept a client of r, NULL if that fails */
+static struct handle_data *rigctld_accept(struct rigctld_rig *r, int vfo_mode)
+{
+    struct handle_data *arg;
+    char host[NI_MAXHOST];
+    char serv[NI_MAXSERV];
+    int retcode;
+
+    arg = calloc(1, sizeof(struct handle_data));
+
+    if (!arg)
+    {
+        rig_debug(RIG_DEBUG_ERR, "calloc: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    if (rigctld_password[0] != 0) { arg->use_password = 1; }
+
+    arg->r = r;
+    arg->rig = r->rig;
+    arg->clilen = sizeof(arg->cli_addr);
+    arg->vfo_mode = vfo_mode;
+    arg->sock = accept(r->sock_listen,
+                       (struct sockaddr *)&arg->cli_addr,
+                       &arg->clilen);
+
+    if (arg->sock < 0)
+    {
+        handle_error(RIG_DEBUG_ERR, "accept");
+        free(arg);
+        return NULL;
+    }
+
+    if ((retcode = getnameinfo((struct sockaddr const *)&arg->cli_addr,
+                               arg->clilen,
+                               host,
+                               sizeof(host),
+                               serv,
+                               sizeof(serv),
+                               NI_NUMERICHOST | NI_NUMERICSERV))
+            < 0)
+    {
+        rig_debug(RIG_DEBUG_WARN,
+                  "Peer lookup error: %s",
+                  gai_strerror(retcode));
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE,
+              "Connection opened from %s:%s to port %s\n",
+              host,
+              serv,
+              r->portno);
+
+    return arg;
+}
+
+/*
+ * After a hard error close the rig and try to open it again, this should
+ * cover short dropouts that can occur.  Returns the last rig_open status.
+ */
+static int rigctld_reopen(struct rigctld_rig *r)
+{
+    int retry = 3;
+    int retcode;
+    const struct rig_state *rs = &r->rig->state;
+
+    /* a dropped network port is reconnected by the next command, see
+       network_reconnect(), closing the rig here only adds a stall */
+    if (rs->comm_state && rs->comm_status == RIG_COMM_STATUS_DISCONNECTED
+            && rs->net_reconnect)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: connection lost, reconnecting\n", __func__);
+        return RIG_OK;
+    }
+
+    rig_debug(RIG_DEBUG_ERR, "%s: i/o error\n", __func__);
+
+    do
+    {
+        rigctld_lock(r, 1);
+        retcode = rig_close(r->rig);
+        r->opened = 0;
+        rigctld_lock(r, 0);
+        rig_debug(RIG_DEBUG_ERR, "%s: rig_close retcode=%d\n", __func__, retcode);
+
+        hl_usleep(1000 * 1000);
+
+        rigctld_lock(r, 1);
+
+        if (!r->opened)
+        {
+            retcode = rig_open(r->rig);
+            r->opened = retcode == RIG_OK ? 1 : 0;
+            rig_debug(RIG_DEBUG_ERR, "%s: rig_open retcode=%d, opened=%d\n", __func__,
+                      retcode, r->opened);
+        }
+
+        rigctld_lock(r, 0);
+    }
+    while (!ctrl_c && !r->opened && retry-- > 0 && retcode != RIG_OK);
+
+    return retcode;
+}
+
+/* the rig may have been closed (-R or an error), open it for a command */
+static void rigctld_check_open(struct rigctld_rig *r)
+{
+    /* don't queue behind a busy rig before the next command is read */
+    if (!r->opened)
+    {
+        rigctld_lock(r, 1);
+
+        if (!r->opened)
+        {
+            int retcode = rig_open(r->rig);
+            r->opened = retcode == RIG_OK ? 1 : 0;
+            rig_debug(RIG_DEBUG_ERR, "%s: rig_open reopened retcode=%d\n", __func__,
+                      retcode);
+        }
+
+        rigctld_lock(r, 0);
+    }
+}
+
+/* one thread per client, for -F and where there is no fmemopen() */
+static void rigctld_threads(int vfo_mode)
+{
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    pthread_key_create(&rig_key, NULL);
+#endif
+    int retcode;
+
+    do
+    {
+        fd_set set;
+        struct timeval timeout;
+        int maxfd = -1;
+        int i;
+
+        /* use select to allow for periodic checks for CTRL+C */
+        FD_ZERO(&set);
+        rigctld_fd_set_listen(&set, &maxfd);
+        timeout.tv_sec = 5;
+        timeout.tv_usec = 0;
+        retcode = select(maxfd + 1, &set, NULL, NULL, &timeout);
+
+        if (retcode == -1)
+        {
+            int errno_stored = errno;
+            rig_debug(RIG_DEBUG_ERR, "%s: select() failed: %s\n", __func__,
+                      strerror(errno_stored));
+
+            if (ctrl_c)
+            {
+                rig_debug(RIG_DEBUG_VERBOSE, "%s: ctrl_c when retcode==-1\n", __func__);
+                break;
+            }
+
+            if (errno == EINTR)
+            {
+                rig_debug(RIG_DEBUG_VERBOSE, "%s: ignoring interrupted system call\n",
+                          __func__);
+            }
+
+            continue;
+        }
+        else if (retcode == 0)
+        {
+            if (ctrl_c)
+            {
+                rig_debug(RIG_DEBUG_VERBOSE, "%s: ctrl_c when retcode==0\n", __func__);
+                break;
+            }
+
+            continue;
+        }
+
+        for (i = 0; i < nrigs; i++)
+        {
+            struct handle_data *arg;
+
+            if (!FD_ISSET(rigs[i].sock_listen, &set)) { continue; }
+
+            arg = rigctld_accept(&rigs[i], vfo_mode);
+
+            if (!arg)
+            {
+                return;
+            }
+
+#ifdef HAVE_PTHREAD
+            pthread_attr_init(&attr);
+            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+            retcode = pthread_create(&thread, &attr, handle_socket, arg);
+
+            if (retcode != 0)
+            {
+                rig_debug(RIG_DEBUG_ERR, "pthread_create: %s\n", strerror(retcode));
+                return;
+            }
+
+#else
+            handle_socket(arg);
+#endif
+        }
+    }
+    while (!ctrl_c);
+}
+
+
+#ifdef RIGCTLD_REACTOR
+/*
+ * The event loop in the main thread owns the sockets: it accepts, reads
+ * what clients send into their inbuf and puts clients that have a whole
+ * line on their rig's ready list.  Responses are queued in the client's
+ * out buffer and sent by the loop without blocking, so a client on a slow
+ * link never holds up a worker or the other clients.  Each rig's worker runs one command at a
+ * time off that list, round robin, so a client pipelining commands cannot
+ * starve the others and threads scale with rigs, not clients.
+ */
+static pthread_mutex_t reactor_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct handle_data *client_list;
+static int wake_pipe[2];        /* workers wake the loop to send responses */
+
+/* queue c on its rig's worker if it has a command, reactor_lock held */
+static void rigctld_ready(struct handle_data *c)
+{
+    struct rigctld_rig *r = c->r;
+
+    if (c->queued || c->busy || c->dead || !memchr(c->inbuf, '\n', c->inlen))
+    {
+        return;
+    }
+
+    c->queued = 1;
+    c->ready_next = NULL;
+
+    if (r->ready_tail) { r->ready_tail->ready_next = c; }
+    else { r->ready_head = c; }
+
+    r->ready_tail = c;
+    pthread_cond_signal(&r->cond);
+}
+
+/* tell the event loop there is something to send */
+static void rigctld_wake(void)
+{
+    static const char b = 0;
+
+    if (write(wake_pipe[1], &b, 1) < 0 && errno != EAGAIN)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s\n", __func__, strerror(errno));
+    }
+}
+
+/* a stream for the response of one command in r->outbuf */
+static FILE *rigctld_outopen(struct rigctld_rig *r)
+{
+#ifdef HAVE_OPEN_MEMSTREAM
+    free(r->outbuf);
+    r->outbuf = NULL;
+    return open_memstream(&r->outbuf, &r->outsize);
+#else
+    r->outsize = RIGCTLD_OUTBUF;
+    return fmemopen(r->outbuf, RIGCTLD_OUTBUF, "w");
+#endif
+}
+
+/*
+ * Run the first command in the avail bytes of c->inbuf, the response goes
+ * to r->outbuf and its length to *outlen.  Returns how many bytes it used,
+ * 0 when the command is not complete yet.  Arguments are normally on the
+ * command line, but a command may carry on to the next.
+ */
+static size_t rigctld_run(struct rigctld_rig *r, struct handle_data *c,
+                          size_t avail, int *retcode, size_t *outlen)
+{
+    char *nl = memchr(c->inbuf, '\n', avail);
+    size_t blank = 0;
+
+    /* rigctl_parse leaves the line end behind, it is not a command */
+    while (blank < avail && isspace((unsigned char)c->inbuf[blank])) { blank++; }
+
+    if (blank)
+    {
+        *retcode = RIG_OK;
+        return blank;
+    }
+
+    *outlen = 0;
+
+    while (nl)
+    {
+        size_t len = nl - c->inbuf + 1;
+        FILE *fin = fmemopen(c->inbuf, len, "r");
+        FILE *fout = rigctld_outopen(r);
+        long pos;
+        int eof;
+
+        if (!fin || !fout)
+        {
+            if (fin) { fclose(fin); }
+
+            if (fout) { fclose(fout); }
+
+            *retcode = -RIG_ENOMEM;
+            return avail;
+        }
+
+        *retcode = rigctl_parse(r->rig, fin, fout, NULL, 0, NULL, 1, 0,
+                                &c->vfo_mode, '\r', &c->ext_resp, &c->resp_sep,
+                                c->use_password);
+        pos = ftell(fin);
+        eof = feof(fin);
+        fclose(fin);
+        fflush(fout);
+        *outlen = ftell(fout);
+        fclose(fout);
+
+#ifndef HAVE_OPEN_MEMSTREAM
+
+        if (*outlen >= RIGCTLD_OUTBUF - 1)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: response truncated to %d bytes\n", __func__,
+                      RIGCTLD_OUTBUF - 1);
+            *outlen = RIGCTLD_OUTBUF - 1;
+        }
+
+#endif
+
+        if (*retcode != RIGCTL_PARSE_ERROR || !eof)
+        {
+            r->commands++;
+            return pos > 0 ? (size_t)pos : len;
+        }
+
+        nl = memchr(nl + 1, '\n', avail - len);
+    }
+
+    return 0;
+}
+
+static void *rigctld_worker(void *arg)
+{
+    struct rigctld_rig *r = (struct rigctld_rig *)arg;
+
+    pthread_mutex_lock(&reactor_lock);
+
+    while (!ctrl_c)
+    {
+        struct handle_data *c;
+        size_t avail, used = 0, outlen = 0;
+        int retcode = RIG_OK;
+
+        if (r->idle_close)
+        {
+            r->idle_close = 0;
+
+            if (!r->clients && r->opened)
+            {
+                pthread_mutex_unlock(&reactor_lock);
+                rig_close(r->rig);
+                r->opened = 0;
+
+                if (verbose > RIG_DEBUG_ERR) { printf("Closed rig model %s.  Will reopen for new clients\n", r->rig->caps->model_name); }
+
+                pthread_mutex_lock(&reactor_lock);
+            }
+
+            continue;
+        }
+
+        if (!r->ready_head)
+        {
+            pthread_cond_wait(&r->cond, &reactor_lock);
+            continue;
+        }
+
+        c = r->ready_head;
+        r->ready_head = c->ready_next;
+
+        if (!r->ready_head) { r->ready_tail = NULL; }
+
+        c->queued = 0;
+        c->busy = 1;
+        avail = c->inlen;
+        pthread_mutex_unlock(&reactor_lock);
+
+        /* the event loop only appends past avail, inbuf[0..avail) is ours */
+        rigctld_check_open(r);
+
+        if (!c->started && r->opened)
+        {
+            c->started = 1;
+            r->powerstat = RIG_POWER_ON; // defaults to power on
+
+            if (r->rig->caps->get_powerstat)
+            {
+                rig_get_powerstat(r->rig, &r->powerstat);
+                r->rig->state.powerstat = r->powerstat;
+            }
+        }
+
+        if (r->opened)
+        {
+            used = rigctld_run(r, c, avail, &retcode, &outlen);
+
+            if (retcode != 0) { rig_debug(RIG_DEBUG_VERBOSE, "%s: rigctl_parse retcode=%d\n", __func__, retcode); }
+
+            // If we get a timeout, the rig might be powered off
+            // Update our power status in case power gets turned off
+            if (retcode == -RIG_ETIMEOUT && r->rig->caps->get_powerstat)
+            {
+                powerstat_t powerstat;
+
+                rig_get_powerstat(r->rig, &powerstat);
+                r->powerstat = powerstat;
+
+                if (powerstat == RIG_POWER_OFF || powerstat == RIG_POWER_STANDBY)
+                {
+                    retcode = -RIG_EPOWER;
+                }
+            }
+        }
+        else
+        {
+            retcode = -RIG_EIO;
+        }
+
+        if (retcode < 0 && !RIG_IS_SOFT_ERRCODE(-retcode))
+        {
+            retcode = rigctld_reopen(r);
+        }
+
+        pthread_mutex_lock(&reactor_lock);
+
+        /* a client not reading its responses is dropped, not waited for,
+           but one that is gets a response of any size */
+        if (outlen && c->outlen && c->outlen + outlen > client_queue)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: %d bytes not read by client, dropping it\n",
+                      __func__, (int)c->outlen);
+            r->dropped++;
+            c->outlen = 0;
+            c->dead = 1;
+        }
+        else if (outlen && !c->dead)
+        {
+            if (c->outlen + outlen > c->outsize)
+            {
+                char *out = realloc(c->out, c->outlen + outlen);
+
+                if (!out)
+                {
+                    rig_debug(RIG_DEBUG_ERR, "%s: no memory for a %d byte response\n",
+                              __func__, (int)outlen);
+                    outlen = 0;
+                    c->dead = 1;
+                }
+                else
+                {
+                    c->out = out;
+                    c->outsize = c->outlen + outlen;
+                }
+            }
+
+            if (!c->outlen) { rigctld_wake(); }
+
+            memcpy(c->out + c->outlen, r->outbuf, outlen);
+            c->outlen += outlen;
+
+            if (c->outlen > c->outpeak) { c->outpeak = c->outlen; }
+
+            if (c->outlen > r->outpeak) { r->outpeak = c->outlen; }
+        }
+
+        if (retcode == RIGCTL_PARSE_END || (retcode < 0
+                                            && !RIG_IS_SOFT_ERRCODE(-retcode)))
+        {
+            /* the event loop closes it once the response is sent */
+            c->dead = 1;
+            rigctld_wake();
+        }
+
+        /* no more is coming to complete the command */
+        if (!used && c->hangup) { c->dead = 1; }
+
+        memmove(c->inbuf, c->inbuf + used, c->inlen - used);
+        c->inlen -= used;
+        c->busy = 0;
+
+        /* to the back of the line, the next command waits for the others */
+        if (used) { rigctld_ready(c); }
+    }
+
+    pthread_mutex_unlock(&reactor_lock);
+    return NULL;
+}
+
+/* close c and forget it, reactor_lock held */
+static void rigctld_reap(struct handle_data *c)
+{
+    struct rigctld_rig *r = c->r;
+    char host[NI_MAXHOST];
+    char serv[NI_MAXSERV];
+
+    if (getnameinfo((struct sockaddr const *)&c->cli_addr, c->clilen, host,
+                    sizeof(host), serv, sizeof(serv),
+                    NI_NUMERICHOST | NI_NUMERICSERV) == 0)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE,
+                  "Connection closed from %s:%s, %lu bytes sent, at most %d queued\n",
+                  host, serv, c->outsent, (int)c->outpeak);
+    }
+
+    close(c->sock);
+    r->clients--;
+
+    if (rigctld_idle && !r->clients)
+    {
+        r->idle_close = 1;
+        pthread_cond_signal(&r->cond);
+    }
+
+    free(c->out);
+    free(c);
+}
+
+/* send what c->out holds without blocking, reactor_lock held */
+static void rigctld_send(struct handle_data *c)
+{
+    ssize_t n;
+
+#ifdef MSG_NOSIGNAL
+    n = send(c->sock, c->out, c->outlen, MSG_NOSIGNAL);
+#else
+    n = send(c->sock, c->out, c->outlen, 0);
+#endif
+
+    if (n < 0)
+    {
+        if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            c->outlen = 0;
+            c->dead = 1;
+        }
+
+        return;
+    }
+
+    memmove(c->out, c->out + n, c->outlen - n);
+    c->outlen -= n;
+    c->outsent += n;
+}
+
+static void rigctld_reactor(int vfo_mode)
+{
+    struct handle_data *c, **pc;
+    int i;
+
+    if (pipe(wake_pipe) < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: pipe: %s\n", __func__, strerror(errno));
+        exit(1);
+    }
+
+    fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+    for (i = 0; i < nrigs; i++)
+    {
+        pthread_cond_init(&rigs[i].cond, NULL);
+#ifndef HAVE_OPEN_MEMSTREAM
+        rigs[i].outbuf = malloc(RIGCTLD_OUTBUF);
+
+        if (!rigs[i].outbuf)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: worker: %s\n", __func__, strerror(errno));
+            exit(1);
+        }
+
+#endif
+
+        if (pthread_create(&rigs[i].worker, NULL, rigctld_worker, &rigs[i]) != 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: worker: %s\n", __func__, strerror(errno));
+            exit(1);
+        }
+    }
+
+    while (!ctrl_c)
+    {
+        fd_set set, wset;
+        struct timeval timeout;
+        int maxfd = wake_pipe[0];
+        int retcode;
+        char drain[64];
+
+        FD_ZERO(&set);
+        FD_ZERO(&wset);
+        FD_SET(wake_pipe[0], &set);
+        rigctld_fd_set_listen(&set, &maxfd);
+
+        pthread_mutex_lock(&reactor_lock);
+
+        for (pc = &client_list; (c = *pc) != NULL;)
+        {
+            int full = c->inlen == sizeof(c->inbuf);
+
+            if (full && !memchr(c->inbuf, '\n', c->inlen) && !c->dead)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: %d bytes without a command, dropping client\n",
+                          __func__, (int)c->inlen);
+                c->dead = 1;
+            }
+
+            if (((c->dead || (c->hangup && !memchr(c->inbuf, '\n', c->inlen)))
+                    && !c->outlen && !c->queued && !c->busy))
+            {
+                *pc = c->next;
+                rigctld_reap(c);
+                continue;
+            }
+
+            if (!c->dead && !c->hangup && !full)
+            {
+                FD_SET(c->sock, &set);
+            }
+
+            if (c->outlen)
+            {
+                FD_SET(c->sock, &wset);
+            }
+
+            if (c->sock > maxfd) { maxfd = c->sock; }
+
+            pc = &c->next;
+        }
+
+        pthread_mutex_unlock(&reactor_lock);
+
+        /* short timeout for periodic checks for CTRL+C */
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 500000;
+        retcode = select(maxfd + 1, &set, &wset, NULL, &timeout);
+
+        if (retcode < 0)
+        {
+            if (errno != EINTR)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: select() failed: %s\n", __func__,
+                          strerror(errno));
+            }
+
+            continue;
+        }
+
+        if (retcode == 0) { continue; }
+
+        if (FD_ISSET(wake_pipe[0], &set))
+        {
+            while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {}
+        }
+
+        for (i = 0; i < nrigs; i++)
+        {
+            if (FD_ISSET(rigs[i].sock_listen, &set)
+                    && (c = rigctld_accept(&rigs[i], vfo_mode)) != NULL)
+            {
+                c->resp_sep = resp_sep;
+                c->out = malloc(client_queue);
+                c->outsize = client_queue;
+
+                /* a client that stops reading must not block the loop */
+                if (!c->out || fcntl(c->sock, F_SETFL, O_NONBLOCK) < 0)
+                {
+                    rig_debug(RIG_DEBUG_ERR, "%s: client setup: %s\n", __func__, strerror(errno));
+                    c->dead = 1;
+                }
+
+                pthread_mutex_lock(&reactor_lock);
+                c->next = client_list;
+                client_list = c;
+                rigs[i].clients++;
+                rigs[i].accepted++;
+                pthread_mutex_unlock(&reactor_lock);
+            }
+        }
+
+        for (c = client_list; c; c = c->next)
+        {
+            ssize_t n;
+
+            if (!FD_ISSET(c->sock, &set) && !FD_ISSET(c->sock, &wset)) { continue; }
+
+            /* the worker only moves inbuf and out with the lock held */
+            pthread_mutex_lock(&reactor_lock);
+
+            if (FD_ISSET(c->sock, &wset) && c->outlen) { rigctld_send(c); }
+
+            if (FD_ISSET(c->sock, &set) && !c->dead)
+            {
+                n = recv(c->sock, c->inbuf + c->inlen, sizeof(c->inbuf) - c->inlen, 0);
+
+                if (n > 0)
+                {
+                    c->inlen += n;
+                    rigctld_ready(c);
+                }
+                else if (n == 0)
+                {
+                    /* finish what was sent before the close */
+                    c->hangup = 1;
+                    rigctld_ready(c);
+                }
+                else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    c->outlen = 0;
+                    c->dead = 1;
+                }
+            }
 
-    default:
-        return FALSE;
+            pthread_mutex_unlock(&reactor_lock);
+        }
     }
-}
-#else
-static void signal_handler(int sig)
-{
-    switch (sig)
-    {
-    case SIGINT:
-    case SIGTERM:
-        fprintf(stderr, "\nTerminating application, caught signal %d\n", sig);
-        // Close stdin to stop reading input
-        fclose(stdin);
-        ctrl_c = 1;
-        break;
 
-    default:
-        /* do nothing */
-        break;
-    }
-}
-#endif
+    pthread_mutex_lock(&reactor_lock);
 
-static void handle_error(enum rig_debug_level_e lvl, const char *msg)
-{
-    int e;
-#ifdef __MINGW32__
-    LPVOID lpMsgBuf;
+    for (i = 0; i < nrigs; i++)
+    {
+        pthread_cond_broadcast(&rigs[i].cond);
+    }
 
-    lpMsgBuf = (LPVOID)"Unknown error";
-    e = WSAGetLastError();
+    pthread_mutex_unlock(&reactor_lock);
 
-    if (FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER
-                      | FORMAT_MESSAGE_FROM_SYSTEM
-                      | FORMAT_MESSAGE_IGNORE_INSERTS,
-                      NULL, e,
-                      MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                      // Default language
-                      (LPTSTR)&lpMsgBuf, 0, NULL))
+    for (i = 0; i < nrigs; i++)
     {
-
-        rig_debug(lvl, "%s: Network error %d: %s\n", msg, e, (char *)lpMsgBuf);
-        LocalFree(lpMsgBuf);
+        pthread_join(rigs[i].worker, NULL);
+        pthread_cond_destroy(&rigs[i].cond);
+        free(rigs[i].outbuf);
     }
-    else
+
+    while ((c = client_list) != NULL)
     {
-        rig_debug(lvl, "%s: Network error %d\n", msg, e);
+        client_list = c->next;
+        rigctld_reap(c);
     }
 
-#else
-    e = errno;
-    rig_debug(lvl, "%s: Network error %d: %s\n", msg, e, strerror(e));
-#endif
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
 }
+#endif /* RIGCTLD_REACTOR */
 
 int main(int argc, char *argv[])
 {
-    rig_model_t my_model = RIG_MODEL_DUMMY;
+    static struct rig_opts opts[RIGCTLD_MAX_RIGS];
+    struct rig_opts *cur = &opts[0];
+    int model_seen = 0;
 
     int retcode;        /* generic return code from functions */
 
     int show_conf = 0;
     int dump_caps_opt = 0;
-    const char *rig_file = NULL, *ptt_file = NULL, *dcd_file = NULL;
-    ptt_type_t ptt_type = RIG_PTT_NONE;
-    dcd_type_t dcd_type = RIG_DCD_NONE;
-    int serial_rate = 0;
-    char *civaddr = NULL;   /* NULL means no need to set conf */
-    char conf_parms[MAXCONFLEN] = "";
 
-    struct addrinfo hints, *result, *saved_result;
-    int sock_listen;
-//    int reuseaddr = 1;
-    int twiddle_timeout = 0;
-    int twiddle_rit = 0;
-    int uplink = 0;
-    char host[NI_MAXHOST];
-    char serv[NI_MAXSERV];
     char rigstartup[1024];
     char vbuf[1024];
 #if HAVE_SIGACTION
     struct sigaction act;
 #endif
 
-#ifdef HAVE_PTHREAD
-    pthread_t thread;
-    pthread_attr_t attr;
-#endif
-    struct handle_data *arg;
     int vfo_mode = 0; /* vfo_mode=0 means target VFO is current VFO */
     int i;
     extern int is_rigctld;
 
     is_rigctld = 1;
 
+    for (i = 0; i < RIGCTLD_MAX_RIGS; i++)
+    {
+        opts[i].model = RIG_MODEL_DUMMY;
+    }
+
     int err = setvbuf(stderr, vbuf, _IOFBF, sizeof(vbuf));
 
     if (err) { rig_debug(RIG_DEBUG_ERR, "%s: setvbuf err=%s\n", __func__, strerror(err)); }
@@ -322,6 +1430,21 @@ int main(int argc, char *argv[])
             bind_all = 1;
             break;
 
+        case 'F':
+            freq_coalesce = 1;
+            break;
+
+        case 'Q':
+            client_queue = strtoul(optarg, NULL, 0);
+
+            if (client_queue < 1024)
+            {
+                fprintf(stderr, "Client queue must be at least 1024 bytes\n");
+                exit(1);
+            }
+
+            break;
+
         case 'A':
             strncpy(rigctld_password, optarg, sizeof(rigctld_password) - 1);
             //char *md5 = rig_make_m d5(rigctld_password);
@@ -338,7 +1461,20 @@ int main(int argc, char *argv[])
                 exit(1);
             }
 
-            my_model = atoi(optarg);
+            /* another -m starts the next rig */
+            if (model_seen)
+            {
+                if (cur == &opts[RIGCTLD_MAX_RIGS - 1])
+                {
+                    fprintf(stderr, "At most %d rigs\n", RIGCTLD_MAX_RIGS);
+                    exit(1);
+                }
+
+                cur++;
+            }
+
+            model_seen = 1;
+            cur->model = atoi(optarg);
             break;
 
         case 'r':
@@ -348,7 +1484,7 @@ int main(int argc, char *argv[])
                 exit(1);
             }
 
-            rig_file = optarg;
+            cur->rig_file = optarg;
             break;
 
         case 'p':
@@ -358,7 +1494,7 @@ int main(int argc, char *argv[])
                 exit(1);
             }
 
-            ptt_file = optarg;
+            cur->ptt_file = optarg;
             break;
 
         case 'd':
@@ -368,7 +1504,7 @@ int main(int argc, char *argv[])
                 exit(1);
             }
 
-            dcd_file = optarg;
+            cur->dcd_file = optarg;
             break;
 
         case 'P':
@@ -380,40 +1516,40 @@ int main(int argc, char *argv[])
 
             if (!strcmp(optarg, "RIG"))
             {
-                ptt_type = RIG_PTT_RIG;
+                cur->ptt_type = RIG_PTT_RIG;
             }
             else if (!strcmp(optarg, "DTR"))
             {
-                ptt_type = RIG_PTT_SERIAL_DTR;
+                cur->ptt_type = RIG_PTT_SERIAL_DTR;
             }
             else if (!strcmp(optarg, "RTS"))
             {
-                ptt_type = RIG_PTT_SERIAL_RTS;
+                cur->ptt_type = RIG_PTT_SERIAL_RTS;
             }
             else if (!strcmp(optarg, "PARALLEL"))
             {
-                ptt_type = RIG_PTT_PARALLEL;
+                cur->ptt_type = RIG_PTT_PARALLEL;
             }
             else if (!strcmp(optarg, "CM108"))
             {
-                ptt_type = RIG_PTT_CM108;
+                cur->ptt_type = RIG_PTT_CM108;
             }
             else if (!strcmp(optarg, "GPIO"))
             {
-                ptt_type = RIG_PTT_GPIO;
+                cur->ptt_type = RIG_PTT_GPIO;
             }
             else if (!strcmp(optarg, "GPION"))
             {
-                ptt_type = RIG_PTT_GPION;
+                cur->ptt_type = RIG_PTT_GPION;
             }
             else if (!strcmp(optarg, "NONE"))
             {
-                ptt_type = RIG_PTT_NONE;
+                cur->ptt_type = RIG_PTT_NONE;
             }
             else
             {
                 puts("Unrecognised PTT type, using NONE");
-                ptt_type = RIG_PTT_NONE;
+                cur->ptt_type = RIG_PTT_NONE;
             }
 
             break;
@@ -427,44 +1563,44 @@ int main(int argc, char *argv[])
 
             if (!strcmp(optarg, "RIG"))
             {
-                dcd_type = RIG_DCD_RIG;
+                cur->dcd_type = RIG_DCD_RIG;
             }
             else if (!strcmp(optarg, "DSR"))
             {
-                dcd_type = RIG_DCD_SERIAL_DSR;
+                cur->dcd_type = RIG_DCD_SERIAL_DSR;
             }
             else if (!strcmp(optarg, "CTS"))
             {
-                dcd_type = RIG_DCD_SERIAL_CTS;
+                cur->dcd_type = RIG_DCD_SERIAL_CTS;
             }
             else if (!strcmp(optarg, "CD"))
             {
-                dcd_type = RIG_DCD_SERIAL_CAR;
+                cur->dcd_type = RIG_DCD_SERIAL_CAR;
             }
             else if (!strcmp(optarg, "PARALLEL"))
             {
-                dcd_type = RIG_DCD_PARALLEL;
+                cur->dcd_type = RIG_DCD_PARALLEL;
             }
             else if (!strcmp(optarg, "CM108"))
             {
-                dcd_type = RIG_DCD_CM108;
+                cur->dcd_type = RIG_DCD_CM108;
             }
             else if (!strcmp(optarg, "GPIO"))
             {
-                dcd_type = RIG_DCD_GPIO;
+                cur->dcd_type = RIG_DCD_GPIO;
             }
             else if (!strcmp(optarg, "GPION"))
             {
-                dcd_type = RIG_DCD_GPION;
+                cur->dcd_type = RIG_DCD_GPION;
             }
             else if (!strcmp(optarg, "NONE"))
             {
-                dcd_type = RIG_DCD_NONE;
+                cur->dcd_type = RIG_DCD_NONE;
             }
             else
             {
                 puts("Unrecognised DCD type, using NONE");
-                dcd_type = RIG_DCD_NONE;
+                cur->dcd_type = RIG_DCD_NONE;
             }
 
             break;
@@ -476,7 +1612,7 @@ int main(int argc, char *argv[])
                 exit(1);
             }
 
-            civaddr = optarg;
+            cur->civaddr = optarg;
             break;
 
         case 'S':
@@ -497,7 +1633,7 @@ int main(int argc, char *argv[])
                 exit(1);
             }
 
-            if (sscanf(optarg, "%d%1s", &serial_rate, dummy) != 1)
+            if (sscanf(optarg, "%d%1s", &cur->serial_rate, dummy) != 1)
             {
                 fprintf(stderr, "Invalid baud rate of %s\n", optarg);
                 exit(1);
@@ -520,19 +1656,19 @@ int main(int argc, char *argv[])
             else
             {
 
-                if (*conf_parms != '\0')
+                if (*cur->conf_parms != '\0')
                 {
-                    strcat(conf_parms, ",");
+                    strcat(cur->conf_parms, ",");
                 }
 
-                if (strlen(conf_parms) + strlen(optarg) > MAXCONFLEN - 24)
+                if (strlen(cur->conf_parms) + strlen(optarg) > MAXCONFLEN - 24)
                 {
-                    printf("Length of conf_parms exceeds internal maximum of %d\n",
+                    printf("Length of cur->conf_parms exceeds internal maximum of %d\n",
                            MAXCONFLEN - 24);
                     return 1;
                 }
 
-                strncat(conf_parms, optarg, MAXCONFLEN - strlen(conf_parms));
+                strncat(cur->conf_parms, optarg, MAXCONFLEN - strlen(cur->conf_parms));
             }
 
             break;
@@ -544,7 +1680,7 @@ int main(int argc, char *argv[])
                 exit(1);
             }
 
-            portno = optarg;
+            cur->portno = optarg;
             break;
 
         case 'T':
@@ -648,318 +1784,144 @@ int main(int argc, char *argv[])
     rig_debug(RIG_DEBUG_VERBOSE, "Max# of rigctld client services=%d\n",
               NI_MAXSERV);
 
-    my_rig = rig_init(my_model);
-
-    if (!my_rig)
-    {
-        fprintf(stderr,
-                "Unknown rig num %u, or initialization error.\n",
-                my_model);
-
-        fprintf(stderr, "Please check with --list option.\n");
-        exit(2);
-    }
-    
-    char *token=strtok(conf_parms,",");
-    while(token)
-    {
-        char mytoken[100], myvalue[100];
-        token_t lookup;
-        sscanf(token,"%99[^=]=%99s", mytoken, myvalue);
-        //printf("mytoken=%s,myvalue=%s\n",mytoken, myvalue);
-        lookup = rig_token_lookup(my_rig,mytoken);
-        if (lookup == 0)
-        {
-            rig_debug(RIG_DEBUG_ERR, "%s: no such token as '%s'\n", __func__, mytoken);
-            token = strtok(NULL, ",");
-            continue;
-        }
-        retcode = rig_set_conf(my_rig, rig_token_lookup(my_rig,mytoken), myvalue);
-        if (retcode != RIG_OK)
-        {
-            fprintf(stderr, "Config parameter error: %s\n", rigerror(retcode));
-            exit(2);
-        }
-        token = strtok(NULL, ",");
-    }
-
-    if (rig_file)
-    {
-        strncpy(my_rig->state.rigport.pathname, rig_file, HAMLIB_FILPATHLEN - 1);
-    }
-
-    my_rig->state.twiddle_timeout = twiddle_timeout;
-    my_rig->state.twiddle_rit = twiddle_rit;
-    my_rig->state.uplink = uplink;
-    rig_debug(RIG_DEBUG_TRACE, "%s: twiddle=%d, uplink=%d, twiddle_rit=%d\n",
-              __func__,
-              my_rig->state.twiddle_timeout, my_rig->state.uplink, my_rig->state.twiddle_rit);
-
-    /*
-     * ex: RIG_PTT_PARALLEL and /dev/parport0
-     */
-    if (ptt_type != RIG_PTT_NONE)
-    {
-        my_rig->state.pttport.type.ptt = ptt_type;
-        my_rig->state.pttport_deprecated.type.ptt = ptt_type;
-        // This causes segfault since backend rig_caps are const
-        // rigctld will use the rig->state version of this for clients
-        //my_rig->caps->ptt_type = ptt_type;
-    }
-
-    if (dcd_type != RIG_DCD_NONE)
-    {
-        my_rig->state.dcdport.type.dcd = dcd_type;
-        my_rig->state.dcdport_deprecated.type.dcd = dcd_type;
-    }
-
-    if (ptt_file)
-    {
-        strncpy(my_rig->state.pttport.pathname, ptt_file, HAMLIB_FILPATHLEN - 1);
-        strncpy(my_rig->state.pttport_deprecated.pathname, ptt_file,
-                HAMLIB_FILPATHLEN - 1);
-    }
-
-    if (dcd_file)
-    {
-        strncpy(my_rig->state.dcdport.pathname, dcd_file, HAMLIB_FILPATHLEN - 1);
-        strncpy(my_rig->state.dcdport_deprecated.pathname, dcd_file,
-                HAMLIB_FILPATHLEN - 1);
-    }
-
-    /* FIXME: bound checking and port type == serial */
-    if (serial_rate != 0)
-    {
-        my_rig->state.rigport.parm.serial.rate = serial_rate;
-        my_rig->state.rigport_deprecated.parm.serial.rate = serial_rate;
-    }
-
-    if (civaddr)
-    {
-        rig_set_conf(my_rig, rig_token_lookup(my_rig, "civaddr"), civaddr);
-    }
-
-    /*
-     * print out conf parameters
-     */
-    if (show_conf)
-    {
-        rig_token_foreach(my_rig, print_conf_list, (rig_ptr_t)my_rig);
-    }
-
-    /*
-     * print out conf parameters, and exits immediately
-     * We may be interested only in only caps, and rig_open may fail.
-     */
-    if (dump_caps_opt)
-    {
-        dumpcaps(my_rig, stdout);
-        rig_cleanup(my_rig); /* if you care about memory */
-        exit(0);
-    }
-
-    /* attempt to open rig to check early for issues */
-    if (skip_open)
-    {
-        rig_opened = 0;
-    }
-    else
-    {
-        retcode = rig_open(my_rig);
-        rig_opened = retcode == RIG_OK ? 1 : 0;
-    }
-
-    if (retcode != RIG_OK)
-    {
-        fprintf(stderr, "rig_open: error = %s %s %s \n", rigerror(retcode), rig_file,
-                strerror(errno));
-        // continue even if opening the rig fails, because it may be powered off
-    }
+    nrigs = (int)(cur - opts) + 1;
 
-    if (verbose > RIG_DEBUG_ERR)
+    for (i = 0; i < nrigs; i++)
     {
-        printf("Opened rig model %u, '%s'\n",
-               my_rig->caps->rig_model,
-               my_rig->caps->model_name);
-    }
+        struct rigctld_rig *r = &rigs[i];
 
-    rig_debug(RIG_DEBUG_VERBOSE, "Backend version: %s, Status: %s\n",
-              my_rig->caps->version, rig_strstatus(my_rig->caps->status));
-
-    // Normally we keep the rig open to speed up the 1st client connect
-    // But some rigs like the FT-736 have to lock the rig for CAT control
-    // So they need to release the rig when no clients are connected
-    if (rigctld_idle)
-    {
-        rig_close(my_rig);          /* we will reopen for clients */
+        r->rig = rigctld_rig_init(&opts[i]);
+        r->sock_listen = -1;
+        r->powerstat = RIG_POWER_ON;
+#ifdef HAVE_PTHREAD
+        pthread_mutex_init(&r->lock, NULL);
+#endif
 
-        if (verbose > RIG_DEBUG_ERR)
+        if (opts[i].portno)
         {
-            printf("Closed rig model %u, '%s - will reopen for clients'\n",
-                   my_rig->caps->rig_model,
-                   my_rig->caps->model_name);
+            strncpy(r->portno, opts[i].portno, sizeof(r->portno) - 1);
         }
-    }
-
-#ifdef __MINGW32__
-#  ifndef SO_OPENTYPE
-#    define SO_OPENTYPE     0x7008
-#  endif
-#  ifndef SO_SYNCHRONOUS_NONALERT
-#    define SO_SYNCHRONOUS_NONALERT 0x20
-#  endif
-#  ifndef INVALID_SOCKET
-#    define INVALID_SOCKET -1
-#  endif
-
-    WSADATA wsadata;
-
-    if (WSAStartup(MAKEWORD(1, 1), &wsadata) == SOCKET_ERROR)
-    {
-        fprintf(stderr, "WSAStartup socket error\n");
-        exit(1);
-    }
-
-    {
-        int sockopt = SO_SYNCHRONOUS_NONALERT;
-        setsockopt(INVALID_SOCKET, SOL_SOCKET, SO_OPENTYPE, (char *)&sockopt,
-                   sizeof(sockopt));
-    }
-
-#endif
-
-    /*
-     * Prepare listening socket
-     */
-    memset(&hints, 0, sizeof(struct addrinfo));
-    hints.ai_family = AF_UNSPEC;    /* Allow IPv4 or IPv6 */
-    hints.ai_socktype = SOCK_STREAM;/* TCP socket */
-    hints.ai_flags = AI_PASSIVE;    /* For wildcard IP address */
-    hints.ai_protocol = 0;          /* Any protocol */
-
-    retcode = getaddrinfo(src_addr, portno, &hints, &result);
-
-    if (retcode == 0 && result->ai_family == AF_INET6)
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: Using IPV6\n", __func__);
-    }
-    else if (retcode == 0)
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: Using IPV4\n", __func__);
-    }
-    else
-    {
-        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(retcode));
-        exit(2);
-    }
-
-    saved_result = result;
-
-    do
-    {
-        sock_listen = socket(result->ai_family,
-                             result->ai_socktype,
-                             result->ai_protocol);
-
-        if (sock_listen < 0)
+        else if (i == 0)
+        {
+            strncpy(r->portno, portno, sizeof(r->portno) - 1);
+        }
+        else
         {
-            handle_error(RIG_DEBUG_ERR, "socket");
-            freeaddrinfo(saved_result);     /* No longer needed */
-            exit(2);
+            /* count up from the first rig's port */
+            SNPRINTF(r->portno, sizeof(r->portno), "%d", atoi(rigs[0].portno) + i);
         }
-    int optval = 1;
-#ifdef __MINGW32__
-    if (setsockopt(sock_listen, SOL_SOCKET, SO_REUSEADDR, (PCHAR)&optval, sizeof(optval)) < 0)
-#else
-    if (setsockopt(sock_listen, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) < 0)
-#endif
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: error enabling UDP address reuse: %s\n", __func__,
-                strerror(errno));
     }
 
-    // Windows does not have SO_REUSEPORT. However, SO_REUSEADDR works in a similar way.
-#if defined(SO_REUSEPORT)
-    if (setsockopt(sock_listen, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0)
+    /*
+     * print out conf parameters
+     */
+    if (show_conf)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: error enabling UDP port reuse: %s\n", __func__,
-                strerror(errno));
+        rig_token_foreach(rigs[0].rig, print_conf_list, (rig_ptr_t)rigs[0].rig);
     }
-#endif
 
+    /*
+     * print out conf parameters, and exits immediately
+     * We may be interested only in only caps, and rig_open may fail.
+     */
+    if (dump_caps_opt)
+    {
+        dumpcaps(rigs[0].rig, stdout);
 
-#if 0
-        if (setsockopt(sock_listen,
-                       SOL_SOCKET,
-                       SO_REUSEADDR,
-                       (char *)&reuseaddr,
-                       sizeof(reuseaddr))
-                < 0)
+        for (i = 0; i < nrigs; i++)
         {
-
-            handle_error(RIG_DEBUG_ERR, "setsockopt");
-            freeaddrinfo(saved_result);     /* No longer needed */
-            exit(1);
+            rig_cleanup(rigs[i].rig); /* if you care about memory */
         }
-#endif
 
-#ifdef IPV6_V6ONLY
+        exit(0);
+    }
 
-        if (AF_INET6 == result->ai_family)
-        {
-            /* allow IPv4 mapped to IPv6 clients Windows and BSD default
-               this to 1 (i.e. disallowed) and we prefer it off */
-            int sockopt = 0;
+    for (i = 0; i < nrigs; i++)
+    {
+        RIG *my_rig = rigs[i].rig;
 
-            if (setsockopt(sock_listen,
-                           IPPROTO_IPV6,
-                           IPV6_V6ONLY,
-                           (char *)&sockopt,
-                           sizeof(sockopt))
-                    < 0)
-            {
+        retcode = RIG_OK;
 
-                handle_error(RIG_DEBUG_ERR, "setsockopt");
-                freeaddrinfo(saved_result);     /* No longer needed */
-                exit(1);
-            }
+        /* attempt to open rig to check early for issues */
+        if (skip_open)
+        {
+            rigs[i].opened = 0;
+        }
+        else
+        {
+            retcode = rig_open(my_rig);
+            rigs[i].opened = retcode == RIG_OK ? 1 : 0;
         }
 
-#endif
+        if (retcode != RIG_OK)
+        {
+            fprintf(stderr, "rig_open: error = %s %s %s \n", rigerror(retcode), opts[i].rig_file,
+                    strerror(errno));
+            // continue even if opening the rig fails, because it may be powered off
+        }
 
-        int retval = bind(sock_listen, result->ai_addr, result->ai_addrlen);
-        if (retval == 0)
+        if (verbose > RIG_DEBUG_ERR)
         {
-            break;
+            printf("Opened rig model %u, '%s'\n",
+                   my_rig->caps->rig_model,
+                   my_rig->caps->model_name);
         }
+
+        rig_debug(RIG_DEBUG_VERBOSE, "Backend version: %s, Status: %s\n",
+                  my_rig->caps->version, rig_strstatus(my_rig->caps->status));
+
+        // Normally we keep the rig open to speed up the 1st client connect
+        // But some rigs like the FT-736 have to lock the rig for CAT control
+        // So they need to release the rig when no clients are connected
+        if (rigctld_idle)
         {
-            rig_debug(RIG_DEBUG_ERR,"%s: bind: %s\n", __func__, strerror(errno));
+            rig_close(my_rig);          /* we will reopen for clients */
+
+            if (verbose > RIG_DEBUG_ERR)
+            {
+                printf("Closed rig model %u, '%s - will reopen for clients'\n",
+                       my_rig->caps->rig_model,
+                       my_rig->caps->model_name);
+            }
         }
+    }
 
-        if (bind_all)
-            handle_error(RIG_DEBUG_WARN, "binding failed (trying next interface)");
-        else
-            handle_error(RIG_DEBUG_WARN, "binding failed");
 #ifdef __MINGW32__
-        closesocket(sock_listen);
-#else
-        close(sock_listen);
-#endif
-    }
-    while (bind_all && ((result = result->ai_next) != NULL));
+#  ifndef SO_OPENTYPE
+#    define SO_OPENTYPE     0x7008
+#  endif
+#  ifndef SO_SYNCHRONOUS_NONALERT
+#    define SO_SYNCHRONOUS_NONALERT 0x20
+#  endif
+#  ifndef INVALID_SOCKET
+#    define INVALID_SOCKET -1
+#  endif
 
-    freeaddrinfo(saved_result);     /* No longer needed */
+    WSADATA wsadata;
 
-    if (NULL == result)
+    if (WSAStartup(MAKEWORD(1, 1), &wsadata) == SOCKET_ERROR)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: bind error - no available interface\n", __func__);
+        fprintf(stderr, "WSAStartup socket error\n");
         exit(1);
     }
 
-    if (listen(sock_listen, 4) < 0)
     {
-        handle_error(RIG_DEBUG_ERR, "listening");
-        exit(1);
+        int sockopt = SO_SYNCHRONOUS_NONALERT;
+        setsockopt(INVALID_SOCKET, SOL_SOCKET, SO_OPENTYPE, (char *)&sockopt,
+                   sizeof(sockopt));
+    }
+
+#endif
+
+    for (i = 0; i < nrigs; i++)
+    {
+        rigs[i].sock_listen = rigctld_listen(rigs[i].portno);
+
+        if (nrigs > 1 && verbose > RIG_DEBUG_ERR)
+        {
+            printf("Rig %d '%s' on port %s\n", i + 1, rigs[i].rig->caps->model_name,
+                   rigs[i].portno);
+        }
     }
 
 #if HAVE_SIGACTION
@@ -1037,132 +1999,73 @@ int main(int argc, char *argv[])
      * main loop accepting connections
      */
     rig_debug(RIG_DEBUG_TRACE, "%s: rigctld listening on port %s\n", __func__,
-              portno);
+              rigs[0].portno);
 
-    do
+#ifdef RIGCTLD_REACTOR
+
+    if (!freq_coalesce)
     {
-        fd_set set;
-        struct timeval timeout;
+        rigctld_reactor(vfo_mode);
+    }
+    else
+#endif
+    {
+        rigctld_threads(vfo_mode);
+    }
 
-        arg = calloc(1, sizeof(struct handle_data));
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: while loop done\n", __func__);
+
+    for (i = 0; i < nrigs; i++)
+    {
+        /* allow threads to finish current action */
+        rigctld_lock(&rigs[i], 1);
 
-        if (!arg)
+        if (rigs[i].clients)
         {
-            rig_debug(RIG_DEBUG_ERR, "calloc: %s\n", strerror(errno));
-            exit(1);
+            rig_debug(RIG_DEBUG_WARN, "%u outstanding client(s)\n", rigs[i].clients);
         }
 
-        if (rigctld_password[0] != 0) { arg->use_password = 1; }
+#ifdef __MINGW32__
+        closesocket(rigs[i].sock_listen);
+#else
+        close(rigs[i].sock_listen);
+#endif
+        rig_close(rigs[i].rig); /* close port */
+        rigctld_lock(&rigs[i], 0);
+    }
 
-        /* use select to allow for periodic checks for CTRL+C */
-        FD_ZERO(&set);
-        FD_SET(sock_listen, &set);
-        timeout.tv_sec = 5;
-        timeout.tv_usec = 0;
-        retcode = select(sock_listen + 1, &set, NULL, NULL, &timeout);
+    for (i = 0; i < nrigs; i++)
+    {
+        RIG *my_rig = rigs[i].rig;
 
-        if (retcode == -1)
+        if (nrigs > 1)
         {
-            int errno_stored = errno;
-            rig_debug(RIG_DEBUG_ERR, "%s: select() failed: %s\n", __func__,
-                      strerror(errno_stored));
+            printf("%s on port %s: %lu connections, %lu commands\n",
+                   my_rig->caps->model_name, rigs[i].portno, rigs[i].accepted,
+                   rigs[i].commands);
+        }
 
-            if (ctrl_c)
-            {
-                rig_debug(RIG_DEBUG_VERBOSE, "%s: ctrl_c when retcode==-1\n", __func__);
-                break;
-            }
+#ifdef RIGCTLD_REACTOR
 
-            if (errno == EINTR)
-            {
-                rig_debug(RIG_DEBUG_VERBOSE, "%s: ignoring interrupted system call\n",
-                          __func__);
-                //retcode = 0; // not used?
-            }
-        }
-        else if (retcode == 0)
+        if (rigs[i].dropped || verbose > RIG_DEBUG_ERR)
         {
-            if (ctrl_c)
-            {
-                rig_debug(RIG_DEBUG_VERBOSE, "%s: ctrl_c when retcode==0\n", __func__);
-                break;
-            }
+            printf("client queues: at most %d bytes, %lu clients dropped\n",
+                   (int)rigs[i].outpeak, rigs[i].dropped);
         }
-        else
-        {
-            arg->rig = my_rig;
-            arg->clilen = sizeof(arg->cli_addr);
-            arg->vfo_mode = vfo_mode;
-            arg->sock = accept(sock_listen,
-                               (struct sockaddr *)&arg->cli_addr,
-                               &arg->clilen);
-
-            if (arg->sock < 0)
-            {
-                handle_error(RIG_DEBUG_ERR, "accept");
-                break;
-            }
-
-            if ((retcode = getnameinfo((struct sockaddr const *)&arg->cli_addr,
-                                       arg->clilen,
-                                       host,
-                                       sizeof(host),
-                                       serv,
-                                       sizeof(serv),
-                                       NI_NUMERICHOST | NI_NUMERICSERV))
-                    < 0)
-            {
-                rig_debug(RIG_DEBUG_WARN,
-                          "Peer lookup error: %s",
-                          gai_strerror(retcode));
-            }
 
-            rig_debug(RIG_DEBUG_VERBOSE,
-                      "Connection opened from %s:%s\n",
-                      host,
-                      serv);
-
-#ifdef HAVE_PTHREAD
-            pthread_attr_init(&attr);
-            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-
-            retcode = pthread_create(&thread, &attr, handle_socket, arg);
-
-            if (retcode != 0)
-            {
-                rig_debug(RIG_DEBUG_ERR, "pthread_create: %s\n", strerror(retcode));
-                break;
-            }
-
-#else
-            handle_socket(arg);
 #endif
-        }
-    }
-    while(!ctrl_c);
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s: while loop done\n", __func__);
+        if (my_rig->state.freq_coalesce)
+        {
+            unsigned long requests, sent, coalesced;
 
-#ifdef HAVE_PTHREAD
-    /* allow threads to finish current action */
-    mutex_rigctld(1);
+            rig_get_freq_coalesce_stats(my_rig, &requests, &sent, &coalesced);
+            printf("set_freq: %lu requests, %lu sent, %lu coalesced\n", requests, sent,
+                   coalesced);
+        }
 
-    if (client_count)
-    {
-        rig_debug(RIG_DEBUG_WARN, "%u outstanding client(s)\n", client_count);
+        rig_cleanup(my_rig); /* if you care about memory */
     }
-#ifdef __MINGW__
-    closesocket(sock_listen);
-#else
-    close(sock_listen);
-#endif
-    rig_close(my_rig);
-    mutex_rigctld(0);
-#else
-    rig_close(my_rig); /* close port */
-#endif
-
-    rig_cleanup(my_rig); /* if you care about memory */
 
 #ifdef __MINGW32__
     WSACleanup();
@@ -1204,6 +2107,8 @@ static FILE *get_fsockin(struct handle_data *handle_data_arg)
 void *handle_socket(void *arg)
 {
     struct handle_data *handle_data_arg = (struct handle_data *)arg;
+    struct rigctld_rig *r = handle_data_arg->r;
+    RIG *my_rig = r->rig;
     FILE *fsockin = NULL;
     FILE *fsockout = NULL;
     int retcode = RIG_OK;
@@ -1211,7 +2116,13 @@ void *handle_socket(void *arg)
     char serv[NI_MAXSERV];
     char send_cmd_term = '\r';  /* send_cmd termination char */
     int ext_resp = 0;
-    rig_powerstat = RIG_POWER_ON; // defaults to power on
+    sync_cb_t sync_cb = NULL;
+    r->powerstat = RIG_POWER_ON; // defaults to power on
+
+#ifdef HAVE_PTHREAD
+    pthread_setspecific(rig_key, r);
+    sync_cb = rigctld_sync;
+#endif
 
     fsockin = get_fsockin(handle_data_arg);
 
@@ -1236,29 +2147,14 @@ void *handle_socket(void *arg)
 
 #ifdef HAVE_PTHREAD
     mutex_rigctld(1);
-
-    ++client_count;
-#if 0
-
-    if (!client_count++)
-    {
-        retcode = rig_open(my_rig);
-
-        if (RIG_OK == retcode && verbose > RIG_DEBUG_ERR)
-        {
-            printf("Opened rig model %d, '%s'\n",
-                   my_rig->caps->rig_model,
-                   my_rig->caps->model_name);
-        }
-    }
-
-#endif
-
+    ++r->clients;
+    ++r->accepted;
     mutex_rigctld(0);
 #else
-    mutex_rigctld(1);
+    rigctld_lock(r, 1);
     retcode = rig_open(my_rig);
-    mutex_rigctld(1);
+    r->opened = retcode == RIG_OK ? 1 : 0;
+    rigctld_lock(r, 0);
 
     if (RIG_OK == retcode && verbose > RIG_DEBUG_ERR)
     {
@@ -1271,36 +2167,27 @@ void *handle_socket(void *arg)
 
     if (my_rig->caps->get_powerstat)
     {
-        mutex_rigctld(1);
-        rig_get_powerstat(my_rig, &rig_powerstat);
-        mutex_rigctld(0);
-        my_rig->state.powerstat = rig_powerstat;
+        rigctld_lock(r, 1);
+        rig_get_powerstat(my_rig, &r->powerstat);
+        rigctld_lock(r, 0);
+        my_rig->state.powerstat = r->powerstat;
     }
 
     do
     {
-        mutex_rigctld(1);
-
-        if (!rig_opened)
-        {
-            retcode = rig_open(my_rig);
-            rig_opened = retcode == RIG_OK ? 1 : 0;
-            rig_debug(RIG_DEBUG_ERR, "%s: rig_open reopened retcode=%d\n", __func__,
-                      retcode);
-        }
-
-        mutex_rigctld(0);
+        rigctld_check_open(r);
 
-        if (rig_opened) // only do this if rig is open
+        if (r->opened) // only do this if rig is open
         {
             powerstat_t powerstat;
             rig_debug(RIG_DEBUG_TRACE, "%s: doing rigctl_parse vfo_mode=%d, secure=%d\n",
                       __func__,
                       handle_data_arg->vfo_mode, handle_data_arg->use_password);
             retcode = rigctl_parse(handle_data_arg->rig, fsockin, fsockout, NULL, 0,
-                                   mutex_rigctld,
+                                   sync_cb,
                                    1, 0, &handle_data_arg->vfo_mode, send_cmd_term, &ext_resp, &resp_sep,
                                    handle_data_arg->use_password);
+            r->commands++;
 
             if (retcode != 0) { rig_debug(RIG_DEBUG_VERBOSE, "%s: rigctl_parse retcode=%d\n", __func__, retcode); }
 
@@ -1309,7 +2196,7 @@ void *handle_socket(void *arg)
             if (retcode == -RIG_ETIMEOUT && my_rig->caps->get_powerstat)
             {
                 rig_get_powerstat(my_rig, &powerstat);
-                rig_powerstat = powerstat;
+                r->powerstat = powerstat;
 
                 if (powerstat == RIG_POWER_OFF || powerstat == RIG_POWER_STANDBY)
                 {
@@ -1323,72 +2210,34 @@ void *handle_socket(void *arg)
         }
 
         // if we get a hard error we try to reopen the rig again
-        // this should cover short dropouts that can occur
         if (retcode < 0 && !RIG_IS_SOFT_ERRCODE(-retcode))
         {
-            int retry = 3;
-            rig_debug(RIG_DEBUG_ERR, "%s: i/o error\n", __func__);
-
-            do
-            {
-                mutex_rigctld(1);
-                retcode = rig_close(my_rig);
-                rig_opened = 0;
-                mutex_rigctld(0);
-                rig_debug(RIG_DEBUG_ERR, "%s: rig_close retcode=%d\n", __func__, retcode);
-
-                hl_usleep(1000 * 1000);
-
-                mutex_rigctld(1);
-
-                if (!rig_opened)
-                {
-                    retcode = rig_open(my_rig);
-                    rig_opened = retcode == RIG_OK ? 1 : 0;
-                    rig_debug(RIG_DEBUG_ERR, "%s: rig_open retcode=%d, opened=%d\n", __func__,
-                              retcode, rig_opened);
-                }
-
-                mutex_rigctld(0);
-            }
-            while (!ctrl_c && !rig_opened && retry-- > 0 && retcode != RIG_OK);
+            retcode = rigctld_reopen(r);
         }
     }
     while (!ctrl_c && (retcode == RIG_OK || RIG_IS_SOFT_ERRCODE(-retcode)));
 
-    if (rigctld_idle && client_count == 1)
+    if (rigctld_idle && r->clients == 1)
     {
+        rigctld_lock(r, 1);
         rig_close(my_rig);
+        r->opened = 0;
+        rigctld_lock(r, 0);
 
         if (verbose > RIG_DEBUG_ERR) { printf("Closed rig model %s.  Will reopen for new clients\n", my_rig->caps->model_name); }
     }
 
 
 #ifdef HAVE_PTHREAD
-    --client_count;
-
-    if (rigctld_idle && client_count > 0) { printf("%u client%s still connected so rig remains open\n", client_count, client_count > 1 ? "s" : ""); }
-
-#if 0
     mutex_rigctld(1);
+    --r->clients;
+    mutex_rigctld(0);
 
-    /* Release rig if there are no clients */
-    if (!--client_count)
-    {
-        rig_close(my_rig);
-
-        if (verbose > RIG_DEBUG_ERR)
-        {
-            printf("Closed rig model %d, '%s - no clients, will reopen for new clients'\n",
-                   my_rig->caps->rig_model,
-                   my_rig->caps->model_name);
-        }
-    }
+    if (rigctld_idle && r->clients > 0) { printf("%u client%s still connected so rig remains open\n", r->clients, r->clients > 1 ? "s" : ""); }
 
-    mutex_rigctld(0);
-#endif
 #else
     rig_close(my_rig);
+    r->opened = 0;
 
     if (verbose > RIG_DEBUG_ERR)
     {
@@ -1456,6 +2305,8 @@ void usage(void)
 
     printf(
         "  -m, --model=ID                select radio model number. See model list\n"
+        "                                repeat to serve more radios, the options up to\n"
+        "                                the next -m apply to that one\n"
         "  -r, --rig-file=DEVICE         set device of the radio to operate on\n"
         "  -p, --ptt-file=DEVICE         set device of the PTT device to operate on\n"
         "  -d, --dcd-file=DEVICE         set device of the DCD device to operate on\n"
@@ -1478,9 +2329,11 @@ void usage(void)
         "  -Z, --debug-time-stamps       enable time stamps for debug messages\n"
         "  -A, --password                set password for rigctld access\n"
         "  -R, --rigctld-idle            make rigctld close the rig when no clients are connected\n"
+        "  -F, --freq-coalesce           drop intermediate set_freq targets while one is in flight\n"
+        "  -Q, --client-queue=BYTES      drop clients leaving more unread responses, default %d\n"
         "  -h, --help                    display this help and exit\n"
         "  -V, --version                 output version information and exit\n\n",
-        portno);
+        portno, (int)client_queue);
 
     usage_rig(stdout);
 
@@ -6,7 +6,9 @@
  *
  *   This program will synchronize frequency from one rig to another
  *   Implemented for AirSpy SDR# to keep freq synced with a real rig
- *   It simply polls the real rig and when freq changes sends it to SDR# (or whatever rig is hooked up)
+ *   When the source rig has async data (transceive) it follows its freq/mode
+ *   events, otherwise it polls the freq, and sends changes to SDR# (or
+ *   whatever rig is hooked up)
  *
  *   This program is free software; you can redistribute it and/or modify
  *   it under the terms of the GNU General Public License as published by
@@ -68,10 +70,15 @@
 #  endif
 #endif
 
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
 #include <hamlib/rig.h>
 #include "rigctl_parse.h"
 #include "riglist.h"
 #include "sleep.h"
+#include "misc.h"
 
 /*
  * Reminder: when adding long options,
@@ -79,7 +86,7 @@
  * NB: do NOT use -W since it's reserved by POSIX.
  * TODO: add an option to read from a file
  */
-#define SHORT_OPTIONS "B:m:M:r:R:p:d:P:D:s:S:c:C:lLuvhVZ"
+#define SHORT_OPTIONS "B:m:M:r:R:p:d:P:D:s:S:c:C:i:NlLuvhVZ"
 static struct option long_options[] =
 {
     {"mapa2b",          0, 0, 'B'},
@@ -94,6 +101,8 @@ static struct option long_options[] =
     {"serial-speed2",   1, 0, 'S'},
     {"civaddr",         1, 0, 'c'},
     {"set-conf",        1, 0, 'C'},
+    {"interval",        1, 0, 'i'},
+    {"poll",            0, 0, 'N'},
     {"list",            0, 0, 'l'},
     {"show-conf",       0, 0, 'L'},
     {"dump-caps",       0, 0, 'u'},
@@ -123,7 +132,6 @@ static int volatile ctrl_c;
 
 #define MAXCONFLEN 2048
 
-#if 0
 # ifdef WIN32
 static BOOL WINAPI CtrlHandler(DWORD fdwCtrlType)
 {
@@ -155,7 +163,6 @@ static void signal_handler(int sig)
     }
 }
 # endif  /* ifdef WIN32 */
-#endif   /* if 0 */
 
 #if 0
 static void handle_error(enum rig_debug_level_e lvl, const char *msg)
@@ -195,6 +202,212 @@ static void handle_error(enum rig_debug_level_e lvl, const char *msg)
 #endif  /* if 0 */
 
 
+/*
+ * Source rig changes waiting to go to the sync rig.  Events and polls only
+ * overwrite them, so a burst of dial clicks costs a single set_freq with
+ * the newest value -- latest wins.
+ */
+struct sync_pending
+{
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    int have_freq;
+    int have_mode;
+    struct timespec freq_seen;  /* when the newest value came in */
+    struct timespec mode_seen;
+};
+
+struct sync_stats
+{
+    unsigned long events;       /* freq/mode events from the source */
+    unsigned long polls;
+    unsigned long coalesced;    /* overwritten before they were sent */
+    unsigned long suppressed;   /* the sync rig has it already */
+    unsigned long sent;
+    double latency_ms;          /* total, for the average */
+    double latency_max_ms;
+};
+
+static struct sync_pending pending;
+static struct sync_stats stats;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+#  define SYNC_LOCK() pthread_mutex_lock(&pending_lock)
+#  define SYNC_UNLOCK() pthread_mutex_unlock(&pending_lock)
+#  define SYNC_SIGNAL() pthread_cond_signal(&pending_cond)
+#else
+#  define SYNC_LOCK()
+#  define SYNC_UNLOCK()
+#  define SYNC_SIGNAL()
+#endif
+
+static void sync_post_freq(freq_t freq, int event)
+{
+    SYNC_LOCK();
+
+    if (pending.have_freq) { stats.coalesced++; }
+
+    if (event) { stats.events++; }
+
+    pending.freq = freq;
+    pending.have_freq = 1;
+    elapsed_ms(&pending.freq_seen, HAMLIB_ELAPSED_SET);
+    SYNC_SIGNAL();
+    SYNC_UNLOCK();
+}
+
+static void sync_post_mode(rmode_t mode, pbwidth_t width, int event)
+{
+    SYNC_LOCK();
+
+    if (pending.have_mode) { stats.coalesced++; }
+
+    if (event) { stats.events++; }
+
+    pending.mode = mode;
+    pending.width = width;
+    pending.have_mode = 1;
+    elapsed_ms(&pending.mode_seen, HAMLIB_ELAPSED_SET);
+    SYNC_SIGNAL();
+    SYNC_UNLOCK();
+}
+
+/* these run on the source rig's async data thread */
+static int sync_freq_event(RIG *rig, vfo_t vfo, freq_t freq, rig_ptr_t arg)
+{
+    if (vfo == RIG_VFO_CURR || vfo == rig->state.current_vfo)
+    {
+        sync_post_freq(freq, 1);
+    }
+
+    return RIG_OK;
+}
+
+static int sync_mode_event(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width,
+                           rig_ptr_t arg)
+{
+    if (vfo == RIG_VFO_CURR || vfo == rig->state.current_vfo)
+    {
+        sync_post_mode(mode, width, 1);
+    }
+
+    return RIG_OK;
+}
+
+/* wait up to timeout_ms for something to send */
+static void sync_wait(int timeout_ms)
+{
+#ifdef HAVE_PTHREAD
+    struct timespec until;
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeout_ms / 1000;
+    until.tv_nsec += (timeout_ms % 1000) * 1000000L;
+
+    if (until.tv_nsec >= 1000000000L)
+    {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+
+    SYNC_LOCK();
+
+    while (!pending.have_freq && !pending.have_mode && !ctrl_c)
+    {
+        if (pthread_cond_timedwait(&pending_cond, &pending_lock, &until) != 0)
+        {
+            break;
+        }
+    }
+
+    SYNC_UNLOCK();
+#else
+    hl_usleep(timeout_ms * 1000);
+#endif
+}
+
+static void sync_latency(struct timespec *seen, const char *what, double val)
+{
+    double ms = elapsed_ms(seen, HAMLIB_ELAPSED_GET);
+
+    stats.sent++;
+    stats.latency_ms += ms;
+
+    if (ms > stats.latency_max_ms) { stats.latency_max_ms = ms; }
+
+    if (verbose > 0)
+    {
+        printf("%s %.0f synced in %.1f ms\n", what, val, ms);
+    }
+}
+
+/*
+ * Send what is pending to the sync rig.  What the sync rig was last set to
+ * is not sent again, so a change that comes back from the sync side (e.g.
+ * another rigctlsync running the other way) stops here instead of looping.
+ */
+static int sync_flush(RIG *rig)
+{
+    static freq_t last_freq;
+    static rmode_t last_mode = RIG_MODE_NONE;
+    static pbwidth_t last_width;
+    struct sync_pending p;
+    int retcode = RIG_OK;
+
+    SYNC_LOCK();
+    p = pending;
+    pending.have_freq = 0;
+    pending.have_mode = 0;
+    SYNC_UNLOCK();
+
+    if (p.have_freq)
+    {
+        if (p.freq == last_freq)
+        {
+            stats.suppressed++;
+        }
+        else
+        {
+            retcode = rig_set_freq(rig, RIG_VFO_CURR, p.freq);
+
+            if (retcode != RIG_OK) { return retcode; }
+
+            last_freq = p.freq;
+            sync_latency(&p.freq_seen, "freq", p.freq);
+        }
+    }
+
+    if (p.have_mode)
+    {
+        if (p.mode == last_mode && p.width == last_width)
+        {
+            stats.suppressed++;
+        }
+        else
+        {
+            retcode = rig_set_mode(rig, RIG_VFO_CURR, p.mode, p.width);
+
+            // not every sync target does modes, keep the freq going
+            if (retcode != RIG_OK)
+            {
+                rig_debug(RIG_DEBUG_WARN, "%s: set_mode: %s\n", __func__,
+                          rigerror(retcode));
+                return RIG_OK;
+            }
+
+            last_mode = p.mode;
+            last_width = p.width;
+            sync_latency(&p.mode_seen, "mode", (double)p.mode);
+        }
+    }
+
+    return retcode;
+}
+
+
 int main(int argc, char *argv[])
 {
     rig_model_t my_model[] = { RIG_MODEL_DUMMY, RIG_MODEL_SDRSHARP };
@@ -211,6 +424,9 @@ int main(int argc, char *argv[])
     int serial_rate2 = 0;  /* virtual com port default speed */
     char *civaddr = NULL;       /* NULL means no need to set conf */
     char conf_parms[MAXCONFLEN] = "";
+    int interval_ms = 400;
+    int force_poll = 0;
+    int use_events;
 
     printf("rigctlsync Version 1.0\n");
 
@@ -457,6 +673,23 @@ int main(int argc, char *argv[])
             strncat(conf_parms, optarg, MAXCONFLEN - strlen(conf_parms));
             break;
 
+        case 'i':
+            if (!optarg)
+            {
+                usage();        /* wrong arg count */
+                exit(1);
+            }
+
+            interval_ms = atoi(optarg);
+
+            if (interval_ms <= 0) { interval_ms = 400; }
+
+            break;
+
+        case 'N':
+            force_poll = 1;
+            break;
+
         case 'v':
             verbose++;
             break;
@@ -608,6 +841,18 @@ int main(int argc, char *argv[])
         exit(0);
     }
 
+    /* follow the source rig's transceive data when it can send it */
+    if (!force_poll && my_rig->caps->async_data_supported)
+    {
+        rig_set_conf(my_rig, rig_token_lookup(my_rig, "async"), "1");
+    }
+
+#ifdef WIN32
+    SetConsoleCtrlHandler(CtrlHandler, TRUE);
+#else
+    signal(SIGINT, signal_handler);
+#endif
+
     /* open and close rig connection to check early for issues */
     retcode = rig_open(my_rig);
 
@@ -637,28 +882,91 @@ int main(int argc, char *argv[])
     rig_debug(RIG_DEBUG_VERBOSE, "Backend version: %s, Status: %s\n",
               my_rig->caps->version, rig_strstatus(my_rig->caps->status));
 
+#ifdef HAVE_PTHREAD
+    use_events = my_rig->state.async_data_enabled;
+
+    if (use_events)
+    {
+        /* the callbacks can only be set on an open rig */
+        rig_set_freq_callback(my_rig, sync_freq_event, NULL);
+        rig_set_mode_callback(my_rig, sync_mode_event, NULL);
+    }
+
+#else
+    use_events = 0;
+#endif
+
+    printf("Following %s by %s\n", my_rig->caps->model_name,
+           use_events ? "freq/mode events" : "polling");
+
+    /* start from where the source rig is now */
+    {
+        freq_t freq;
+        rmode_t mode;
+        pbwidth_t width;
+
+        if (rig_get_freq(my_rig, RIG_VFO_CURR, &freq) == RIG_OK)
+        {
+            sync_post_freq(freq, 0);
+        }
+
+        if (use_events && rig_get_mode(my_rig, RIG_VFO_CURR, &mode, &width) == RIG_OK)
+        {
+            sync_post_mode(mode, width, 0);
+        }
+    }
+
     /*
      * main loop
      */
     do
     {
-        freq_t freq;
-        retcode = rig_get_freq(my_rig, RIG_VFO_CURR, &freq);
-
-        if (retcode != RIG_OK)
+        if (use_events)
+        {
+            sync_wait(1000);   // wake up now and then to see ctrl_c
+        }
+        else
         {
-            rig_debug(RIG_DEBUG_ERR, "%s: Error in rig_get_freq: %s\n", __func__,
-                      rigerror(retcode));
+            freq_t freq;
+
+            retcode = rig_get_freq(my_rig, RIG_VFO_CURR, &freq);
+
+            if (retcode != RIG_OK)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: Error in rig_get_freq: %s\n", __func__,
+                          rigerror(retcode));
+            }
+            else
+            {
+                stats.polls++;
+                sync_post_freq(freq, 0);
+            }
         }
 
-        retcode = rig_set_freq(my_rig_sync, RIG_VFO_CURR, freq);
+        retcode = sync_flush(my_rig_sync);
 
-        hl_usleep(400 * 1000); // fairly fast to keep up
+        if (!use_events)
+        {
+            hl_usleep(interval_ms * 1000); // fairly fast to keep up
+        }
     }
     while (retcode == 0 && !ctrl_c);
 
     rig_close(my_rig);          /* close port */
     rig_cleanup(my_rig);        /* if you care about memory */
+    rig_close(my_rig_sync);
+    rig_cleanup(my_rig_sync);
+
+    printf("events=%lu polls=%lu sent=%lu coalesced=%lu suppressed=%lu\n",
+           stats.events, stats.polls, stats.sent, stats.coalesced,
+           stats.suppressed);
+
+    if (stats.sent > 0)
+    {
+        printf("propagation latency avg %.1f ms, max %.1f ms%s\n",
+               stats.latency_ms / stats.sent, stats.latency_max_ms,
+               use_events ? "" : " (after the poll that saw it)");
+    }
 
     return 0;
 }
@@ -683,6 +991,8 @@ void usage()
         "  -S, --serial-speed2=BAUD      set serial speed of the virtual com port [default=115200]\n"
         "  -c, --civaddr=ID              set CI-V address, decimal (for Icom rigs only)\n"
         "  -C, --set-conf=PARM=VAL       set config parameters\n"
+        "  -i, --interval=MS             poll interval when polling [default=400]\n"
+        "  -N, --poll                    poll even if the rig can send events\n"
         "  -L, --show-conf               list all config parameters\n"
         "  -l, --list                    list all model numbers and exit\n"
         "  -u, --dump-caps               dump capabilities and exit\n"
@@ -0,0 +1,244 @@
+/*
+ * rigmemsize.c - per instance memory footprint of each backend
+ *
+ * Where dumpmem dumps the memory channels of a rig, this dumps the memory
+ * a RIG handle costs the host: the size of the handle and its largest
+ * embedded members, then for each model the heap taken by rig_init() of
+ * the first instance and of each further instance of the same model, so
+ * what is shared between instances shows up as the difference.
+ *
+ * Usage:
+ *   rigmemsize                 every model, 8 instances each
+ *   rigmemsize -n 32 1 3073    32 instances of the dummy and the IC-7300
+ *   rigmemsize -o 1            ... and rig_open them (dummy, netrigctl)
+ *
+ * With -o the threads column counts the threads each open instance adds.
+ * Heap figures need glibc's mallinfo2(), otherwise only sizes are shown.
+ *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <getopt.h>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_HEAP_STATS 1
+#endif
+
+#include <hamlib/rig.h>
+
+#define MAX_INSTANCES 256
+
+#define MEMBER(m) { #m, offsetof(struct rig_state, m), sizeof(((struct rig_state *)0)->m) }
+
+static const struct
+{
+    const char *name;
+    size_t offset;
+    size_t size;
+} members[] =
+{
+    MEMBER(rigport),
+    MEMBER(pttport),
+    MEMBER(dcdport),
+    MEMBER(rigport_deprecated),
+    MEMBER(rx_range_list),
+    MEMBER(tx_range_list),
+    MEMBER(tuning_steps),
+    MEMBER(filters),
+    MEMBER(chan_list),
+    MEMBER(level_gran),
+    MEMBER(parm_gran),
+    MEMBER(cache),
+    MEMBER(spectrum_scopes),
+    MEMBER(spectrum_spans),
+    MEMBER(spectrum_avg_modes),
+};
+
+static int instances = 8;
+static int do_open;
+static int models_done;
+
+
+static long heap_used(void)
+{
+#ifdef HAVE_HEAP_STATS
+    return (long) mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+
+static int thread_count(void)
+{
+    FILE *fp = fopen("/proc/self/status", "r");
+    char line[128];
+    int n = 0;
+
+    if (fp == NULL) { return 0; }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (sscanf(line, "Threads: %d", &n) == 1) { break; }
+    }
+
+    fclose(fp);
+
+    return n;
+}
+
+
+static void dump_model(rig_model_t model)
+{
+    RIG *rigs[MAX_INSTANCES];
+    const struct rig_caps *caps = rig_get_caps(model);
+    long heap0, heap1 = 0, heapn;
+    int threads0, threads, i, n = 0;
+
+    if (caps == NULL)
+    {
+        fprintf(stderr, "Unknown rig num: %u\n", model);
+        return;
+    }
+
+    threads0 = thread_count();
+    heap0 = heap_used();
+
+    for (i = 0; i < instances; i++)
+    {
+        rigs[n] = rig_init(model);
+
+        if (rigs[n] == NULL) { break; }
+
+        if (do_open && rig_open(rigs[n]) != RIG_OK)
+        {
+            rig_cleanup(rigs[n]);
+            break;
+        }
+
+        if (++n == 1) { heap1 = heap_used(); }
+    }
+
+    heapn = heap_used();
+    threads = thread_count() - threads0;
+
+    if (n == 0)
+    {
+        printf("%8u  %-24.24s  %s\n", model, caps->model_name,
+               do_open ? "open failed" : "init failed");
+        return;
+    }
+
+#ifdef HAVE_HEAP_STATS
+    printf("%8u  %-24.24s  %10ld  %10ld", model, caps->model_name,
+           heap1 - heap0, n > 1 ? (heapn - heap1) / (n - 1) : 0);
+#else
+    printf("%8u  %-24.24s  %10s  %10s", model, caps->model_name, "-", "-");
+#endif
+
+    if (do_open) { printf("  %7.1f", (double) threads / n); }
+
+    printf("\n");
+
+    for (i = 0; i < n; i++)
+    {
+        if (do_open) { rig_close(rigs[i]); }
+
+        rig_cleanup(rigs[i]);
+    }
+
+    models_done++;
+}
+
+
+static int dump_model_cb(const struct rig_caps *caps, rig_ptr_t data)
+{
+    dump_model(caps->rig_model);
+
+    return 1;
+}
+
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-n instances] [-o] [model...]\n", name);
+    exit(1);
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t i;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:oh")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            instances = atoi(optarg);
+
+            if (instances < 1 || instances > MAX_INSTANCES) { usage(argv[0]); }
+
+            break;
+
+        case 'o':
+            do_open = 1;
+            break;
+
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    rig_set_debug(RIG_DEBUG_NONE);
+    rig_load_all_backends();
+
+    printf("sizeof(RIG)              %6zu\n", sizeof(RIG));
+    printf("sizeof(struct rig_state) %6zu\n", sizeof(struct rig_state));
+    printf("sizeof(struct rig_caps)  %6zu\n", sizeof(struct rig_caps));
+    printf("sizeof(hamlib_port_t)    %6zu\n\n", sizeof(hamlib_port_t));
+
+    printf("largest rig_state members:\n");
+
+    for (i = 0; i < sizeof(members) / sizeof(members[0]); i++)
+    {
+        printf("  %-24s %6zu at %6zu\n", members[i].name, members[i].size,
+               members[i].offset);
+    }
+
+    printf("\n   model  %-24s  %10s  %10s%s\n", "name", "heap first",
+           "heap each", do_open ? "  threads" : "");
+
+    if (optind < argc)
+    {
+        for (; optind < argc; optind++) { dump_model(atoi(argv[optind])); }
+    }
+    else
+    {
+        rig_list_foreach(dump_model_cb, NULL);
+    }
+
+    return models_done ? 0 : 2;
+}
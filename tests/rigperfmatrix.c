@@ -0,0 +1,480 @@
+/*
+ * rigperfmatrix.c - backend transaction throughput matrix
+ *
+ * Companion to rigmatrix: instead of listing caps this runs each backend
+ * through a fixed workload against a simulator or a port_replay trace
+ * and reports how long it took and how much it talked to the rig:
+ *
+ *   open                      time to rig_open
+ *   read   freq/mode/ptt/split  4 operations
+ *   set    freq x 100         100 operations
+ *   levels up to 10 readable levels
+ *   scan   rig_sw_scan over 20 channels, no dwell
+ *
+ * For each phase the matrix shows transactions (port writes) per
+ * operation, bytes per operation (both directions) and operations per
+ * second, which for the scan phase is channels per second.  The cache is
+ * disabled so every operation reaches the backend.
+ *
+ * Usage:
+ *   rigperfmatrix -S ../simulators/simrig       every model simrig knows
+ *   rigperfmatrix -R traces -S ../simulators/simrig  ... and keep traces
+ *   rigperfmatrix 2014=/dev/pts/3 3073=replay:traces/3073.hlrc
+ *
+ * A replayed trace only lines up with the workload it was recorded with,
+ * so record traces for this tool with -R.
+ *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "portrec.h"
+
+#define SET_FREQ_COUNT 100
+#define MAX_LEVELS 10
+#define SCAN_CHANNELS 20
+
+enum phase { PH_OPEN, PH_READ, PH_SET, PH_LEVELS, PH_SCAN, PH_COUNT };
+
+static const char *phase_names[PH_COUNT] = { "open", "read", "set", "levels", "scan" };
+
+struct phase_result
+{
+    int ops;
+    double secs;
+    struct portrec_counts counts;
+};
+
+struct model_result
+{
+    rig_model_t model;
+    const char *name;
+    int errors;
+    struct phase_result ph[PH_COUNT];
+};
+
+static int csv;
+static const char *record_dir;
+
+
+static double now_secs(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+static void phase_end(RIG *rig, struct phase_result *ph, double start,
+                      struct portrec_counts *prev)
+{
+    struct portrec_counts now;
+
+    ph->secs = now_secs() - start;
+    portrec_get_counts(&rig->state.rigport, &now);
+    ph->counts.writes = now.writes - prev->writes;
+    ph->counts.write_bytes = now.write_bytes - prev->write_bytes;
+    ph->counts.reads = now.reads - prev->reads;
+    ph->counts.read_bytes = now.read_bytes - prev->read_bytes;
+    *prev = now;
+}
+
+
+static int run_workload(rig_model_t model, const char *port,
+                        struct model_result *res)
+{
+    struct portrec_counts prev = { 0 };
+    struct phase_result *ph;
+    RIG *rig;
+    double start;
+    int i, n;
+
+    memset(res, 0, sizeof(*res));
+    res->model = model;
+
+    rig = rig_init(model);
+
+    if (rig == NULL)
+    {
+        fprintf(stderr, "%u: unknown model\n", (unsigned)model);
+        return -RIG_EINVAL;
+    }
+
+    res->name = rig->caps->model_name;
+
+    if (strncmp(port, "replay:", 7) == 0)
+    {
+        rig_set_conf(rig, rig_token_lookup(rig, "port_replay"), port + 7);
+        rig_set_conf(rig, rig_token_lookup(rig, "replay_scale"), "1");
+    }
+    else
+    {
+        strncpy(rig->state.rigport.pathname, port, HAMLIB_FILPATHLEN - 1);
+    }
+
+    if (record_dir)
+    {
+        char path[HAMLIB_FILPATHLEN];
+
+        snprintf(path, sizeof(path), "%s/%u.hlrc", record_dir, (unsigned)model);
+        rig_set_conf(rig, rig_token_lookup(rig, "port_record"), path);
+    }
+
+    /* no polling and no cache, every call has to reach the backend */
+    rig_set_conf(rig, rig_token_lookup(rig, "poll_interval"), "0");
+    rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_ALL, 0);
+
+    portrec_count_start(&rig->state.rigport);
+
+    ph = &res->ph[PH_OPEN];
+    start = now_secs();
+
+    if (rig_open(rig) != RIG_OK)
+    {
+        fprintf(stderr, "%u: rig_open on %s failed\n", (unsigned)model, port);
+        rig_cleanup(rig);
+        return -RIG_EIO;
+    }
+
+    ph->ops = 1;
+    phase_end(rig, ph, start, &prev);
+
+    ph = &res->ph[PH_READ];
+    start = now_secs();
+    {
+        freq_t freq;
+        rmode_t mode;
+        pbwidth_t width;
+        ptt_t ptt;
+        split_t split;
+        vfo_t tx_vfo;
+
+        res->errors += rig_get_freq(rig, RIG_VFO_CURR, &freq) != RIG_OK;
+        res->errors += rig_get_mode(rig, RIG_VFO_CURR, &mode, &width) != RIG_OK;
+        res->errors += rig_get_ptt(rig, RIG_VFO_CURR, &ptt) != RIG_OK;
+        res->errors += rig_get_split_vfo(rig, RIG_VFO_CURR, &split, &tx_vfo)
+                       != RIG_OK;
+        ph->ops = 4;
+    }
+    phase_end(rig, ph, start, &prev);
+
+    ph = &res->ph[PH_SET];
+    start = now_secs();
+
+    for (i = 0; i < SET_FREQ_COUNT; i++)
+    {
+        res->errors += rig_set_freq(rig, RIG_VFO_CURR, 14074000 + i * 10)
+                       != RIG_OK;
+    }
+
+    ph->ops = SET_FREQ_COUNT;
+    phase_end(rig, ph, start, &prev);
+
+    ph = &res->ph[PH_LEVELS];
+    start = now_secs();
+
+    for (i = 0, n = 0; i < RIG_SETTING_MAX && n < MAX_LEVELS; i++)
+    {
+        setting_t level = rig_idx2setting(i);
+        value_t val;
+
+        if (!rig_has_get_level(rig, level)) { continue; }
+
+        res->errors += rig_get_level(rig, RIG_VFO_CURR, level, &val) != RIG_OK;
+        n++;
+    }
+
+    ph->ops = n;
+    phase_end(rig, ph, start, &prev);
+
+    ph = &res->ph[PH_SCAN];
+    start = now_secs();
+    {
+        struct rig_sw_scan scan;
+        struct rig_sw_scan_stats stats;
+
+        memset(&scan, 0, sizeof(scan));
+        scan.start = 14100000;
+        scan.stop = 14100000 + (SCAN_CHANNELS - 1) * 1000;
+        scan.step = 1000;
+        scan.signal = rig_has_get_level(rig, RIG_LEVEL_STRENGTH) ?
+                      RIG_SW_SCAN_STRENGTH : RIG_SW_SCAN_DCD;
+        scan.threshold = 100;   /* nothing is that loud, never stop */
+        scan.passes = 1;
+
+        if (rig_sw_scan(rig, RIG_VFO_CURR, &scan, NULL, NULL, &stats) != RIG_OK)
+        {
+            res->errors++;
+        }
+
+        ph->ops = stats.channels;
+    }
+    phase_end(rig, ph, start, &prev);
+
+    rig_close(rig);
+    rig_cleanup(rig);
+
+    return RIG_OK;
+}
+
+
+static void print_header(void)
+{
+    int p;
+
+    if (csv)
+    {
+        printf("model,name,open_ms,open_tx");
+
+        for (p = PH_READ; p < PH_COUNT; p++)
+        {
+            printf(",%s_tx_per_op,%s_bytes_per_op,%s_ops_per_sec",
+                   phase_names[p], phase_names[p], phase_names[p]);
+        }
+
+        printf(",errors\n");
+        return;
+    }
+
+    printf("%-6s %-16s %8s %5s", "Model", "Name", "Open ms", "tx");
+
+    for (p = PH_READ; p < PH_COUNT; p++)
+    {
+        printf(" | %-6s %5s %6s %8s", phase_names[p], "tx/op", "B/op", "op/s");
+    }
+
+    printf(" | %s\n", "Err");
+    /* before fork() in start_sim() copies the buffer */
+    fflush(stdout);
+}
+
+
+static void print_result(const struct model_result *res)
+{
+    int p;
+
+    printf(csv ? "%u,%s,%.1f,%lu" : "%-6u %-16.16s %8.1f %5lu",
+           (unsigned)res->model, res->name, res->ph[PH_OPEN].secs * 1000,
+           res->ph[PH_OPEN].counts.writes);
+
+    for (p = PH_READ; p < PH_COUNT; p++)
+    {
+        const struct phase_result *ph = &res->ph[p];
+        double ops = ph->ops ? ph->ops : 1;
+        double bytes = ph->counts.write_bytes + ph->counts.read_bytes;
+
+        printf(csv ? ",%.2f,%.1f,%.1f" : " |        %5.2f %6.1f %8.1f",
+               ph->counts.writes / ops, bytes / ops,
+               ph->secs > 0 ? ph->ops / ph->secs : 0.0);
+    }
+
+    printf(csv ? ",%d\n" : " | %d\n", res->errors);
+    fflush(stdout);
+}
+
+
+/* start "simrig -m name -l link" and wait for the link to appear */
+static pid_t start_sim(const char *simrig, const char *name, const char *link)
+{
+    pid_t pid = fork();
+    int i;
+
+    if (pid == 0)
+    {
+        if (!freopen("/dev/null", "w", stdout)
+                || !freopen("/dev/null", "w", stderr))
+        {
+            _exit(127);
+        }
+
+        execl(simrig, simrig, "-m", name, "-l", link, (char *)NULL);
+        _exit(127);
+    }
+
+    for (i = 0; pid > 0 && i < 200; i++)
+    {
+        if (access(link, F_OK) == 0) { return pid; }
+
+        hl_usleep(10 * 1000);
+    }
+
+    if (pid > 0)
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+
+    return -1;
+}
+
+
+static int run_simrig(const char *simrig)
+{
+    char cmd[HAMLIB_FILPATHLEN + 8];
+    char line[128];
+    FILE *fp;
+
+    snprintf(cmd, sizeof(cmd), "%s -L", simrig);
+    fp = popen(cmd, "r");
+
+    if (fp == NULL)
+    {
+        perror(simrig);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        struct model_result res;
+        char name[32], link[64];
+        unsigned model;
+        pid_t pid;
+
+        if (sscanf(line, "%31s %u", name, &model) != 2) { continue; }
+
+        snprintf(link, sizeof(link), "/tmp/rigperfmatrix.%d.%s", (int)getpid(),
+                 name);
+        pid = start_sim(simrig, name, link);
+
+        if (pid < 0)
+        {
+            fprintf(stderr, "%s: could not start simulator for %s\n", simrig, name);
+            continue;
+        }
+
+        if (run_workload(model, link, &res) == RIG_OK)
+        {
+            print_result(&res);
+        }
+
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+
+    pclose(fp);
+
+    return 0;
+}
+
+
+static void usage(void)
+{
+    printf("Usage: rigperfmatrix [-c] [-v] [-R dir] -S simrig\n"
+           "       rigperfmatrix [-c] [-v] [-R dir] model=device|model=replay:file ...\n\n"
+           "  -S, --simrig=PATH   run every model the simrig simulator knows\n"
+           "  -R, --record=DIR    save each session as DIR/<model>.hlrc for replay\n"
+           "  -c, --csv           comma separated output\n"
+           "  -v, --verbose       increase the hamlib debug level\n"
+           "  -h, --help          display this help and exit\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    static const struct option long_options[] =
+    {
+        {"simrig",  1, 0, 'S'},
+        {"record",  1, 0, 'R'},
+        {"csv",     0, 0, 'c'},
+        {"verbose", 0, 0, 'v'},
+        {"help",    0, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    const char *simrig = NULL;
+    int verbose = RIG_DEBUG_NONE;
+    int c, i;
+
+    while ((c = getopt_long(argc, argv, "S:R:cvh", long_options, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case 'S':
+            simrig = optarg;
+            break;
+
+        case 'R':
+            record_dir = optarg;
+            break;
+
+        case 'c':
+            csv = 1;
+            break;
+
+        case 'v':
+            verbose++;
+            break;
+
+        case 'h':
+            usage();
+            return 0;
+
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    if (simrig == NULL && optind >= argc)
+    {
+        usage();
+        return 1;
+    }
+
+    rig_set_debug(verbose);
+    rig_load_all_backends();
+
+    print_header();
+
+    if (simrig)
+    {
+        return run_simrig(simrig);
+    }
+
+    for (i = optind; i < argc; i++)
+    {
+        struct model_result res;
+        char *eq = strchr(argv[i], '=');
+
+        if (eq == NULL)
+        {
+            fprintf(stderr, "%s: expected model=device\n", argv[i]);
+            continue;
+        }
+
+        if (run_workload(atoi(argv[i]), eq + 1, &res) == RIG_OK)
+        {
+            print_result(&res);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*  Checks rig_submit() and friends against the dummy rig
+ *  To run:
+ *      ./testasync
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <hamlib/rig.h>
+#include <hamlib/riglist.h>
+
+static int callbacks;
+static int cancelled;
+static freq_t cb_freq;
+
+
+static int slow_op(RIG *rig, rig_ptr_t arg)
+{
+    usleep(200 * 1000);
+    return RIG_OK;
+}
+
+
+static int done_cb(RIG *rig, const struct rig_async_op *op, rig_ptr_t arg)
+{
+    callbacks++;
+
+    if (op->retcode == -RIG_ECANCELED) { cancelled++; }
+
+    if (op->op == RIG_ASYNC_GET_FREQ && op->retcode == RIG_OK)
+    {
+        cb_freq = op->freq;
+    }
+
+    return 0;
+}
+
+
+/* reap until n completions arrived or a second passed */
+static int reap(RIG *rig, struct rig_async_op *done, int n)
+{
+    struct pollfd pfd;
+    int got = 0;
+
+    pfd.fd = rig_async_fd(rig);
+    pfd.events = POLLIN;
+
+    while (got < n && poll(&pfd, 1, 1000) > 0)
+    {
+        got += rig_async_reap(rig, done + got, n - got);
+    }
+
+    return got;
+}
+
+
+// callback completions, in order
+static int test1(RIG *rig)
+{
+    struct rig_async_op op;
+    int i;
+
+    memset(&op, 0, sizeof(op));
+    op.op = RIG_ASYNC_SET_FREQ;
+    op.vfo = RIG_VFO_A;
+    op.freq = 14074000;
+
+    if (rig_submit(rig, &op, done_cb, NULL) <= 0) { printf("Test#1a Failed\n"); return 1; }
+
+    op.op = RIG_ASYNC_GET_FREQ;
+    op.freq = 0;
+
+    if (rig_submit(rig, &op, done_cb, NULL) <= 0) { printf("Test#1b Failed\n"); return 1; }
+
+    for (i = 0; i < 100 && callbacks < 2; i++) { usleep(10 * 1000); }
+
+    if (callbacks == 2 && cb_freq == 14074000) { printf("Test#1 OK\n"); }
+    else {printf("Test#1 Failed callbacks=%d freq=%.0f\n", callbacks, cb_freq); return 1;}
+
+    return 0;
+}
+
+
+// fd completions, superseded reads and cancel
+static int test2(RIG *rig)
+{
+    struct rig_async_op op, done[8];
+    long ids[4];
+    int i, n, ok = 0, stale = 0;
+
+    memset(&op, 0, sizeof(op));
+    op.op = RIG_ASYNC_CALL;
+    op.fn = slow_op;
+    ids[0] = rig_submit(rig, &op, NULL, NULL);
+
+    memset(&op, 0, sizeof(op));
+    op.op = RIG_ASYNC_GET_FREQ;
+    op.vfo = RIG_VFO_A;
+    op.flags = RIG_ASYNC_SUPERSEDE;
+
+    for (i = 1; i < 4; i++) { ids[i] = rig_submit(rig, &op, NULL, NULL); }
+
+    if (rig_async_cancel(rig, ids[3]) != RIG_OK) { printf("Test#2a Failed\n"); return 1; }
+
+    n = reap(rig, done, 4);
+
+    for (i = 0; i < n; i++)
+    {
+        if (done[i].retcode == RIG_OK && done[i].id == ids[0]) { ok++; }
+        else if (done[i].retcode == -RIG_ECANCELED) { stale++; }
+    }
+
+    if (n == 4 && ok == 1 && stale == 3) { printf("Test#2 OK\n"); }
+    else {printf("Test#2 Failed n=%d ok=%d cancelled=%d\n", n, ok, stale); return 1;}
+
+    return 0;
+}
+
+
+static int resubmitted;
+
+
+/* a superseded read asks again, from inside rig_submit() */
+static int resubmit_cb(RIG *rig, const struct rig_async_op *op, rig_ptr_t arg)
+{
+    callbacks++;
+
+    if (op->retcode == -RIG_ECANCELED)
+    {
+        struct rig_async_op again = *op;
+
+        /* not the same value, or the next supersede would take it too */
+        again.op = RIG_ASYNC_GET_MODE;
+        again.flags = 0;
+
+        if (rig_submit(rig, &again, done_cb, NULL) > 0) { resubmitted++; }
+    }
+
+    return 0;
+}
+
+
+// cancelled callbacks may submit
+static int test3(RIG *rig)
+{
+    struct rig_async_op op;
+    int i;
+
+    callbacks = cancelled = 0;
+
+    memset(&op, 0, sizeof(op));
+    op.op = RIG_ASYNC_CALL;
+    op.fn = slow_op;
+    rig_submit(rig, &op, NULL, NULL);
+
+    memset(&op, 0, sizeof(op));
+    op.op = RIG_ASYNC_GET_FREQ;
+    op.vfo = RIG_VFO_A;
+    op.flags = RIG_ASYNC_SUPERSEDE;
+
+    for (i = 0; i < 4; i++) { rig_submit(rig, &op, resubmit_cb, NULL); }
+
+    for (i = 0; i < 100 && callbacks < 7; i++) { usleep(10 * 1000); }
+
+    /* 3 superseded, each submitting a mode read, the last freq read and those 3 */
+    if (callbacks == 7 && resubmitted == 3 && cancelled == 0) { printf("Test#3 OK\n"); }
+    else {printf("Test#3 Failed callbacks=%d resubmitted=%d\n", callbacks, resubmitted); return 1;}
+
+    return 0;
+}
+
+
+// rig_close cancels what is still queued
+static int test4(RIG *rig)
+{
+    struct rig_async_op op;
+
+    callbacks = cancelled = 0;
+
+    memset(&op, 0, sizeof(op));
+    op.op = RIG_ASYNC_CALL;
+    op.fn = slow_op;
+    rig_submit(rig, &op, done_cb, NULL);
+    usleep(50 * 1000);
+
+    op.op = RIG_ASYNC_GET_FREQ;
+    op.vfo = RIG_VFO_A;
+    rig_submit(rig, &op, done_cb, NULL);
+
+    rig_close(rig);
+
+    if (callbacks == 2 && cancelled == 1) { printf("Test#4 OK\n"); }
+    else {printf("Test#4 Failed callbacks=%d cancelled=%d\n", callbacks, cancelled); return 1;}
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    int retcode;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+    rig = rig_init(RIG_MODEL_DUMMY);
+
+    if (rig == NULL || (retcode = rig_open(rig)) != RIG_OK)
+    {
+        printf("rig_open failed\n");
+        return 1;
+    }
+
+    if (test1(rig)) { return 1; }
+
+    if (test2(rig)) { return 1; }
+
+    if (test3(rig)) { return 1; }
+
+    if (test4(rig)) { return 1; }
+
+    rig_cleanup(rig);
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*  Records a port session against a fake rig on a pty and replays it
+ *  To run:
+ *      ./testportrec
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <hamlib/rig.h>
+#include <hamlib/riglist.h>
+#include "iofunc.h"
+#include "portrec.h"
+
+static const char *session[][2] =
+{
+    { "ID;", "ID019;" },
+    { "FA;", "FA00014074000;" },
+    { "MD;", "MD2;" },
+    { NULL, NULL }
+};
+
+
+static void port_setup(hamlib_port_t *port, const char *pathname)
+{
+    memset(port, 0, sizeof(*port));
+    port->type.rig = RIG_PORT_SERIAL;
+    strncpy(port->pathname, pathname, HAMLIB_FILPATHLEN - 1);
+    port->parm.serial.rate = 9600;
+    port->parm.serial.data_bits = 8;
+    port->parm.serial.stop_bits = 1;
+    port->parm.serial.parity = RIG_PARITY_NONE;
+    port->parm.serial.handshake = RIG_HANDSHAKE_NONE;
+    port->timeout = 200;
+}
+
+
+static int transact(hamlib_port_t *port, int master, const char *cmd,
+                    char *reply, size_t len)
+{
+    int ret;
+
+    write_block(port, (const unsigned char *)cmd, strlen(cmd));
+
+    /* the fake rig, only while recording */
+    if (master >= 0)
+    {
+        char buf[64];
+        int i;
+
+        if (read(master, buf, sizeof(buf)) <= 0) { return -RIG_EIO; }
+
+        for (i = 0; session[i][0] && strcmp(session[i][0], cmd); i++) { }
+
+        if (session[i][0]
+                && write(master, session[i][1], strlen(session[i][1])) < 0)
+        {
+            return -RIG_EIO;
+        }
+    }
+
+    ret = read_string(port, (unsigned char *)reply, len, ";", 1, 0, 1);
+
+    if (ret > 0) { reply[ret] = '\0'; }
+
+    return ret;
+}
+
+
+// record against the pty
+static int test1(const char *file)
+{
+    hamlib_port_t port;
+    char reply[64];
+    int master, i;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (master < 0 || grantpt(master) || unlockpt(master))
+    {
+        printf("Test#1 Failed, no pty\n");
+        return 1;
+    }
+
+    port_setup(&port, ptsname(master));
+
+    if (port_open(&port) < 0) { printf("Test#1 Failed, port_open\n"); return 1; }
+
+    portrec_record_start(&port, file, RIG_MODEL_TS2000);
+
+    for (i = 0; session[i][0]; i++)
+    {
+        if (transact(&port, master, session[i][0], reply, sizeof(reply)) <= 0
+                || strcmp(reply, session[i][1]))
+        {
+            printf("Test#1 Failed %s\n", session[i][0]);
+            return 1;
+        }
+    }
+
+    port_close(&port, port.type.rig);
+    close(master);
+    printf("Test#1 OK\n");
+
+    return 0;
+}
+
+
+// replay without the pty, plus a command never recorded
+static int test2(const char *file)
+{
+    hamlib_port_t port;
+    char reply[64];
+    int i;
+
+    port_setup(&port, "/nonexistent");
+
+    if (portrec_replay_open(&port, file, RIG_MODEL_TS2000, 0) != RIG_OK
+            || port_open(&port) < 0)
+    {
+        printf("Test#2 Failed, replay open\n");
+        return 1;
+    }
+
+    for (i = 0; session[i][0]; i++)
+    {
+        if (transact(&port, -1, session[i][0], reply, sizeof(reply)) <= 0
+                || strcmp(reply, session[i][1]))
+        {
+            printf("Test#2 Failed %s\n", session[i][0]);
+            return 1;
+        }
+    }
+
+    if (transact(&port, -1, "PS;", reply, sizeof(reply)) > 0)
+    {
+        printf("Test#2 Failed, PS; was answered\n");
+        return 1;
+    }
+
+    port_close(&port, port.type.rig);
+    printf("Test#2 OK\n");
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    char file[] = "/tmp/testportrecXXXXXX";
+    int fd, retcode;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    fd = mkstemp(file);
+
+    if (fd < 0) { printf("mkstemp failed\n"); return 1; }
+
+    close(fd);
+
+    retcode = test1(file) || test2(file);
+
+    unlink(file);
+
+    return retcode;
+}
@@ -0,0 +1,120 @@
+/*  Checks split TX changes and rig_set_vfo_settings() against the dummy rig
+ *  To run:
+ *      ./testvfoplan
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <hamlib/rig.h>
+#include <hamlib/riglist.h>
+
+
+static freq_t vfo_freq(RIG *rig, vfo_t vfo)
+{
+    freq_t freq = 0;
+
+    rig->caps->get_freq(rig, vfo, &freq);
+    return freq;
+}
+
+
+// split off: turned on, TX VFO tuned, RX VFO left alone
+static int test1(RIG *rig)
+{
+    split_t split = RIG_SPLIT_OFF;
+    vfo_t tx_vfo;
+
+    rig_set_split_freq_mode(rig, RIG_VFO_CURR, 14080000, RIG_MODE_USB, 2400);
+    rig_get_split_vfo(rig, RIG_VFO_CURR, &split, &tx_vfo);
+
+    if (split == RIG_SPLIT_ON && vfo_freq(rig, RIG_VFO_A) == 14074000
+            && vfo_freq(rig, RIG_VFO_B) == 14080000) { printf("Test#1 OK\n"); }
+    else {printf("Test#1 Failed split=%d A=%.0f B=%.0f\n", split, vfo_freq(rig, RIG_VFO_A), vfo_freq(rig, RIG_VFO_B)); return 1;}
+
+    return 0;
+}
+
+
+// split on: the TX VFO again
+static int test2(RIG *rig)
+{
+    rig_set_split_freq_mode(rig, RIG_VFO_CURR, 14090000, RIG_MODE_CW, 500);
+
+    if (vfo_freq(rig, RIG_VFO_A) == 14074000
+            && vfo_freq(rig, RIG_VFO_B) == 14090000) { printf("Test#2 OK\n"); }
+    else {printf("Test#2 Failed A=%.0f B=%.0f\n", vfo_freq(rig, RIG_VFO_A), vfo_freq(rig, RIG_VFO_B)); return 1;}
+
+    return 0;
+}
+
+
+// split off again: RIG_VFO_TX still means the TX VFO, not the RX one
+static int test3(RIG *rig)
+{
+    rig_vfo_setting_t tx = { RIG_VFO_TX, 14095000, RIG_MODE_NONE, 0 };
+
+    rig_set_split_vfo(rig, RIG_VFO_A, RIG_SPLIT_OFF, RIG_VFO_B);
+    rig_set_vfo_settings(rig, &tx, 1);
+
+    if (vfo_freq(rig, RIG_VFO_A) == 14074000
+            && vfo_freq(rig, RIG_VFO_B) == 14095000) { printf("Test#3 OK\n"); }
+    else {printf("Test#3 Failed A=%.0f B=%.0f\n", vfo_freq(rig, RIG_VFO_A), vfo_freq(rig, RIG_VFO_B)); return 1;}
+
+    return 0;
+}
+
+
+// no targetable VFOs: one swap out, one back, and current_vfo follows
+static int test4(RIG *rig)
+{
+    rig_vfo_setting_t b = { RIG_VFO_B, 7074000, RIG_MODE_USB, 2400 };
+    struct rig_vfo_plan_stats before, after;
+    int targetable = rig->caps->targetable_vfo;
+
+    rig->caps->targetable_vfo &= ~(RIG_TARGETABLE_FREQ | RIG_TARGETABLE_MODE);
+    rig_get_vfo_plan_stats(rig, &before);
+    rig_set_vfo_settings(rig, &b, 1);
+    rig_get_vfo_plan_stats(rig, &after);
+    rig->caps->targetable_vfo = targetable;
+
+    if (vfo_freq(rig, RIG_VFO_B) == 7074000 && vfo_freq(rig, RIG_VFO_A) == 14074000
+            && rig->state.current_vfo == RIG_VFO_A
+            && after.vfo_swaps - before.vfo_swaps == 2) { printf("Test#4 OK\n"); }
+    else {printf("Test#4 Failed B=%.0f vfo=%s swaps=%lu\n", vfo_freq(rig, RIG_VFO_B), rig_strvfo(rig->state.current_vfo), after.vfo_swaps - before.vfo_swaps); return 1;}
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    int retcode;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+    rig = rig_init(RIG_MODEL_DUMMY);
+
+    if (rig == NULL || (retcode = rig_open(rig)) != RIG_OK)
+    {
+        printf("rig_open failed\n");
+        return 1;
+    }
+
+    rig_set_vfo(rig, RIG_VFO_A);
+    rig_set_freq(rig, RIG_VFO_A, 14074000);
+    rig_set_freq(rig, RIG_VFO_B, 14074000);
+    rig_set_split_vfo(rig, RIG_VFO_A, RIG_SPLIT_OFF, RIG_VFO_A);
+
+    if (test1(rig)) { return 1; }
+
+    if (test2(rig)) { return 1; }
+
+    if (test3(rig)) { return 1; }
+
+    if (test4(rig)) { return 1; }
+
+    rig_close(rig);
+    rig_cleanup(rig);
+
+    return 0;
+}